@@ -0,0 +1,69 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_HIL_HPP_
+#define _PAL_HIL_HPP_
+
+#include "kernel.hpp"
+#include "replay.hpp"
+
+#include <initializer_list>
+#include <string>
+
+/* Mocked PROS API for running the robot code on the host
+ * The RTOS calls go to SimKernel, and the device getters read the channels of a
+ * recorded log at the simulated time. Paths under /usd/ are opened in a host
+ * directory instead, so the logger writes its files there, and /ser/ streams and
+ * serial smart ports go to the files or ttys given
+ */
+namespace pal
+{
+
+/* Feed the mock from a log (nullptr for none), and put the uSD card in a host
+ * directory (empty for no card)
+ */
+void hil_attach(LogReplay * replay, const std::string& usd_dir);
+
+/* Send the serial streams the robot code opens (/ser/...) to a file or tty, such as
+ * the robot side of a pty, or nowhere for an empty path. Throws std::runtime_error
+ * if it can't be opened
+ */
+void hil_serial(const std::string& path);
+
+/* Send what the robot code writes to a smart port in generic serial mode to a
+ * file or tty. The port takes bytes only as fast as its baud rate carries them in
+ * simulated time. Throws std::runtime_error if the port or path is bad
+ */
+void hil_port(unsigned port, const std::string& path);
+
+/* The log being replayed, or nullptr */
+LogReplay * hil_replay();
+
+/* Value of a channel of the device on a port at the simulated time
+ * Returns false, setting errno to ENODEV, if the log has no such channel
+ */
+bool hil_read(const char * prefix, unsigned port, const char * field, double& value);
+
+/* Make each read of a device take us of simulated time, holding the CPU as a slow
+ * read would. Reads take no time unless this is set
+ */
+void hil_read_cost(uint64_t us);
+
+/* A channel the robot code logs itself, under one of the names it has had, with
+ * the factor from the units it was logged in to those of the API
+ */
+struct HilChannel
+{
+    const char * name;
+    double scale;
+};
+
+/* Value of the first channel the log has at the simulated time, or def without any */
+double hil_read(std::initializer_list<HilChannel> names, double def);
+
+} /* namespace pal */
+
+#endif /* _PAL_HIL_HPP_ */
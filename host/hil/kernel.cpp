@@ -0,0 +1,322 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "kernel.hpp"
+
+#include <thread>
+
+namespace pal
+{
+
+/* Wait time of a task blocked with no timeout */
+#define KERNEL_FOREVER UINT64_MAX
+
+struct SimKernel::Task
+{
+    enum State
+    {
+        READY,      /* Can run at wake */
+        BLOCKED,    /* Waiting on a mutex or a notification, until wake at the latest */
+        DEAD
+    };
+
+    TaskFn fn;
+    void * arg;
+    uint32_t prio;
+    std::string name;
+    State state = READY;
+    uint64_t wake = 0;
+    uint64_t order = 0;         /* When it became ready, to break ties */
+    Mutex * waiting = nullptr;
+    uint32_t notified = 0;
+    bool notify_wait = false;
+    bool killed = false;
+    std::condition_variable cv;
+};
+
+struct SimKernel::Mutex
+{
+    Task * owner = nullptr;
+};
+
+/* Thrown in a deleted task to unwind it */
+struct TaskKilled
+{
+};
+
+SimKernel& SimKernel::get()
+{
+    /* Never destroyed, since task threads may still be parked on it at exit */
+    static SimKernel * k = new SimKernel;
+    return *k;
+}
+
+SimKernel::Task * SimKernel::spawn(TaskFn fn, void * arg, uint32_t prio, const char * name)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    Task * t = new Task;
+    t->fn = fn;
+    t->arg = arg;
+    t->prio = prio;
+    t->name = name ? name : "";
+    wake(t,now);
+    tasks.push_back(t);
+    std::thread(entry,t).detach();
+    return t;
+}
+
+void SimKernel::kill(Task * t)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    if(!t || t->state == Task::DEAD) return;
+    if(t == cur)
+    {
+        lk.unlock();
+        throw TaskKilled();
+    }
+    t->killed = true;
+    t->waiting = nullptr;
+    wake(t,now);
+}
+
+const char * SimKernel::name(const Task * t) const
+{
+    return t ? t->name.c_str() : "";
+}
+
+uint32_t SimKernel::priority(const Task * t) const
+{
+    return t ? t->prio : 0;
+}
+
+void SimKernel::set_priority(Task * t, uint32_t prio)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    if(t) t->prio = prio;
+}
+
+void SimKernel::delay_until(uint64_t t_us)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    Task * self = cur;
+    if(!self) return;
+    wake(self,t_us > now ? t_us : now);
+    switch_out(lk,self);
+}
+
+void SimKernel::spend(uint64_t us)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    if(cur) advance(now + us);
+}
+
+SimKernel::Mutex * SimKernel::mutex_create()
+{
+    return new Mutex;
+}
+
+void SimKernel::mutex_delete(Mutex * m)
+{
+    delete m;
+}
+
+bool SimKernel::mutex_take(Mutex * m, uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    Task * self = cur;
+    if(!m) return false;
+    if(!m->owner)
+    {
+        m->owner = self;
+        return true;
+    }
+    if(!timeout_ms || !self) return false;
+
+    self->state = Task::BLOCKED;
+    self->waiting = m;
+    self->wake = (timeout_ms == 0xffffffffu) ? KERNEL_FOREVER : now + timeout_ms * 1000ull;
+    self->order = seq++;
+    switch_out(lk,self);
+    return m->owner == self;
+}
+
+bool SimKernel::mutex_give(Mutex * m)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    if(!m || m->owner != cur) return false;
+
+    /* Hand it straight to the longest waiter, who runs once the giver blocks */
+    Task * next = nullptr;
+    for(Task * t : tasks)
+    {
+        if(t->state == Task::BLOCKED && t->waiting == m && (!next || t->order < next->order)) next = t;
+    }
+    m->owner = next;
+    if(next)
+    {
+        next->waiting = nullptr;
+        wake(next,now);
+    }
+    return true;
+}
+
+void SimKernel::notify(Task * t)
+{
+    std::lock_guard<std::mutex> lk(lock);
+    if(!t || t->state == Task::DEAD) return;
+    t->notified++;
+    if(t->state == Task::BLOCKED && t->notify_wait)
+    {
+        t->notify_wait = false;
+        wake(t,now);
+    }
+}
+
+uint32_t SimKernel::notify_take(bool clear, uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    Task * self = cur;
+    if(!self) return 0;
+    if(!self->notified && timeout_ms)
+    {
+        self->state = Task::BLOCKED;
+        self->notify_wait = true;
+        self->wake = (timeout_ms == 0xffffffffu) ? KERNEL_FOREVER : now + timeout_ms * 1000ull;
+        self->order = seq++;
+        switch_out(lk,self);
+    }
+    uint32_t n = self->notified;
+    if(n) self->notified = clear ? 0 : n - 1;
+    return n;
+}
+
+uint64_t SimKernel::run(uint64_t start_us, uint64_t end_us)
+{
+    std::unique_lock<std::mutex> lk(lock);
+    now = start_us;
+    end = end_us;
+    wall0 = std::chrono::steady_clock::now();
+    sim0 = start_us;
+    stopped = false;
+    Task * next = pick();
+    if(!next || next->wake > end) return 0;
+    advance(next->wake);
+    cur = next;
+    next->cv.notify_one();
+    done_cv.wait(lk,[this] { return stopped; });
+    return switches;
+}
+
+/* Task to run next: of those ready now, the highest priority, as the RTOS would
+ * run it, then the first to become ready. With none ready, the earliest to be
+ */
+SimKernel::Task * SimKernel::pick() const
+{
+    Task * best = nullptr;
+    for(Task * t : tasks)
+    {
+        if(t->state == Task::DEAD || t->wake == KERNEL_FOREVER) continue;
+        if(!best)
+        {
+            best = t;
+            continue;
+        }
+        uint64_t tw = (t->wake > now) ? t->wake : now;
+        uint64_t bw = (best->wake > now) ? best->wake : now;
+        if(tw < bw || (tw == bw && (t->prio > best->prio || (t->prio == best->prio &&
+           (t->wake < best->wake || (t->wake == best->wake && t->order < best->order))))))
+        {
+            best = t;
+        }
+    }
+    return best;
+}
+
+void SimKernel::pace(double s)
+{
+    speed = s;
+}
+
+/* Move the clock on to t, first waiting for real time to catch up when paced */
+void SimKernel::advance(uint64_t t)
+{
+    if(t <= now) return;
+    if(speed > 0.0)
+    {
+        std::chrono::duration<double> wall((t - sim0) / 1e6 / speed);
+        std::this_thread::sleep_until(wall0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wall));
+    }
+    now = t;
+}
+
+void SimKernel::wake(Task * t, uint64_t at)
+{
+    t->state = Task::READY;
+    t->wake = at;
+    t->order = seq++;
+}
+
+/* Pass the CPU on from self, which has just blocked or finished, and wait to get
+ * it back. Called with the lock held
+ */
+void SimKernel::switch_out(std::unique_lock<std::mutex>& lk, Task * self)
+{
+    switches++;
+    Task * next = pick();
+    if(!next || next->wake > end)
+    {
+        cur = nullptr;
+        stopped = true;
+        done_cv.notify_all();
+    }
+    else
+    {
+        /* A wait timing out leaves the mutex with its owner, or the count at 0 */
+        if(next->state == Task::BLOCKED)
+        {
+            next->state = Task::READY;
+            next->waiting = nullptr;
+            next->notify_wait = false;
+        }
+        advance(next->wake);
+        cur = next;
+        next->cv.notify_one();
+    }
+    if(self->state == Task::DEAD) return;
+
+    self->cv.wait(lk,[&] { return cur == self; });
+    if(self->killed)
+    {
+        lk.unlock();
+        throw TaskKilled();
+    }
+}
+
+void SimKernel::entry(Task * t)
+{
+    SimKernel& k = get();
+    std::unique_lock<std::mutex> lk(k.lock);
+    t->cv.wait(lk,[&] { return k.cur == t; });
+    bool run = !t->killed;
+    lk.unlock();
+
+    if(run)
+    {
+        try
+        {
+            t->fn(t->arg);
+        }
+        catch(const TaskKilled&)
+        {
+        }
+    }
+
+    lk.lock();
+    t->state = Task::DEAD;
+    k.switch_out(lk,t);
+}
+
+} /* namespace pal */
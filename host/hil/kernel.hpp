@@ -0,0 +1,115 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_HIL_KERNEL_HPP_
+#define _PAL_HIL_KERNEL_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Tasks scheduled on a simulated clock, standing in for the PROS RTOS
+ * Each task is a thread, but only one runs at a time, and it runs until it
+ * blocks in a delay or on a mutex. The clock then jumps to the earliest time a
+ * task can run again, so time passes as fast as the code runs. Tasks ready at
+ * the same time run highest priority first, then in the order they became ready,
+ * so a run is repeatable. Code spinning on millis() never sees it move
+ */
+class SimKernel
+{
+public:
+    typedef void (*TaskFn)(void *);
+    struct Task;
+    struct Mutex;
+
+    /* The kernel the PROS API calls go to */
+    static SimKernel& get();
+
+    /* Simulated time since power on */
+    uint64_t now_us() const { return now; }
+
+    /* Create a task, ready to run once the current one blocks */
+    Task * spawn(TaskFn fn, void * arg, uint32_t prio, const char * name);
+
+    /* Delete a task. A task deleting itself doesn't return; others stop at their
+     * next delay or mutex wait, or before they start
+     */
+    void kill(Task * t);
+
+    /* Task running now, or nullptr outside the scheduler */
+    Task * current() const { return cur; }
+
+    const char * name(const Task * t) const;
+    uint32_t priority(const Task * t) const;
+    void set_priority(Task * t, uint32_t prio);
+
+    /* Block the current task until the clock reaches t_us (now to yield) */
+    void delay_until(uint64_t t_us);
+
+    /* Move the clock on by us while the current task keeps running, as code busy
+     * for that long would. Tasks which come due meanwhile run once it blocks
+     */
+    void spend(uint64_t us);
+
+    Mutex * mutex_create();
+    void mutex_delete(Mutex * m);
+
+    /* Take a mutex, waiting up to timeout_ms (0xffffffff forever). False on timeout */
+    bool mutex_take(Mutex * m, uint32_t timeout_ms);
+
+    /* Give a mutex to the task waiting longest for it. False if not the owner */
+    bool mutex_give(Mutex * m);
+
+    /* Add one to a task's notification count, waking it if it waits for one */
+    void notify(Task * t);
+
+    /* Wait up to timeout_ms (0xffffffff forever) for the current task's count to
+     * be non-zero. Returns the count, then clears it or takes one from it
+     */
+    uint32_t notify_take(bool clear, uint32_t timeout_ms);
+
+    /* Run the tasks from the calling thread until none can run before end_us,
+     * starting the clock at start_us. Returns the number of task switches
+     */
+    uint64_t run(uint64_t start_us, uint64_t end_us);
+
+    /* Hold the clock to speed times real time, i.e. 1 for real time, so the code can
+     * talk to programs outside it. 0, the default, lets it run as fast as it can
+     */
+    void pace(double speed);
+
+private:
+    SimKernel() = default;
+
+    Task * pick() const;
+    void wake(Task * t, uint64_t at);
+    void advance(uint64_t t);
+    void switch_out(std::unique_lock<std::mutex>& lk, Task * self);
+    static void entry(Task * t);
+
+    std::mutex lock;
+    std::condition_variable done_cv;
+    std::vector<Task *> tasks;
+    Task * cur = nullptr;
+    uint64_t now = 0;
+    uint64_t end = 0;
+    uint64_t seq = 0;
+    uint64_t switches = 0;
+    bool stopped = false;
+    double speed = 0.0;
+    std::chrono::steady_clock::time_point wall0;    /* Real and simulated time run() began at */
+    uint64_t sim0 = 0;
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_HIL_KERNEL_HPP_ */
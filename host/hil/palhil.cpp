@@ -0,0 +1,262 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Runs the robot code in src/ on the host against a recorded log
+ * The competition tasks are started as the log's COMP_* channels change, the
+ * devices read what the log recorded, and the clock runs as fast as the code
+ * does, or at the pace given with -x. The logger writes its files to the directory given with -o, its serial
+ * streams to the link given with -s, and serial smart ports where -p sends them.
+ * With -t the logger also sends its records to a smart port, as log_sink_port_t does
+ * With -r the logger runs on a replay clock, so its rows carry the recorded times
+ */
+#include "main.h"
+#include "hil.hpp"
+#include "pal/log.h"
+#include "pal/log_sink.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/* Competition task the robot runs from a time on */
+struct hil_mode_t
+{
+    uint64_t time_us;
+    pal::SimKernel::TaskFn fn;
+    const char * name;
+};
+
+static void run_disabled(void *)
+{
+    disabled();
+}
+
+static void run_comp_init(void *)
+{
+    competition_initialize();
+}
+
+static void run_autonomous(void *)
+{
+    autonomous();
+}
+
+static void run_opcontrol(void *)
+{
+    opcontrol();
+}
+
+/* Column of the first of a channel's names the log has, or -1 */
+static int hil_find(pal::LogReplay& log, const char * name, const char * legacy)
+{
+    int c = log.find(name);
+    return c >= 0 ? c : log.find(legacy);
+}
+
+/* The task started on each change of the log's competition status, as the PROS
+ * system daemon starts them. Without field control, competition_initialize() is
+ * skipped and disabled() only runs on a change to disabled
+ */
+static std::vector<hil_mode_t> hil_modes(pal::LogReplay& log)
+{
+    int dis = hil_find(log,"COMP_DISABLED","comp_dis");
+    int aut = hil_find(log,"COMP_AUTONOMOUS","comp_auto");
+    int con = hil_find(log,"COMP_CONNECTED","comp_conn");
+    std::vector<hil_mode_t> modes;
+    pal::SimKernel::TaskFn last = nullptr;
+    for(size_t r = 0; r < log.rows(); r++)
+    {
+        bool d = dis >= 0 && log.value(dis,r) != 0.0;
+        bool a = aut >= 0 && log.value(aut,r) != 0.0;
+        bool c = con >= 0 && log.value(con,r) != 0.0;
+        pal::SimKernel::TaskFn fn = d ? run_disabled : a ? run_autonomous : run_opcontrol;
+        if(fn == last) continue;
+        last = fn;
+
+        hil_mode_t m = {log.time(r),fn,d ? "disabled" : a ? "autonomous" : "opcontrol"};
+        if(modes.empty() && d)
+        {
+            if(!c) continue;
+            m.fn = run_comp_init;
+            m.name = "competition_initialize";
+        }
+        modes.push_back(m);
+    }
+    return modes;
+}
+
+/* Steps the logger's replay clock to each recorded row time as the simulated
+ * clock reaches it
+ */
+static void hil_replay_clock(void * arg)
+{
+    auto& clk = *static_cast<log_clock_replay_t *>(arg);
+    pal::SimKernel& k = pal::SimKernel::get();
+    for(size_t r = 1; r < clk.count; r++)
+    {
+        k.delay_until(clk.times_us[r]);
+        log_clock_replay_next(&clk);
+    }
+}
+
+/* Smart port sink added with -t, and its port and baud rate */
+static log_sink_port_t hil_port_sink;
+static unsigned hil_sink_port = 0;
+static int32_t hil_sink_baud = 0;
+
+/* Stands in for the system daemon: initialize(), then the competition tasks */
+static void hil_system(void * arg)
+{
+    const auto& modes = *static_cast<const std::vector<hil_mode_t> *>(arg);
+    if(hil_sink_port)
+    {
+        log_sink_port_init(&hil_port_sink,static_cast<uint8_t>(hil_sink_port),hil_sink_baud,LOG_SINK_ALL,LOG_LEVEL_INFO);
+        log_sink_add(&hil_port_sink.sink);
+    }
+    initialize();
+
+    pal::SimKernel& k = pal::SimKernel::get();
+    pal::SimKernel::Task * comp = nullptr;
+    for(const auto& m : modes)
+    {
+        k.delay_until(m.time_us);
+        if(comp) k.kill(comp);
+        comp = k.spawn(m.fn,nullptr,TASK_PRIORITY_DEFAULT,m.name);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const char * usage = "usage: palhil [-o DIR] [-s PATH] [-p PORT=PATH]... [-t PORT=BAUD] [-x SPEED] [-k SECS] [-r] [-q] LOG\n"
+                         "  -o DIR   use DIR as the uSD card, so the logger writes its files there\n"
+                         "  -s PATH  send the serial streams the robot code opens to PATH, a file\n"
+                         "           or tty such as one pallog recv -t made, framed as PROS does\n"
+                         "  -p PORT=PATH  send what the robot code writes to serial smart port PORT\n"
+                         "           to PATH, at the port's baud rate in simulated time\n"
+                         "  -t PORT=BAUD  also send the logger's records to smart port PORT at BAUD,\n"
+                         "           as log_sink_port_t does, for -p to send on\n"
+                         "  -x SPEED run at SPEED times real time, i.e. to talk to pallog fetch\n"
+                         "  -k SECS  keep running SECS past the end of the log\n"
+                         "  -r       stamp the rows the logger writes with the log's row times\n"
+                         "  -q       discard the console output of the robot code\n";
+    std::string usd;
+    std::string serial;
+    std::vector<std::pair<unsigned,std::string>> ports;
+    double speed = 0.0;
+    double keep = 0.0;
+    bool quiet = false;
+    bool replay_clock = false;
+    int c;
+    while((c = getopt(argc,argv,"o:s:p:t:x:k:rq")) != -1)
+    {
+        switch(c)
+        {
+        case 'o':
+            usd = optarg;
+            break;
+        case 's':
+            serial = optarg;
+            break;
+        case 'p':
+        {
+            const char * eq = strchr(optarg,'=');
+            if(!eq)
+            {
+                fprintf(stderr,"%s",usage);
+                return 2;
+            }
+            ports.emplace_back(static_cast<unsigned>(atoi(optarg)),eq + 1);
+            break;
+        }
+        case 't':
+        {
+            const char * eq = strchr(optarg,'=');
+            hil_sink_port = static_cast<unsigned>(atoi(optarg));
+            hil_sink_baud = eq ? atoi(eq + 1) : 0;
+            if(hil_sink_port < 1 || hil_sink_port > 21 || hil_sink_baud <= 0)
+            {
+                fprintf(stderr,"%s",usage);
+                return 2;
+            }
+            break;
+        }
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'k':
+            keep = atof(optarg);
+            break;
+        case 'r':
+            replay_clock = true;
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind + 1 != argc)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    try
+    {
+        if(!usd.empty() && mkdir(usd.c_str(),0777) && errno != EEXIST)
+        {
+            throw std::runtime_error(usd + ": " + strerror(errno));
+        }
+        pal::LogReplay log(argv[optind]);
+        std::vector<hil_mode_t> modes = hil_modes(log);
+        pal::hil_attach(&log,usd);
+        pal::hil_serial(serial);
+        for(const auto& p : ports) pal::hil_port(p.first,p.second);
+        if(quiet && !freopen("/dev/null","w",stdout)) throw std::runtime_error("can't discard the console");
+
+        /* The logger's clock is chosen before initialize() starts it */
+        pal::SimKernel& k = pal::SimKernel::get();
+        std::vector<uint64_t> times;
+        log_clock_replay_t clk;
+        if(replay_clock)
+        {
+            for(size_t r = 0; r < log.rows(); r++) times.push_back(log.time(r));
+            log_clock_replay_init(&clk,times.data(),times.size());
+            log_clock(&clk.clock);
+            k.spawn(hil_replay_clock,&clk,TASK_PRIORITY_MAX,"replay_clock");
+        }
+        k.spawn(hil_system,&modes,TASK_PRIORITY_MAX,"system");
+        auto t0 = std::chrono::steady_clock::now();
+        k.pace(speed);
+        uint64_t switches = k.run(log.start_us(),log.end_us() + static_cast<uint64_t>(keep * 1e6));
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        fflush(stdout);
+
+        double logged = (log.end_us() - log.start_us()) / 1e6;
+        fprintf(stderr,"%s: %zu rows, %.1f s replayed in %.3f s (%.0fx real time), %llu task switches\n",
+            argv[optind],log.rows(),logged,secs,secs > 0.0 ? logged / secs : 0.0,
+            static_cast<unsigned long long>(switches));
+        for(const auto& m : modes)
+        {
+            fprintf(stderr,"  %10.3f s  %s\n",m.time_us / 1e6,m.name);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr,"palhil: %s\n",e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,660 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* C++ device classes of the mocked PROS API, forwarding to the C functions as
+ * the PROS library's own do
+ */
+#include "api.h"
+
+#include <cstdlib>
+
+/* The PID setters are deprecated in the API, but still need defining */
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+namespace pros
+{
+
+/******************************************************************************/
+/** Motor                                                                    **/
+/******************************************************************************/
+
+Motor::Motor(const std::int8_t port, const motor_gearset_e_t gearset, const bool reverse,
+             const motor_encoder_units_e_t encoder_units)
+    : _port(static_cast<std::uint8_t>(std::abs(port)))
+{
+    set_gearing(gearset);
+    set_reversed(reverse);
+    set_encoder_units(encoder_units);
+}
+
+Motor::Motor(const std::int8_t port, const motor_gearset_e_t gearset, const bool reverse)
+    : _port(static_cast<std::uint8_t>(std::abs(port)))
+{
+    set_gearing(gearset);
+    set_reversed(reverse);
+}
+
+Motor::Motor(const std::int8_t port, const motor_gearset_e_t gearset)
+    : _port(static_cast<std::uint8_t>(std::abs(port)))
+{
+    set_gearing(gearset);
+    set_reversed(port < 0);
+}
+
+Motor::Motor(const std::int8_t port, const bool reverse) : _port(static_cast<std::uint8_t>(std::abs(port)))
+{
+    set_reversed(reverse);
+}
+
+Motor::Motor(const std::int8_t port) : _port(static_cast<std::uint8_t>(std::abs(port)))
+{
+    set_reversed(port < 0);
+}
+
+std::int32_t Motor::operator=(std::int32_t voltage) const
+{
+    return c::motor_move(_port,voltage);
+}
+
+std::int32_t Motor::move(std::int32_t voltage) const
+{
+    return c::motor_move(_port,voltage);
+}
+
+std::int32_t Motor::move_absolute(const double position, const std::int32_t velocity) const
+{
+    return c::motor_move_absolute(_port,position,velocity);
+}
+
+std::int32_t Motor::move_relative(const double position, const std::int32_t velocity) const
+{
+    return c::motor_move_relative(_port,position,velocity);
+}
+
+std::int32_t Motor::move_velocity(const std::int32_t velocity) const
+{
+    return c::motor_move_velocity(_port,velocity);
+}
+
+std::int32_t Motor::move_voltage(const std::int32_t voltage) const
+{
+    return c::motor_move_voltage(_port,voltage);
+}
+
+std::int32_t Motor::brake(void) const
+{
+    return c::motor_brake(_port);
+}
+
+std::int32_t Motor::modify_profiled_velocity(const std::int32_t velocity) const
+{
+    return c::motor_modify_profiled_velocity(_port,velocity);
+}
+
+double Motor::get_target_position(void) const
+{
+    return c::motor_get_target_position(_port);
+}
+
+std::int32_t Motor::get_target_velocity(void) const
+{
+    return c::motor_get_target_velocity(_port);
+}
+
+double Motor::get_actual_velocity(void) const
+{
+    return c::motor_get_actual_velocity(_port);
+}
+
+std::int32_t Motor::get_current_draw(void) const
+{
+    return c::motor_get_current_draw(_port);
+}
+
+std::int32_t Motor::get_direction(void) const
+{
+    return c::motor_get_direction(_port);
+}
+
+double Motor::get_efficiency(void) const
+{
+    return c::motor_get_efficiency(_port);
+}
+
+std::int32_t Motor::is_over_current(void) const
+{
+    return c::motor_is_over_current(_port);
+}
+
+std::int32_t Motor::is_stopped(void) const
+{
+    return c::motor_is_stopped(_port);
+}
+
+std::int32_t Motor::get_zero_position_flag(void) const
+{
+    return c::motor_get_zero_position_flag(_port);
+}
+
+std::uint32_t Motor::get_faults(void) const
+{
+    return c::motor_get_faults(_port);
+}
+
+std::uint32_t Motor::get_flags(void) const
+{
+    return c::motor_get_flags(_port);
+}
+
+std::int32_t Motor::get_raw_position(std::uint32_t * const timestamp) const
+{
+    return c::motor_get_raw_position(_port,timestamp);
+}
+
+std::int32_t Motor::is_over_temp(void) const
+{
+    return c::motor_is_over_temp(_port);
+}
+
+double Motor::get_position(void) const
+{
+    return c::motor_get_position(_port);
+}
+
+double Motor::get_power(void) const
+{
+    return c::motor_get_power(_port);
+}
+
+double Motor::get_temperature(void) const
+{
+    return c::motor_get_temperature(_port);
+}
+
+double Motor::get_torque(void) const
+{
+    return c::motor_get_torque(_port);
+}
+
+std::int32_t Motor::get_voltage(void) const
+{
+    return c::motor_get_voltage(_port);
+}
+
+std::int32_t Motor::set_zero_position(const double position) const
+{
+    return c::motor_set_zero_position(_port,position);
+}
+
+std::int32_t Motor::tare_position(void) const
+{
+    return c::motor_tare_position(_port);
+}
+
+std::int32_t Motor::set_brake_mode(const motor_brake_mode_e_t mode) const
+{
+    return c::motor_set_brake_mode(_port,mode);
+}
+
+std::int32_t Motor::set_current_limit(const std::int32_t limit) const
+{
+    return c::motor_set_current_limit(_port,limit);
+}
+
+std::int32_t Motor::set_encoder_units(const motor_encoder_units_e_t units) const
+{
+    return c::motor_set_encoder_units(_port,units);
+}
+
+std::int32_t Motor::set_gearing(const motor_gearset_e_t gearset) const
+{
+    return c::motor_set_gearing(_port,gearset);
+}
+
+motor_pid_s_t Motor::convert_pid(double kf, double kp, double ki, double kd)
+{
+    return c::motor_convert_pid(kf,kp,ki,kd);
+}
+
+motor_pid_full_s_t Motor::convert_pid_full(double kf, double kp, double ki, double kd, double filter, double limit,
+                                           double threshold, double loopspeed)
+{
+    return c::motor_convert_pid_full(kf,kp,ki,kd,filter,limit,threshold,loopspeed);
+}
+
+std::int32_t Motor::set_pos_pid(const motor_pid_s_t pid) const
+{
+    return c::motor_set_pos_pid(_port,pid);
+}
+
+std::int32_t Motor::set_pos_pid_full(const motor_pid_full_s_t pid) const
+{
+    return c::motor_set_pos_pid_full(_port,pid);
+}
+
+std::int32_t Motor::set_vel_pid(const motor_pid_s_t pid) const
+{
+    return c::motor_set_vel_pid(_port,pid);
+}
+
+std::int32_t Motor::set_vel_pid_full(const motor_pid_full_s_t pid) const
+{
+    return c::motor_set_vel_pid_full(_port,pid);
+}
+
+std::int32_t Motor::set_reversed(const bool reverse) const
+{
+    return c::motor_set_reversed(_port,reverse);
+}
+
+std::int32_t Motor::set_voltage_limit(const std::int32_t limit) const
+{
+    return c::motor_set_voltage_limit(_port,limit);
+}
+
+motor_brake_mode_e_t Motor::get_brake_mode(void) const
+{
+    return c::motor_get_brake_mode(_port);
+}
+
+std::int32_t Motor::get_current_limit(void) const
+{
+    return c::motor_get_current_limit(_port);
+}
+
+motor_encoder_units_e_t Motor::get_encoder_units(void) const
+{
+    return c::motor_get_encoder_units(_port);
+}
+
+motor_gearset_e_t Motor::get_gearing(void) const
+{
+    return c::motor_get_gearing(_port);
+}
+
+motor_pid_full_s_t Motor::get_pos_pid(void) const
+{
+    return c::motor_get_pos_pid(_port);
+}
+
+motor_pid_full_s_t Motor::get_vel_pid(void) const
+{
+    return c::motor_get_vel_pid(_port);
+}
+
+std::int32_t Motor::is_reversed(void) const
+{
+    return c::motor_is_reversed(_port);
+}
+
+std::int32_t Motor::get_voltage_limit(void) const
+{
+    return c::motor_get_voltage_limit(_port);
+}
+
+std::uint8_t Motor::get_port(void) const
+{
+    return _port;
+}
+
+/******************************************************************************/
+/** Inertial sensor                                                          **/
+/******************************************************************************/
+
+std::int32_t Imu::reset(bool blocking) const
+{
+    return blocking ? c::imu_reset_blocking(_port) : c::imu_reset(_port);
+}
+
+std::int32_t Imu::set_data_rate(std::uint32_t rate) const
+{
+    return c::imu_set_data_rate(_port,rate);
+}
+
+double Imu::get_rotation() const
+{
+    return c::imu_get_rotation(_port);
+}
+
+double Imu::get_heading() const
+{
+    return c::imu_get_heading(_port);
+}
+
+c::quaternion_s_t Imu::get_quaternion() const
+{
+    return c::imu_get_quaternion(_port);
+}
+
+c::euler_s_t Imu::get_euler() const
+{
+    return c::imu_get_euler(_port);
+}
+
+double Imu::get_pitch() const
+{
+    return c::imu_get_pitch(_port);
+}
+
+double Imu::get_roll() const
+{
+    return c::imu_get_roll(_port);
+}
+
+double Imu::get_yaw() const
+{
+    return c::imu_get_yaw(_port);
+}
+
+c::imu_gyro_s_t Imu::get_gyro_rate() const
+{
+    return c::imu_get_gyro_rate(_port);
+}
+
+std::int32_t Imu::tare_rotation() const
+{
+    return c::imu_tare_rotation(_port);
+}
+
+std::int32_t Imu::tare_heading() const
+{
+    return c::imu_tare_heading(_port);
+}
+
+std::int32_t Imu::tare_pitch() const
+{
+    return c::imu_tare_pitch(_port);
+}
+
+std::int32_t Imu::tare_yaw() const
+{
+    return c::imu_tare_yaw(_port);
+}
+
+std::int32_t Imu::tare_roll() const
+{
+    return c::imu_tare_roll(_port);
+}
+
+std::int32_t Imu::tare() const
+{
+    return c::imu_tare(_port);
+}
+
+std::int32_t Imu::tare_euler() const
+{
+    return c::imu_tare_euler(_port);
+}
+
+std::int32_t Imu::set_heading(const double target) const
+{
+    return c::imu_set_heading(_port,target);
+}
+
+std::int32_t Imu::set_rotation(const double target) const
+{
+    return c::imu_set_rotation(_port,target);
+}
+
+std::int32_t Imu::set_yaw(const double target) const
+{
+    return c::imu_set_yaw(_port,target);
+}
+
+std::int32_t Imu::set_pitch(const double target) const
+{
+    return c::imu_set_pitch(_port,target);
+}
+
+std::int32_t Imu::set_roll(const double target) const
+{
+    return c::imu_set_roll(_port,target);
+}
+
+std::int32_t Imu::set_euler(const c::euler_s_t target) const
+{
+    return c::imu_set_euler(_port,target);
+}
+
+c::imu_accel_s_t Imu::get_accel() const
+{
+    return c::imu_get_accel(_port);
+}
+
+c::imu_status_e_t Imu::get_status() const
+{
+    return c::imu_get_status(_port);
+}
+
+bool Imu::is_calibrating() const
+{
+    return get_status() & c::E_IMU_STATUS_CALIBRATING;
+}
+
+/******************************************************************************/
+/** GPS                                                                      **/
+/******************************************************************************/
+
+std::int32_t Gps::initialize_full(double xInitial, double yInitial, double headingInitial, double xOffset,
+                                  double yOffset) const
+{
+    return c::gps_initialize_full(_port,xInitial,yInitial,headingInitial,xOffset,yOffset);
+}
+
+std::int32_t Gps::set_offset(double xOffset, double yOffset) const
+{
+    return c::gps_set_offset(_port,xOffset,yOffset);
+}
+
+std::int32_t Gps::get_offset(double * xOffset, double * yOffset) const
+{
+    return c::gps_get_offset(_port,xOffset,yOffset);
+}
+
+std::int32_t Gps::set_position(double xInitial, double yInitial, double headingInitial) const
+{
+    return c::gps_set_position(_port,xInitial,yInitial,headingInitial);
+}
+
+std::int32_t Gps::set_data_rate(std::uint32_t rate) const
+{
+    return c::gps_set_data_rate(_port,rate);
+}
+
+double Gps::get_error() const
+{
+    return c::gps_get_error(_port);
+}
+
+c::gps_status_s_t Gps::get_status() const
+{
+    return c::gps_get_status(_port);
+}
+
+double Gps::get_heading() const
+{
+    return c::gps_get_heading(_port);
+}
+
+double Gps::get_heading_raw() const
+{
+    return c::gps_get_heading_raw(_port);
+}
+
+double Gps::get_rotation() const
+{
+    return c::gps_get_rotation(_port);
+}
+
+std::int32_t Gps::set_rotation(double target) const
+{
+    return c::gps_set_rotation(_port,target);
+}
+
+std::int32_t Gps::tare_rotation() const
+{
+    return c::gps_tare_rotation(_port);
+}
+
+c::gps_gyro_s_t Gps::get_gyro_rate() const
+{
+    return c::gps_get_gyro_rate(_port);
+}
+
+c::gps_accel_s_t Gps::get_accel() const
+{
+    return c::gps_get_accel(_port);
+}
+
+/******************************************************************************/
+/** Vision sensor                                                            **/
+/******************************************************************************/
+
+Vision::Vision(std::uint8_t port, vision_zero_e_t zero_point) : _port(port)
+{
+    (void)zero_point;
+}
+
+std::uint8_t Vision::get_port(void) const
+{
+    return _port;
+}
+
+std::int32_t Vision::get_object_count(void) const
+{
+    return c::vision_get_object_count(_port);
+}
+
+std::int32_t Vision::read_by_size(const std::uint32_t size_id, const std::uint32_t object_count,
+                                  vision_object_s_t * const object_arr) const
+{
+    return c::vision_read_by_size(_port,size_id,object_count,object_arr);
+}
+
+/******************************************************************************/
+/** Controller, battery and competition                                      **/
+/******************************************************************************/
+
+Controller::Controller(controller_id_e_t id) : _id(id)
+{
+}
+
+std::int32_t Controller::is_connected(void)
+{
+    return c::controller_is_connected(_id);
+}
+
+std::int32_t Controller::get_analog(controller_analog_e_t channel)
+{
+    return c::controller_get_analog(_id,channel);
+}
+
+std::int32_t Controller::get_battery_capacity(void)
+{
+    return c::controller_get_battery_capacity(_id);
+}
+
+std::int32_t Controller::get_battery_level(void)
+{
+    return c::controller_get_battery_level(_id);
+}
+
+std::int32_t Controller::get_digital(controller_digital_e_t button)
+{
+    return c::controller_get_digital(_id,button);
+}
+
+std::int32_t Controller::get_digital_new_press(controller_digital_e_t button)
+{
+    return c::controller_get_digital_new_press(_id,button);
+}
+
+std::int32_t Controller::set_text(std::uint8_t line, std::uint8_t col, const char * str)
+{
+    return c::controller_set_text(_id,line,col,str);
+}
+
+std::int32_t Controller::set_text(std::uint8_t line, std::uint8_t col, const std::string& str)
+{
+    return c::controller_set_text(_id,line,col,str.c_str());
+}
+
+std::int32_t Controller::clear_line(std::uint8_t line)
+{
+    return c::controller_clear_line(_id,line);
+}
+
+std::int32_t Controller::rumble(const char * rumble_pattern)
+{
+    return c::controller_rumble(_id,rumble_pattern);
+}
+
+std::int32_t Controller::clear(void)
+{
+    return c::controller_clear(_id);
+}
+
+namespace battery
+{
+
+double get_capacity(void)
+{
+    return c::battery_get_capacity();
+}
+
+int32_t get_current(void)
+{
+    return c::battery_get_current();
+}
+
+double get_temperature(void)
+{
+    return c::battery_get_temperature();
+}
+
+int32_t get_voltage(void)
+{
+    return c::battery_get_voltage();
+}
+
+} /* namespace battery */
+
+namespace competition
+{
+
+std::uint8_t get_status(void)
+{
+    return c::competition_get_status();
+}
+
+std::uint8_t is_autonomous(void)
+{
+    return (c::competition_get_status() & COMPETITION_AUTONOMOUS) != 0;
+}
+
+std::uint8_t is_connected(void)
+{
+    return (c::competition_get_status() & COMPETITION_CONNECTED) != 0;
+}
+
+std::uint8_t is_disabled(void)
+{
+    return (c::competition_get_status() & COMPETITION_DISABLED) != 0;
+}
+
+} /* namespace competition */
+
+namespace usd
+{
+
+std::int32_t is_installed(void)
+{
+    return c::usd_is_installed();
+}
+
+} /* namespace usd */
+
+} /* namespace pros */
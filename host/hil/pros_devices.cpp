@@ -0,0 +1,1028 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Device getters of the mocked PROS API, read from the log being replayed
+ * Each getter returns what the device reported when the log was recorded, in the
+ * units the API uses, so the control code sees the run it is replaying. What the
+ * code commands is kept, for the getters reporting it back, but moves nothing.
+ * Zeroing and taring offset the logged readings as they would on the robot
+ */
+#include "api.h"
+#include "display/lvgl.h"
+#include "hil.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace pros
+{
+namespace c
+{
+
+/* What the code has told each port */
+struct motor_state_t
+{
+    double zero = 0.0;              /* Position subtracted by set_zero_position */
+    double target_pos = 0.0;
+    int32_t target_vel = 0;
+    int32_t voltage = 0;
+    motor_brake_mode_e_t brake = E_MOTOR_BRAKE_COAST;
+    motor_encoder_units_e_t units = E_MOTOR_ENCODER_DEGREES;
+    motor_gearset_e_t gearing = E_MOTOR_GEARSET_18;
+    int32_t current_limit = 2500;
+    int32_t voltage_limit = 0;
+    bool reversed = false;
+    motor_pid_full_s_t pos_pid = {};
+    motor_pid_full_s_t vel_pid = {};
+};
+
+struct imu_state_t
+{
+    double heading = 0.0;           /* Offsets added to the logged readings */
+    double rotation = 0.0;
+    double pitch = 0.0;
+    double roll = 0.0;
+    double yaw = 0.0;
+};
+
+struct gps_state_t
+{
+    double rotation = 0.0;
+    double x_offset = 0.0;
+    double y_offset = 0.0;
+};
+
+static motor_state_t motors[NUM_V5_PORTS];
+static imu_state_t imus[NUM_V5_PORTS];
+static gps_state_t gpss[NUM_V5_PORTS];
+
+/* Check a port number, setting errno as PROS does */
+static bool port_ok(uint8_t port)
+{
+    if(port >= 1 && port < NUM_V5_PORTS) return true;
+    errno = ENXIO;
+    return false;
+}
+
+/* Reading of a device channel, or PROS_ERR_F */
+static double get(const char * prefix, uint8_t port, const char * field)
+{
+    double v;
+    if(!port_ok(port) || !pal::hil_read(prefix,port,field,v)) return PROS_ERR_F;
+    return v;
+}
+
+/* Reading scaled to an integer, or PROS_ERR */
+static int32_t get_int(const char * prefix, uint8_t port, const char * field, double scale)
+{
+    double v = get(prefix,port,field);
+    return std::isfinite(v) ? static_cast<int32_t>(std::lround(v * scale)) : PROS_ERR;
+}
+
+/* Angle wrapped into [0,360) */
+static double wrap360(double deg)
+{
+    return deg - 360.0 * std::floor(deg / 360.0);
+}
+
+/******************************************************************************/
+/** Motors                                                                   **/
+/******************************************************************************/
+
+int32_t motor_move(uint8_t port, int32_t voltage)
+{
+    return motor_move_voltage(port,voltage * 12000 / 127);
+}
+
+int32_t motor_brake(uint8_t port)
+{
+    return motor_move_velocity(port,0);
+}
+
+int32_t motor_move_absolute(uint8_t port, const double position, const int32_t velocity)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].target_pos = position;
+    motors[port].target_vel = velocity;
+    return 1;
+}
+
+int32_t motor_move_relative(uint8_t port, const double position, const int32_t velocity)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    return motor_move_absolute(port,motors[port].target_pos + position,velocity);
+}
+
+int32_t motor_move_velocity(uint8_t port, const int32_t velocity)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].target_vel = velocity;
+    return 1;
+}
+
+int32_t motor_move_voltage(uint8_t port, const int32_t voltage)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].voltage = voltage;
+    return 1;
+}
+
+int32_t motor_modify_profiled_velocity(uint8_t port, const int32_t velocity)
+{
+    return motor_move_velocity(port,velocity);
+}
+
+double motor_get_target_position(uint8_t port)
+{
+    return port_ok(port) ? motors[port].target_pos : PROS_ERR_F;
+}
+
+int32_t motor_get_target_velocity(uint8_t port)
+{
+    return port_ok(port) ? motors[port].target_vel : PROS_ERR;
+}
+
+double motor_get_actual_velocity(uint8_t port)
+{
+    return get("mtr",port,"vel");
+}
+
+int32_t motor_get_current_draw(uint8_t port)
+{
+    return get_int("mtr",port,"cur",1000.0);
+}
+
+int32_t motor_get_direction(uint8_t port)
+{
+    double v = get("mtr",port,"vel");
+    if(v == PROS_ERR_F) return PROS_ERR;
+    return v < 0.0 ? -1 : 1;
+}
+
+/* Not logged by the poller */
+double motor_get_efficiency(uint8_t port)
+{
+    return port_ok(port) ? 0.0 : PROS_ERR_F;
+}
+
+int32_t motor_is_over_current(uint8_t port)
+{
+    double c = get("mtr",port,"cur");
+    if(c == PROS_ERR_F) return PROS_ERR;
+    return c * 1000.0 >= motors[port].current_limit;
+}
+
+int32_t motor_is_over_temp(uint8_t port)
+{
+    double t = get("mtr",port,"temp");
+    if(t == PROS_ERR_F) return PROS_ERR;
+    return t >= 55.0;
+}
+
+int32_t motor_is_stopped(uint8_t port)
+{
+    double v = get("mtr",port,"vel");
+    if(v == PROS_ERR_F) return PROS_ERR;
+    return v == 0.0;
+}
+
+int32_t motor_get_zero_position_flag(uint8_t port)
+{
+    return port_ok(port) ? 0 : PROS_ERR;
+}
+
+uint32_t motor_get_faults(uint8_t port)
+{
+    return port_ok(port) ? 0 : PROS_ERR;
+}
+
+uint32_t motor_get_flags(uint8_t port)
+{
+    return port_ok(port) ? 0 : PROS_ERR;
+}
+
+int32_t motor_get_raw_position(uint8_t port, uint32_t * const timestamp)
+{
+    int32_t pos = get_int("mtr",port,"pos",1.0);
+    if(pos != PROS_ERR && timestamp) *timestamp = millis();
+    return pos;
+}
+
+double motor_get_position(uint8_t port)
+{
+    double p = get("mtr",port,"pos");
+    return p == PROS_ERR_F ? p : p - motors[port].zero;
+}
+
+double motor_get_power(uint8_t port)
+{
+    return get("mtr",port,"power");
+}
+
+double motor_get_temperature(uint8_t port)
+{
+    return get("mtr",port,"temp");
+}
+
+double motor_get_torque(uint8_t port)
+{
+    return get("mtr",port,"torque");
+}
+
+int32_t motor_get_voltage(uint8_t port)
+{
+    return get_int("mtr",port,"volt",1000.0);
+}
+
+int32_t motor_set_zero_position(uint8_t port, const double position)
+{
+    double p = get("mtr",port,"pos");
+    if(p == PROS_ERR_F) return PROS_ERR;
+    motors[port].zero = p - position;
+    return 1;
+}
+
+int32_t motor_tare_position(uint8_t port)
+{
+    return motor_set_zero_position(port,0.0);
+}
+
+int32_t motor_set_brake_mode(uint8_t port, const motor_brake_mode_e_t mode)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].brake = mode;
+    return 1;
+}
+
+int32_t motor_set_current_limit(uint8_t port, const int32_t limit)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].current_limit = limit;
+    return 1;
+}
+
+int32_t motor_set_encoder_units(uint8_t port, const motor_encoder_units_e_t units)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].units = units;
+    return 1;
+}
+
+int32_t motor_set_gearing(uint8_t port, const motor_gearset_e_t gearset)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].gearing = gearset;
+    return 1;
+}
+
+motor_pid_s_t motor_convert_pid(double kf, double kp, double ki, double kd)
+{
+    motor_pid_s_t pid;
+    pid.kf = static_cast<uint8_t>(kf * 16.0);
+    pid.kp = static_cast<uint8_t>(kp * 16.0);
+    pid.ki = static_cast<uint8_t>(ki * 16.0);
+    pid.kd = static_cast<uint8_t>(kd * 16.0);
+    return pid;
+}
+
+motor_pid_full_s_t motor_convert_pid_full(double kf, double kp, double ki, double kd, double filter, double limit,
+                                          double threshold, double loopspeed)
+{
+    motor_pid_full_s_t pid;
+    pid.kf = static_cast<uint8_t>(kf * 16.0);
+    pid.kp = static_cast<uint8_t>(kp * 16.0);
+    pid.ki = static_cast<uint8_t>(ki * 16.0);
+    pid.kd = static_cast<uint8_t>(kd * 16.0);
+    pid.filter = static_cast<uint8_t>(filter * 16.0);
+    pid.limit = static_cast<uint16_t>(limit * 16.0);
+    pid.threshold = static_cast<uint8_t>(threshold * 16.0);
+    pid.loopspeed = static_cast<uint8_t>(loopspeed * 16.0);
+    return pid;
+}
+
+int32_t motor_set_pos_pid(uint8_t port, const motor_pid_s_t pid)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motor_pid_full_s_t& p = motors[port].pos_pid;
+    p.kf = pid.kf;
+    p.kp = pid.kp;
+    p.ki = pid.ki;
+    p.kd = pid.kd;
+    return 1;
+}
+
+int32_t motor_set_pos_pid_full(uint8_t port, const motor_pid_full_s_t pid)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].pos_pid = pid;
+    return 1;
+}
+
+int32_t motor_set_vel_pid(uint8_t port, const motor_pid_s_t pid)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motor_pid_full_s_t& p = motors[port].vel_pid;
+    p.kf = pid.kf;
+    p.kp = pid.kp;
+    p.ki = pid.ki;
+    p.kd = pid.kd;
+    return 1;
+}
+
+int32_t motor_set_vel_pid_full(uint8_t port, const motor_pid_full_s_t pid)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].vel_pid = pid;
+    return 1;
+}
+
+int32_t motor_set_reversed(uint8_t port, const bool reverse)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].reversed = reverse;
+    return 1;
+}
+
+int32_t motor_set_voltage_limit(uint8_t port, const int32_t limit)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    motors[port].voltage_limit = limit;
+    return 1;
+}
+
+motor_brake_mode_e_t motor_get_brake_mode(uint8_t port)
+{
+    return port_ok(port) ? motors[port].brake : E_MOTOR_BRAKE_INVALID;
+}
+
+int32_t motor_get_current_limit(uint8_t port)
+{
+    return port_ok(port) ? motors[port].current_limit : PROS_ERR;
+}
+
+motor_encoder_units_e_t motor_get_encoder_units(uint8_t port)
+{
+    return port_ok(port) ? motors[port].units : E_MOTOR_ENCODER_INVALID;
+}
+
+motor_gearset_e_t motor_get_gearing(uint8_t port)
+{
+    return port_ok(port) ? motors[port].gearing : E_MOTOR_GEARSET_INVALID;
+}
+
+motor_pid_full_s_t motor_get_pos_pid(uint8_t port)
+{
+    return port_ok(port) ? motors[port].pos_pid : motor_pid_full_s_t{};
+}
+
+motor_pid_full_s_t motor_get_vel_pid(uint8_t port)
+{
+    return port_ok(port) ? motors[port].vel_pid : motor_pid_full_s_t{};
+}
+
+int32_t motor_is_reversed(uint8_t port)
+{
+    return port_ok(port) ? motors[port].reversed : PROS_ERR;
+}
+
+int32_t motor_get_voltage_limit(uint8_t port)
+{
+    return port_ok(port) ? motors[port].voltage_limit : PROS_ERR;
+}
+
+/******************************************************************************/
+/** Inertial sensor                                                          **/
+/******************************************************************************/
+
+int32_t imu_reset(uint8_t port)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    imus[port] = imu_state_t();
+    return 1;
+}
+
+int32_t imu_reset_blocking(uint8_t port)
+{
+    return imu_reset(port);
+}
+
+int32_t imu_set_data_rate(uint8_t port, uint32_t rate)
+{
+    (void)rate;
+    return port_ok(port) ? 1 : PROS_ERR;
+}
+
+double imu_get_rotation(uint8_t port)
+{
+    double r = get("imu",port,"rot");
+    return r == PROS_ERR_F ? r : r + imus[port].rotation;
+}
+
+double imu_get_heading(uint8_t port)
+{
+    double h = get("imu",port,"hdg");
+    return h == PROS_ERR_F ? h : wrap360(h + imus[port].heading);
+}
+
+quaternion_s_t imu_get_quaternion(uint8_t port)
+{
+    quaternion_s_t q;
+    q.x = get("imu",port,"quat_x");
+    q.y = get("imu",port,"quat_y");
+    q.z = get("imu",port,"quat_z");
+    q.w = get("imu",port,"quat_w");
+    return q;
+}
+
+double imu_get_pitch(uint8_t port)
+{
+    double v = get("imu",port,"euler_pitch");
+    return v == PROS_ERR_F ? v : v + imus[port].pitch;
+}
+
+double imu_get_roll(uint8_t port)
+{
+    double v = get("imu",port,"euler_roll");
+    return v == PROS_ERR_F ? v : v + imus[port].roll;
+}
+
+double imu_get_yaw(uint8_t port)
+{
+    double v = get("imu",port,"euler_yaw");
+    return v == PROS_ERR_F ? v : v + imus[port].yaw;
+}
+
+euler_s_t imu_get_euler(uint8_t port)
+{
+    euler_s_t e;
+    e.pitch = imu_get_pitch(port);
+    e.roll = imu_get_roll(port);
+    e.yaw = imu_get_yaw(port);
+    return e;
+}
+
+imu_gyro_s_t imu_get_gyro_rate(uint8_t port)
+{
+    imu_gyro_s_t g;
+    g.x = get("imu",port,"gyro_x");
+    g.y = get("imu",port,"gyro_y");
+    g.z = get("imu",port,"gyro_z");
+    return g;
+}
+
+imu_accel_s_t imu_get_accel(uint8_t port)
+{
+    imu_accel_s_t a;
+    a.x = get("imu",port,"acc_x");
+    a.y = get("imu",port,"acc_y");
+    a.z = get("imu",port,"acc_z");
+    return a;
+}
+
+imu_status_e_t imu_get_status(uint8_t port)
+{
+    double cal = get("imu",port,"cal");
+    if(cal == PROS_ERR_F) return E_IMU_STATUS_ERROR;
+    return cal != 0.0 ? E_IMU_STATUS_CALIBRATING : static_cast<imu_status_e_t>(0);
+}
+
+int32_t imu_set_heading(uint8_t port, double target)
+{
+    double h = get("imu",port,"hdg");
+    if(h == PROS_ERR_F) return PROS_ERR;
+    imus[port].heading = target - h;
+    return 1;
+}
+
+int32_t imu_set_rotation(uint8_t port, double target)
+{
+    double r = get("imu",port,"rot");
+    if(r == PROS_ERR_F) return PROS_ERR;
+    imus[port].rotation = target - r;
+    return 1;
+}
+
+int32_t imu_set_pitch(uint8_t port, double target)
+{
+    double v = get("imu",port,"euler_pitch");
+    if(v == PROS_ERR_F) return PROS_ERR;
+    imus[port].pitch = target - v;
+    return 1;
+}
+
+int32_t imu_set_roll(uint8_t port, double target)
+{
+    double v = get("imu",port,"euler_roll");
+    if(v == PROS_ERR_F) return PROS_ERR;
+    imus[port].roll = target - v;
+    return 1;
+}
+
+int32_t imu_set_yaw(uint8_t port, double target)
+{
+    double v = get("imu",port,"euler_yaw");
+    if(v == PROS_ERR_F) return PROS_ERR;
+    imus[port].yaw = target - v;
+    return 1;
+}
+
+int32_t imu_set_euler(uint8_t port, euler_s_t target)
+{
+    if(imu_set_pitch(port,target.pitch) == PROS_ERR) return PROS_ERR;
+    if(imu_set_roll(port,target.roll) == PROS_ERR) return PROS_ERR;
+    return imu_set_yaw(port,target.yaw);
+}
+
+int32_t imu_tare_heading(uint8_t port)
+{
+    return imu_set_heading(port,0.0);
+}
+
+int32_t imu_tare_rotation(uint8_t port)
+{
+    return imu_set_rotation(port,0.0);
+}
+
+int32_t imu_tare_pitch(uint8_t port)
+{
+    return imu_set_pitch(port,0.0);
+}
+
+int32_t imu_tare_roll(uint8_t port)
+{
+    return imu_set_roll(port,0.0);
+}
+
+int32_t imu_tare_yaw(uint8_t port)
+{
+    return imu_set_yaw(port,0.0);
+}
+
+int32_t imu_tare_euler(uint8_t port)
+{
+    euler_s_t zero = {0.0,0.0,0.0};
+    return imu_set_euler(port,zero);
+}
+
+int32_t imu_tare(uint8_t port)
+{
+    if(imu_tare_euler(port) == PROS_ERR) return PROS_ERR;
+    if(imu_tare_heading(port) == PROS_ERR) return PROS_ERR;
+    return imu_tare_rotation(port);
+}
+
+/******************************************************************************/
+/** GPS                                                                      **/
+/******************************************************************************/
+
+/* The GPS reports the position it was recorded with, so setting it only keeps
+ * what the code asked for
+ */
+int32_t gps_initialize_full(uint8_t port, double xInitial, double yInitial, double headingInitial, double xOffset,
+                            double yOffset)
+{
+    (void)xInitial;
+    (void)yInitial;
+    (void)headingInitial;
+    return gps_set_offset(port,xOffset,yOffset);
+}
+
+int32_t gps_set_offset(uint8_t port, double xOffset, double yOffset)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    gpss[port].x_offset = xOffset;
+    gpss[port].y_offset = yOffset;
+    return 1;
+}
+
+int32_t gps_get_offset(uint8_t port, double * xOffset, double * yOffset)
+{
+    if(!port_ok(port)) return PROS_ERR;
+    *xOffset = gpss[port].x_offset;
+    *yOffset = gpss[port].y_offset;
+    return 1;
+}
+
+int32_t gps_set_position(uint8_t port, double xInitial, double yInitial, double headingInitial)
+{
+    (void)xInitial;
+    (void)yInitial;
+    (void)headingInitial;
+    return port_ok(port) ? 1 : PROS_ERR;
+}
+
+int32_t gps_set_data_rate(uint8_t port, uint32_t rate)
+{
+    (void)rate;
+    return port_ok(port) ? 1 : PROS_ERR;
+}
+
+double gps_get_error(uint8_t port)
+{
+    return get("gps",port,"error");
+}
+
+gps_status_s_t gps_get_status(uint8_t port)
+{
+    gps_status_s_t s;
+    s.x = get("gps",port,"x");
+    s.y = get("gps",port,"y");
+    s.pitch = get("gps",port,"pitch");
+    s.roll = get("gps",port,"roll");
+    s.yaw = get("gps",port,"yaw");
+    return s;
+}
+
+double gps_get_heading(uint8_t port)
+{
+    return get("gps",port,"hdg");
+}
+
+double gps_get_heading_raw(uint8_t port)
+{
+    return get("gps",port,"hdg");
+}
+
+double gps_get_rotation(uint8_t port)
+{
+    double r = get("gps",port,"rot");
+    return r == PROS_ERR_F ? r : r + gpss[port].rotation;
+}
+
+int32_t gps_set_rotation(uint8_t port, double target)
+{
+    double r = get("gps",port,"rot");
+    if(r == PROS_ERR_F) return PROS_ERR;
+    gpss[port].rotation = target - r;
+    return 1;
+}
+
+int32_t gps_tare_rotation(uint8_t port)
+{
+    return gps_set_rotation(port,0.0);
+}
+
+gps_gyro_s_t gps_get_gyro_rate(uint8_t port)
+{
+    gps_gyro_s_t g;
+    g.x = get("gps",port,"gyro_x");
+    g.y = get("gps",port,"gyro_y");
+    g.z = get("gps",port,"gyro_z");
+    return g;
+}
+
+gps_accel_s_t gps_get_accel(uint8_t port)
+{
+    gps_accel_s_t a;
+    a.x = get("gps",port,"acc_x");
+    a.y = get("gps",port,"acc_y");
+    a.z = get("gps",port,"acc_z");
+    return a;
+}
+
+/******************************************************************************/
+/** Vision sensor                                                            **/
+/******************************************************************************/
+
+/* Logs only keep how many objects were seen, so the sensor sees none */
+int32_t vision_read_by_size(uint8_t port, const uint32_t size_id, const uint32_t object_count,
+                            vision_object_s_t * const object_arr)
+{
+    (void)size_id;
+    if(!port_ok(port)) return PROS_ERR;
+    for(uint32_t i = 0; i < object_count; i++)
+    {
+        memset(&object_arr[i],0,sizeof(object_arr[i]));
+        object_arr[i].signature = VISION_OBJECT_ERR_SIG;
+    }
+    return 0;
+}
+
+int32_t vision_get_object_count(uint8_t port)
+{
+    return port_ok(port) ? 0 : PROS_ERR;
+}
+
+/******************************************************************************/
+/** Battery, competition and controller                                      **/
+/******************************************************************************/
+
+/* Channels src/main.cpp logs these under, in volts and amps, or in millivolts and
+ * milliamps as in the older logs of model/
+ */
+int32_t battery_get_voltage(void)
+{
+    double v = pal::hil_read({{"BATT_VOLT",1000.0},{"batt_volt",1.0}},NAN);
+    return std::isfinite(v) ? static_cast<int32_t>(std::lround(v)) : PROS_ERR;
+}
+
+int32_t battery_get_current(void)
+{
+    double v = pal::hil_read({{"BATT_CUR",1000.0},{"batt_cur",1.0}},NAN);
+    return std::isfinite(v) ? static_cast<int32_t>(std::lround(v)) : PROS_ERR;
+}
+
+double battery_get_temperature(void)
+{
+    return pal::hil_read({{"BATT_TEMP",1.0},{"batt_temp",1.0}},PROS_ERR_F);
+}
+
+double battery_get_capacity(void)
+{
+    return pal::hil_read({{"BATT_CAP",1.0},{"batt_cap",1.0}},PROS_ERR_F);
+}
+
+/* Without competition channels the robot is enabled in driver control, as it is
+ * with no field control connected
+ */
+uint8_t competition_get_status(void)
+{
+    uint8_t s = 0;
+    if(pal::hil_read({{"COMP_DISABLED",1.0},{"comp_dis",1.0}},0.0) != 0.0) s |= COMPETITION_DISABLED;
+    if(pal::hil_read({{"COMP_AUTONOMOUS",1.0},{"comp_auto",1.0}},0.0) != 0.0) s |= COMPETITION_AUTONOMOUS;
+    if(pal::hil_read({{"COMP_CONNECTED",1.0},{"comp_conn",1.0}},0.0) != 0.0) s |= COMPETITION_CONNECTED;
+    return s;
+}
+
+/* Names of the controller channels, by analog channel then button: the suffix of
+ * CTRL_MSTR_* (CRTL_MSTR_* for the sticks) and of mas_* in the older logs
+ */
+static const char * const analog_names[][2] = {{"LX","lx"},{"LY","ly"},{"RX","rx"},{"RY","ry"}};
+static const char * const digital_names[][2] =
+{
+    {"L1","l1"},{"L2","l2"},{"R1","r1"},{"R2","r2"},{"DU","up"},{"DD","dn"},
+    {"DL","lt"},{"DR","rt"},{"DX","x"},{"DB","b"},{"DY","y"},{"DA","a"}
+};
+
+/* Controller channel, which the partner controller logs as CTRL_PRTN_* */
+static double controller_read(controller_id_e_t id, const char * const names[2])
+{
+    if(id != E_CONTROLLER_MASTER) return pal::hil_read({{(std::string("CTRL_PRTN_") + names[0]).c_str(),1.0}},0.0);
+    std::string ctrl = std::string("CTRL_MSTR_") + names[0];
+    std::string crtl = std::string("CRTL_MSTR_") + names[0];
+    std::string mas = std::string("mas_") + names[1];
+    return pal::hil_read({{ctrl.c_str(),1.0},{crtl.c_str(),1.0},{mas.c_str(),1.0}},0.0);
+}
+
+int32_t controller_is_connected(controller_id_e_t id)
+{
+    pal::LogReplay * r = pal::hil_replay();
+    if(!r) return 0;
+    const char * prefix = (id == E_CONTROLLER_MASTER) ? "_MSTR_" : "_PRTN_";
+    for(const auto& c : r->columns())
+    {
+        if(c.name.find(prefix) != std::string::npos) return 1;
+        if(id == E_CONTROLLER_MASTER && !c.name.compare(0,4,"mas_")) return 1;
+    }
+    return 0;
+}
+
+int32_t controller_get_analog(controller_id_e_t id, controller_analog_e_t channel)
+{
+    if(channel < E_CONTROLLER_ANALOG_LEFT_X || channel > E_CONTROLLER_ANALOG_RIGHT_Y) return PROS_ERR;
+    return static_cast<int32_t>(controller_read(id,analog_names[channel]));
+}
+
+int32_t controller_get_digital(controller_id_e_t id, controller_digital_e_t button)
+{
+    if(button < E_CONTROLLER_DIGITAL_L1 || button > E_CONTROLLER_DIGITAL_A) return PROS_ERR;
+    return controller_read(id,digital_names[button - E_CONTROLLER_DIGITAL_L1]) != 0.0;
+}
+
+int32_t controller_get_digital_new_press(controller_id_e_t id, controller_digital_e_t button)
+{
+    static bool held[2][12];
+    int32_t now = controller_get_digital(id,button);
+    if(now == PROS_ERR) return PROS_ERR;
+    bool& was = held[id == E_CONTROLLER_MASTER ? 0 : 1][button - E_CONTROLLER_DIGITAL_L1];
+    bool press = now && !was;
+    was = now;
+    return press;
+}
+
+int32_t controller_get_battery_capacity(controller_id_e_t id)
+{
+    return controller_is_connected(id) ? 100 : PROS_ERR;
+}
+
+int32_t controller_get_battery_level(controller_id_e_t id)
+{
+    return controller_is_connected(id) ? 100 : PROS_ERR;
+}
+
+int32_t controller_print(controller_id_e_t id, uint8_t line, uint8_t col, const char * fmt, ...)
+{
+    (void)id;
+    (void)line;
+    (void)col;
+    (void)fmt;
+    return 1;
+}
+
+int32_t controller_set_text(controller_id_e_t id, uint8_t line, uint8_t col, const char * str)
+{
+    (void)str;
+    return controller_print(id,line,col,"");
+}
+
+int32_t controller_clear_line(controller_id_e_t id, uint8_t line)
+{
+    return controller_print(id,line,0,"");
+}
+
+int32_t controller_clear(controller_id_e_t id)
+{
+    return controller_print(id,0,0,"");
+}
+
+int32_t controller_rumble(controller_id_e_t id, const char * rumble_pattern)
+{
+    (void)rumble_pattern;
+    return controller_print(id,0,0,"");
+}
+
+/******************************************************************************/
+/** Screen                                                                   **/
+/******************************************************************************/
+
+/* Nobody watches the brain screen in a replay, so drawing on it does nothing */
+uint32_t screen_erase(void)
+{
+    return 1;
+}
+
+uint32_t screen_set_pen(uint32_t color)
+{
+    (void)color;
+    return 1;
+}
+
+uint32_t screen_print(text_format_e_t txt_fmt, const int16_t line, const char * text, ...)
+{
+    (void)txt_fmt;
+    (void)line;
+    (void)text;
+    return 1;
+}
+
+} /* namespace c */
+} /* namespace pros */
+
+/******************************************************************************/
+/** Display                                                                  **/
+/******************************************************************************/
+
+/* LVGL, which a replay has no screen for either. Objects keep what the sinks read
+ * back or write into directly, their size and a chart's series, and draw nothing
+ */
+struct hil_chart_t
+{
+    lv_obj_t obj;
+    uint16_t points = 10;
+    std::vector<std::unique_ptr<lv_chart_series_t>> series;
+    std::vector<std::vector<lv_coord_t>> data;
+};
+
+static lv_obj_t hil_screen = [] { lv_obj_t o = {}; o.coords = {0,0,LV_HOR_RES - 1,LV_VER_RES - 1}; return o; }();
+static std::vector<std::unique_ptr<hil_chart_t>> hil_charts;
+
+static hil_chart_t * hil_chart(const lv_obj_t * obj)
+{
+    return static_cast<hil_chart_t *>(obj->ext_attr);
+}
+
+lv_obj_t * lv_scr_act(void)
+{
+    return &hil_screen;
+}
+
+void lv_obj_set_size(lv_obj_t * obj, lv_coord_t w, lv_coord_t h)
+{
+    obj->coords.x2 = obj->coords.x1 + w - 1;
+    obj->coords.y2 = obj->coords.y1 + h - 1;
+}
+
+lv_coord_t lv_obj_get_width(const lv_obj_t * obj)
+{
+    return obj->coords.x2 - obj->coords.x1 + 1;
+}
+
+lv_coord_t lv_obj_get_height(const lv_obj_t * obj)
+{
+    return obj->coords.y2 - obj->coords.y1 + 1;
+}
+
+lv_obj_t * lv_chart_create(lv_obj_t * par, const lv_obj_t * copy)
+{
+    (void)copy;
+    hil_charts.emplace_back(new hil_chart_t);
+    hil_chart_t * c = hil_charts.back().get();
+    c->obj = {};
+    c->obj.par = par;
+    c->obj.coords = par->coords;
+    c->obj.ext_attr = c;
+    return &c->obj;
+}
+
+lv_chart_series_t * lv_chart_add_series(lv_obj_t * chart, lv_color_t color)
+{
+    hil_chart_t * c = hil_chart(chart);
+    c->data.emplace_back(c->points,LV_CHART_POINT_DEF);
+    c->series.emplace_back(new lv_chart_series_t);
+    lv_chart_series_t * ser = c->series.back().get();
+    ser->points = c->data.back().data();
+    ser->color = color;
+    ser->start_point = 0;
+    return ser;
+}
+
+void lv_chart_set_type(lv_obj_t * chart, lv_chart_type_t type)
+{
+    (void)chart;
+    (void)type;
+}
+
+void lv_chart_set_range(lv_obj_t * chart, lv_coord_t ymin, lv_coord_t ymax)
+{
+    (void)chart;
+    (void)ymin;
+    (void)ymax;
+}
+
+void lv_chart_set_point_count(lv_obj_t * chart, uint16_t point_cnt)
+{
+    hil_chart_t * c = hil_chart(chart);
+    c->points = point_cnt;
+    for(size_t i = 0; i < c->series.size(); i++)
+    {
+        c->data[i].assign(point_cnt,LV_CHART_POINT_DEF);
+        c->series[i]->points = c->data[i].data();
+        c->series[i]->start_point = 0;
+    }
+}
+
+uint16_t lv_chart_get_point_cnt(const lv_obj_t * chart)
+{
+    return hil_chart(chart)->points;
+}
+
+void lv_chart_refresh(lv_obj_t * chart)
+{
+    (void)chart;
+}
+
+/* lv_tasks, which an "lvgl" task runs as PROS's display task would, sleeping
+ * until the next one is due rather than polling
+ */
+static std::vector<std::unique_ptr<lv_task_t>> hil_lv_tasks;
+
+static void hil_lvgl(void * arg)
+{
+    (void)arg;
+    pal::SimKernel& k = pal::SimKernel::get();
+    while(true)
+    {
+        uint32_t now = static_cast<uint32_t>(k.now_us() / 1000);
+        uint32_t next = now + 1000;
+        for(size_t i = 0; i < hil_lv_tasks.size(); i++)
+        {
+            lv_task_t * t = hil_lv_tasks[i].get();
+            if(t->prio == LV_TASK_PRIO_OFF) continue;
+            if(now - t->last_run >= t->period)
+            {
+                t->last_run = now;
+                t->task(t->param);
+            }
+            uint32_t due = t->last_run + t->period;
+            if(static_cast<int32_t>(due - next) < 0) next = due;
+        }
+        if(next == now) next++;
+        k.delay_until(next * 1000ull);
+    }
+}
+
+lv_task_t * lv_task_create(void (*task)(void *), uint32_t period, lv_task_prio_t prio, void * param)
+{
+    pal::SimKernel& k = pal::SimKernel::get();
+    if(hil_lv_tasks.empty()) k.spawn(hil_lvgl,nullptr,TASK_PRIORITY_MIN + 1,"lvgl");
+    hil_lv_tasks.emplace_back(new lv_task_t);
+    lv_task_t * t = hil_lv_tasks.back().get();
+    t->period = period;
+    t->last_run = static_cast<uint32_t>(k.now_us() / 1000);
+    t->task = task;
+    t->param = param;
+    t->prio = prio;
+    t->once = 0;
+    return t;
+}
+
+void lv_task_set_period(lv_task_t * lv_task_p, uint32_t period)
+{
+    lv_task_p->period = period;
+}
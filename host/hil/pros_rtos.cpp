@@ -0,0 +1,458 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* RTOS, uSD, serial and poller hooks of the mocked PROS API */
+#include "api.h"
+#include "pros/apix.h"
+#include "pros/serial.h"
+#include "hil.hpp"
+#include "telemetry.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace pal
+{
+
+static LogReplay * replay = nullptr;
+static std::string usd;
+static uint64_t read_cost_us = 0;
+
+/* Serial link: where it goes, the streams activated, and whether PROS frames them */
+static int serial_fd = -1;
+static std::set<uint32_t> serial_active;
+static bool serial_cobs = true;
+
+/* Smart ports in generic serial mode, where each goes and its write buffer, which
+ * empties at the baud rate in simulated time
+ */
+#define PORT_WRITE_BUF 1024
+
+struct port_link_t
+{
+    int fd = -1;
+    bool enabled = false;
+    int32_t baud = 115200;
+    double queued = 0.0;        /* Bytes in the write buffer as of when */
+    uint64_t when_us = 0;
+};
+
+static port_link_t ports[NUM_V5_PORTS];
+
+/* Write all of data to fd, returning false on an error */
+static bool write_all(int fd, const uint8_t * data, size_t len)
+{
+    for(size_t done = 0; done < len;)
+    {
+        ssize_t n = write(fd,data + done,len - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+void hil_attach(LogReplay * r, const std::string& usd_dir)
+{
+    replay = r;
+    usd = usd_dir;
+}
+
+void hil_serial(const std::string& path)
+{
+    if(serial_fd >= 0) close(serial_fd);
+    serial_fd = -1;
+    if(path.empty()) return;
+
+    /* What the host sends on a tty comes in on stdin, as it does over USB */
+    serial_fd = open(path.c_str(),O_RDWR | O_NOCTTY);
+    if(serial_fd >= 0 && isatty(serial_fd))
+    {
+        dup2(serial_fd,STDIN_FILENO);
+    }
+    else
+    {
+        if(serial_fd >= 0) close(serial_fd);
+        serial_fd = open(path.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY,0666);
+    }
+    if(serial_fd < 0) throw std::runtime_error(path + ": " + strerror(errno));
+}
+
+/* Write a /ser/ stream's bytes to the link as PROS does: unless COBS is disabled,
+ * each write is a packet of the stream id and the bytes, COBS encoded and ended
+ * by a zero byte, which pros terminal and pallog recv take apart again
+ */
+static ssize_t serial_write(void * cookie, const char * buf, size_t size)
+{
+    uint32_t id = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(cookie));
+    if(serial_fd < 0 || !serial_active.count(id)) return size;
+
+    std::vector<uint8_t> out;
+    if(serial_cobs)
+    {
+        std::vector<uint8_t> raw(4 + size);
+        memcpy(raw.data(),&id,4);
+        memcpy(raw.data() + 4,buf,size);
+        out = cobs_encode(raw.data(),raw.size());
+        out.push_back(0);
+    }
+    else
+    {
+        out.assign(buf,buf + size);
+    }
+
+    return write_all(serial_fd,out.data(),out.size()) ? static_cast<ssize_t>(size) : -1;
+}
+
+static FILE * serial_open(const char * id)
+{
+    if(serial_fd < 0 || strlen(id) != 4)
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+    uint32_t sid;
+    memcpy(&sid,id,4);
+    cookie_io_functions_t io = {};
+    io.write = serial_write;
+    return fopencookie(reinterpret_cast<void *>(static_cast<uintptr_t>(sid)),"w",io);
+}
+
+void hil_port(unsigned port, const std::string& path)
+{
+    if(port < 1 || port > 21) throw std::runtime_error("no smart port " + std::to_string(port));
+    port_link_t& p = ports[port - 1];
+    if(p.fd >= 0) close(p.fd);
+    p.fd = open(path.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY,0666);
+    if(p.fd < 0) throw std::runtime_error(path + ": " + strerror(errno));
+}
+
+/* The port a serial call names, or nullptr with errno set as PROS sets it */
+static port_link_t * port_link(uint8_t port, bool enabled = true)
+{
+    if(port < 1 || port > 21)
+    {
+        errno = ENXIO;
+        return nullptr;
+    }
+    port_link_t * p = &ports[port - 1];
+    if(enabled && !p->enabled)
+    {
+        errno = EACCES;
+        return nullptr;
+    }
+    return p;
+}
+
+/* Empty the write buffer at the baud rate, ten bits a byte */
+static void port_drain(port_link_t& p)
+{
+    uint64_t now = SimKernel::get().now_us();
+    p.queued -= (now - p.when_us) * (p.baud / 10.0) / 1e6;
+    if(p.queued < 0.0) p.queued = 0.0;
+    p.when_us = now;
+}
+
+LogReplay * hil_replay()
+{
+    return replay;
+}
+
+void hil_read_cost(uint64_t us)
+{
+    read_cost_us = us;
+}
+
+bool hil_read(const char * prefix, unsigned port, const char * field, double& value)
+{
+    if(read_cost_us) SimKernel::get().spend(read_cost_us);
+    int c = replay ? replay->device(prefix,port,field) : -1;
+    if(c < 0)
+    {
+        errno = ENODEV;
+        return false;
+    }
+    value = replay->at(c,SimKernel::get().now_us());
+    return true;
+}
+
+double hil_read(std::initializer_list<HilChannel> names, double def)
+{
+    if(!replay) return def;
+    for(const auto& n : names)
+    {
+        int c = replay->find(n.name);
+        if(c >= 0) return replay->at(c,SimKernel::get().now_us()) * n.scale;
+    }
+    return def;
+}
+
+} /* namespace pal */
+
+using pal::SimKernel;
+
+namespace pros
+{
+namespace c
+{
+
+uint32_t millis(void)
+{
+    return static_cast<uint32_t>(SimKernel::get().now_us() / 1000);
+}
+
+uint64_t micros(void)
+{
+    return SimKernel::get().now_us();
+}
+
+void task_delay(const uint32_t milliseconds)
+{
+    SimKernel& k = SimKernel::get();
+    k.delay_until(k.now_us() + milliseconds * 1000ull);
+}
+
+void delay(const uint32_t milliseconds)
+{
+    task_delay(milliseconds);
+}
+
+void task_delay_until(uint32_t * const prev_time, const uint32_t delta)
+{
+    /* Like FreeRTOS, a wake time already passed returns at once */
+    *prev_time += delta;
+    uint64_t wake = *prev_time * 1000ull;
+    SimKernel& k = SimKernel::get();
+    if(wake > k.now_us()) k.delay_until(wake);
+}
+
+task_t task_create(task_fn_t function, void * const parameters, uint32_t prio, const uint16_t stack_depth,
+                   const char * const name)
+{
+    (void)stack_depth;
+    return SimKernel::get().spawn(function,parameters,prio,name);
+}
+
+void task_delete(task_t task)
+{
+    SimKernel& k = SimKernel::get();
+    k.kill(task ? static_cast<SimKernel::Task *>(task) : k.current());
+}
+
+task_t task_get_current()
+{
+    return SimKernel::get().current();
+}
+
+uint32_t task_get_priority(task_t task)
+{
+    SimKernel& k = SimKernel::get();
+    return k.priority(task ? static_cast<SimKernel::Task *>(task) : k.current());
+}
+
+void task_set_priority(task_t task, uint32_t prio)
+{
+    SimKernel& k = SimKernel::get();
+    k.set_priority(task ? static_cast<SimKernel::Task *>(task) : k.current(),prio);
+}
+
+char * task_get_name(task_t task)
+{
+    SimKernel& k = SimKernel::get();
+    return const_cast<char *>(k.name(task ? static_cast<SimKernel::Task *>(task) : k.current()));
+}
+
+uint32_t task_notify(task_t task)
+{
+    SimKernel::get().notify(static_cast<SimKernel::Task *>(task));
+    return 1;
+}
+
+uint32_t task_notify_take(bool clear_on_exit, uint32_t timeout)
+{
+    return SimKernel::get().notify_take(clear_on_exit,timeout);
+}
+
+int32_t serctl(const uint32_t action, void * const extra_arg)
+{
+    uint32_t id = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(extra_arg));
+    switch(action)
+    {
+    case SERCTL_ACTIVATE:
+        pal::serial_active.insert(id);
+        break;
+    case SERCTL_DEACTIVATE:
+        pal::serial_active.erase(id);
+        break;
+    case SERCTL_ENABLE_COBS:
+        pal::serial_cobs = true;
+        break;
+    case SERCTL_DISABLE_COBS:
+        pal::serial_cobs = false;
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/* stdin is the serial link when it is a tty, see hil_serial() */
+int32_t fdctl(int file, const uint32_t action, void * const extra_arg)
+{
+    (void)extra_arg;
+    int n = 0;
+    if(action != DEVCTL_FIONREAD || ioctl(file,FIONREAD,&n))
+    {
+        errno = EINVAL;
+        return PROS_ERR;
+    }
+    return n;
+}
+
+int32_t serial_enable(uint8_t port)
+{
+    pal::port_link_t * p = pal::port_link(port,false);
+    if(!p) return PROS_ERR;
+    p->enabled = true;
+    p->queued = 0.0;
+    p->when_us = pal::SimKernel::get().now_us();
+    return 1;
+}
+
+int32_t serial_set_baudrate(uint8_t port, int32_t baudrate)
+{
+    pal::port_link_t * p = pal::port_link(port);
+    if(!p) return PROS_ERR;
+    pal::port_drain(*p);
+    p->baud = baudrate;
+    return 1;
+}
+
+int32_t serial_flush(uint8_t port)
+{
+    pal::port_link_t * p = pal::port_link(port);
+    if(!p) return PROS_ERR;
+    p->queued = 0.0;
+    return 1;
+}
+
+int32_t serial_get_read_avail(uint8_t port)
+{
+    return pal::port_link(port) ? 0 : PROS_ERR;
+}
+
+int32_t serial_get_write_free(uint8_t port)
+{
+    pal::port_link_t * p = pal::port_link(port);
+    if(!p) return PROS_ERR;
+    pal::port_drain(*p);
+    return PORT_WRITE_BUF - static_cast<int32_t>(std::ceil(p->queued));
+}
+
+int32_t serial_read(uint8_t port, uint8_t * buffer, int32_t length)
+{
+    (void)buffer;
+    (void)length;
+    return pal::port_link(port) ? 0 : PROS_ERR;
+}
+
+/* Takes what fits in the write buffer, sending it to the port's file at once */
+int32_t serial_write(uint8_t port, uint8_t * buffer, int32_t length)
+{
+    pal::port_link_t * p = pal::port_link(port);
+    if(!p) return PROS_ERR;
+    int32_t n = serial_get_write_free(port);
+    if(n > length) n = length;
+    if(n <= 0) return 0;
+    if(p->fd >= 0 && !pal::write_all(p->fd,buffer,n))
+    {
+        errno = EIO;
+        return PROS_ERR;
+    }
+    p->queued += n;
+    return n;
+}
+
+mutex_t mutex_create(void)
+{
+    return SimKernel::get().mutex_create();
+}
+
+bool mutex_take(mutex_t mutex, uint32_t timeout)
+{
+    return SimKernel::get().mutex_take(static_cast<SimKernel::Mutex *>(mutex),timeout);
+}
+
+bool mutex_give(mutex_t mutex)
+{
+    return SimKernel::get().mutex_give(static_cast<SimKernel::Mutex *>(mutex));
+}
+
+void mutex_delete(mutex_t mutex)
+{
+    SimKernel::get().mutex_delete(static_cast<SimKernel::Mutex *>(mutex));
+}
+
+int32_t usd_is_installed(void)
+{
+    return !pal::usd.empty();
+}
+
+} /* namespace c */
+} /* namespace pros */
+
+/* Linked with -Wl,--wrap so the robot code's calls come here first */
+extern "C"
+{
+
+FILE * __real_fopen(const char * path, const char * mode);
+int __real_log_poll_motor(const char * name, unsigned char port, unsigned int fields);
+int __real_log_poll_imu(const char * name, unsigned char port, unsigned int fields);
+int __real_log_poll_gps(const char * name, unsigned char port, unsigned int fields);
+
+/* Open the card's files in the host directory standing in for it, and the serial
+ * streams on the link given to palhil
+ */
+FILE * __wrap_fopen(const char * path, const char * mode)
+{
+    if(!strncmp(path,"/ser/",5)) return pal::serial_open(path + 5);
+    if(strncmp(path,"/usd/",5)) return __real_fopen(path,mode);
+    if(pal::usd.empty())
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+    return __real_fopen((pal::usd + "/" + (path + 5)).c_str(),mode);
+}
+
+/* Registered names tell the replay which columns hold each port's channels */
+int __wrap_log_poll_motor(const char * name, unsigned char port, unsigned int fields)
+{
+    if(pal::replay) pal::replay->name_device("mtr",port,name);
+    return __real_log_poll_motor(name,port,fields);
+}
+
+int __wrap_log_poll_imu(const char * name, unsigned char port, unsigned int fields)
+{
+    if(pal::replay) pal::replay->name_device("imu",port,name);
+    return __real_log_poll_imu(name,port,fields);
+}
+
+int __wrap_log_poll_gps(const char * name, unsigned char port, unsigned int fields)
+{
+    if(pal::replay) pal::replay->name_device("gps",port,name);
+    return __real_log_poll_gps(name,port,fields);
+}
+
+} /* extern "C" */
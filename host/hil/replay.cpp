@@ -0,0 +1,78 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "replay.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace pal
+{
+
+/* Rows read per block when loading */
+#define REPLAY_BLOCK_ROWS 4096
+
+LogReplay::LogReplay(const std::string& path)
+{
+    auto src = open_rows(path);
+    cols = src->columns();
+    data.resize(cols.size());
+    for(auto& d : data) d.reserve(src->rows());
+    times.reserve(src->rows());
+
+    std::vector<double> block(cols.size() * REPLAY_BLOCK_ROWS);
+    size_t n;
+    while((n = src->read(block.data(),REPLAY_BLOCK_ROWS)))
+    {
+        for(size_t c = 0; c < cols.size(); c++)
+        {
+            const double * col = &block[c * REPLAY_BLOCK_ROWS];
+            data[c].insert(data[c].end(),col,col + n);
+        }
+        for(size_t r = 0; r < n; r++) times.push_back(static_cast<uint64_t>(std::llround(block[r] * 1e6)));
+    }
+    if(times.empty()) throw std::runtime_error(path + ": no rows to replay");
+    for(size_t c = 0; c < cols.size(); c++) index.emplace(cols[c].name,static_cast<int>(c));
+}
+
+int LogReplay::find(const std::string& name) const
+{
+    auto it = index.find(name);
+    return it == index.end() ? -1 : it->second;
+}
+
+double LogReplay::at(int c, uint64_t t_us)
+{
+    /* Come back to the start if the caller went backwards */
+    if(t_us < times[row]) row = 0;
+    while(row + 1 < times.size() && times[row + 1] <= t_us) row++;
+    return data[c][row];
+}
+
+int LogReplay::device(const char * prefix, unsigned port, const char * field)
+{
+    std::string dev = prefix + std::to_string(port);
+    std::string key = dev + "_" + field;
+    auto it = found.find(key);
+    if(it != found.end()) return it->second;
+
+    int c = -1;
+    auto named = names.find(dev);
+    if(named != names.end()) c = find(named->second + "_" + field);
+    if(c < 0) c = find(key);
+    if(c < 0) c = find(std::string(prefix) + "_" + field);
+    found[key] = c;
+    return c;
+}
+
+void LogReplay::name_device(const char * prefix, unsigned port, const char * name)
+{
+    if(!name) return;
+    names[prefix + std::to_string(port)] = name;
+    found.clear();
+}
+
+} /* namespace pal */
@@ -0,0 +1,71 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_HIL_REPLAY_HPP_
+#define _PAL_HIL_REPLAY_HPP_
+
+#include "rows.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pal
+{
+
+/* A recorded log held in memory, giving the value each channel had at a time
+ * A channel holds the value of the last row at or before the time asked for, or
+ * of the first row before the log starts. Times only move forward in a run, so
+ * finding the row costs nothing per read
+ */
+class LogReplay
+{
+public:
+    /* Throws std::runtime_error if the file can't be read or has no rows */
+    explicit LogReplay(const std::string& path);
+
+    /* Times of the first and last rows */
+    uint64_t start_us() const { return times.front(); }
+    uint64_t end_us() const { return times.back(); }
+    size_t rows() const { return times.size(); }
+
+    const std::vector<RowColumn>& columns() const { return cols; }
+
+    /* Index of a column by name, or -1 */
+    int find(const std::string& name) const;
+
+    /* Value of column c at time t_us */
+    double at(int c, uint64_t t_us);
+
+    /* Value of column c in row r, and the time of row r */
+    double value(int c, size_t r) const { return data[c][r]; }
+    uint64_t time(size_t r) const { return times[r]; }
+
+    /* Column of a channel of the device on a port, or -1
+     * The poller names it <name>_<field> when the device was registered with a
+     * name, else <prefix><port>_<field>. Channels src/main.cpp logs itself, such
+     * as imu_quat_x, are found as <prefix>_<field> last
+     */
+    int device(const char * prefix, unsigned port, const char * field);
+
+    /* Record the name a device was registered with the poller under */
+    void name_device(const char * prefix, unsigned port, const char * name);
+
+private:
+    std::vector<RowColumn> cols;
+    std::vector<std::vector<double>> data;
+    std::vector<uint64_t> times;
+    size_t row = 0;
+
+    std::unordered_map<std::string, int> index;             /* Column name to column */
+    std::unordered_map<std::string, std::string> names;    /* "<prefix><port>" to name */
+    std::unordered_map<std::string, int> found;             /* "<prefix><port>_<field>" to column */
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_HIL_REPLAY_HPP_ */
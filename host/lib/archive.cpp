@@ -0,0 +1,412 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "archive.hpp"
+#include "arrow.hpp"
+#include "mapped_file.hpp"
+#include "rows.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <strings.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+static void make_dir(const std::string& path)
+{
+    if(mkdir(path.c_str(),0755) < 0 && errno != EEXIST)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
+
+/* CSV field, quoted if it holds a comma, quote or line break */
+static std::string csv_field(const std::string& s)
+{
+    if(s.find_first_of(",\"\r\n") == std::string::npos) return s;
+    std::string q = "\"";
+    for(char c : s)
+    {
+        if(c == '"') q += '"';
+        q += c;
+    }
+    return q + "\"";
+}
+
+/* Split a CSV line, undoing csv_field() */
+static std::vector<std::string> csv_split(const std::string& line)
+{
+    std::vector<std::string> out(1);
+    bool quoted = false;
+    for(size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if(quoted)
+        {
+            if(c != '"') out.back() += c;
+            else if(i + 1 < line.size() && line[i + 1] == '"') out.back() += line[++i];
+            else quoted = false;
+        }
+        else if(c == '"') quoted = true;
+        else if(c == ',') out.emplace_back();
+        else if(c != '\r') out.back() += c;
+    }
+    return out;
+}
+
+/* Lines of a CSV file after its header, or none if it doesn't exist yet */
+static std::vector<std::vector<std::string>> read_table(const std::string& path, size_t ncols)
+{
+    std::vector<std::vector<std::string>> rows;
+    std::ifstream in(path);
+    std::string line;
+    if(!in || !std::getline(in,line)) return rows;
+    while(std::getline(in,line))
+    {
+        if(line.empty()) continue;
+        rows.push_back(csv_split(line));
+        if(rows.back().size() != ncols)
+        {
+            throw std::runtime_error(path + ": bad line " + std::to_string(rows.size() + 1));
+        }
+    }
+    return rows;
+}
+
+/* Write a file to a temporary name and move it into place, so an interrupted run
+ * leaves the old file rather than half a new one
+ */
+static void replace_file(const std::string& path, const std::string& text)
+{
+    std::string tmp = path + ".tmp";
+    FILE * f = fopen(tmp.c_str(),"wb");
+    if(!f || fwrite(text.data(),1,text.size(),f) != text.size() || fclose(f) != 0)
+    {
+        int err = errno;
+        if(f) fclose(f);
+        throw std::runtime_error(tmp + ": " + strerror(err));
+    }
+    if(rename(tmp.c_str(),path.c_str()) < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
+
+static const char * CATALOG_HEADER = "id,robot,date,segment,mode,rows,seconds,data,log,source\n";
+static const char * SOURCES_HEADER = "path,size,mtime,id\n";
+
+Archive::Archive(const std::string& dir) : root(dir)
+{
+    make_dir(root);
+    make_dir(root + "/data");
+    make_dir(root + "/logs");
+
+    for(const auto& r : read_table(root + "/catalog.csv",10))
+    {
+        CatalogEntry e;
+        e.id = r[0];
+        e.robot = r[1];
+        e.date = r[2];
+        e.segment = atoi(r[3].c_str());
+        e.mode = r[4];
+        e.rows = strtoull(r[5].c_str(),nullptr,10);
+        e.seconds = strtod(r[6].c_str(),nullptr);
+        e.data = r[7];
+        e.log = r[8];
+        e.source = r[9];
+        add(e);
+    }
+    for(const auto& r : read_table(root + "/sources.csv",4))
+    {
+        SourceEntry s;
+        s.size = strtoull(r[1].c_str(),nullptr,10);
+        s.mtime = strtoll(r[2].c_str(),nullptr,10);
+        s.id = r[3];
+        seen[r[0]] = s;
+    }
+}
+
+const CatalogEntry * Archive::find(const std::string& id) const
+{
+    auto it = by_id.find(id);
+    return (it == by_id.end()) ? nullptr : &catalog[it->second];
+}
+
+void Archive::add(const CatalogEntry& e)
+{
+    auto it = by_id.find(e.id);
+    if(it != by_id.end())
+    {
+        catalog[it->second] = e;
+        return;
+    }
+    by_id[e.id] = catalog.size();
+    catalog.push_back(e);
+}
+
+void Archive::remove(const std::string& id)
+{
+    auto it = by_id.find(id);
+    if(it == by_id.end()) return;
+    const CatalogEntry& e = catalog[it->second];
+    if(!e.data.empty()) unlink((root + "/" + e.data).c_str());
+    if(!e.log.empty()) unlink((root + "/" + e.log).c_str());
+    catalog.erase(catalog.begin() + it->second);
+    by_id.clear();
+    for(size_t i = 0; i < catalog.size(); i++) by_id[catalog[i].id] = i;
+}
+
+void Archive::save() const
+{
+    std::vector<const CatalogEntry *> order;
+    for(const auto& e : catalog) order.push_back(&e);
+    std::sort(order.begin(),order.end(),[](const CatalogEntry * a, const CatalogEntry * b)
+    {
+        if(a->robot != b->robot) return a->robot < b->robot;
+        if(a->date != b->date) return a->date < b->date;
+        if(a->segment != b->segment) return a->segment < b->segment;
+        return a->id < b->id;
+    });
+
+    std::string text = CATALOG_HEADER;
+    char num[64];
+    for(const CatalogEntry * e : order)
+    {
+        snprintf(num,sizeof(num),"%d,",e->segment);
+        text += csv_field(e->id) + "," + csv_field(e->robot) + "," + csv_field(e->date) + "," + num;
+        snprintf(num,sizeof(num),",%zu,%.3f,",e->rows,e->seconds);
+        text += csv_field(e->mode) + num;
+        text += csv_field(e->data) + "," + csv_field(e->log) + "," + csv_field(e->source) + "\n";
+    }
+    replace_file(root + "/catalog.csv",text);
+
+    text = SOURCES_HEADER;
+    for(const auto& s : seen)
+    {
+        snprintf(num,sizeof(num),",%llu,%lld,",(unsigned long long)s.second.size,(long long)s.second.mtime);
+        text += csv_field(s.first) + num + csv_field(s.second.id) + "\n";
+    }
+    replace_file(root + "/sources.csv",text);
+}
+
+/* Index of a file named prefix%05d.ext, or -1 */
+static int file_index(const char * name, const char * prefix, const char * ext)
+{
+    size_t np = strlen(prefix);
+    size_t ne = strlen(ext);
+    size_t len = strlen(name);
+    if(len != np + 5 + ne || strncmp(name,prefix,np) || strcmp(name + np + 5,ext)) return -1;
+    int idx = 0;
+    for(size_t i = np; i < np + 5; i++)
+    {
+        if(!isdigit((unsigned char)name[i])) return -1;
+        idx = idx * 10 + (name[i] - '0');
+    }
+    return idx;
+}
+
+std::vector<CardSegment> find_segments(const std::string& dir)
+{
+    DIR * d = opendir(dir.c_str());
+    if(!d)
+    {
+        throw std::runtime_error(dir + ": " + strerror(errno));
+    }
+    std::map<int, CardSegment> found;
+    while(struct dirent * e = readdir(d))
+    {
+        int idx;
+        if((idx = file_index(e->d_name,"log",".txt")) >= 0)
+        {
+            found[idx].log = dir + "/" + e->d_name;
+        }
+        else if((idx = file_index(e->d_name,"dat",".csv")) >= 0 ||
+            (idx = file_index(e->d_name,"dat",".bin")) >= 0)
+        {
+            found[idx].data = dir + "/" + e->d_name;
+        }
+    }
+    closedir(d);
+
+    std::vector<CardSegment> segs;
+    for(auto& f : found)
+    {
+        f.second.segment = f.first;
+        segs.push_back(f.second);
+    }
+    return segs;
+}
+
+std::string path_date(const std::string& path)
+{
+    for(size_t i = 0; i + 10 <= path.size(); i++)
+    {
+        const char * p = path.c_str() + i;
+        bool ok = true;
+        for(int k = 0; k < 10 && ok; k++)
+        {
+            ok = (k == 4 || k == 7) ? (p[k] == '-') : isdigit((unsigned char)p[k]) != 0;
+        }
+        if(ok && (i == 0 || !isdigit((unsigned char)p[-1])) && !isdigit((unsigned char)p[10]))
+        {
+            return std::string(p,10);
+        }
+    }
+    return "";
+}
+
+std::string dump_date(const std::string& dir, const std::string& file)
+{
+    /* Dumps are usually filed by event */
+    std::string date = path_date(dir);
+    if(!date.empty()) return date;
+
+    /* The Brain has no clock, so the file times are when the card was copied */
+    struct stat st;
+    char buf[16] = "unknown";
+    if(stat(file.c_str(),&st) == 0)
+    {
+        struct tm tm;
+        localtime_r(&st.st_mtime,&tm);
+        strftime(buf,sizeof(buf),"%Y-%m-%d",&tm);
+    }
+    return buf;
+}
+
+/* Row source passed through to the archive writer, which works out the competition
+ * mode and the time span on the way
+ */
+class ModeRows : public RowSource
+{
+public:
+    explicit ModeRows(RowSource& src) : src(src)
+    {
+        cols = src.columns();
+        nrows = src.rows();
+        for(size_t c = 0; c < cols.size(); c++)
+        {
+            if(!strncasecmp(cols[c].name.c_str(),"comp_dis",8)) dis_col = static_cast<int>(c);
+            if(!strncasecmp(cols[c].name.c_str(),"comp_auto",9)) auto_col = static_cast<int>(c);
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t n = src.read(block,max);
+        for(size_t r = 0; r < n; r++)
+        {
+            double t = block[r];
+            if(std::isfinite(t))
+            {
+                if(!have_time) first = t;
+                last = t;
+                have_time = true;
+            }
+            if(dis_col < 0) continue;
+            if(block[dis_col * max + r] != 0.0) disabled++;
+            else if(auto_col >= 0 && block[auto_col * max + r] != 0.0) autonomous++;
+            else driver++;
+        }
+        return n;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        return src.span(first,last);
+    }
+
+    /* Mode the robot was enabled in for most rows, or disabled if it never was */
+    std::string mode() const
+    {
+        if(dis_col < 0) return "unknown";
+        if(!autonomous && !driver) return disabled ? "disabled" : "unknown";
+        return (autonomous >= driver) ? "auto" : "driver";
+    }
+
+    double seconds() const { return have_time ? last - first : 0.0; }
+
+private:
+    RowSource& src;
+    int dis_col = -1;
+    int auto_col = -1;
+    size_t disabled = 0, autonomous = 0, driver = 0;
+    bool have_time = false;
+    double first = 0.0, last = 0.0;
+};
+
+/* Mode from the text log, for segments with no data: the last of the messages
+ * src/main.cpp writes on entering each mode
+ */
+static std::string log_mode(const MappedFile& log)
+{
+    static const struct { const char * text; const char * mode; } marks[] =
+    {
+        {"In Autonomous","auto"},
+        {"In Disabled","disabled"},
+        {"In Competition Initialize","disabled"},
+    };
+    std::string text(log.chars(),log.size());
+    std::string mode = "unknown";
+    size_t best = 0;
+    for(const auto& m : marks)
+    {
+        size_t at = text.rfind(m.text);
+        if(at != std::string::npos && at >= best)
+        {
+            best = at;
+            mode = m.mode;
+        }
+    }
+    return mode;
+}
+
+CatalogEntry ingest_segment(const std::string& archive, const std::string& id, const CardSegment& seg)
+{
+    CatalogEntry e;
+    e.id = id;
+    e.segment = seg.segment;
+    e.mode = "unknown";
+
+    if(!seg.data.empty())
+    {
+        auto src = open_rows(seg.data);
+        ModeRows rows(*src);
+        e.data = "data/" + id + ".feather";
+        std::string tmp = archive + "/" + e.data + ".tmp";
+        write_arrow(rows,tmp);
+        if(rename(tmp.c_str(),(archive + "/" + e.data).c_str()) < 0)
+        {
+            throw std::runtime_error(archive + "/" + e.data + ": " + strerror(errno));
+        }
+        e.rows = src->rows();
+        e.seconds = rows.seconds();
+        e.mode = rows.mode();
+    }
+
+    if(!seg.log.empty())
+    {
+        MappedFile log(seg.log);
+        e.log = "logs/" + id + ".txt";
+        replace_file(archive + "/" + e.log,std::string(log.chars(),log.size()));
+        if(e.data.empty()) e.mode = log_mode(log);
+    }
+    return e;
+}
+
+} /* namespace pal */
@@ -0,0 +1,114 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_ARCHIVE_HPP_
+#define _PAL_ARCHIVE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Archive of the logs of many robots, built up from SD card dumps
+ *
+ * The file index in /usd/index.txt restarts on every card, so the same name means
+ * different segments on different Brains, and the same segment is often dumped
+ * more than once. Segments are therefore stored by content id (see content_id()),
+ * and described by a catalog:
+ *   ARCHIVE/catalog.csv       one row per segment, by robot, date, segment, mode
+ *   ARCHIVE/sources.csv       every file ingested, to skip it next time
+ *   ARCHIVE/data/<id>.feather the data file, as Arrow IPC
+ *   ARCHIVE/logs/<id>.txt     the text log paired with it
+ */
+
+/* One segment in the catalog */
+struct CatalogEntry
+{
+    std::string id;         /* Content id of the data file and log together */
+    std::string robot;
+    std::string date;       /* YYYY-MM-DD */
+    int segment = -1;       /* File index on the card */
+    std::string mode;       /* auto, driver, disabled or unknown */
+    size_t rows = 0;
+    double seconds = 0.0;   /* Time from first to last row */
+    std::string data;       /* Paths within the archive, empty if missing */
+    std::string log;
+    std::string source;     /* Where the data file was first found */
+};
+
+/* A segment already ingested, by where its data file (or log) was found */
+struct SourceEntry
+{
+    uint64_t size = 0;      /* Of the data file and log together */
+    int64_t mtime = 0;      /* Of the newer of the two */
+    std::string id;
+};
+
+/* Catalog of an archive directory, creating the directory if needed
+ * Throws std::runtime_error if it can't be read or created
+ */
+class Archive
+{
+public:
+    explicit Archive(const std::string& dir);
+
+    const std::string& dir() const { return root; }
+    const std::vector<CatalogEntry>& entries() const { return catalog; }
+    const std::map<std::string, SourceEntry>& sources() const { return seen; }
+
+    /* Entry with content id, or nullptr */
+    const CatalogEntry * find(const std::string& id) const;
+
+    void add(const CatalogEntry& e);
+
+    /* Drop an entry and delete its files */
+    void remove(const std::string& id);
+    void add_source(const std::string& path, const SourceEntry& s) { seen[path] = s; }
+
+    /* Write catalog.csv and sources.csv, sorted, replacing the old ones whole */
+    void save() const;
+
+private:
+    std::string root;
+    std::vector<CatalogEntry> catalog;
+    std::map<std::string, size_t> by_id;
+    std::map<std::string, SourceEntry> seen;
+};
+
+/* A segment on a card dump: log%05d.txt and dat%05d.csv (or .bin) with the same index */
+struct CardSegment
+{
+    int segment;
+    std::string data;       /* Empty if missing */
+    std::string log;
+};
+
+/* Segments of a card dump directory, in index order
+ * Throws std::runtime_error if the directory can't be read
+ */
+std::vector<CardSegment> find_segments(const std::string& dir);
+
+/* First YYYY-MM-DD in a path, or an empty string */
+std::string path_date(const std::string& path);
+
+/* Date of a card dump, from a YYYY-MM-DD in its path, or else the modification
+ * time of file
+ */
+std::string dump_date(const std::string& dir, const std::string& file);
+
+/* Copy one segment into the archive directory under id, and describe it
+ * The caller fills in robot, date and source, the rest comes from the files
+ * Throws std::runtime_error if the files can't be read or written
+ */
+CatalogEntry ingest_segment(const std::string& archive, const std::string& id, const CardSegment& seg);
+
+} /* namespace pal */
+
+#endif /* _PAL_ARCHIVE_HPP_ */
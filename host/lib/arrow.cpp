@@ -0,0 +1,530 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "arrow.hpp"
+#include "flatbuf.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace pal
+{
+
+/* Rows per record batch */
+#define ARROW_BATCH_ROWS 65536
+
+/* Alignment of every buffer in the file */
+#define ARROW_ALIGN 64
+
+/* Enum values and field ids from the Arrow format (Schema.fbs, Message.fbs, File.fbs) */
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOAT 3
+#define ARROW_TYPE_BOOL 6
+#define ARROW_PRECISION_SINGLE 1
+#define ARROW_PRECISION_DOUBLE 2
+
+/* FieldNode and Buffer structs of a RecordBatch */
+struct ArrowFieldNode
+{
+    int64_t length;
+    int64_t null_count;
+};
+struct ArrowBuffer
+{
+    int64_t offset;
+    int64_t length;
+};
+
+/* Block struct of the file footer, locating a record batch message */
+struct ArrowBlock
+{
+    int64_t offset;
+    int32_t meta_len;
+    int32_t pad;
+    int64_t body_len;
+};
+
+/* Buffered writer which tracks the file position */
+class ArrowFile
+{
+public:
+    ArrowFile(const std::string& path) : path(path)
+    {
+        f = fopen(path.c_str(),"wb");
+        if(!f) throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    ~ArrowFile()
+    {
+        if(f) fclose(f);
+    }
+
+    void write(const void * data, size_t len)
+    {
+        if(len && fwrite(data,1,len,f) != len) throw std::runtime_error(path + ": " + strerror(errno));
+        pos += len;
+    }
+    void pad(size_t align)
+    {
+        static const uint8_t zero[ARROW_ALIGN] = {0};
+        write(zero,(align - pos % align) % align);
+    }
+    void close()
+    {
+        int err = fclose(f);
+        f = nullptr;
+        if(err) throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    std::string path;
+    FILE * f = nullptr;
+    size_t pos = 0;
+};
+
+/* Write an encapsulated message, padding the metadata so the body starts aligned
+ * Returns the metadata length including the prefix, for the footer
+ */
+static int32_t write_message(ArrowFile& out, const std::vector<uint8_t>& meta)
+{
+    size_t len = meta.size();
+    while((out.pos + 8 + len) % ARROW_ALIGN) len += 8;
+    uint32_t prefix[2] = {0xFFFFFFFFu,static_cast<uint32_t>(len)};
+    out.write(prefix,sizeof(prefix));
+    out.write(meta.data(),meta.size());
+    out.pad(ARROW_ALIGN);
+    return static_cast<int32_t>(8 + len);
+}
+
+/* Schema table, written both as the first message and in the footer */
+static FbRef make_schema(const std::vector<RowColumn>& cols)
+{
+    std::vector<FbRef> fields;
+    for(const auto& c : cols)
+    {
+        FbRef type = FbNode::table();
+        uint8_t type_id;
+        if(c.type == ColType::Bool)
+        {
+            type_id = ARROW_TYPE_BOOL;
+        }
+        else if(c.type == ColType::Int)
+        {
+            type_id = ARROW_TYPE_INT;
+            type->add_i32(0,32).add_u8(1,1);
+        }
+        else
+        {
+            type_id = ARROW_TYPE_FLOAT;
+            type->add_i16(0,ARROW_PRECISION_DOUBLE);
+        }
+
+        FbRef field = FbNode::table();
+        field->add(0,FbNode::string(c.name))
+            .add_u8(1,1)
+            .add_u8(2,type_id)
+            .add(3,type)
+            .add(5,FbNode::tables({}));
+        fields.push_back(field);
+    }
+    FbRef schema = FbNode::table();
+    schema->add_i16(0,0).add(1,FbNode::tables(fields));
+    return schema;
+}
+
+/* Message table wrapping a header */
+static std::vector<uint8_t> make_message(uint8_t header_type, FbRef header, int64_t body_len)
+{
+    FbRef msg = FbNode::table();
+    msg->add_i16(0,ARROW_METADATA_V5)
+        .add_u8(1,header_type)
+        .add(2,header)
+        .add_i64(3,body_len);
+    return msg->finish();
+}
+
+void write_arrow(RowSource& src, const std::string& path)
+{
+    const auto& cols = src.columns();
+    const size_t ncols = cols.size();
+    std::vector<ArrowBlock> blocks;
+
+    try
+    {
+        ArrowFile out(path);
+        out.write("ARROW1\0\0",8);
+        write_message(out,make_message(ARROW_HEADER_SCHEMA,make_schema(cols),0));
+
+        /* Batch buffers, reused for every batch */
+        std::vector<double> block(ncols * ARROW_BATCH_ROWS);
+        std::vector<uint8_t> valid((ARROW_BATCH_ROWS + 7) / 8);
+        std::vector<uint8_t> body;
+        size_t n;
+        while((n = src.read(block.data(),ARROW_BATCH_ROWS)))
+        {
+            std::vector<ArrowFieldNode> nodes;
+            std::vector<ArrowBuffer> bufs;
+            body.clear();
+
+            /* Each column is a validity bitmap (empty without nulls) and its values */
+            for(size_t c = 0; c < ncols; c++)
+            {
+                const double * v = &block[c * ARROW_BATCH_ROWS];
+                size_t bytes = (n + 7) / 8;
+                int64_t nulls = 0;
+                memset(valid.data(),0,bytes);
+                for(size_t r = 0; r < n; r++)
+                {
+                    if(std::isfinite(v[r])) valid[r / 8] |= 1 << (r % 8);
+                    else nulls++;
+                }
+                nodes.push_back({static_cast<int64_t>(n),nulls});
+
+                bufs.push_back({static_cast<int64_t>(body.size()),nulls ? static_cast<int64_t>(bytes) : 0});
+                if(nulls) body.insert(body.end(),valid.begin(),valid.begin() + bytes);
+                body.resize((body.size() + ARROW_ALIGN - 1) & ~(ARROW_ALIGN - 1),0);
+
+                size_t start = body.size();
+                if(cols[c].type == ColType::Bool)
+                {
+                    body.resize(start + bytes,0);
+                    for(size_t r = 0; r < n; r++)
+                    {
+                        if(std::isfinite(v[r]) && v[r] != 0.0) body[start + r / 8] |= 1 << (r % 8);
+                    }
+                }
+                else if(cols[c].type == ColType::Int)
+                {
+                    body.resize(start + n * sizeof(int32_t),0);
+                    for(size_t r = 0; r < n; r++)
+                    {
+                        int32_t iv = std::isfinite(v[r]) ? static_cast<int32_t>(v[r]) : 0;
+                        memcpy(&body[start + r * sizeof(iv)],&iv,sizeof(iv));
+                    }
+                }
+                else
+                {
+                    body.resize(start + n * sizeof(double),0);
+                    for(size_t r = 0; r < n; r++)
+                    {
+                        double dv = std::isfinite(v[r]) ? v[r] : 0.0;
+                        memcpy(&body[start + r * sizeof(dv)],&dv,sizeof(dv));
+                    }
+                }
+                bufs.push_back({static_cast<int64_t>(start),static_cast<int64_t>(body.size() - start)});
+                body.resize((body.size() + ARROW_ALIGN - 1) & ~(ARROW_ALIGN - 1),0);
+            }
+
+            FbRef batch = FbNode::table();
+            batch->add_i64(0,n)
+                .add(1,FbNode::structs(nodes.data(),sizeof(ArrowFieldNode),nodes.size(),8))
+                .add(2,FbNode::structs(bufs.data(),sizeof(ArrowBuffer),bufs.size(),8));
+
+            ArrowBlock b;
+            b.offset = out.pos;
+            b.meta_len = write_message(out,make_message(ARROW_HEADER_RECORD_BATCH,batch,body.size()));
+            b.pad = 0;
+            b.body_len = body.size();
+            out.write(body.data(),body.size());
+            blocks.push_back(b);
+        }
+
+        /* End of stream marker, then the footer which indexes the batches */
+        uint32_t eos[2] = {0xFFFFFFFFu,0};
+        out.write(eos,sizeof(eos));
+
+        FbRef footer = FbNode::table();
+        footer->add_i16(0,ARROW_METADATA_V5)
+            .add(1,make_schema(cols))
+            .add(2,FbNode::structs(nullptr,sizeof(ArrowBlock),0,8))
+            .add(3,FbNode::structs(blocks.data(),sizeof(ArrowBlock),blocks.size(),8));
+        std::vector<uint8_t> fb = footer->finish();
+        int32_t fb_len = static_cast<int32_t>(fb.size());
+        out.write(fb.data(),fb.size());
+        out.write(&fb_len,sizeof(fb_len));
+        out.write("ARROW1",6);
+        out.close();
+    }
+    catch(...)
+    {
+        remove(path.c_str());
+        throw;
+    }
+}
+
+/* Arrow IPC file, read a record batch at a time from the mapping */
+class ArrowRows : public RowSource
+{
+public:
+    explicit ArrowRows(MappedFile&& f) : file(std::move(f))
+    {
+        const uint8_t * data = file.data();
+        size_t len = file.size();
+        if(len < 20 || memcmp(data,"ARROW1",6) || memcmp(data + len - 6,"ARROW1",6))
+        {
+            throw std::runtime_error("not an Arrow IPC file");
+        }
+        int32_t fb_len;
+        memcpy(&fb_len,data + len - 10,sizeof(fb_len));
+        if(fb_len <= 0 || static_cast<size_t>(fb_len) > len - 18)
+        {
+            throw std::runtime_error("bad Arrow footer");
+        }
+        FbTable footer(data + len - 10 - fb_len,fb_len);
+
+        /* Schema, Field.type_type gives which table Field.type is */
+        FbTable schema = footer.table(1);
+        for(size_t i = 0; i < schema.count(1); i++)
+        {
+            FbTable field = schema.table_at(1,i);
+            Col c;
+            RowColumn rc{field.string(0),ColType::Double};
+            switch(field.u8(2))
+            {
+            case ARROW_TYPE_BOOL:
+                c.kind = Col::BOOL;
+                rc.type = ColType::Bool;
+                break;
+            case ARROW_TYPE_INT:
+            {
+                FbTable t = field.table(3);
+                c.size = t.i32(0) / 8;
+                c.kind = t.u8(1) ? Col::INT : Col::UINT;
+                if(c.size != 1 && c.size != 2 && c.size != 4 && c.size != 8)
+                {
+                    throw std::runtime_error("bad integer width in column " + rc.name);
+                }
+                rc.type = (c.size <= 2 || (c.size == 4 && c.kind == Col::INT)) ? ColType::Int : ColType::Double;
+                break;
+            }
+            case ARROW_TYPE_FLOAT:
+            {
+                int16_t prec = field.table(3).i16(0);
+                if(prec != ARROW_PRECISION_SINGLE && prec != ARROW_PRECISION_DOUBLE)
+                {
+                    throw std::runtime_error("half precision column " + rc.name);
+                }
+                c.kind = Col::FLOAT;
+                c.size = (prec == ARROW_PRECISION_DOUBLE) ? 8 : 4;
+                break;
+            }
+            default:
+                throw std::runtime_error("unsupported type in column " + rc.name);
+            }
+            if(field.count(5))
+            {
+                throw std::runtime_error("nested column " + rc.name);
+            }
+            cols.push_back(rc);
+            layout.push_back(c);
+        }
+
+        /* Record batches, through the blocks in the footer */
+        size_t nblocks;
+        const uint8_t * blocks = footer.structs(3,sizeof(ArrowBlock),&nblocks);
+        for(size_t b = 0; b < nblocks; b++)
+        {
+            ArrowBlock blk;
+            memcpy(&blk,blocks + b * sizeof(blk),sizeof(blk));
+            add_batch(blk);
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t r = 0;
+        while(r < max && batch < batches.size())
+        {
+            const Batch& bt = batches[batch];
+            size_t n = std::min(max - r,bt.rows - row);
+            for(size_t c = 0; c < layout.size(); c++)
+            {
+                copy(layout[c],bt.bufs[c],row,block + c * max + r,n);
+            }
+            r += n;
+            row += n;
+            if(row == bt.rows)
+            {
+                batch++;
+                row = 0;
+            }
+        }
+        return r;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        if(!nrows || layout.empty()) return false;
+        size_t a = 0, b = batches.size() - 1;
+        while(!batches[a].rows) a++;
+        while(!batches[b].rows) b--;
+        copy(layout[0],batches[a].bufs[0],0,&first,1);
+        copy(layout[0],batches[b].bufs[0],batches[b].rows - 1,&last,1);
+        return true;
+    }
+
+    /* Positions are the batch in the upper 32 bits and the row within it below */
+    uint64_t tell() const override
+    {
+        return (static_cast<uint64_t>(batch) << 32) | row;
+    }
+
+    void seek(uint64_t pos) override
+    {
+        size_t b = pos >> 32;
+        size_t r = pos & 0xFFFFFFFFu;
+        if(b > batches.size() || (b < batches.size() && r >= batches[b].rows) || (b == batches.size() && r))
+        {
+            throw std::runtime_error("seek out of range");
+        }
+        batch = b;
+        row = r;
+    }
+
+private:
+    /* How a column is stored */
+    struct Col
+    {
+        enum { BOOL, INT, UINT, FLOAT } kind;
+        size_t size = 0;
+    };
+
+    /* Where a column's buffers are in one batch */
+    struct Bufs
+    {
+        const uint8_t * valid;      /* nullptr if there are no nulls */
+        const uint8_t * values;
+    };
+
+    struct Batch
+    {
+        size_t rows;
+        std::vector<Bufs> bufs;
+    };
+
+    void add_batch(const ArrowBlock& blk)
+    {
+        const uint8_t * data = file.data();
+        size_t len = file.size();
+        if(blk.offset < 0 || blk.meta_len < 8 || blk.body_len < 0 ||
+            static_cast<uint64_t>(blk.offset) + blk.meta_len + blk.body_len > len)
+        {
+            throw std::runtime_error("Arrow record batch out of range");
+        }
+
+        /* Message is the continuation marker and length, then the flatbuffer */
+        const uint8_t * msg = data + blk.offset;
+        uint32_t marker;
+        memcpy(&marker,msg,sizeof(marker));
+        size_t skip = (marker == 0xFFFFFFFFu) ? 8 : 4;
+        FbTable message(msg + skip,blk.meta_len - skip);
+        if(message.u8(1) != ARROW_HEADER_RECORD_BATCH)
+        {
+            throw std::runtime_error("Arrow block is not a record batch");
+        }
+        FbTable rb = message.table(2);
+        if(rb.has(3))
+        {
+            throw std::runtime_error("compressed Arrow files are not supported");
+        }
+
+        Batch bt;
+        bt.rows = rb.i64(0);
+        size_t nnodes, nbufs;
+        const uint8_t * nodes = rb.structs(1,sizeof(ArrowFieldNode),&nnodes);
+        const uint8_t * bufs = rb.structs(2,sizeof(ArrowBuffer),&nbufs);
+        if(nnodes != layout.size() || nbufs != 2 * layout.size())
+        {
+            throw std::runtime_error("Arrow record batch does not match the schema");
+        }
+        const uint8_t * body = msg + blk.meta_len;
+        for(size_t c = 0; c < layout.size(); c++)
+        {
+            ArrowFieldNode node;
+            ArrowBuffer valid, values;
+            memcpy(&node,nodes + c * sizeof(node),sizeof(node));
+            memcpy(&valid,bufs + 2 * c * sizeof(valid),sizeof(valid));
+            memcpy(&values,bufs + (2 * c + 1) * sizeof(values),sizeof(values));
+
+            size_t need = (layout[c].kind == Col::BOOL) ? (bt.rows + 7) / 8 : bt.rows * layout[c].size;
+            if(static_cast<size_t>(node.length) != bt.rows || values.offset < 0 ||
+                values.length < static_cast<int64_t>(need) || values.offset + values.length > blk.body_len ||
+                (node.null_count && (valid.offset < 0 || valid.length < static_cast<int64_t>((bt.rows + 7) / 8) ||
+                valid.offset + valid.length > blk.body_len)))
+            {
+                throw std::runtime_error("Arrow buffer out of range in column " + cols[c].name);
+            }
+            bt.bufs.push_back({node.null_count ? body + valid.offset : nullptr,body + values.offset});
+        }
+        nrows += bt.rows;
+        batches.push_back(std::move(bt));
+    }
+
+    /* Copy n rows of a column of a batch, from row start */
+    static void copy(const Col& c, const Bufs& b, size_t start, double * out, size_t n)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            size_t r = start + i;
+            double v;
+            const uint8_t * q = b.values + r * c.size;
+            switch(c.kind)
+            {
+            case Col::BOOL:
+                v = (b.values[r / 8] >> (r % 8)) & 1;
+                break;
+            case Col::FLOAT:
+                if(c.size == 8)
+                {
+                    memcpy(&v,q,sizeof(v));
+                }
+                else
+                {
+                    float fv;
+                    memcpy(&fv,q,sizeof(fv));
+                    v = fv;
+                }
+                break;
+            default:
+            {
+                uint64_t u = 0;
+                memcpy(&u,q,c.size);
+                if(c.kind == Col::INT && c.size < 8 && (u >> (8 * c.size - 1)) & 1)
+                {
+                    u |= ~0ULL << (8 * c.size);
+                }
+                v = (c.kind == Col::INT) ? static_cast<double>(static_cast<int64_t>(u)) : static_cast<double>(u);
+                break;
+            }
+            }
+            if(b.valid && !((b.valid[r / 8] >> (r % 8)) & 1))
+            {
+                v = std::numeric_limits<double>::quiet_NaN();
+            }
+            out[i] = v;
+        }
+    }
+
+    MappedFile file;
+    std::vector<Col> layout;
+    std::vector<Batch> batches;
+    size_t batch = 0;
+    size_t row = 0;
+};
+
+std::unique_ptr<RowSource> open_arrow(MappedFile&& file)
+{
+    return std::unique_ptr<RowSource>(new ArrowRows(std::move(file)));
+}
+
+} /* namespace pal */
@@ -0,0 +1,39 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_ARROW_HPP_
+#define _PAL_ARROW_HPP_
+
+#include "mapped_file.hpp"
+#include "rows.hpp"
+
+#include <memory>
+#include <string>
+
+namespace pal
+{
+
+/* Write a row source to an Arrow IPC file (Feather v2), without the Arrow library
+ * Columns keep their types: flags become bit-packed bool, ints int32 and the rest
+ * float64. Non-finite values (the inf sensors report before they are ready, or
+ * empty CSV fields) become nulls. Rows are written in record batches of
+ * ARROW_BATCH_ROWS, so memory use does not grow with the file, and every buffer
+ * starts 64-byte aligned in the file so readers can mmap it in place
+ * Throws std::runtime_error if the file can't be written
+ */
+void write_arrow(RowSource& src, const std::string& path);
+
+/* Row source over an Arrow IPC file, such as those written by write_arrow()
+ * Bool, integer and floating point columns are read in place from the mapping,
+ * nulls become NaN. The first column is taken as the time in seconds
+ * Throws std::runtime_error if the file is not Arrow IPC or has other column
+ * types or compressed buffers
+ */
+std::unique_ptr<RowSource> open_arrow(MappedFile&& file);
+
+} /* namespace pal */
+
+#endif /* _PAL_ARROW_HPP_ */
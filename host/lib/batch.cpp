@@ -0,0 +1,107 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace pal
+{
+
+/* Data files are named dat%05d.csv or dat%05d.bin by the logger */
+static bool is_log_name(const std::string& name)
+{
+    if(name.size() < 8 || name.compare(0,3,"dat")) return false;
+    std::string ext = name.substr(name.size() - 4);
+    return ext == ".csv" || ext == ".bin";
+}
+
+std::vector<std::string> find_logs(const std::vector<std::string>& args)
+{
+    std::vector<std::string> files;
+    for(const auto& a : args)
+    {
+        struct stat st;
+        if(stat(a.c_str(),&st) < 0 || !S_ISDIR(st.st_mode))
+        {
+            files.push_back(a);
+            continue;
+        }
+
+        DIR * d = opendir(a.c_str());
+        if(!d)
+        {
+            throw std::runtime_error(a + ": " + strerror(errno));
+        }
+        std::vector<std::string> found;
+        while(struct dirent * e = readdir(d))
+        {
+            if(is_log_name(e->d_name)) found.push_back(a + "/" + e->d_name);
+        }
+        closedir(d);
+        std::sort(found.begin(),found.end());
+        files.insert(files.end(),found.begin(),found.end());
+    }
+    return files;
+}
+
+void parallel_for(size_t n, unsigned threads, const std::function<void(size_t)>& fn)
+{
+    if(!threads) threads = std::thread::hardware_concurrency();
+    if(!threads) threads = 1;
+    if(threads > n) threads = static_cast<unsigned>(n);
+
+    /* Each worker takes the next index, so long and short jobs balance out */
+    std::atomic<size_t> next(0);
+    auto worker = [&]
+    {
+        for(size_t i = next++; i < n; i = next++) fn(i);
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for(auto& t : pool) t.join();
+}
+
+std::string output_path(const std::string& path, const std::string& dir, const std::string& ext)
+{
+    size_t slash = path.find_last_of('/');
+    std::string base = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    size_t dot = base.find_last_of('.');
+    if(dot != std::string::npos && dot > 0) base.resize(dot);
+    if(!dir.empty()) return dir + "/" + base + ext;
+    return ((slash == std::string::npos) ? std::string() : path.substr(0,slash + 1)) + base + ext;
+}
+
+std::vector<std::string> output_paths(const std::vector<std::string>& files, const std::string& dir,
+    const std::string& ext)
+{
+    std::vector<std::string> outs;
+    std::map<std::string, size_t> from;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        outs.push_back(output_path(files[i],dir,ext));
+        auto in = from.emplace(outs.back(),i);
+        if(!in.second)
+        {
+            throw std::runtime_error(files[in.first->second] + " and " + files[i] + " would both write " +
+                outs.back());
+        }
+    }
+    return outs;
+}
+
+} /* namespace pal */
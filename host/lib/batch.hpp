@@ -0,0 +1,41 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_BATCH_HPP_
+#define _PAL_BATCH_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Expand command line arguments into data files. Files are kept as given, and
+ * directories give their dat*.csv and dat*.bin files in name order
+ * Throws std::runtime_error if a directory can't be read
+ */
+std::vector<std::string> find_logs(const std::vector<std::string>& args);
+
+/* Call fn(i) for every i in [0,n), spread over up to threads threads (0 uses
+ * every core). fn must not throw
+ */
+void parallel_for(size_t n, unsigned threads, const std::function<void(size_t)>& fn);
+
+/* Path with its directory replaced by dir (if not empty) and its extension by ext */
+std::string output_path(const std::string& path, const std::string& dir, const std::string& ext);
+
+/* output_path() of every file, for tools which write them in parallel
+ * Throws std::runtime_error if two files would write the same output, i.e. files of
+ * the same name from different directories under one dir, or a .csv and .bin pair
+ */
+std::vector<std::string> output_paths(const std::vector<std::string>& files, const std::string& dir,
+    const std::string& ext);
+
+} /* namespace pal */
+
+#endif /* _PAL_BATCH_HPP_ */
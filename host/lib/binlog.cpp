@@ -0,0 +1,355 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "binlog.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace pal
+{
+
+/* Types allowed in a VAR layout, matching log_layout_size() in src/log.c */
+static const struct
+{
+    const char * name;
+    size_t size;
+} var_types[] =
+{
+    {"i8",1},{"u8",1},{"i16",2},{"u16",2},{"i32",4},{"u32",4},{"f32",4},{"f64",8}
+};
+
+std::vector<VarField> parse_layout(const std::string& layout)
+{
+    std::vector<VarField> fields;
+    size_t offset = 0;
+    size_t p = 0;
+    while(p < layout.size())
+    {
+        size_t comma = layout.find(',',p);
+        if(comma == std::string::npos) comma = layout.size();
+        std::string field = layout.substr(p,comma - p);
+        p = comma + 1;
+
+        size_t colon = field.find(':');
+        if(colon == std::string::npos)
+        {
+            throw std::runtime_error("bad layout field '" + field + "'");
+        }
+        VarField f;
+        f.name = field.substr(0,colon);
+        f.type = field.substr(colon + 1);
+        f.offset = offset;
+        f.size = 0;
+        for(const auto& t : var_types)
+        {
+            if(f.type == t.name) f.size = t.size;
+        }
+        if(!f.size)
+        {
+            throw std::runtime_error("unknown layout type '" + f.type + "'");
+        }
+        offset += f.size;
+        fields.push_back(f);
+    }
+    return fields;
+}
+
+/* Read a value of type T from a packed (possibly unaligned) struct */
+template <typename T>
+static inline double read_packed(const uint8_t * p)
+{
+    T v;
+    memcpy(&v,p,sizeof(v));
+    return static_cast<double>(v);
+}
+
+double var_field_value(const VarField& f, const uint8_t * rec)
+{
+    const uint8_t * p = rec + f.offset;
+    switch(f.type[0])
+    {
+    case 'i':
+        if(f.size == 1) return read_packed<int8_t>(p);
+        if(f.size == 2) return read_packed<int16_t>(p);
+        return read_packed<int32_t>(p);
+    case 'u':
+        if(f.size == 1) return read_packed<uint8_t>(p);
+        if(f.size == 2) return read_packed<uint16_t>(p);
+        return read_packed<uint32_t>(p);
+    default:
+        if(f.size == 4) return read_packed<float>(p);
+        return read_packed<double>(p);
+    }
+}
+
+std::string BinChannel::element_name(int i) const
+{
+    static const char * xyz_names[] = {"x","y","z","w"};
+    static const char * euler_names[] = {"pitch","roll","yaw"};
+
+    if(count == 1 || !in_row()) return name;
+    if(shape == LOG_SHAPE_XYZ && i < 4) return name + "_" + xyz_names[i];
+    if(shape == LOG_SHAPE_EULER && i < 3) return name + "_" + euler_names[i];
+    return name + "_" + std::to_string(i);
+}
+
+BinChannel parse_channel(const uint8_t * payload, uint32_t len)
+{
+    /* The fixed part is followed by the name and, for VAR channels, the layout */
+    log_bin_channel_t ch;
+    if(len < sizeof(ch) + 1)
+    {
+        throw std::runtime_error("channel record too short");
+    }
+    memcpy(&ch,payload,sizeof(ch));
+    const char * str = reinterpret_cast<const char *>(payload + sizeof(ch));
+    size_t slen = len - sizeof(ch);
+
+    BinChannel c;
+    c.name.assign(str,strnlen(str,slen));
+    if(c.name.size() + 1 < slen)
+    {
+        const char * lay = str + c.name.size() + 1;
+        c.layout.assign(lay,strnlen(lay,slen - c.name.size() - 1));
+    }
+    c.type = ch.type;
+    c.flags = ch.flags;
+    c.shape = ch.shape;
+    c.count = ch.count;
+    c.offset = ch.offset;
+    c.ts_offset = 0;
+    if(c.in_row() && (c.flags & LOG_CHAN_TS)) c.ts_offset = ch.ts_offset;
+    return c;
+}
+
+BinCursor::BinCursor(const uint8_t * data, size_t len) : data(data), len(len)
+{
+    if(len < sizeof(hdr))
+    {
+        throw std::runtime_error("too short for a binary log");
+    }
+    memcpy(&hdr,data,sizeof(hdr));
+    if(memcmp(hdr.magic,LOG_BIN_MAGIC,sizeof(hdr.magic)) || hdr.header_len < sizeof(hdr))
+    {
+        throw std::runtime_error("not a binary log");
+    }
+    if(hdr.version != LOG_BIN_VERSION)
+    {
+        throw std::runtime_error("unsupported version " + std::to_string(hdr.version));
+    }
+    pos = 0;
+    next_pos = hdr.header_len;
+    memset(&rec,0,sizeof(rec));
+}
+
+bool BinCursor::next()
+{
+    if(cut || next_pos >= len) return false;
+    if(len - next_pos < sizeof(rec))
+    {
+        cut = true;
+        return false;
+    }
+    memcpy(&rec,data + next_pos,sizeof(rec));
+    if(rec.len > len - next_pos - sizeof(rec))
+    {
+        cut = true;
+        return false;
+    }
+    pos = next_pos;
+    next_pos = pos + sizeof(rec) + LOG_BIN_PAD(rec.len);
+    return true;
+}
+
+void BinCursor::seek(size_t to)
+{
+    if(to < hdr.header_len || to > len)
+    {
+        throw std::runtime_error("seek out of range");
+    }
+    pos = 0;
+    next_pos = to;
+    cut = false;
+    memset(&rec,0,sizeof(rec));
+}
+
+BinLog::BinLog(const std::string& path) : file(path)
+{
+    try
+    {
+        index();
+    }
+    catch(const std::runtime_error& e)
+    {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+/* Walk the records once, building the schema and the indexes */
+void BinLog::index()
+{
+    BinCursor cur(file.data(),file.size());
+    open_time = cur.header().open_ms;
+
+    size_t row_len = 0;
+    while(cur.next())
+    {
+        const log_bin_record_t& rec = cur.record();
+        switch(rec.type)
+        {
+        case LOG_REC_CHANNEL:
+        {
+            /* Channel records are numbered in order, anything else is corrupt */
+            if(rec.chan != chans.size())
+            {
+                throw std::runtime_error("channel records out of order");
+            }
+            BinChannel c = parse_channel(cur.payload(),rec.len);
+            if(c.in_row())
+            {
+                size_t end = c.offset + c.value_size() * c.count;
+                if(end > row_len) row_len = end;
+                if(c.flags & LOG_CHAN_TS) end = c.ts_offset + sizeof(int32_t);
+                if(end > row_len) row_len = end;
+            }
+            chans.push_back(c);
+            rec_index.emplace_back();
+            break;
+        }
+        case LOG_REC_ROW:
+            /* Rows shorter than the schema can't be read in place */
+            if(rec.len >= row_len && rec.len >= sizeof(log_bin_row_t))
+            {
+                row_index.push_back(cur.offset());
+            }
+            break;
+        case LOG_REC_VAR:
+            if(rec.chan < chans.size() && rec.len >= sizeof(log_bin_var_t))
+            {
+                rec_index[rec.chan].push_back(cur.offset());
+            }
+            break;
+        case LOG_REC_POINT:
+            if(rec.chan < chans.size() && rec.len >= sizeof(log_bin_point_t))
+            {
+                rec_index[rec.chan].push_back(cur.offset());
+            }
+            break;
+        default:
+            /* Unknown records are skipped, so newer files still read */
+            break;
+        }
+    }
+    cut = cur.truncated();
+
+    /* Rows are evenly spaced unless other records sit between them */
+    if(row_index.size() > 1)
+    {
+        row_stride = row_index[1] - row_index[0];
+        for(size_t i = 2; i < row_index.size() && row_stride; i++)
+        {
+            if(row_index[i] - row_index[i - 1] != row_stride) row_stride = 0;
+        }
+    }
+    else
+    {
+        row_stride = LOG_BIN_PAD(row_len) + sizeof(log_bin_record_t);
+    }
+}
+
+int BinLog::find(const std::string& name) const
+{
+    for(size_t i = 0; i < chans.size(); i++)
+    {
+        if(chans[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const BinChannel& BinLog::row_channel(int chan, uint8_t type) const
+{
+    if(chan < 0 || static_cast<size_t>(chan) >= chans.size())
+    {
+        throw std::runtime_error(path() + ": no channel " + std::to_string(chan));
+    }
+    const BinChannel& c = chans[chan];
+    if(!c.in_row())
+    {
+        throw std::runtime_error(path() + ": " + c.name + " is not stored in the rows");
+    }
+    if(type && c.type != type)
+    {
+        throw std::runtime_error(path() + ": " + c.name + " read as the wrong type");
+    }
+    return c;
+}
+
+Column<uint32_t> BinLog::time() const
+{
+    return at<uint32_t>(offsetof(log_bin_row_t,time_ms));
+}
+
+Column<int32_t> BinLog::sample_delta(int chan) const
+{
+    const BinChannel& c = row_channel(chan,0);
+    if(!(c.flags & LOG_CHAN_TS))
+    {
+        throw std::runtime_error(path() + ": " + c.name + " has no sample times");
+    }
+    return at<int32_t>(c.ts_offset);
+}
+
+double BinLog::value(int chan, int element, size_t row) const
+{
+    const BinChannel& c = row_channel(chan,0);
+    const uint8_t * p = file.data() + row_index.at(row) + c.offset + element * c.value_size();
+    if(c.type == LOG_TYPE_INT) return *reinterpret_cast<const int32_t *>(p);
+    return *reinterpret_cast<const double *>(p);
+}
+
+Records<log_bin_var_t> BinLog::vars(int chan) const
+{
+    if(chan < 0 || static_cast<size_t>(chan) >= chans.size() || !(chans[chan].flags & LOG_CHAN_VAR))
+    {
+        throw std::runtime_error(path() + ": not a VAR channel");
+    }
+    const auto& idx = rec_index[chan];
+    return Records<log_bin_var_t>(file.data(),idx.data(),idx.size());
+}
+
+Records<log_bin_point_t> BinLog::points(int chan) const
+{
+    if(chan < 0 || static_cast<size_t>(chan) >= chans.size() || !(chans[chan].flags & LOG_CHAN_SPARSE))
+    {
+        throw std::runtime_error(path() + ": not a compressed channel");
+    }
+    const auto& idx = rec_index[chan];
+    return Records<log_bin_point_t>(file.data(),idx.data(),idx.size());
+}
+
+std::pair<size_t,size_t> BinLog::range(uint32_t t0_ms, uint32_t t1_ms) const
+{
+    /* Row times come from millis(), so they never go backwards within a file */
+    Column<uint32_t> t = time();
+    auto lower = [&](uint32_t v)
+    {
+        size_t lo = 0, hi = t.size();
+        while(lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if(t[mid] < v) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    };
+    size_t first = lower(t0_ms);
+    size_t last = lower(t1_ms);
+    if(last < first) last = first;
+    return {first,last};
+}
+
+} /* namespace pal */
@@ -0,0 +1,304 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_BINLOG_HPP_
+#define _PAL_BINLOG_HPP_
+
+#include "mapped_file.hpp"
+#include "pal/log_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pal
+{
+
+/* Contiguous run of values, i.e. the elements of a vector channel within one row */
+template <typename T>
+struct Span
+{
+    const T * ptr = nullptr;
+    size_t n = 0;
+
+    const T * begin() const { return ptr; }
+    const T * end() const { return ptr + n; }
+    size_t size() const { return n; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+};
+
+/* Read-only view of one value in each row of the mapped file, without copying
+ * When the rows are evenly spaced (no VAR or POINT records between them) the view
+ * is a plain stride, otherwise it goes through the row index
+ * Values are read in place, which is safe since every row starts 8-byte aligned
+ * and the logger places values at their natural alignment
+ */
+template <typename T>
+class Column
+{
+public:
+    Column() = default;
+    Column(const uint8_t * base, size_t stride, const uint64_t * index, size_t n)
+        : base(base), stride(stride), index(index), n(n) {}
+
+    size_t size() const { return n; }
+
+    const T& operator[](size_t i) const
+    {
+        const uint8_t * p = stride ? base + i * stride : base + index[i];
+        return *reinterpret_cast<const T *>(p);
+    }
+
+    /* View of rows [first,last) */
+    Column slice(size_t first, size_t last) const
+    {
+        if(last > n) last = n;
+        if(first > last) first = last;
+        if(stride) return Column(base + first * stride,stride,nullptr,last - first);
+        return Column(base,0,index + first,last - first);
+    }
+
+    /* Call fn with every value, with the stride check hoisted out of the loop */
+    template <typename F>
+    void for_each(F fn) const
+    {
+        if(stride)
+        {
+            const uint8_t * p = base;
+            for(size_t i = 0; i < n; i++, p += stride) fn(*reinterpret_cast<const T *>(p));
+        }
+        else
+        {
+            for(size_t i = 0; i < n; i++) fn(*reinterpret_cast<const T *>(base + index[i]));
+        }
+    }
+
+private:
+    const uint8_t * base = nullptr;
+    size_t stride = 0;
+    const uint64_t * index = nullptr;
+    size_t n = 0;
+};
+
+/* Read-only view of the VAR or POINT records of one channel, in time order
+ * Element i is the record payload, i.e. a log_bin_var_t or log_bin_point_t
+ */
+template <typename T>
+class Records
+{
+public:
+    Records() = default;
+    Records(const uint8_t * base, const uint64_t * index, size_t n)
+        : base(base), index(index), n(n) {}
+
+    size_t size() const { return n; }
+    const T& operator[](size_t i) const { return *reinterpret_cast<const T *>(base + index[i]); }
+
+    /* Records with time in [t0_ms,t1_ms) */
+    Records slice_time(uint32_t t0_ms, uint32_t t1_ms) const
+    {
+        size_t first = lower(t0_ms);
+        size_t last = lower(t1_ms);
+        if(last < first) last = first;
+        return Records(base,index + first,last - first);
+    }
+
+private:
+    size_t lower(uint32_t t) const
+    {
+        size_t lo = 0, hi = n;
+        while(lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if((*this)[mid].time_ms < t) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    const uint8_t * base = nullptr;
+    const uint64_t * index = nullptr;
+    size_t n = 0;
+};
+
+/* A field of a VAR channel's struct layout */
+struct VarField
+{
+    std::string name;
+    std::string type;       /* i8, u8, i16, u16, i32, u32, f32 or f64 */
+    size_t offset;          /* Offset within the struct */
+    size_t size;
+};
+
+/* Parse a VAR layout string ("name:type,name:type,...")
+ * Throws std::runtime_error if it contains an unknown type
+ */
+std::vector<VarField> parse_layout(const std::string& layout);
+
+/* Read a VAR field from a packed struct as a double */
+double var_field_value(const VarField& f, const uint8_t * rec);
+
+/* A channel from the schema of a binary data file */
+struct BinChannel
+{
+    std::string name;
+    std::string layout;     /* Struct layout of VAR channels, empty otherwise */
+    uint8_t type;           /* LOG_TYPE_* */
+    uint8_t flags;          /* LOG_CHAN_* */
+    uint8_t shape;          /* LOG_SHAPE_* */
+    uint16_t count;         /* Values per row, or struct size for VAR channels */
+    uint16_t offset;        /* Offset of the first value within the ROW payload */
+    uint16_t ts_offset;     /* Offset of the sample time delta, if LOG_CHAN_TS is set */
+
+    /* Channels which have a value in every row */
+    bool in_row() const { return !(flags & (LOG_CHAN_VAR | LOG_CHAN_SPARSE)); }
+
+    /* Size of one value in the row */
+    size_t value_size() const { return (type == LOG_TYPE_INT) ? sizeof(int32_t) : sizeof(double); }
+
+    /* Column name of element i, as the CSV header and model/readlog.m name them */
+    std::string element_name(int i) const;
+};
+
+/* Parse the payload of a CHANNEL record
+ * Throws std::runtime_error if it is too short
+ */
+BinChannel parse_channel(const uint8_t * payload, uint32_t len);
+
+/* Forward walk over the records of a binary file, without building an index
+ * BinLog uses this to build its index, and the streaming exporters use it directly
+ * so their memory use does not grow with the file
+ */
+class BinCursor
+{
+public:
+    /* Check the file header and start before the first record
+     * Throws std::runtime_error if the data is not a binary log
+     */
+    BinCursor(const uint8_t * data, size_t len);
+
+    /* Move to the next record, returning false at the end of the file or at a
+     * record cut short by the end of the file
+     */
+    bool next();
+
+    const log_bin_header_t& header() const { return hdr; }
+    const log_bin_record_t& record() const { return rec; }
+    const uint8_t * payload() const { return data + pos + sizeof(rec); }
+    size_t offset() const { return pos + sizeof(rec); }
+    bool truncated() const { return cut; }
+
+    /* File offset of the record next() moves to, and a move back to such an offset
+     * Throws std::runtime_error if pos is not within the file
+     */
+    size_t tell() const { return next_pos; }
+    void seek(size_t pos);
+
+private:
+    const uint8_t * data;
+    size_t len;
+    size_t pos;
+    size_t next_pos;
+    bool cut = false;
+    log_bin_header_t hdr;
+    log_bin_record_t rec;
+};
+
+/* Binary data file (dat%05d.bin), mapped into memory and indexed on open
+ * The file stays mapped for the life of the object, and every view points into it,
+ * so views must not outlive the BinLog they came from
+ * A record cut short at the end of the file (i.e. the robot lost power) ends the
+ * file there, and sets truncated()
+ * Throws std::runtime_error if the file can't be read or is not a binary log
+ */
+class BinLog
+{
+public:
+    explicit BinLog(const std::string& path);
+
+    const std::string& path() const { return file.path(); }
+    const MappedFile& mapped() const { return file; }
+    uint32_t open_ms() const { return open_time; }
+    bool truncated() const { return cut; }
+
+    const std::vector<BinChannel>& channels() const { return chans; }
+
+    /* Index of the named channel, or -1 if it is not present */
+    int find(const std::string& name) const;
+
+    size_t rows() const { return row_index.size(); }
+
+    /* Row time in ms, from log_step() */
+    Column<uint32_t> time() const;
+
+    /* Element of a row channel, T must be int32_t for LOG_TYPE_INT or double for
+     * LOG_TYPE_DBL. Throws std::runtime_error on a type or channel mismatch
+     */
+    template <typename T>
+    Column<T> column(int chan, int element = 0) const;
+
+    /* Sample time delta from the row time in us, for channels with LOG_CHAN_TS */
+    Column<int32_t> sample_delta(int chan) const;
+
+    /* All elements of a vector channel in one row */
+    template <typename T>
+    Span<T> values(int chan, size_t row) const;
+
+    /* Element of a row channel as a double, whatever its type */
+    double value(int chan, int element, size_t row) const;
+
+    /* VAR and POINT records of a channel */
+    Records<log_bin_var_t> vars(int chan) const;
+    Records<log_bin_point_t> points(int chan) const;
+
+    /* Rows with time in [t0_ms,t1_ms), as an index range for Column::slice() */
+    std::pair<size_t,size_t> range(uint32_t t0_ms, uint32_t t1_ms) const;
+
+private:
+    void index();
+    const BinChannel& row_channel(int chan, uint8_t type) const;
+    template <typename T>
+    Column<T> at(size_t offset) const;
+
+    MappedFile file;
+    uint32_t open_time = 0;
+    bool cut = false;
+    std::vector<BinChannel> chans;
+    std::vector<uint64_t> row_index;    /* File offset of each ROW payload */
+    size_t row_stride = 0;              /* Spacing of the rows, or 0 if they are uneven */
+    std::vector<std::vector<uint64_t>> rec_index;   /* File offsets of VAR or POINT payloads */
+};
+
+template <typename T>
+Column<T> BinLog::at(size_t offset) const
+{
+    if(row_index.empty()) return Column<T>();
+    if(row_stride) return Column<T>(file.data() + row_index[0] + offset,row_stride,nullptr,row_index.size());
+    return Column<T>(file.data() + offset,0,row_index.data(),row_index.size());
+}
+
+template <typename T>
+Column<T> BinLog::column(int chan, int element) const
+{
+    static_assert(sizeof(T) == sizeof(int32_t) || sizeof(T) == sizeof(double),"Columns are int32_t or double");
+    const BinChannel& c = row_channel(chan,(sizeof(T) == sizeof(int32_t)) ? LOG_TYPE_INT : LOG_TYPE_DBL);
+    if(element < 0 || element >= c.count) throw std::out_of_range("element out of range");
+    return at<T>(c.offset + element * sizeof(T));
+}
+
+template <typename T>
+Span<T> BinLog::values(int chan, size_t row) const
+{
+    const BinChannel& c = row_channel(chan,(sizeof(T) == sizeof(int32_t)) ? LOG_TYPE_INT : LOG_TYPE_DBL);
+    return Span<T>{reinterpret_cast<const T *>(file.data() + row_index.at(row) + c.offset),c.count};
+}
+
+} /* namespace pal */
+
+#endif /* _PAL_BINLOG_HPP_ */
@@ -0,0 +1,312 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "csv.hpp"
+#include "mapped_file.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace pal
+{
+
+/* Exact powers of ten, any double mantissa below 2^53 divided by one of these is
+ * correctly rounded
+ */
+static const double pow10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Check that all 8 bytes of a little-endian word are ASCII digits */
+static inline bool is_eight_digits(uint64_t v)
+{
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+        (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+        0x3333333333333333ULL);
+}
+
+/* Convert 8 ASCII digits in a little-endian word to their value, using three
+ * multiplies rather than eight
+ */
+static inline uint32_t parse_eight_digits(uint64_t v)
+{
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL; /* 100 + (1000000ULL << 32) */
+    const uint64_t mul2 = 0x0000271000000001ULL; /* 1 + (10000ULL << 32) */
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(v);
+}
+
+/* Read a run of digits into the mantissa, 8 at a time where possible
+ * Returns the number of digits consumed, and clears ok if the mantissa overflowed
+ */
+static inline int parse_digits(const char *& p, const char * end, uint64_t& mant, bool& ok)
+{
+    int n = 0;
+    while(end - p >= 8)
+    {
+        uint64_t v;
+        memcpy(&v,p,sizeof(v));
+        if(!is_eight_digits(v)) break;
+        if(mant > (UINT64_MAX - 99999999ULL) / 100000000ULL) ok = false;
+        mant = mant * 100000000ULL + parse_eight_digits(v);
+        p += 8;
+        n += 8;
+    }
+    while(p < end && (unsigned)(*p - '0') < 10)
+    {
+        if(mant > (UINT64_MAX - 9) / 10) ok = false;
+        mant = mant * 10 + (*p - '0');
+        p++;
+        n++;
+    }
+    return n;
+}
+
+/* Case-insensitive match of a word at p */
+static bool match_word(const char * p, const char * end, const char * word)
+{
+    size_t n = strlen(word);
+    if((size_t)(end - p) != n) return false;
+    for(size_t i = 0; i < n; i++)
+    {
+        if((p[i] | 0x20) != word[i]) return false;
+    }
+    return true;
+}
+
+/* Slow path, for anything the fast path can't round correctly */
+static double parse_slow(const char * p, const char * end)
+{
+    char buf[64];
+    size_t n = end - p;
+    if(n >= sizeof(buf)) return std::numeric_limits<double>::quiet_NaN();
+    memcpy(buf,p,n);
+    buf[n] = 0;
+    char * stop;
+    double v = strtod(buf,&stop);
+    return (stop == buf) ? std::numeric_limits<double>::quiet_NaN() : v;
+}
+
+double parse_field(const char * p, const char * end)
+{
+    const char * start = p;
+
+    /* Trim spaces, which the logger never writes but hand-edited files might have */
+    while(p < end && *p == ' ') p++;
+    while(end > p && (end[-1] == ' ' || end[-1] == '\r')) end--;
+    if(p == end) return std::numeric_limits<double>::quiet_NaN();
+
+    bool neg = false;
+    if(*p == '-' || *p == '+')
+    {
+        neg = (*p == '-');
+        p++;
+    }
+
+    /* inf is what PROS returns for sensors which are not ready */
+    if(p < end && (*p | 0x20) >= 'a' && (*p | 0x20) <= 'z')
+    {
+        if(match_word(p,end,"inf") || match_word(p,end,"infinity"))
+        {
+            return neg ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        }
+        if(match_word(p,end,"nan"))
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return parse_slow(start,end);
+    }
+
+    uint64_t mant = 0;
+    bool ok = true;
+    int idigits = parse_digits(p,end,mant,ok);
+    int fdigits = 0;
+    if(p < end && *p == '.')
+    {
+        p++;
+        fdigits = parse_digits(p,end,mant,ok);
+    }
+
+    /* Anything left over (an exponent) or a mantissa that doesn't fit goes the slow way */
+    if(p != end || !ok || (idigits + fdigits) == 0 || mant > (1ULL << 53) || fdigits > 22)
+    {
+        return parse_slow(start,end);
+    }
+
+    double v = static_cast<double>(mant) / pow10[fdigits];
+    return neg ? -v : v;
+}
+
+int CsvLog::find(const std::string& name) const
+{
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        if(names[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+/* Find the end of the line starting at p */
+static inline const char * line_end(const char * p, const char * end)
+{
+    const char * nl = static_cast<const char *>(memchr(p,'\n',end - p));
+    return nl ? nl : end;
+}
+
+/* A line holds a row if it has anything besides a carriage return */
+static inline bool is_row(const char * p, const char * eol)
+{
+    return (eol - p) > 1 || ((eol - p) == 1 && *p != '\r');
+}
+
+size_t count_csv_rows(const char * p, const char * end)
+{
+    size_t n = 0;
+    while(p < end)
+    {
+        const char * eol = line_end(p,end);
+        if(is_row(p,eol)) n++;
+        p = eol + 1;
+    }
+    return n;
+}
+
+const char * parse_csv_row(const char * p, const char * end, double * out, size_t ncols, size_t stride)
+{
+    /* Skip blank lines to the next row */
+    const char * eol = (p < end) ? line_end(p,end) : end;
+    while(p < end && !is_row(p,eol))
+    {
+        p = eol + 1;
+        eol = (p < end) ? line_end(p,end) : end;
+    }
+    if(p >= end) return nullptr;
+
+    /* Split the line on commas, extra fields are ignored and missing ones are NaN */
+    size_t c = 0;
+    const char * f = p;
+    while(c < ncols)
+    {
+        const char * comma = static_cast<const char *>(memchr(f,',',eol - f));
+        const char * fend = comma ? comma : eol;
+        out[c * stride] = parse_field(f,fend);
+        c++;
+        if(!comma) break;
+        f = comma + 1;
+    }
+    for(; c < ncols; c++)
+    {
+        out[c * stride] = std::numeric_limits<double>::quiet_NaN();
+    }
+    return (eol < end) ? eol + 1 : end;
+}
+
+const char * parse_csv_header(const char * data, size_t len, std::vector<std::string>& names)
+{
+    const char * end = data + len;
+    names.clear();
+
+    /* Skip blank lines before the header, the logger starts rows with a newline */
+    const char * p = data;
+    while(p < end && (*p == '\n' || *p == '\r')) p++;
+    if(p == end) return end;
+
+    /* Header row gives the column names */
+    const char * eol = line_end(p,end);
+    const char * hend = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+    while(true)
+    {
+        const char * comma = static_cast<const char *>(memchr(p,',',hend - p));
+        const char * fend = comma ? comma : hend;
+        names.emplace_back(p,fend);
+        if(!comma) break;
+        p = comma + 1;
+    }
+    return (eol < end) ? eol + 1 : end;
+}
+
+/* Parse the rows of a chunk into the columns, starting at row */
+static void parse_rows(const char * p, const char * end, size_t row, std::vector<std::vector<double>>& cols)
+{
+    /* Each row is parsed into a scratch row, then scattered into the columns */
+    std::vector<double> tmp(cols.size());
+    while((p = parse_csv_row(p,end,tmp.data(),tmp.size(),1)))
+    {
+        for(size_t c = 0; c < cols.size(); c++) cols[c][row] = tmp[c];
+        row++;
+    }
+}
+
+CsvLog parse_csv(const char * data, size_t len, unsigned threads)
+{
+    CsvLog log;
+    const char * end = data + len;
+    const char * body = parse_csv_header(data,len,log.names);
+    if(log.names.empty()) return log;
+
+    /* Split the body into chunks on line boundaries, one per thread */
+    if(!threads) threads = std::thread::hardware_concurrency();
+    if(!threads) threads = 1;
+    size_t blen = end - body;
+    if(blen < ((size_t)threads << 16)) threads = static_cast<unsigned>(blen >> 16) + 1;
+    std::vector<const char *> bounds(threads + 1);
+    bounds[0] = body;
+    bounds[threads] = end;
+    for(unsigned i = 1; i < threads; i++)
+    {
+        const char * b = body + (blen * i) / threads;
+        if(b < bounds[i - 1]) b = bounds[i - 1];
+        bounds[i] = (b < end) ? line_end(b,end) : end;
+        if(bounds[i] < end) bounds[i]++;
+    }
+
+    /* First pass counts the rows in each chunk, so every thread knows where its
+     * rows land in the columns
+     */
+    std::vector<size_t> counts(threads);
+    std::vector<std::thread> pool;
+    for(unsigned i = 0; i < threads; i++)
+    {
+        pool.emplace_back([&,i]{ counts[i] = count_csv_rows(bounds[i],bounds[i + 1]); });
+    }
+    for(auto& t : pool) t.join();
+    pool.clear();
+
+    std::vector<size_t> first(threads);
+    size_t total = 0;
+    for(unsigned i = 0; i < threads; i++)
+    {
+        first[i] = total;
+        total += counts[i];
+    }
+    log.cols.assign(log.names.size(),std::vector<double>(total));
+
+    /* Second pass parses each chunk straight into its rows */
+    for(unsigned i = 0; i < threads; i++)
+    {
+        pool.emplace_back([&,i]{ parse_rows(bounds[i],bounds[i + 1],first[i],log.cols); });
+    }
+    for(auto& t : pool) t.join();
+
+    return log;
+}
+
+CsvLog load_csv(const std::string& path, unsigned threads)
+{
+    MappedFile file(path);
+    return parse_csv(file.chars(),file.size(),threads);
+}
+
+} /* namespace pal */
@@ -0,0 +1,61 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_CSV_HPP_
+#define _PAL_CSV_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Columnar contents of a CSV data file (dat%05d.csv)
+ * Every column is stored as doubles, including TIME and the int columns
+ * Missing or empty fields are NaN, and inf values from uncalibrated sensors are kept
+ */
+struct CsvLog
+{
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> cols;
+
+    size_t rows() const { return cols.empty() ? 0 : cols[0].size(); }
+
+    /* Index of the named column, or -1 if it is not present */
+    int find(const std::string& name) const;
+};
+
+/* Load a CSV data file, splitting the rows across threads (0 uses every core)
+ * Throws std::runtime_error if the file can't be read
+ */
+CsvLog load_csv(const std::string& path, unsigned threads = 0);
+
+/* Parse CSV text which is already in memory */
+CsvLog parse_csv(const char * data, size_t len, unsigned threads = 0);
+
+/* Pieces of the loader, for readers which stream rather than load the whole file */
+
+/* Parse the header row into names, returning the start of the first row */
+const char * parse_csv_header(const char * data, size_t len, std::vector<std::string>& names);
+
+/* Count the rows between p and end, which must start at the beginning of a line */
+size_t count_csv_rows(const char * p, const char * end);
+
+/* Parse the next row at or after p into out[0], out[stride], ... out[(ncols - 1) * stride]
+ * Returns the start of the following line, or nullptr if there are no rows left
+ */
+const char * parse_csv_row(const char * p, const char * end, double * out, size_t ncols, size_t stride);
+
+/* Parse one field starting at p and ending before end, which must not include the
+ * delimiter. Handles plain decimals with SWAR digit parsing and falls back to
+ * strtod for exponents or long mantissas. Returns NaN for an empty or invalid field
+ */
+double parse_field(const char * p, const char * end);
+
+} /* namespace pal */
+
+#endif /* _PAL_CSV_HPP_ */
@@ -0,0 +1,148 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "estimate.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace pal
+{
+
+/* Standard gravity, for accelerometers which read in g */
+#define EKF_G 9.80665
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/* Column named <device>_<suffix>, or <device><port>_<suffix> as the poller names
+ * devices registered without a name, or -1
+ */
+static int find_sensor(const std::vector<RowColumn>& cols, const char * device, const char * suffix)
+{
+    size_t dlen = strlen(device);
+    for(size_t c = 0; c < cols.size(); c++)
+    {
+        const std::string& n = cols[c].name;
+        if(n.compare(0,dlen,device)) continue;
+        size_t i = dlen;
+        while(i < n.size() && n[i] >= '0' && n[i] <= '9') i++;
+        if(i < n.size() && n[i] == '_' && !n.compare(i + 1,std::string::npos,suffix)) return static_cast<int>(c);
+    }
+    return -1;
+}
+
+EkfColumns::EkfColumns(const std::vector<RowColumn>& cols)
+{
+    gps_x = find_sensor(cols,"gps","x");
+    gps_y = find_sensor(cols,"gps","y");
+    gps_hdg = find_sensor(cols,"gps","hdg");
+    gps_error = find_sensor(cols,"gps","error");
+    gyro = find_sensor(cols,"imu","gyro_z");
+    if(gyro < 0) gyro = find_sensor(cols,"gps","gyro_z");
+    acc_x = find_sensor(cols,"imu","acc_x");
+    acc_y = find_sensor(cols,"imu","acc_y");
+    for(size_t c = 0; c < cols.size(); c++)
+    {
+        if(cols[c].name == "left_vel") left = static_cast<int>(c);
+        if(cols[c].name == "right_vel") right = static_cast<int>(c);
+    }
+}
+
+EkfInput EkfColumns::row(const double * block, size_t max, size_t r) const
+{
+    auto at = [&](int c) { return c < 0 ? NaN : block[c * max + r]; };
+    return {block[r],at(gps_x),at(gps_y),at(gps_hdg),at(gps_error),at(gyro),at(acc_x),at(acc_y),at(left),
+        at(right)};
+}
+
+void EkfReplayer::step(const EkfInput& in)
+{
+    double theta = ekf_compass_theta(in.gps_hdg + opt.gps_offset);
+    bool fix = std::isfinite(in.gps_x) && std::isfinite(in.gps_y);
+    bool fresh = fix && (!run || in.gps_x != last_gx || in.gps_y != last_gy);
+    held = false;
+    if(fresh)
+    {
+        last_gx = in.gps_x;
+        last_gy = in.gps_y;
+    }
+
+    if(!run)
+    {
+        ekf.predict(0.0);
+        if(!fresh || !opt.gps) return;
+        ekf.reset(in.gps_x,in.gps_y,std::isfinite(theta) ? theta : 0.0);
+        run = true;
+        last_t = in.time;
+        readings = 1;
+        return;
+    }
+
+    ekf.predict(in.time - last_t);
+    last_t = in.time;
+    if(opt.gps && fresh)
+    {
+        if(opt.gps_every <= 1 || readings % opt.gps_every == 0) ekf.update_gps(in.gps_x,in.gps_y,theta,in.gps_error);
+        else held = true;
+        readings++;
+    }
+    if(opt.gyro) ekf.update_gyro(ekf_compass_rate(in.gyro_z));
+    if(opt.accel) ekf.update_accel(in.acc_x * EKF_G,-in.acc_y * EKF_G);
+    if(opt.odometry)
+    {
+        double vl = in.left_vel * opt.mps_per_rpm;
+        double vr = in.right_vel * opt.mps_per_rpm;
+        ekf.update_odometry((vl + vr) / 2.0,(vr - vl) / opt.track);
+    }
+}
+
+/* Source rows with the estimator's channels after them */
+class EkfRows : public RowSource
+{
+public:
+    EkfRows(std::unique_ptr<RowSource> s, const EkfReplay& opt) : src(std::move(s)), in(src->columns()), rep(opt)
+    {
+        cols = src->columns();
+        nrows = src->rows();
+        nsrc = cols.size();
+        for(int i = 0; i < EKF_STATES; i++) cols.push_back({ekf_state_names[i],ColType::Double});
+        for(int i = 0; i < EKF_INNOVATIONS; i++) cols.push_back({ekf_innovation_names[i],ColType::Double});
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        /* The source fills the first columns, in the same layout */
+        size_t n = src->read(block,max);
+        for(size_t r = 0; r < n; r++)
+        {
+            rep.step(in.row(block,max,r));
+            const Ekf& f = rep.filter();
+            double * out = block + nsrc * max + r;
+            for(int i = 0; i < EKF_STATES; i++, out += max) *out = rep.started() ? f[i] : NaN;
+            for(int i = 0; i < EKF_INNOVATIONS; i++, out += max) *out = f.innovation(i);
+        }
+        return n;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        return src->span(first,last);
+    }
+
+private:
+    std::unique_ptr<RowSource> src;
+    EkfColumns in;
+    EkfReplayer rep;
+    size_t nsrc;
+};
+
+std::unique_ptr<RowSource> replay_ekf(std::unique_ptr<RowSource> src, const EkfReplay& opt)
+{
+    return std::unique_ptr<RowSource>(new EkfRows(std::move(src),opt));
+}
+
+} /* namespace pal */
@@ -0,0 +1,101 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_ESTIMATE_HPP_
+#define _PAL_ESTIMATE_HPP_
+
+#include "rows.hpp"
+#include "pal/ekf.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace pal
+{
+
+/* How logged channels are fed to the estimator */
+struct EkfReplay
+{
+    EkfParams params;
+    double mps_per_rpm = 0.1016 * M_PI / 60.0;  /* Wheel surface speed per motor rpm */
+    double track = 0.30;                        /* Distance between the drive wheels in m */
+    double gps_offset = 0.0;                    /* Degrees added to the GPS heading, for a sensor
+                                                 * facing away from the robot's front */
+    bool gps = true;
+    bool gyro = true;
+    bool accel = false;     /* Off by default, since the axes depend on how the IMU is mounted */
+    bool odometry = true;
+    int gps_every = 1;      /* Update with one GPS reading in this many, holding out the rest */
+};
+
+/* Sensor readings of one row, in the units the poller logs them */
+struct EkfInput
+{
+    double time;
+    double gps_x, gps_y, gps_hdg, gps_error;
+    double gyro_z;
+    double acc_x, acc_y;
+    double left_vel, right_vel;
+};
+
+/* Where the sensors are in a row source, found by the column names the poller
+ * gives them, named or not (gps_x or gps11_x): GPS x, y, hdg and error, the IMU's
+ * gyro_z (or the GPS's), the IMU's acc_x and acc_y taken as forward and rightward
+ * in g, and left_vel and right_vel in rpm. Missing sensors read NaN
+ */
+class EkfColumns
+{
+public:
+    explicit EkfColumns(const std::vector<RowColumn>& cols);
+
+    /* Readings of row r of a block from RowSource::read(block,max) */
+    EkfInput row(const double * block, size_t max, size_t r) const;
+
+    bool has_gps() const { return gps_x >= 0 && gps_y >= 0; }
+
+private:
+    int gps_x, gps_y, gps_hdg, gps_error, gyro, acc_x, acc_y;
+    int left = -1, right = -1;
+};
+
+/* The estimator stepped a row at a time, as src/main.cpp steps it on the robot
+ * The filter starts at the first GPS fix, and steps by the time between rows. A
+ * GPS reading only counts when it changes, since the sensor is slower than the
+ * poller. With gps_every above 1, the readings between those used are held out,
+ * so they can score the estimate independently
+ */
+class EkfReplayer
+{
+public:
+    explicit EkfReplayer(const EkfReplay& opt) : opt(opt), ekf(opt.params) {}
+
+    void step(const EkfInput& in);
+
+    const Ekf& filter() const { return ekf; }
+    bool started() const { return run; }
+
+    /* True if the last step had a new GPS reading which was held out */
+    bool held_out() const { return held; }
+
+private:
+    EkfReplay opt;
+    Ekf ekf;
+    bool run = false;
+    bool held = false;
+    double last_t = 0.0;
+    double last_gx = 0.0, last_gy = 0.0;
+    long readings = 0;
+};
+
+/* Run the estimator over the rows of a log, and return a row source of the
+ * source's columns followed by the ekf_* state and innovation channels
+ * log_data(const Ekf&) would have logged
+ */
+std::unique_ptr<RowSource> replay_ekf(std::unique_ptr<RowSource> src, const EkfReplay& opt);
+
+} /* namespace pal */
+
+#endif /* _PAL_ESTIMATE_HPP_ */
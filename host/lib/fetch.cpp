@@ -0,0 +1,287 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "fetch.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+FileClient::FileClient(int fd, int timeout_ms, int retries)
+    : fd(fd), timeout_ms(timeout_ms), retries(retries),
+      demux([this](uint32_t id, const uint8_t * data, size_t len) { if(id == LOG_SERVE_STREAM_ID) frames.feed(data,len); }),
+      frames([this](const std::vector<uint8_t>& raw)
+      {
+          if(raw.size() < sizeof(log_serve_msg_t)) return;
+          Msg m;
+          memcpy(&m.head,raw.data(),sizeof(m.head));
+          m.body.assign(raw.begin() + sizeof(m.head),raw.end());
+          msgs.push_back(std::move(m));
+      })
+{
+    /* Start the ids somewhere new, so answers to an earlier run are ignored */
+    last_id = std::random_device()();
+}
+
+void FileClient::send(uint8_t op, uint32_t id, uint32_t offset, uint32_t arg, const std::string& name)
+{
+    log_serve_msg_t msg;
+    memset(&msg,0,sizeof(msg));
+    msg.op = op;
+    msg.id = id;
+    msg.offset = offset;
+    msg.arg = arg;
+    std::vector<uint8_t> frame = pack_frame(&msg,sizeof(msg),name.data(),name.size());
+    size_t done = 0;
+    while(done < frame.size())
+    {
+        ssize_t n = write(fd,frame.data() + done,frame.size() - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) throw std::runtime_error(std::string("write: ") + strerror(errno));
+        done += n;
+    }
+}
+
+/* Read what has arrived, waiting up to timeout_ms for something */
+bool FileClient::read_link(int timeout)
+{
+    struct pollfd p = {fd,POLLIN,0};
+    int r = poll(&p,1,timeout);
+    if(r < 0 && errno == EINTR) return false;
+    if(r < 0) throw std::runtime_error(std::string("poll: ") + strerror(errno));
+    if(!r) return false;
+
+    uint8_t buf[4096];
+    ssize_t n = read(fd,buf,sizeof(buf));
+    if(n < 0 && errno == EINTR) return false;
+    if(n < 0) throw std::runtime_error(std::string("read: ") + strerror(errno));
+    if(!n) throw std::runtime_error("the link closed");
+    heard = true;
+    demux.feed(buf,n);
+    return true;
+}
+
+bool FileClient::wait_link(int timeout)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while(!heard)
+    {
+        int left = std::chrono::duration_cast<std::chrono::milliseconds>(end - std::chrono::steady_clock::now()).count();
+        if(left <= 0) return false;
+        read_link(left);
+    }
+    return true;
+}
+
+/* The next message from the file server, waiting up to timeout_ms for one */
+bool FileClient::next(Msg& m, int timeout)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while(msgs.empty())
+    {
+        int left = std::chrono::duration_cast<std::chrono::milliseconds>(end - std::chrono::steady_clock::now()).count();
+        if(left <= 0) return false;
+        read_link(left);
+    }
+    m = std::move(msgs.front());
+    msgs.pop_front();
+    return true;
+}
+
+std::vector<RemoteFile> FileClient::list()
+{
+    for(int tries = 0; tries < retries; tries++)
+    {
+        uint32_t id = new_id();
+        send(LOG_SERVE_LIST,id,0,0);
+        std::vector<RemoteFile> files;
+        Msg m;
+        while(next(m,timeout_ms))
+        {
+            if(m.head.id != id) continue;
+            if(m.head.op == LOG_SERVE_ERROR) throw std::runtime_error(std::string(m.body.begin(),m.body.end()));
+            if(m.head.op != LOG_SERVE_LIST) continue;
+            if(m.body.empty())
+            {
+                /* A list missing entries is asked for again */
+                if(files.size() == m.head.arg) return files;
+                break;
+            }
+            files.push_back({std::string(m.body.begin(),m.body.end()),m.head.arg,(m.head.flags & LOG_SERVE_OPEN) != 0});
+        }
+    }
+    throw std::runtime_error("the robot isn't answering");
+}
+
+uint32_t FileClient::sum(const std::string& name, uint32_t& len)
+{
+    for(int tries = 0; tries < retries; tries++)
+    {
+        uint32_t id = new_id();
+        send(LOG_SERVE_SUM,id,len,0,name);
+        Msg m;
+        while(next(m,timeout_ms))
+        {
+            if(m.head.id != id) continue;
+            if(m.head.op == LOG_SERVE_ERROR) throw std::runtime_error(name + ": " + std::string(m.body.begin(),m.body.end()));
+            if(m.head.op != LOG_SERVE_SUM) continue;
+            len = m.head.offset;
+            return m.head.arg;
+        }
+    }
+    throw std::runtime_error("the robot isn't answering");
+}
+
+/* CRC-32 of the first len bytes of a local file, or of less if it is shorter */
+static uint32_t file_crc(const std::string& path, uint32_t len)
+{
+    FILE * f = fopen(path.c_str(),"rb");
+    if(!f) return 0;
+    uint8_t buf[65536];
+    uint32_t crc = 0;
+    while(len)
+    {
+        size_t n = fread(buf,1,len < sizeof(buf) ? len : sizeof(buf),f);
+        if(!n) break;
+        crc = crc32(buf,n,crc);
+        len -= n;
+    }
+    fclose(f);
+    return crc;
+}
+
+bool FileClient::have(const RemoteFile& f, const std::string& path)
+{
+    struct stat st;
+    if(stat(path.c_str(),&st) || static_cast<uint64_t>(st.st_size) != f.size) return false;
+    uint32_t len = f.size;
+    uint32_t crc = sum(f.name,len);
+    return len == f.size && crc == file_crc(path,len);
+}
+
+FetchResult FileClient::fetch(const RemoteFile& f, const std::string& path, int window,
+                              std::function<void(uint32_t done, uint32_t size)> progress)
+{
+    FetchResult res;
+    std::string part = path + ".part";
+
+    /* Resume from what an earlier fetch left, if the robot has the same start. A
+     * file fetched while the logger was still writing it is the start of it too
+     */
+    struct stat st;
+    if(stat(part.c_str(),&st) && !stat(path.c_str(),&st) && static_cast<uint64_t>(st.st_size) < f.size)
+    {
+        if(rename(path.c_str(),part.c_str())) throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    uint32_t have = 0;
+    if(!stat(part.c_str(),&st) && st.st_size > 0 && static_cast<uint64_t>(st.st_size) <= f.size)
+    {
+        uint32_t len = static_cast<uint32_t>(st.st_size);
+        uint32_t crc = sum(f.name,len);
+        if(len == st.st_size && crc == file_crc(part,len)) have = len;
+    }
+    res.from = have;
+    if(truncate(part.c_str(),have) && errno != ENOENT) throw std::runtime_error(part + ": " + strerror(errno));
+    FILE * out = fopen(part.c_str(),have ? "ab" : "wb");
+    if(!out) throw std::runtime_error(part + ": " + strerror(errno));
+
+    /* However the transfer breaks off, what arrived is left for the next to resume from */
+    uint32_t end = 0;
+    try
+    {
+        uint32_t expected = have;
+        uint32_t id = new_id();
+        send(LOG_SERVE_READ,id,expected,window,f.name);
+        int tries = 0;
+        bool done = false;
+        while(!done)
+        {
+            Msg m;
+            if(!next(m,timeout_ms))
+            {
+                if(++tries >= retries) throw std::runtime_error(f.name + ": the robot stopped answering");
+                /* Ask again from where it stopped, under a new id so the rest of the
+                 * old window is ignored
+                 */
+                id = new_id();
+                send(LOG_SERVE_READ,id,expected,window,f.name);
+                res.resent++;
+                continue;
+            }
+            if(m.head.id != id) continue;
+            tries = 0;
+
+            switch(m.head.op)
+            {
+            case LOG_SERVE_DATA:
+                if(m.head.offset == expected)
+                {
+                    if(fwrite(m.body.data(),1,m.body.size(),out) != m.body.size())
+                    {
+                        throw std::runtime_error(part + ": " + strerror(errno));
+                    }
+                    expected += m.body.size();
+                    send(LOG_SERVE_ACK,id,expected,0);
+                    if(progress) progress(expected,f.size);
+                }
+                else if(m.head.offset > expected)
+                {
+                    id = new_id();
+                    send(LOG_SERVE_READ,id,expected,window,f.name);
+                    res.resent++;
+                }
+                break;
+            case LOG_SERVE_END:
+                if(m.head.offset == expected)
+                {
+                    end = expected;
+                    send(LOG_SERVE_ACK,id,expected,0);
+                    done = true;
+                }
+                else if(m.head.offset > expected)
+                {
+                    id = new_id();
+                    send(LOG_SERVE_READ,id,expected,window,f.name);
+                    res.resent++;
+                }
+                break;
+            case LOG_SERVE_ERROR:
+                throw std::runtime_error(f.name + ": " + std::string(m.body.begin(),m.body.end()));
+            default:
+                break;
+            }
+        }
+    }
+    catch(...)
+    {
+        fclose(out);
+        throw;
+    }
+    if(fclose(out)) throw std::runtime_error(part + ": " + strerror(errno));
+
+    /* Check all of it against the robot's copy before taking it */
+    uint32_t len = end;
+    uint32_t crc = sum(f.name,len);
+    if(len != end || crc != file_crc(part,end))
+    {
+        remove(part.c_str());
+        throw std::runtime_error(f.name + ": the file fetched doesn't match the robot's");
+    }
+    if(rename(part.c_str(),path.c_str())) throw std::runtime_error(path + ": " + strerror(errno));
+    res.size = end;
+    return res;
+}
+
+} /* namespace pal */
@@ -0,0 +1,93 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_FETCH_HPP_
+#define _PAL_FETCH_HPP_
+
+#include "telemetry.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* A file on the robot's card, as its file server lists it */
+struct RemoteFile
+{
+    std::string name;
+    uint32_t size;
+    bool open;              /* The logger is still writing it */
+};
+
+/* How a fetch went */
+struct FetchResult
+{
+    uint32_t from = 0;      /* Offset it resumed from, 0 if it started afresh */
+    uint32_t size = 0;      /* Bytes in the file fetched */
+    uint32_t resent = 0;    /* Times it asked again from a missing chunk */
+};
+
+/* Client of the robot's file server (log_serve_start()) on a serial link, which
+ * carries PROS's streams as the brain's USB port does. Other streams are ignored
+ * Throws std::runtime_error when the robot stops answering or reports an error
+ */
+class FileClient
+{
+public:
+    /* The robot is taken to have stopped once it hasn't answered in timeout_ms,
+     * after asking retries times
+     */
+    explicit FileClient(int fd, int timeout_ms = 1000, int retries = 10);
+
+    std::vector<RemoteFile> list();
+
+    /* CRC-32 of the first len bytes of the file, setting len to the bytes summed */
+    uint32_t sum(const std::string& name, uint32_t& len);
+
+    /* The file at path is the robot's file, by its size and CRC-32. Card indexes
+     * start over once a card is wiped, so a name and size alone don't tell
+     */
+    bool have(const RemoteFile& f, const std::string& path);
+
+    /* Fetch a file to path, window chunks ahead. The file is written as path.part,
+     * and a transfer which broke off resumes from it, or from a shorter file at path,
+     * if the start the robot has is the same. Checked against the robot's CRC-32 of it, then renamed to path
+     */
+    FetchResult fetch(const RemoteFile& f, const std::string& path, int window,
+                      std::function<void(uint32_t done, uint32_t size)> progress = nullptr);
+
+    /* Wait up to timeout_ms for the robot to send anything, returning false if it doesn't */
+    bool wait_link(int timeout_ms);
+
+private:
+    struct Msg
+    {
+        log_serve_msg_t head;
+        std::vector<uint8_t> body;
+    };
+
+    void send(uint8_t op, uint32_t id, uint32_t offset, uint32_t arg, const std::string& name = "");
+    bool next(Msg& m, int timeout_ms);
+    bool read_link(int timeout_ms);
+    uint32_t new_id() { return ++last_id; }
+
+    int fd;
+    int timeout_ms;
+    int retries;
+    uint32_t last_id;
+    ProsDemux demux;
+    FrameSplitter frames;
+    std::deque<Msg> msgs;
+    bool heard = false;
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_FETCH_HPP_ */
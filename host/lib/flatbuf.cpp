@@ -0,0 +1,301 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "flatbuf.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace pal
+{
+
+FbRef FbNode::table()
+{
+    FbRef n(new FbNode());
+    n->kind = TABLE;
+    return n;
+}
+
+FbRef FbNode::string(const std::string& s)
+{
+    FbRef n(new FbNode());
+    n->kind = STRING;
+    n->bytes = s;
+    return n;
+}
+
+FbRef FbNode::tables(const std::vector<FbRef>& items)
+{
+    FbRef n(new FbNode());
+    n->kind = TABLES;
+    n->items = items;
+    return n;
+}
+
+FbRef FbNode::structs(const void * data, size_t size, size_t count, size_t align)
+{
+    FbRef n(new FbNode());
+    n->kind = STRUCTS;
+    if(count) n->bytes.assign(static_cast<const char *>(data),size * count);
+    n->count = count;
+    n->align = std::max<size_t>(align,4);
+    return n;
+}
+
+FbNode& FbNode::scalar(int id, uint64_t v, size_t size)
+{
+    fields.push_back({id,size,v,nullptr});
+    return *this;
+}
+
+FbNode& FbNode::add(int id, FbRef child)
+{
+    fields.push_back({id,0,0,child});
+    return *this;
+}
+
+/* Append a little-endian value of size bytes */
+static void put_le(std::vector<uint8_t>& buf, uint64_t v, size_t size)
+{
+    for(size_t i = 0; i < size; i++) buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+/* Overwrite a uint32 at pos */
+static void patch_u32(std::vector<uint8_t>& buf, size_t pos, uint32_t v)
+{
+    memcpy(&buf[pos],&v,sizeof(v));
+}
+
+static void pad_to(std::vector<uint8_t>& buf, size_t align)
+{
+    while(buf.size() % align) buf.push_back(0);
+}
+
+size_t FbNode::put(std::vector<uint8_t>& buf) const
+{
+    size_t pos;
+    switch(kind)
+    {
+    case STRING:
+        pad_to(buf,4);
+        pos = buf.size();
+        put_le(buf,bytes.size(),4);
+        buf.insert(buf.end(),bytes.begin(),bytes.end());
+        buf.push_back(0);
+        return pos;
+
+    case STRUCTS:
+        /* The elements follow the length, so align the length to end on the boundary */
+        while((buf.size() + 4) % align) buf.push_back(0);
+        pos = buf.size();
+        put_le(buf,count,4);
+        buf.insert(buf.end(),bytes.begin(),bytes.end());
+        return pos;
+
+    case TABLES:
+    {
+        pad_to(buf,4);
+        pos = buf.size();
+        put_le(buf,items.size(),4);
+        buf.resize(buf.size() + 4 * items.size(),0);
+        for(size_t i = 0; i < items.size(); i++)
+        {
+            size_t at = pos + 4 + 4 * i;
+            size_t child = items[i]->put(buf);
+            patch_u32(buf,at,static_cast<uint32_t>(child - at));
+        }
+        return pos;
+    }
+
+    default:
+        break;
+    }
+
+    /* Lay out the table, largest fields first so each sits at its natural alignment
+     * after the 4-byte vtable offset
+     */
+    std::vector<const Field *> order;
+    int slots = 0;
+    size_t table_align = 4;
+    for(const auto& f : fields)
+    {
+        order.push_back(&f);
+        slots = std::max(slots,f.id + 1);
+        table_align = std::max(table_align,f.size);
+    }
+    std::stable_sort(order.begin(),order.end(),[](const Field * a, const Field * b)
+    {
+        return (a->size ? a->size : 4) > (b->size ? b->size : 4);
+    });
+    std::vector<uint16_t> voff(slots,0);
+    std::vector<size_t> foff(fields.size());
+    size_t off = 4;
+    for(const Field * f : order)
+    {
+        size_t size = f->size ? f->size : 4;
+        off = (off + size - 1) & ~(size - 1);
+        foff[f - fields.data()] = off;
+        voff[f->id] = static_cast<uint16_t>(off);
+        off += size;
+    }
+    size_t table_size = off;
+
+    /* vtable, then the table which points back at it */
+    pad_to(buf,2);
+    size_t vt = buf.size();
+    put_le(buf,4 + 2 * slots,2);
+    put_le(buf,table_size,2);
+    for(uint16_t v : voff) put_le(buf,v,2);
+
+    pad_to(buf,table_align);
+    pos = buf.size();
+    buf.resize(pos + table_size,0);
+    int32_t soff = static_cast<int32_t>(pos - vt);
+    memcpy(&buf[pos],&soff,sizeof(soff));
+    for(size_t i = 0; i < fields.size(); i++)
+    {
+        if(fields[i].size)
+        {
+            uint64_t v = fields[i].value;
+            memcpy(&buf[pos + foff[i]],&v,fields[i].size);
+        }
+    }
+
+    /* Children go after the table, so their offsets are forward */
+    for(size_t i = 0; i < fields.size(); i++)
+    {
+        if(!fields[i].size)
+        {
+            size_t at = pos + foff[i];
+            size_t child = fields[i].child->put(buf);
+            patch_u32(buf,at,static_cast<uint32_t>(child - at));
+        }
+    }
+    return pos;
+}
+
+std::vector<uint8_t> FbNode::finish() const
+{
+    std::vector<uint8_t> buf(4,0);
+    size_t root = put(buf);
+    patch_u32(buf,0,static_cast<uint32_t>(root));
+    pad_to(buf,8);
+    return buf;
+}
+
+void FbTable::check(size_t at, size_t size) const
+{
+    if(at > len || size > len - at) throw std::runtime_error("flatbuffer offset out of range");
+}
+
+/* Root table offset, stored at the start of the buffer */
+static size_t root_offset(const uint8_t * buf, size_t len)
+{
+    if(len < 4) throw std::runtime_error("flatbuffer too short");
+    uint32_t off;
+    memcpy(&off,buf,sizeof(off));
+    return off;
+}
+
+FbTable::FbTable(const uint8_t * buf, size_t len) : FbTable(buf,len,root_offset(buf,len))
+{
+}
+
+FbTable::FbTable(const uint8_t * buf, size_t len, size_t at) : buf(buf), len(len), pos(at)
+{
+    check(pos,4);
+    int32_t soff;
+    memcpy(&soff,buf + pos,sizeof(soff));
+    vt = pos - soff;    /* Wraps to a huge value, which check() rejects, if out of range */
+    check(vt,4);
+    uint16_t n;
+    memcpy(&n,buf + vt,sizeof(n));
+    vt_len = n;
+    check(vt,vt_len);
+}
+
+/* Table offset of field id, or 0 if absent */
+size_t FbTable::field(int id) const
+{
+    size_t at = 4 + 2 * id;
+    if(at + 2 > vt_len) return 0;
+    uint16_t off;
+    memcpy(&off,buf + vt + at,sizeof(off));
+    return off;
+}
+
+/* Follow the uoffset stored at at */
+size_t FbTable::deref(size_t at) const
+{
+    check(at,4);
+    uint32_t off;
+    memcpy(&off,buf + at,sizeof(off));
+    check(at + off,0);
+    return at + off;
+}
+
+uint64_t FbTable::u(int id, size_t size, uint64_t def) const
+{
+    size_t off = field(id);
+    if(!off) return def;
+    check(pos + off,size);
+    uint64_t v = 0;
+    memcpy(&v,buf + pos + off,size);
+    return v;
+}
+
+FbTable FbTable::table(int id) const
+{
+    size_t off = field(id);
+    if(!off) throw std::runtime_error("flatbuffer table missing");
+    return FbTable(buf,len,deref(pos + off));
+}
+
+std::string FbTable::string(int id) const
+{
+    size_t n;
+    size_t at = vec(id,1,&n);
+    return n ? std::string(reinterpret_cast<const char *>(buf + at),n) : std::string();
+}
+
+/* Start of the elements of vector field id, with their number in n */
+size_t FbTable::vec(int id, size_t elem, size_t * n) const
+{
+    *n = 0;
+    size_t off = field(id);
+    if(!off) return 0;
+    size_t at = deref(pos + off);
+    check(at,4);
+    uint32_t count;
+    memcpy(&count,buf + at,sizeof(count));
+    if(elem && count > (len - at - 4) / elem) throw std::runtime_error("flatbuffer vector out of range");
+    *n = count;
+    return at + 4;
+}
+
+size_t FbTable::count(int id) const
+{
+    size_t n;
+    vec(id,4,&n);
+    return n;
+}
+
+FbTable FbTable::table_at(int id, size_t i) const
+{
+    size_t n;
+    size_t at = vec(id,4,&n);
+    if(i >= n) throw std::runtime_error("flatbuffer vector index out of range");
+    return FbTable(buf,len,deref(at + 4 * i));
+}
+
+const uint8_t * FbTable::structs(int id, size_t size, size_t * n) const
+{
+    size_t at = vec(id,size,n);
+    return *n ? buf + at : nullptr;
+}
+
+} /* namespace pal */
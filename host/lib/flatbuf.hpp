@@ -0,0 +1,115 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_FLATBUF_HPP_
+#define _PAL_FLATBUF_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Just enough of FlatBuffers to write and read Arrow IPC metadata, without the
+ * library. Objects are built as a tree of nodes and serialized front to back, each table
+ * after its vtable and before its children, so every offset points forward
+ */
+class FbNode
+{
+public:
+    /* Table with no fields yet */
+    static std::shared_ptr<FbNode> table();
+
+    /* String, stored NUL terminated */
+    static std::shared_ptr<FbNode> string(const std::string& s);
+
+    /* Vector of tables */
+    static std::shared_ptr<FbNode> tables(const std::vector<std::shared_ptr<FbNode>>& items);
+
+    /* Vector of structs, given as raw little-endian bytes of count structs each
+     * aligned to align
+     */
+    static std::shared_ptr<FbNode> structs(const void * data, size_t size, size_t count, size_t align);
+
+    /* Add fields to a table, by field id from the schema */
+    FbNode& add_u8(int id, uint8_t v) { return scalar(id,v,1); }
+    FbNode& add_i16(int id, int16_t v) { return scalar(id,static_cast<uint16_t>(v),2); }
+    FbNode& add_i32(int id, int32_t v) { return scalar(id,static_cast<uint32_t>(v),4); }
+    FbNode& add_i64(int id, int64_t v) { return scalar(id,static_cast<uint64_t>(v),8); }
+    FbNode& add(int id, std::shared_ptr<FbNode> child);
+
+    /* Serialize with this node as the root, padded to a multiple of 8 bytes */
+    std::vector<uint8_t> finish() const;
+
+private:
+    enum Kind { TABLE, STRING, TABLES, STRUCTS };
+    struct Field
+    {
+        int id;
+        size_t size;        /* Scalar size, or 0 for a child offset */
+        uint64_t value;
+        std::shared_ptr<FbNode> child;
+    };
+
+    FbNode& scalar(int id, uint64_t v, size_t size);
+    size_t put(std::vector<uint8_t>& buf) const;
+
+    Kind kind;
+    std::vector<Field> fields;
+    std::vector<std::shared_ptr<FbNode>> items;
+    std::string bytes;
+    size_t count = 0;
+    size_t align = 4;
+};
+
+typedef std::shared_ptr<FbNode> FbRef;
+
+/* Read-only view of a table in a FlatBuffers buffer, with every offset checked
+ * against the buffer
+ * Throws std::runtime_error on an offset outside the buffer
+ */
+class FbTable
+{
+public:
+    /* Root table of a buffer */
+    FbTable(const uint8_t * buf, size_t len);
+
+    bool has(int id) const { return field(id) != 0; }
+
+    /* Scalar field, or def if absent */
+    uint64_t u(int id, size_t size, uint64_t def) const;
+    int64_t i64(int id, int64_t def = 0) const { return static_cast<int64_t>(u(id,8,def)); }
+    int32_t i32(int id, int32_t def = 0) const { return static_cast<int32_t>(u(id,4,static_cast<uint32_t>(def))); }
+    int16_t i16(int id, int16_t def = 0) const { return static_cast<int16_t>(u(id,2,static_cast<uint16_t>(def))); }
+    uint8_t u8(int id, uint8_t def = 0) const { return static_cast<uint8_t>(u(id,1,def)); }
+
+    /* Child table, string, or vector of tables or structs. Absent vectors are empty */
+    FbTable table(int id) const;
+    std::string string(int id) const;
+    size_t count(int id) const;
+    FbTable table_at(int id, size_t i) const;
+    const uint8_t * structs(int id, size_t size, size_t * n) const;
+
+private:
+    FbTable(const uint8_t * buf, size_t len, size_t pos);
+    size_t field(int id) const;
+    size_t deref(size_t at) const;
+    size_t vec(int id, size_t elem, size_t * n) const;
+    void check(size_t at, size_t size) const;
+
+    const uint8_t * buf;
+    size_t len;
+    size_t pos;
+    size_t vt;
+    size_t vt_len;
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_FLATBUF_HPP_ */
@@ -0,0 +1,134 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace pal
+{
+
+/* Primes from the XXH64 specification */
+static const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t P3 = 0x165667B19E3779F9ULL;
+static const uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t v, int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t * p)
+{
+    uint64_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t * p)
+{
+    uint32_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static inline uint64_t round(uint64_t acc, uint64_t in)
+{
+    acc += in * P2;
+    acc = rotl(acc,31);
+    return acc * P1;
+}
+
+static inline uint64_t merge(uint64_t acc, uint64_t v)
+{
+    acc ^= round(0,v);
+    return acc * P1 + P4;
+}
+
+uint64_t xxh64(const void * data, size_t len, uint64_t seed)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(data);
+    const uint8_t * end = p + len;
+    uint64_t h;
+
+    /* Four lanes over 32-byte stripes */
+    if(len >= 32)
+    {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        do
+        {
+            v1 = round(v1,read64(p));
+            v2 = round(v2,read64(p + 8));
+            v3 = round(v3,read64(p + 16));
+            v4 = round(v4,read64(p + 24));
+            p += 32;
+        }
+        while(end - p >= 32);
+        h = rotl(v1,1) + rotl(v2,7) + rotl(v3,12) + rotl(v4,18);
+        h = merge(h,v1);
+        h = merge(h,v2);
+        h = merge(h,v3);
+        h = merge(h,v4);
+    }
+    else
+    {
+        h = seed + P5;
+    }
+    h += len;
+
+    /* Tail, 8, then 4, then 1 bytes at a time */
+    while(end - p >= 8)
+    {
+        h ^= round(0,read64(p));
+        h = rotl(h,27) * P1 + P4;
+        p += 8;
+    }
+    if(end - p >= 4)
+    {
+        h ^= static_cast<uint64_t>(read32(p)) * P1;
+        h = rotl(h,23) * P2 + P3;
+        p += 4;
+    }
+    while(p < end)
+    {
+        h ^= (*p) * P5;
+        h = rotl(h,11) * P1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string content_id(const std::vector<std::string>& paths)
+{
+    std::vector<uint64_t> hashes;
+    uint64_t total = 0;
+    for(const auto& p : paths)
+    {
+        MappedFile file(p);
+        hashes.push_back(xxh64(file.data(),file.size()));
+        total += file.size();
+    }
+    char buf[32];
+    snprintf(buf,sizeof(buf),"%016llx%08llx",
+        (unsigned long long)xxh64(hashes.data(),hashes.size() * sizeof(uint64_t)),
+        (unsigned long long)(total & 0xFFFFFFFFULL));
+    return buf;
+}
+
+} /* namespace pal */
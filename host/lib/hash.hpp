@@ -0,0 +1,29 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_HASH_HPP_
+#define _PAL_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* XXH64 of a buffer, a fast non-cryptographic hash used to spot duplicate files */
+uint64_t xxh64(const void * data, size_t len, uint64_t seed = 0);
+
+/* Content id of a set of files, as 24 hex digits: the XXH64 of their XXH64s in
+ * order, then their total length
+ * Throws std::runtime_error if a file can't be read
+ */
+std::string content_id(const std::vector<std::string>& paths);
+
+} /* namespace pal */
+
+#endif /* _PAL_HASH_HPP_ */
@@ -0,0 +1,202 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "kpi.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <strings.h>
+
+namespace pal
+{
+
+/* Rows read per block */
+#define KPI_BLOCK_ROWS 4096
+
+/* TIME steps are counted in 1 ms bins up to this, longer ones share the last bin */
+#define KPI_GAP_BINS 1001
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/* Running min, max and sums of the finite values of a column */
+struct KpiStat
+{
+    double min = INFINITY;
+    double max = -INFINITY;
+    double sum = 0.0;
+    double sum2 = 0.0;
+    size_t n = 0;
+
+    void add(const double * v, size_t count)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            double x = v[i];
+            if(!std::isfinite(x)) continue;
+            min = std::min(min,x);
+            max = std::max(max,x);
+            sum += x;
+            sum2 += x * x;
+            n++;
+        }
+    }
+
+    double lo() const { return n ? min : NaN; }
+    double hi() const { return n ? max : NaN; }
+    double mean() const { return n ? sum / n : NaN; }
+    double rms() const { return n ? std::sqrt(sum2 / n) : NaN; }
+    double peak() const { return n ? std::max(std::fabs(min),std::fabs(max)) : NaN; }
+};
+
+/* Column matching name, ignoring case, or -1 */
+static int find_column(const std::vector<RowColumn>& cols, const char * name)
+{
+    for(size_t c = 0; c < cols.size(); c++)
+    {
+        if(!strcasecmp(cols[c].name.c_str(),name)) return static_cast<int>(c);
+    }
+    return -1;
+}
+
+/* Column starting with prefix, ignoring case, or -1 */
+static int find_prefix(const std::vector<RowColumn>& cols, const char * prefix)
+{
+    size_t len = strlen(prefix);
+    for(size_t c = 0; c < cols.size(); c++)
+    {
+        if(!strncasecmp(cols[c].name.c_str(),prefix,len)) return static_cast<int>(c);
+    }
+    return -1;
+}
+
+/* True if name ends with suffix, ignoring case */
+static bool ends_with(const std::string& name, const char * suffix)
+{
+    size_t len = strlen(suffix);
+    return name.size() > len && !strcasecmp(name.c_str() + name.size() - len,suffix);
+}
+
+KpiList segment_kpis(RowSource& src, double period_ms)
+{
+    const auto& cols = src.columns();
+    const size_t ncols = cols.size();
+
+    int volt = find_column(cols,"batt_volt");
+    int cur = find_column(cols,"batt_cur");
+    int gps = find_column(cols,"gps_error");
+    int dis = find_prefix(cols,"comp_dis");
+    int aut = find_prefix(cols,"comp_auto");
+
+    /* Motor temperature and current columns, as <side>_temp and <side>_cur */
+    struct Motor
+    {
+        std::string name;
+        int col;
+        KpiStat stat;
+    };
+    std::vector<Motor> motors;
+    for(size_t c = 0; c < ncols; c++)
+    {
+        const std::string& n = cols[c].name;
+        if(!strncasecmp(n.c_str(),"batt_",5)) continue;
+        if(ends_with(n,"_temp") || ends_with(n,"_cur")) motors.push_back({n + "_max",static_cast<int>(c),{}});
+    }
+
+    KpiStat s_volt, s_cur, s_gps;
+    std::vector<size_t> gaps(KPI_GAP_BINS,0);
+    double gap_max = NaN;
+    double mode_time[3] = {0.0,0.0,0.0};
+    double first = NaN, last = NaN;
+    int last_mode = -1;
+    size_t rows = 0;
+
+    std::vector<double> block(ncols * KPI_BLOCK_ROWS);
+    size_t n;
+    while((n = src.read(block.data(),KPI_BLOCK_ROWS)))
+    {
+        const double * col = block.data();
+        if(volt >= 0) s_volt.add(col + volt * KPI_BLOCK_ROWS,n);
+        if(cur >= 0) s_cur.add(col + cur * KPI_BLOCK_ROWS,n);
+        if(gps >= 0) s_gps.add(col + gps * KPI_BLOCK_ROWS,n);
+        for(auto& m : motors) m.stat.add(col + m.col * KPI_BLOCK_ROWS,n);
+
+        /* TIME steps, and the time in each mode from the mode at the start of each step */
+        const double * t = col;
+        for(size_t r = 0; r < n; r++)
+        {
+            if(!std::isfinite(t[r])) continue;
+            if(std::isfinite(last))
+            {
+                double dt = t[r] - last;
+                double ms = dt * 1000.0;
+                size_t bin = (ms <= 0.0) ? 0 : std::min<size_t>(static_cast<size_t>(ms + 0.5),KPI_GAP_BINS - 1);
+                gaps[bin]++;
+                if(!(ms <= gap_max)) gap_max = ms;
+                if(last_mode >= 0) mode_time[last_mode] += dt;
+            }
+            else
+            {
+                first = t[r];
+            }
+            last = t[r];
+            if(dis >= 0)
+            {
+                if(col[dis * KPI_BLOCK_ROWS + r] != 0.0) last_mode = 0;
+                else if(aut >= 0 && col[aut * KPI_BLOCK_ROWS + r] != 0.0) last_mode = 1;
+                else last_mode = 2;
+            }
+        }
+        rows += n;
+    }
+
+    /* Overruns are steps well over the loop period */
+    if(period_ms <= 0.0)
+    {
+        size_t best = 0;
+        for(size_t b = 1; b < KPI_GAP_BINS - 1; b++)
+        {
+            if(gaps[b] > gaps[best]) best = b;
+        }
+        period_ms = gaps[best] ? static_cast<double>(best) : NaN;
+    }
+    double overruns = NaN;
+    if(std::isfinite(period_ms))
+    {
+        overruns = 0.0;
+        for(size_t b = 0; b < KPI_GAP_BINS; b++)
+        {
+            if(b > 1.5 * period_ms) overruns += gaps[b];
+        }
+    }
+
+    bool modes = dis >= 0;
+    KpiList k =
+    {
+        {"rows",static_cast<double>(rows)},
+        {"seconds",std::isfinite(first) ? last - first : NaN},
+        {"batt_volt_min",s_volt.lo()},
+        {"batt_volt_max",s_volt.hi()},
+        {"batt_volt_mean",s_volt.mean()},
+        {"batt_cur_min",s_cur.lo()},
+        {"batt_cur_max",s_cur.hi()},
+        {"batt_cur_mean",s_cur.mean()},
+        {"period_ms",period_ms},
+        {"overruns",overruns},
+        {"gap_max_ms",gap_max},
+        {"gps_error_mean",s_gps.mean()},
+        {"gps_error_rms",s_gps.rms()},
+        {"gps_error_max",s_gps.hi()},
+        {"disabled_s",modes ? mode_time[0] : NaN},
+        {"auto_s",modes ? mode_time[1] : NaN},
+        {"driver_s",modes ? mode_time[2] : NaN},
+    };
+    for(const auto& m : motors) k.push_back({m.name,m.stat.peak()});
+    return k;
+}
+
+} /* namespace pal */
@@ -0,0 +1,38 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_KPI_HPP_
+#define _PAL_KPI_HPP_
+
+#include "rows.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pal
+{
+
+/* Summary metrics of one segment, by name, in a fixed order for the columns every
+ * segment has, then the motor columns it was found to have
+ *   rows, seconds
+ *   batt_volt_min/max/mean, batt_cur_min/max/mean
+ *   period_ms (the usual TIME step), overruns (steps over 1.5 periods), gap_max_ms
+ *   gps_error_mean/rms/max
+ *   disabled_s, auto_s, driver_s (time in each competition mode)
+ *   <side>_temp_max, <side>_cur_max for each motor, as named by log_motor()
+ * Metrics with no data (a column the segment doesn't have) are NaN
+ */
+typedef std::vector<std::pair<std::string, double>> KpiList;
+
+/* Compute the metrics of a row source in one pass
+ * period_ms is the control loop period, or 0 to use the most common TIME step
+ */
+KpiList segment_kpis(RowSource& src, double period_ms = 0.0);
+
+} /* namespace pal */
+
+#endif /* _PAL_KPI_HPP_ */
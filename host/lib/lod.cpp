@@ -0,0 +1,326 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "lod.hpp"
+#include "batch.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+/* Rows read from the source per block */
+#define LOD_BLOCK_ROWS 4096
+
+/* Buckets buffered per column and level before they are written */
+#define LOD_FLUSH 1024
+
+/* Running summary of the bucket being filled */
+struct LodAcc
+{
+    double min, max, sum, first, last;
+    size_t n;
+
+    void reset()
+    {
+        min = INFINITY;
+        max = -INFINITY;
+        sum = 0.0;
+        n = 0;
+    }
+
+    void add(double v)
+    {
+        if(!std::isfinite(v)) return;
+        if(!n) first = v;
+        last = v;
+        min = std::fmin(min,v);
+        max = std::fmax(max,v);
+        sum += v;
+        n++;
+    }
+
+    /* Fold in a finished bucket which follows this one */
+    void merge(const LodAcc& o)
+    {
+        if(!o.n) return;
+        if(!n) first = o.first;
+        last = o.last;
+        min = std::fmin(min,o.min);
+        max = std::fmax(max,o.max);
+        sum += o.sum;
+        n += o.n;
+    }
+
+    lod_bucket_t bucket() const
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if(!n) return {nan,nan,nan,nan,nan};
+        return {min,max,sum / n,first,last};
+    }
+};
+
+std::string lod_path(const std::string& source)
+{
+    return output_path(source,"",".lod");
+}
+
+/* Write all of buf at offset, retrying short writes */
+static void write_at(int fdesc, const void * buf, size_t len, off_t off, const std::string& path)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(buf);
+    while(len)
+    {
+        ssize_t n = pwrite(fdesc,p,len,off);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+        p += n;
+        len -= n;
+        off += n;
+    }
+}
+
+void write_lod(RowSource& src, const std::string& path, uint64_t source_size, int64_t source_mtime)
+{
+    const size_t ncols = src.columns().size();
+    const size_t nrows = src.rows();
+
+    /* Levels double until one bucket covers every row */
+    std::vector<lod_level_t> levels;
+    for(uint64_t rows = LOD_BASE; nrows; rows *= 2)
+    {
+        levels.push_back({rows,(nrows + rows - 1) / rows,0});
+        if(rows >= nrows) break;
+    }
+    const size_t nlevels = levels.size();
+
+    lod_file_t hdr;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.magic,LOD_MAGIC,sizeof(hdr.magic));
+    hdr.version = LOD_VERSION;
+    hdr.base = LOD_BASE;
+    hdr.ncols = ncols;
+    hdr.nlevels = nlevels;
+    hdr.nrows = nrows;
+    hdr.source_size = source_size;
+    hdr.source_mtime = source_mtime;
+
+    std::vector<lod_column_t> names(ncols);
+    for(size_t c = 0; c < ncols; c++)
+    {
+        memset(names[c].name,0,sizeof(names[c].name));
+        strncpy(names[c].name,src.columns()[c].name.c_str(),sizeof(names[c].name) - 1);
+    }
+
+    uint64_t off = sizeof(hdr) + ncols * sizeof(lod_column_t) + nlevels * sizeof(lod_level_t);
+    for(auto& l : levels)
+    {
+        l.offset = off;
+        off += l.count * ncols * sizeof(lod_bucket_t);
+    }
+
+    int fdesc = open(path.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if(fdesc < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    try
+    {
+        write_at(fdesc,&hdr,sizeof(hdr),0,path);
+        write_at(fdesc,names.data(),names.size() * sizeof(lod_column_t),sizeof(hdr),path);
+        write_at(fdesc,levels.data(),levels.size() * sizeof(lod_level_t),
+            sizeof(hdr) + ncols * sizeof(lod_column_t),path);
+
+        /* One accumulator and output buffer per level and column */
+        std::vector<LodAcc> acc(nlevels * ncols);
+        for(auto& a : acc) a.reset();
+        std::vector<std::vector<lod_bucket_t>> pend(nlevels * ncols);
+        std::vector<uint64_t> done(nlevels * ncols,0);
+
+        auto flush = [&](size_t k, size_t c)
+        {
+            auto& p = pend[k * ncols + c];
+            uint64_t& d = done[k * ncols + c];
+            uint64_t at = levels[k].offset + (c * levels[k].count + d) * sizeof(lod_bucket_t);
+            write_at(fdesc,p.data(),p.size() * sizeof(lod_bucket_t),at,path);
+            d += p.size();
+            p.clear();
+        };
+
+        /* Finish the bucket of level k ending at row, passing it up to the next level */
+        auto emit = [&](size_t row, size_t c)
+        {
+            for(size_t k = 0; k < nlevels; k++)
+            {
+                if((row + 1) % levels[k].rows && row + 1 != nrows) break;
+                LodAcc& a = acc[k * ncols + c];
+                auto& p = pend[k * ncols + c];
+                p.push_back(a.bucket());
+                if(p.size() >= LOD_FLUSH) flush(k,c);
+                if(k + 1 < nlevels) acc[(k + 1) * ncols + c].merge(a);
+                a.reset();
+            }
+        };
+
+        std::vector<double> block(ncols * LOD_BLOCK_ROWS);
+        size_t row = 0;
+        size_t n;
+        while(row < nrows && (n = src.read(block.data(),LOD_BLOCK_ROWS)))
+        {
+            if(n > nrows - row) n = nrows - row;
+            for(size_t c = 0; c < ncols; c++)
+            {
+                const double * v = &block[c * LOD_BLOCK_ROWS];
+                LodAcc& a = acc[c];
+                for(size_t r = 0; r < n; r++)
+                {
+                    a.add(v[r]);
+                    size_t at = row + r;
+                    if((at + 1) % LOD_BASE == 0 || at + 1 == nrows) emit(at,c);
+                }
+            }
+            row += n;
+        }
+
+        for(size_t k = 0; k < nlevels; k++)
+        {
+            for(size_t c = 0; c < ncols; c++) flush(k,c);
+        }
+        if(ftruncate(fdesc,off) < 0)
+        {
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+    }
+    catch(...)
+    {
+        close(fdesc);
+        unlink(path.c_str());
+        throw;
+    }
+
+    if(close(fdesc) < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
+
+LodFile::LodFile(const std::string& path) : file(path)
+{
+    if(file.size() < sizeof(lod_file_t) || memcmp(file.data(),LOD_MAGIC,4))
+    {
+        throw std::runtime_error(path + ": not a pyramid sidecar");
+    }
+    hdr = reinterpret_cast<const lod_file_t *>(file.data());
+    if(hdr->version != LOD_VERSION)
+    {
+        throw std::runtime_error(path + ": unsupported version " + std::to_string(hdr->version));
+    }
+
+    size_t need = sizeof(lod_file_t) + hdr->ncols * sizeof(lod_column_t) + hdr->nlevels * sizeof(lod_level_t);
+    if(file.size() < need)
+    {
+        throw std::runtime_error(path + ": truncated");
+    }
+    const lod_column_t * cols = reinterpret_cast<const lod_column_t *>(hdr + 1);
+    for(size_t c = 0; c < hdr->ncols; c++)
+    {
+        names.emplace_back(cols[c].name,strnlen(cols[c].name,sizeof(cols[c].name)));
+    }
+    lvl = reinterpret_cast<const lod_level_t *>(cols + hdr->ncols);
+    for(size_t k = 0; k < hdr->nlevels; k++)
+    {
+        if(lvl[k].offset + lvl[k].count * hdr->ncols * sizeof(lod_bucket_t) > file.size())
+        {
+            throw std::runtime_error(path + ": truncated");
+        }
+    }
+}
+
+int LodFile::find(const std::string& name) const
+{
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        if(names[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool LodFile::stale(const std::string& source) const
+{
+    struct stat st;
+    if(stat(source.c_str(),&st) < 0) return true;
+    return static_cast<uint64_t>(st.st_size) != hdr->source_size || st.st_mtime != hdr->source_mtime;
+}
+
+const lod_bucket_t * LodFile::buckets(int col, int k) const
+{
+    const lod_level_t& l = lvl[k];
+    return reinterpret_cast<const lod_bucket_t *>(file.data() + l.offset) + col * l.count;
+}
+
+LodWindow LodFile::window(int col, double t0, double t1, size_t pixels) const
+{
+    LodWindow w;
+    if(!hdr->nlevels || col < 0 || static_cast<size_t>(col) >= names.size()) return w;
+    if(!pixels) pixels = 1;
+
+    /* Find the rows from the finest level of the time column, which only grows */
+    const lod_bucket_t * t = buckets(0,0);
+    size_t count = lvl[0].count;
+    size_t lo = 0, hi = count;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(t[mid].last < t0) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t b0 = lo;
+    hi = count;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(t[mid].first <= t1) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t b1 = lo;
+
+    w.first_row = std::min<size_t>(b0 * lvl[0].rows,hdr->nrows);
+    w.last_row = std::min<size_t>(b1 * lvl[0].rows,hdr->nrows);
+    if(w.last_row <= w.first_row || w.last_row - w.first_row <= pixels) return w;
+
+    /* Coarsen until the window fits in the pixels */
+    for(size_t k = 0; k < hdr->nlevels; k++)
+    {
+        size_t rows = lvl[k].rows;
+        size_t first = w.first_row / rows;
+        size_t last = (w.last_row + rows - 1) / rows;
+        if(last - first <= pixels || k + 1 == hdr->nlevels)
+        {
+            w.level = k;
+            w.bucket_rows = rows;
+            w.buckets = buckets(col,k) + first;
+            w.count = last - first;
+            w.first_row = first * rows;
+            w.last_row = std::min<size_t>(last * rows,hdr->nrows);
+            break;
+        }
+    }
+    return w;
+}
+
+} /* namespace pal */
@@ -0,0 +1,133 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_LOD_HPP_
+#define _PAL_LOD_HPP_
+
+#include "mapped_file.hpp"
+#include "rows.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Level-of-detail pyramid of a data file, stored in a sidecar next to it
+ * (dat00012.bin gives dat00012.lod)
+ *
+ * Level k groups the rows into buckets of LOD_BASE << k rows, and holds the min,
+ * max, mean, first and last finite value of every column in each bucket. Levels
+ * go up until a single bucket covers the file. The buckets of one column at one
+ * level are contiguous, so a plot of any time window at screen resolution reads
+ * one run of at most a few buckets per pixel, whatever the length of the log.
+ * Column 0 is the row time, which is also how windows are found.
+ *
+ * Sidecar layout, all little-endian and 8-byte aligned:
+ *   lod_file_t, then ncols lod_column_t, then nlevels lod_level_t, then the
+ *   buckets of each level, column by column
+ */
+
+#define LOD_MAGIC "PALL"
+#define LOD_VERSION 1
+
+/* Rows in a bucket of the finest level */
+#define LOD_BASE 16
+
+typedef struct
+{
+    char magic[4];          /* LOD_MAGIC */
+    uint16_t version;       /* LOD_VERSION */
+    uint16_t base;          /* Rows per bucket at level 0 */
+    uint32_t ncols;
+    uint32_t nlevels;
+    uint64_t nrows;
+    uint64_t source_size;   /* Size and modification time of the data file, to spot */
+    int64_t source_mtime;   /* a sidecar which is out of date */
+} lod_file_t;
+
+typedef struct
+{
+    char name[64];          /* NUL terminated column name */
+} lod_column_t;
+
+typedef struct
+{
+    uint64_t rows;          /* Rows per bucket */
+    uint64_t count;         /* Buckets per column */
+    uint64_t offset;        /* File offset of column 0's buckets, the rest follow */
+} lod_level_t;
+
+/* One bucket, values are NaN if the bucket has no finite values */
+typedef struct
+{
+    double min;
+    double max;
+    double mean;
+    double first;
+    double last;
+} lod_bucket_t;
+
+/* Build the pyramid of a row source into a sidecar file
+ * source_size and source_mtime identify the data file it was built from
+ * Throws std::runtime_error if the file can't be written
+ */
+void write_lod(RowSource& src, const std::string& path, uint64_t source_size, int64_t source_mtime);
+
+/* Buckets covering a time window, from LodFile::window()
+ * When the window has no more rows than pixels, level is -1 and there are no
+ * buckets, and the caller should plot rows [first_row,last_row) from the data file
+ */
+struct LodWindow
+{
+    int level = -1;
+    size_t first_row = 0;       /* Rows covered by the buckets */
+    size_t last_row = 0;
+    size_t bucket_rows = 1;
+    const lod_bucket_t * buckets = nullptr;
+    size_t count = 0;
+};
+
+/* Sidecar mapped into memory
+ * Throws std::runtime_error if the file can't be read or is not a pyramid
+ */
+class LodFile
+{
+public:
+    explicit LodFile(const std::string& path);
+
+    size_t rows() const { return hdr->nrows; }
+    size_t levels() const { return hdr->nlevels; }
+    const std::vector<std::string>& columns() const { return names; }
+    int find(const std::string& name) const;
+
+    /* True if the sidecar was not built from the data file as it is now */
+    bool stale(const std::string& source) const;
+
+    /* All buckets of column col at level k */
+    const lod_bucket_t * buckets(int col, int k) const;
+    const lod_level_t& level(int k) const { return lvl[k]; }
+
+    /* Buckets of column col covering times [t0,t1] in seconds, at the finest level
+     * with no more than pixels buckets in the window
+     */
+    LodWindow window(int col, double t0, double t1, size_t pixels) const;
+
+private:
+    MappedFile file;
+    const lod_file_t * hdr;
+    const lod_level_t * lvl;
+    std::vector<std::string> names;
+};
+
+/* Sidecar path of a data file */
+std::string lod_path(const std::string& source);
+
+} /* namespace pal */
+
+#endif /* _PAL_LOD_HPP_ */
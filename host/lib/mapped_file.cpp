@@ -0,0 +1,81 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+MappedFile::MappedFile(const std::string& path) : name(path)
+{
+    int fdesc = open(path.c_str(),O_RDONLY);
+    if(fdesc < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if(fstat(fdesc,&st) < 0)
+    {
+        int err = errno;
+        close(fdesc);
+        throw std::runtime_error(path + ": " + strerror(err));
+    }
+    len = st.st_size;
+
+    /* Empty files can't be mapped, but are valid to read */
+    if(len)
+    {
+        void * p = mmap(nullptr,len,PROT_READ,MAP_PRIVATE,fdesc,0);
+        if(p == MAP_FAILED)
+        {
+            int err = errno;
+            close(fdesc);
+            throw std::runtime_error(path + ": " + strerror(err));
+        }
+        ptr = static_cast<const uint8_t *>(p);
+        madvise(p,len,MADV_SEQUENTIAL);
+    }
+    close(fdesc);
+}
+
+MappedFile::~MappedFile()
+{
+    if(ptr) munmap(const_cast<uint8_t *>(ptr),len);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : ptr(other.ptr), len(other.len), name(std::move(other.name))
+{
+    other.ptr = nullptr;
+    other.len = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if(this != &other)
+    {
+        if(ptr) munmap(const_cast<uint8_t *>(ptr),len);
+        ptr = other.ptr;
+        len = other.len;
+        name = std::move(other.name);
+        other.ptr = nullptr;
+        other.len = 0;
+    }
+    return *this;
+}
+
+} /* namespace pal */
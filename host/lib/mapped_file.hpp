@@ -0,0 +1,44 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_MAPPED_FILE_HPP_
+#define _PAL_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pal
+{
+
+/* Read-only memory mapping of a whole file
+ * Throws std::runtime_error if the file can't be opened or mapped
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const uint8_t * data() const { return ptr; }
+    const char * chars() const { return reinterpret_cast<const char *>(ptr); }
+    size_t size() const { return len; }
+    const std::string& path() const { return name; }
+
+private:
+    const uint8_t * ptr = nullptr;
+    size_t len = 0;
+    std::string name;
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_MAPPED_FILE_HPP_ */
@@ -0,0 +1,183 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "mat.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+/* Data and array types from the MAT-file format */
+#define MI_INT8 1
+#define MI_INT32 5
+#define MI_UINT32 6
+#define MI_DOUBLE 9
+#define MI_MATRIX 14
+#define MX_DOUBLE_CLASS 6
+
+/* Longest variable name MATLAB accepts */
+#define MAT_NAME_MAX 63
+
+/* Rows streamed per block */
+#define MAT_BLOCK_ROWS 4096
+
+std::string mat_name(const std::string& name)
+{
+    std::string out;
+    for(char c : name)
+    {
+        out += (isalnum(static_cast<unsigned char>(c)) || c == '_') ? c : '_';
+    }
+    if(out.empty() || !isalpha(static_cast<unsigned char>(out[0]))) out = "x" + out;
+    if(out.size() > MAT_NAME_MAX) out.resize(MAT_NAME_MAX);
+    return out;
+}
+
+/* Write all of buf at offset, retrying short writes */
+static void write_at(int fdesc, const void * buf, size_t len, off_t off, const std::string& path)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(buf);
+    while(len)
+    {
+        ssize_t n = pwrite(fdesc,p,len,off);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+        p += n;
+        len -= n;
+        off += n;
+    }
+}
+
+/* Append a tagged element to a header buffer, padded to 8 bytes */
+static void put_element(std::vector<uint8_t>& buf, uint32_t type, const void * data, uint32_t len)
+{
+    uint32_t tag[2] = {type,len};
+    const uint8_t * t = reinterpret_cast<const uint8_t *>(tag);
+    buf.insert(buf.end(),t,t + sizeof(tag));
+    const uint8_t * d = static_cast<const uint8_t *>(data);
+    buf.insert(buf.end(),d,d + len);
+    buf.resize((buf.size() + 7) & ~7,0);
+}
+
+void write_mat(RowSource& src, const std::string& path)
+{
+    const auto& cols = src.columns();
+    const size_t nrows = src.rows();
+    const size_t ncols = cols.size();
+    if(nrows * sizeof(double) > UINT32_MAX - 256)
+    {
+        throw std::runtime_error(path + ": too many rows for a MAT file");
+    }
+
+    /* File header, 116 bytes of text, subsystem offset, version and endian indicator */
+    std::vector<uint8_t> head(128,' ');
+    const char text[] = "MATLAB 5.0 MAT-file, Platform: GLNXA64, Created by: pallog";
+    memcpy(head.data(),text,sizeof(text) - 1);
+    memset(&head[116],0,8);
+    head[124] = 0x00;
+    head[125] = 0x01;
+    head[126] = 'I';
+    head[127] = 'M';
+
+    /* Each variable is a matrix element holding flags, dimensions, name and then the
+     * data, so the headers are written first and the data streamed in after
+     */
+    std::vector<std::vector<uint8_t>> vars(ncols);
+    std::vector<off_t> data_off(ncols);
+    std::set<std::string> used;
+    off_t pos = head.size();
+    for(size_t c = 0; c < ncols; c++)
+    {
+        /* Names must be unique, or loading the file overwrites the earlier ones */
+        std::string name = mat_name(cols[c].name);
+        std::string base = name;
+        for(int k = 2; used.count(name); k++)
+        {
+            std::string suffix = "_" + std::to_string(k);
+            name = base.substr(0,MAT_NAME_MAX - suffix.size()) + suffix;
+        }
+        used.insert(name);
+
+        std::vector<uint8_t> sub;
+        uint32_t flags[2] = {MX_DOUBLE_CLASS,0};
+        int32_t dims[2] = {static_cast<int32_t>(nrows),1};
+        put_element(sub,MI_UINT32,flags,sizeof(flags));
+        put_element(sub,MI_INT32,dims,sizeof(dims));
+        put_element(sub,MI_INT8,name.data(),name.size());
+
+        uint32_t data_tag[2] = {MI_DOUBLE,static_cast<uint32_t>(nrows * sizeof(double))};
+        uint32_t mat_tag[2] = {MI_MATRIX,static_cast<uint32_t>(sub.size() + sizeof(data_tag) + data_tag[1])};
+        const uint8_t * m = reinterpret_cast<const uint8_t *>(mat_tag);
+        const uint8_t * d = reinterpret_cast<const uint8_t *>(data_tag);
+        std::vector<uint8_t>& v = vars[c];
+        v.insert(v.end(),m,m + sizeof(mat_tag));
+        v.insert(v.end(),sub.begin(),sub.end());
+        v.insert(v.end(),d,d + sizeof(data_tag));
+
+        data_off[c] = pos + v.size();
+        pos = data_off[c] + nrows * sizeof(double);
+    }
+
+    int fdesc = open(path.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if(fdesc < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    try
+    {
+        write_at(fdesc,head.data(),head.size(),0,path);
+        for(size_t c = 0; c < ncols; c++)
+        {
+            write_at(fdesc,vars[c].data(),vars[c].size(),data_off[c] - vars[c].size(),path);
+        }
+        if(ftruncate(fdesc,pos) < 0)
+        {
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+
+        /* Stream the rows, each block lands as one contiguous run per variable */
+        std::vector<double> block(ncols * MAT_BLOCK_ROWS);
+        size_t row = 0;
+        size_t n;
+        while(row < nrows && (n = src.read(block.data(),MAT_BLOCK_ROWS)))
+        {
+            if(n > nrows - row) n = nrows - row;
+            for(size_t c = 0; c < ncols; c++)
+            {
+                write_at(fdesc,&block[c * MAT_BLOCK_ROWS],n * sizeof(double),
+                    data_off[c] + row * sizeof(double),path);
+            }
+            row += n;
+        }
+    }
+    catch(...)
+    {
+        close(fdesc);
+        unlink(path.c_str());
+        throw;
+    }
+
+    if(close(fdesc) < 0)
+    {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
+
+} /* namespace pal */
@@ -0,0 +1,30 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_MAT_HPP_
+#define _PAL_MAT_HPP_
+
+#include "rows.hpp"
+
+#include <string>
+
+namespace pal
+{
+
+/* Write a row source to a Level 5 MAT file, with an N x 1 double variable per column
+ * (as model/simulate.m expects). Every variable's place in the file is known from
+ * the row count, so the rows are streamed into place a block at a time and memory
+ * use does not grow with the file
+ * Throws std::runtime_error if the file can't be written
+ */
+void write_mat(RowSource& src, const std::string& path);
+
+/* Turn a column name into a valid MATLAB variable name, as matlab.lang.makeValidName does */
+std::string mat_name(const std::string& name);
+
+} /* namespace pal */
+
+#endif /* _PAL_MAT_HPP_ */
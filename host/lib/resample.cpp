@@ -0,0 +1,363 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "resample.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+namespace pal
+{
+
+/* Rows read from the sources at a time */
+#define RESAMPLE_ROWS 4096
+
+/* Seconds a sample time may trail its row time, so grid times up to this far
+ * behind the last row read are complete
+ */
+#define RESAMPLE_LAG 1.0
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+struct Sample
+{
+    double t;
+    double v;
+};
+
+/* Kernels filling n grid points from one pair of samples, written as plain loops
+ * over a contiguous column so the compiler vectorizes them
+ */
+static void fill_value(double v, double * out, size_t n)
+{
+    for(size_t i = 0; i < n; i++) out[i] = v;
+}
+
+static void fill_linear(const Sample& a, const Sample& b, double g0, double dt, double * out, size_t n)
+{
+    double slope = (b.v - a.v) / (b.t - a.t);
+    double base = a.v + (g0 - a.t) * slope;
+    double step = dt * slope;
+    for(size_t i = 0; i < n; i++) out[i] = base + static_cast<double>(i) * step;
+}
+
+/* Time column of a column, the <name>_t of its channel if it has one, else row time */
+static int time_column(const std::map<std::string, int>& by_name, int self, std::string name)
+{
+    for(;;)
+    {
+        auto it = by_name.find(name + "_t");
+        if(it != by_name.end() && it->second != self) return it->second;
+        size_t u = name.find_last_of('_');
+        if(u == std::string::npos || u == 0) return 0;
+        name.resize(u);
+    }
+}
+
+class ResampledRows : public RowSource
+{
+public:
+    ResampledRows(std::vector<std::unique_ptr<RowSource>> srcs, const ResampleOptions& opt)
+        : dt(opt.dt), method(opt.method)
+    {
+        if(!(dt > 0.0)) throw std::runtime_error("resample step must be positive");
+
+        /* Channels are matched by name across the sources, in order of appearance */
+        std::map<std::string, std::vector<size_t>> out_index;
+        cols.push_back({"time",ColType::Double});
+        std::vector<bool> requested(opt.channels.size(),false);
+        double first = INFINITY, last = -INFINITY;
+        for(auto& s : srcs)
+        {
+            const auto& sc = s->columns();
+            std::map<std::string, int> by_name;
+            for(size_t c = 0; c < sc.size(); c++) by_name[sc[c].name] = static_cast<int>(c);
+            std::vector<int> tcol(sc.size(),0);
+            std::vector<bool> is_time(sc.size(),false);
+            for(size_t c = 1; c < sc.size(); c++)
+            {
+                tcol[c] = time_column(by_name,static_cast<int>(c),sc[c].name);
+                is_time[tcol[c]] = true;
+            }
+
+            Input in;
+            in.src = std::move(s);
+            std::map<std::string, size_t> seen;
+            for(size_t c = 1; c < sc.size(); c++)
+            {
+                if(is_time[c]) continue;
+                bool want = opt.channels.empty();
+                for(size_t r = 0; r < opt.channels.size(); r++)
+                {
+                    const std::string& n = opt.channels[r];
+                    if(sc[c].name == n || !sc[c].name.compare(0,n.size() + 1,n + "_"))
+                    {
+                        want = true;
+                        requested[r] = true;
+                    }
+                }
+                if(!want) continue;
+
+                /* A name repeated within a source is a separate channel each time */
+                std::vector<size_t>& same = out_index[sc[c].name];
+                size_t nth = seen[sc[c].name]++;
+                if(nth == same.size())
+                {
+                    same.push_back(chans.size());
+                    ColType t = (method == Resample::Linear) ? ColType::Double : sc[c].type;
+                    cols.push_back({sc[c].name,t});
+                    chans.emplace_back();
+                }
+                in.chans.push_back({same[nth],static_cast<int>(c),tcol[c]});
+            }
+
+            double a, b;
+            if(in.src->span(a,b))
+            {
+                first = std::min(first,a);
+                last = std::max(last,b);
+            }
+            inputs.push_back(std::move(in));
+        }
+        for(size_t r = 0; r < opt.channels.size(); r++)
+        {
+            if(!requested[r]) throw std::runtime_error("no channel " + opt.channels[r]);
+        }
+        if(chans.empty()) throw std::runtime_error("no channels to resample");
+
+        /* The grid covers the rows unless given */
+        t0 = std::isfinite(opt.t0) ? opt.t0 : std::ceil(first / dt) * dt;
+        double t1 = std::isfinite(opt.t1) ? opt.t1 : last;
+
+        /* With a whole number of steps a second, grid times are divided out of step
+         * counts so they come out as the nearest double to each exact time
+         */
+        double r = std::round(1.0 / dt);
+        if(r >= 1.0 && std::fabs(1.0 / dt - r) < 1e-9 * r && std::isfinite(t0) &&
+            std::fabs(t0 * r - std::round(t0 * r)) < 1e-6)
+        {
+            rate = r;
+            k0 = std::round(t0 * r);
+            t0 = k0 / rate;
+        }
+        if(std::isfinite(t0) && std::isfinite(t1) && t1 >= t0)
+        {
+            nrows = first_after(t1);
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t r = 0;
+        while(r < max && next < nrows)
+        {
+            /* Grid times far enough behind the input have all their samples */
+            size_t ready = ended ? nrows : std::min(nrows,first_after(last_row - RESAMPLE_LAG));
+            size_t k = (ready > next) ? std::min(max - r,ready - next) : 0;
+            if(!k)
+            {
+                fill_input();
+                continue;
+            }
+
+            for(size_t j = 0; j < k; j++) block[r + j] = grid(next + j);
+            for(size_t c = 0; c < chans.size(); c++)
+            {
+                fill(chans[c].q,next,k,block + (c + 1) * max + r);
+            }
+            r += k;
+            next += k;
+        }
+        return r;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        if(!nrows) return false;
+        first = grid(0);
+        last = grid(nrows - 1);
+        return true;
+    }
+
+private:
+    /* Where a channel comes from in one source */
+    struct Source
+    {
+        size_t chan;
+        int value;
+        int time;       /* Sample time column, 0 for the row time */
+    };
+
+    struct Input
+    {
+        std::unique_ptr<RowSource> src;
+        std::vector<Source> chans;
+    };
+
+    /* Samples of a channel from the one at or before the next grid time onwards */
+    struct Channel
+    {
+        std::deque<Sample> q;
+    };
+
+    double grid(size_t i) const
+    {
+        if(rate > 0.0) return (k0 + static_cast<double>(i)) / rate;
+        return t0 + static_cast<double>(i) * dt;
+    }
+
+    /* Index of the first grid time after t */
+    size_t first_after(double t) const
+    {
+        if(!(t >= t0)) return 0;
+        size_t i = static_cast<size_t>((t - t0) / dt) + 1;
+        while(i > 0 && grid(i - 1) > t) i--;
+        while(grid(i) <= t) i++;
+        return i;
+    }
+
+    /* Index of the first grid time at or after t */
+    size_t first_from(double t) const
+    {
+        if(!(t > t0)) return 0;
+        size_t i = first_after(t);
+        while(i > 0 && grid(i - 1) >= t) i--;
+        return i;
+    }
+
+    /* Read the next block of rows into the channel queues */
+    void fill_input()
+    {
+        while(cur < inputs.size())
+        {
+            Input& in = inputs[cur];
+            size_t ncols = in.src->columns().size();
+            buf.resize(ncols * RESAMPLE_ROWS);
+            size_t n = in.src->read(buf.data(),RESAMPLE_ROWS);
+            if(!n)
+            {
+                cur++;
+                continue;
+            }
+
+            for(const Source& s : in.chans)
+            {
+                const double * v = &buf[s.value * RESAMPLE_ROWS];
+                const double * t = &buf[s.time * RESAMPLE_ROWS];
+                std::deque<Sample>& q = chans[s.chan].q;
+                for(size_t r = 0; r < n; r++)
+                {
+                    /* Timestamped channels repeat a sample until the next one comes in */
+                    if(!std::isfinite(t[r]) || !std::isfinite(v[r])) continue;
+                    if(!q.empty() && t[r] <= q.back().t) continue;
+                    q.push_back({t[r],v[r]});
+                }
+            }
+            for(size_t r = 0; r < n; r++)
+            {
+                if(buf[r] > last_row) last_row = buf[r];
+            }
+
+            /* Samples before the one at or before the next grid time are done with */
+            double g = grid(next);
+            for(auto& c : chans)
+            {
+                while(c.q.size() >= 2 && c.q[1].t <= g) c.q.pop_front();
+            }
+            return;
+        }
+        ended = true;
+    }
+
+    /* Fill k grid points from index idx for a channel */
+    void fill(std::deque<Sample>& q, size_t idx, size_t k, double * out)
+    {
+        size_t j = 0;
+        while(j < k)
+        {
+            double g = grid(idx + j);
+            while(q.size() >= 2 && q[1].t <= g) q.pop_front();
+
+            /* Nothing known before the first sample */
+            if(q.empty() || q[0].t > g)
+            {
+                size_t e = q.empty() ? k : std::min(k,first_from(q[0].t) - idx);
+                fill_value(NaN,out + j,e - j);
+                j = e;
+                continue;
+            }
+
+            /* After the last sample, only a hold carries on */
+            const Sample& a = q[0];
+            if(q.size() < 2)
+            {
+                if(method == Resample::Hold)
+                {
+                    fill_value(a.v,out + j,k - j);
+                }
+                else
+                {
+                    for(; j < k; j++) out[j] = (grid(idx + j) == a.t) ? a.v : NaN;
+                }
+                return;
+            }
+
+            const Sample& b = q[1];
+            size_t e = std::min(k,first_from(b.t) - idx);
+            switch(method)
+            {
+            case Resample::Hold:
+                fill_value(a.v,out + j,e - j);
+                break;
+            case Resample::Linear:
+                fill_linear(a,b,g,dt,out + j,e - j);
+                break;
+            case Resample::Nearest:
+            {
+                /* Start from the midpoint, then settle ties with the same test per point */
+                size_t m = std::min(e,std::max(j,first_after(0.5 * (a.t + b.t)) - idx));
+                while(m > j && grid(idx + m - 1) - a.t > b.t - grid(idx + m - 1)) m--;
+                while(m < e && grid(idx + m) - a.t <= b.t - grid(idx + m)) m++;
+                fill_value(a.v,out + j,m - j);
+                fill_value(b.v,out + m,e - m);
+                break;
+            }
+            }
+            j = e;
+        }
+    }
+
+    double dt;
+    Resample method;
+    double t0 = 0.0;
+    double rate = 0.0;      /* Steps per second if whole, else 0 */
+    double k0 = 0.0;        /* Step count of t0 */
+    std::vector<Input> inputs;
+    std::vector<Channel> chans;
+    std::vector<double> buf;
+    size_t cur = 0;
+    size_t next = 0;
+    double last_row = -INFINITY;
+    bool ended = false;
+};
+
+std::unique_ptr<RowSource> resample(std::vector<std::unique_ptr<RowSource>> sources, const ResampleOptions& opt)
+{
+    return std::unique_ptr<RowSource>(new ResampledRows(std::move(sources),opt));
+}
+
+Resample resample_method(const std::string& name)
+{
+    if(name == "hold" || name == "zoh") return Resample::Hold;
+    if(name == "linear") return Resample::Linear;
+    if(name == "nearest") return Resample::Nearest;
+    throw std::runtime_error("unknown resample method " + name);
+}
+
+} /* namespace pal */
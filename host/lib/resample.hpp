@@ -0,0 +1,59 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_RESAMPLE_HPP_
+#define _PAL_RESAMPLE_HPP_
+
+#include "rows.hpp"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* How a channel's value between samples is found */
+enum class Resample
+{
+    Hold,       /* Zero-order hold, the last sample at or before the grid time */
+    Linear,     /* Straight line between the samples either side */
+    Nearest,    /* Whichever sample is closer in time, the earlier on a tie */
+};
+
+struct ResampleOptions
+{
+    double dt = 0.01;               /* Grid step in seconds */
+    Resample method = Resample::Linear;
+    double t0 = NAN;                /* First grid time, NaN for the first row rounded up to dt */
+    double t1 = NAN;                /* Last grid time, NaN for the last row */
+    std::vector<std::string> channels;  /* Columns, or vector channels by name, empty for all */
+};
+
+/* Resample channels of one or more row sources onto the uniform grid t0 + k * dt
+ *
+ * The sources are segments of one run, read one after the other. Each channel is
+ * taken at its own sample times where it has them (the <name>_t columns of
+ * timestamped binary channels), otherwise at the row times, skipping repeated
+ * samples and non-finite values. Grid times before a channel's first sample are
+ * NaN, as are those after its last sample except with Hold.
+ *
+ * The result is itself a row source, so it can be written by any exporter. It
+ * reads the inputs a block at a time and keeps only the samples within
+ * RESAMPLE_LAG seconds of the grid, so logs of any length stream through
+ * Throws std::runtime_error if no channels are found or dt is not positive
+ */
+std::unique_ptr<RowSource> resample(std::vector<std::unique_ptr<RowSource>> sources, const ResampleOptions& opt);
+
+/* Method by name: hold (or zoh), linear or nearest
+ * Throws std::runtime_error for any other name
+ */
+Resample resample_method(const std::string& name);
+
+} /* namespace pal */
+
+#endif /* _PAL_RESAMPLE_HPP_ */
@@ -0,0 +1,492 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "rows.hpp"
+#include "arrow.hpp"
+#include "binlog.hpp"
+#include "csv.hpp"
+#include "mapped_file.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+#include <map>
+#include <set>
+#include <strings.h>
+
+namespace pal
+{
+
+uint64_t RowSource::tell() const
+{
+    return 0;
+}
+
+void RowSource::seek(uint64_t)
+{
+    throw std::runtime_error("this row source can't seek");
+}
+
+bool is_flag_name(const std::string& name)
+{
+    return !strncasecmp(name.c_str(),"COMP_",5) || !strncasecmp(name.c_str(),"CTRL_",5);
+}
+
+/* CSV data file, parsed a row at a time */
+class CsvRows : public RowSource
+{
+public:
+    explicit CsvRows(MappedFile&& f) : file(std::move(f))
+    {
+        std::vector<std::string> names;
+        const char * data = file.chars();
+        end = data + file.size();
+        p = parse_csv_header(data,file.size(),names);
+        body = p;
+        nrows = count_csv_rows(p,end);
+
+        /* The first column is the row time. The current logger names it TIME and
+         * writes seconds, older loggers named it time and wrote milliseconds
+         */
+        if(!names.empty())
+        {
+            time_div = (names[0] == "time") ? 1000.0 : 1.0;
+            names[0] = "time";
+        }
+        for(const auto& n : names)
+        {
+            cols.push_back({n,is_flag_name(n) ? ColType::Bool : ColType::Double});
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t r = 0;
+        while(r < max && p)
+        {
+            p = parse_csv_row(p,end,block + r,cols.size(),max);
+            if(!p) break;
+            block[r] /= time_div;
+            r++;
+        }
+        return r;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        if(!nrows) return false;
+        std::vector<double> row(cols.size());
+        parse_csv_row(body,end,row.data(),row.size(),1);
+        first = row[0] / time_div;
+
+        /* The last row starts after the last line break which is not at the end */
+        const char * q = end;
+        while(q > body && (q[-1] == '\n' || q[-1] == '\r')) q--;
+        while(q > body && q[-1] != '\n') q--;
+        parse_csv_row(q,end,row.data(),row.size(),1);
+        last = row[0] / time_div;
+        return true;
+    }
+
+    /* Positions are file offsets of row starts */
+    uint64_t tell() const override
+    {
+        return p ? p - file.chars() : file.size();
+    }
+
+    void seek(uint64_t pos) override
+    {
+        if(pos < static_cast<uint64_t>(body - file.chars()) || pos > file.size())
+        {
+            throw std::runtime_error("seek out of range");
+        }
+        p = file.chars() + pos;
+    }
+
+private:
+    MappedFile file;
+    const char * body;
+    const char * p;
+    const char * end;
+    double time_div = 1.0;
+};
+
+/* Name of the sample time column of each delta, keyed by its offset in the row
+ * A delta of one channel takes its name, a delta shared by a poller device's fields
+ * takes their common "<device>_" prefix, so the resampler pairs every field with it
+ */
+static std::map<uint16_t, std::string> sample_time_names(const std::vector<BinChannel>& chans)
+{
+    std::map<uint16_t, std::string> names;
+    for(const BinChannel& ch : chans)
+    {
+        if(!ch.in_row() || !(ch.flags & LOG_CHAN_TS)) continue;
+        auto it = names.find(ch.ts_offset);
+        if(it == names.end())
+        {
+            names[ch.ts_offset] = ch.name;
+            continue;
+        }
+        std::string& n = it->second;
+        size_t len = 0;
+        while(len < n.size() && len < ch.name.size() && n[len] == ch.name[len]) len++;
+        size_t u = n.find_last_of('_',len ? len - 1 : 0);
+        if(len < n.size() && u != std::string::npos && u > 0) n.resize(u);
+    }
+    return names;
+}
+
+/* Binary data file, walked a record at a time */
+class BinRows : public RowSource
+{
+public:
+    explicit BinRows(MappedFile&& f) : file(std::move(f)), cur(file.data(),file.size())
+    {
+        /* First walk reads the schema and counts the rows */
+        BinCursor scan(file.data(),file.size());
+        while(scan.next())
+        {
+            const log_bin_record_t& rec = scan.record();
+            if(rec.type == LOG_REC_CHANNEL)
+            {
+                if(rec.chan != chans.size())
+                {
+                    throw std::runtime_error("channel records out of order");
+                }
+                chans.push_back(parse_channel(scan.payload(),rec.len));
+                const BinChannel& c = chans.back();
+                if(c.in_row())
+                {
+                    size_t e = c.offset + c.value_size() * c.count;
+                    if(e > row_len) row_len = e;
+                    if(c.flags & LOG_CHAN_TS) e = c.ts_offset + sizeof(int32_t);
+                    if(e > row_len) row_len = e;
+                }
+            }
+            else if(rec.type == LOG_REC_ROW && is_row(rec))
+            {
+                log_bin_row_t row;
+                memcpy(&row,scan.payload(),sizeof(row));
+                if(!nrows) first_ms = row.time_ms;
+                last_ms = row.time_ms;
+                nrows++;
+            }
+            else if(rec.type == LOG_REC_POINT && rec.chan < chans.size() && rec.len >= sizeof(log_bin_point_t))
+            {
+                points.resize(chans.size());
+                points[rec.chan].push_back(scan.offset() - sizeof(rec));
+            }
+        }
+
+        /* Then lay out the exported columns */
+        cols.push_back({"time",ColType::Double});
+        outs.push_back({Out::TIME,0,0});
+        var_count.assign(chans.size(),0);
+        std::set<uint16_t> ts_seen;
+        std::map<uint16_t, std::string> ts_names = sample_time_names(chans);
+        for(size_t c = 0; c < chans.size(); c++)
+        {
+            const BinChannel& ch = chans[c];
+            int ci = static_cast<int>(c);
+            if(ch.flags & LOG_CHAN_VAR)
+            {
+                cols.push_back({ch.name + "_n",ColType::Int});
+                outs.push_back({Out::VAR,ci,0});
+            }
+            else if(ch.flags & LOG_CHAN_SPARSE)
+            {
+                cols.push_back({ch.name,ColType::Double});
+                outs.push_back({Out::SPARSE,ci,static_cast<int>(sparse.size())});
+                sparse.emplace_back(file.data(),file.size(),ci,(ch.flags & LOG_CHAN_HOLD) != 0);
+            }
+            else
+            {
+                ColType t = ColType::Double;
+                if(ch.type == LOG_TYPE_INT) t = is_flag_name(ch.name) ? ColType::Bool : ColType::Int;
+                for(int e = 0; e < ch.count; e++)
+                {
+                    cols.push_back({ch.element_name(e),t});
+                    outs.push_back({Out::VALUE,ci,e});
+                }
+                /* Channels sharing a delta get one sample time column, after the first */
+                if((ch.flags & LOG_CHAN_TS) && ts_seen.insert(ch.ts_offset).second)
+                {
+                    cols.push_back({ts_names[ch.ts_offset] + "_t",ColType::Double});
+                    outs.push_back({Out::SAMPLE_TIME,ci,0});
+                }
+            }
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t r = 0;
+        while(r < max && !done)
+        {
+            /* A row is complete once the next row (or the end) is reached, since
+             * its VAR records follow it
+             */
+            bool more = cur.next();
+            if(more && cur.record().type == LOG_REC_VAR && pending)
+            {
+                if(cur.record().chan < var_count.size())
+                {
+                    log_bin_var_t v;
+                    memcpy(&v,cur.payload(),sizeof(v));
+                    var_count[cur.record().chan] += v.count;
+                }
+                continue;
+            }
+            if(more && !(cur.record().type == LOG_REC_ROW && is_row(cur.record())))
+            {
+                continue;
+            }
+
+            if(pending)
+            {
+                emit(block + r,max);
+                r++;
+            }
+            pending = more ? cur.payload() : nullptr;
+            std::fill(var_count.begin(),var_count.end(),0);
+            done = !more;
+        }
+        return r;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        if(!nrows) return false;
+        first = first_ms / 1000.0;
+        last = last_ms / 1000.0;
+        return true;
+    }
+
+    /* Positions are file offsets of ROW records, or of the next record before the
+     * first row has been read
+     */
+    uint64_t tell() const override
+    {
+        if(pending) return pending - file.data() - sizeof(log_bin_record_t);
+        return done ? file.size() : cur.tell();
+    }
+
+    void seek(uint64_t pos) override
+    {
+        cur.seek(pos);
+        pending = nullptr;
+        done = false;
+        std::fill(var_count.begin(),var_count.end(),0);
+
+        /* Compressed channels pick up from their last point at or before the row */
+        log_bin_record_t rec;
+        memset(&rec,0,sizeof(rec));
+        if(pos + sizeof(rec) + sizeof(log_bin_row_t) <= file.size()) memcpy(&rec,file.data() + pos,sizeof(rec));
+        for(auto& s : sparse)
+        {
+            if(rec.type != LOG_REC_ROW || static_cast<size_t>(s.chan) >= points.size())
+            {
+                s = Sparse(file.data(),file.size(),s.chan,s.hold);
+                continue;
+            }
+            log_bin_row_t row;
+            memcpy(&row,file.data() + pos + sizeof(rec),sizeof(row));
+            s.seek(file.data(),points[s.chan],row.time_ms);
+        }
+    }
+
+private:
+    /* Where each exported column comes from */
+    struct Out
+    {
+        enum { TIME, VALUE, SAMPLE_TIME, SPARSE, VAR } kind;
+        int chan;
+        int arg;    /* Element for VALUE, index into sparse for SPARSE */
+    };
+
+    /* Rebuilds a compressed channel at the row times, with its own walk through the
+     * file to find the POINT records around each row
+     */
+    struct Sparse
+    {
+        BinCursor cur;
+        int chan;
+        bool hold;
+        bool have_a = false, have_b = false, done = false;
+        uint32_t ta = 0, tb = 0;
+        double va = 0.0, vb = 0.0;
+
+        Sparse(const uint8_t * data, size_t len, int chan, bool hold)
+            : cur(data,len), chan(chan), hold(hold) {}
+
+        /* Start again after the last point at or before t, from the file offsets of
+         * the channel's POINT records
+         */
+        void seek(const uint8_t * data, const std::vector<uint64_t>& pts, uint32_t t)
+        {
+            auto point = [&](size_t i)
+            {
+                log_bin_point_t pt;
+                memcpy(&pt,data + pts[i] + sizeof(log_bin_record_t),sizeof(pt));
+                return pt;
+            };
+
+            size_t lo = 0, hi = pts.size();
+            while(lo < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+                if(point(mid).time_ms <= t) lo = mid + 1;
+                else hi = mid;
+            }
+            have_a = have_b = done = false;
+            if(!lo)
+            {
+                cur.seek(cur.header().header_len);
+                return;
+            }
+            log_bin_point_t pt = point(lo - 1);
+            ta = pt.time_ms;
+            va = pt.value;
+            have_a = true;
+            cur.seek(pts[lo - 1]);
+            cur.next();
+        }
+
+        double at(uint32_t t)
+        {
+            /* Points come in time order, so move along until b is past t */
+            while(!done && (!have_b || tb <= t))
+            {
+                if(have_b)
+                {
+                    ta = tb;
+                    va = vb;
+                    have_a = true;
+                    have_b = false;
+                }
+                done = true;
+                while(cur.next())
+                {
+                    const log_bin_record_t& rec = cur.record();
+                    if(rec.type == LOG_REC_POINT && rec.chan == chan && rec.len >= sizeof(log_bin_point_t))
+                    {
+                        log_bin_point_t pt;
+                        memcpy(&pt,cur.payload(),sizeof(pt));
+                        tb = pt.time_ms;
+                        vb = pt.value;
+                        have_b = true;
+                        done = false;
+                        break;
+                    }
+                }
+            }
+
+            /* Nothing is known before the first point, or after the last unless held */
+            if(!have_a) return std::numeric_limits<double>::quiet_NaN();
+            if(hold) return va;
+            if(!have_b) return (t == ta) ? va : std::numeric_limits<double>::quiet_NaN();
+            if(!std::isfinite(va) || !std::isfinite(vb) || tb == ta) return va;
+            return va + (vb - va) * (double)(t - ta) / (double)(tb - ta);
+        }
+    };
+
+    bool is_row(const log_bin_record_t& rec) const
+    {
+        return rec.len >= row_len && rec.len >= sizeof(log_bin_row_t);
+    }
+
+    /* Write the pending row into column-major block at row 0 */
+    void emit(double * out, size_t stride)
+    {
+        log_bin_row_t row;
+        memcpy(&row,pending,sizeof(row));
+        double t = row.time_ms / 1000.0;
+        for(size_t i = 0; i < outs.size(); i++)
+        {
+            const Out& o = outs[i];
+            const BinChannel& ch = chans[o.chan];
+            double v;
+            switch(o.kind)
+            {
+            case Out::TIME:
+                v = t;
+                break;
+            case Out::VALUE:
+            {
+                const uint8_t * q = pending + ch.offset + o.arg * ch.value_size();
+                if(ch.type == LOG_TYPE_INT)
+                {
+                    int32_t iv;
+                    memcpy(&iv,q,sizeof(iv));
+                    v = iv;
+                }
+                else
+                {
+                    memcpy(&v,q,sizeof(v));
+                }
+                break;
+            }
+            case Out::SAMPLE_TIME:
+            {
+                int32_t dt;
+                memcpy(&dt,pending + ch.ts_offset,sizeof(dt));
+                v = t + dt / 1e6;
+                break;
+            }
+            case Out::SPARSE:
+                v = sparse[o.arg].at(row.time_ms);
+                break;
+            default:
+                v = var_count[o.chan];
+                break;
+            }
+            out[i * stride] = v;
+        }
+    }
+
+    MappedFile file;
+    BinCursor cur;
+    std::vector<BinChannel> chans;
+    std::vector<Out> outs;
+    std::vector<Sparse> sparse;
+    std::vector<std::vector<uint64_t>> points;     /* File offsets of POINT records, by channel */
+    std::vector<size_t> var_count;
+    size_t row_len = 0;
+    uint32_t first_ms = 0, last_ms = 0;
+    const uint8_t * pending = nullptr;
+    bool done = false;
+};
+
+std::unique_ptr<RowSource> open_rows(const std::string& path)
+{
+    MappedFile file(path);
+    if(file.size() >= 4 && !memcmp(file.data(),LOG_BIN_MAGIC,4))
+    {
+        try
+        {
+            return std::unique_ptr<RowSource>(new BinRows(std::move(file)));
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+    }
+    if(file.size() >= 6 && !memcmp(file.data(),"ARROW1",6))
+    {
+        try
+        {
+            return open_arrow(std::move(file));
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+    }
+    return std::unique_ptr<RowSource>(new CsvRows(std::move(file)));
+}
+
+} /* namespace pal */
@@ -0,0 +1,84 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_ROWS_HPP_
+#define _PAL_ROWS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Type of an exported column */
+enum class ColType
+{
+    Bool,       /* Integer flags named COMP_* or CTRL_* */
+    Int,        /* int32 */
+    Double,
+};
+
+/* A column of a row source */
+struct RowColumn
+{
+    std::string name;
+    ColType type;
+};
+
+/* Rows of a data file, read a block at a time so the exporters use the same
+ * memory however long the file is
+ * The first column is always "time", the row time in seconds. The rest follow the
+ * CSV header, or for binary files match model/readlog.m: vector channels expand
+ * to a column per element, sample times become <name>_t in seconds, compressed
+ * channels are rebuilt at the row times and VAR channels become a <name>_n count
+ */
+class RowSource
+{
+public:
+    virtual ~RowSource() = default;
+
+    const std::vector<RowColumn>& columns() const { return cols; }
+    size_t rows() const { return nrows; }
+
+    /* Read up to max rows into block, column-major so column c of row r is at
+     * block[c * max + r]. Returns the number of rows read, 0 at the end
+     */
+    virtual size_t read(double * block, size_t max) = 0;
+
+    /* Times of the first and last rows in seconds, found without reading through
+     * the rows. Returns false if there are none
+     */
+    virtual bool span(double& first, double& last) const = 0;
+
+    /* Position of the next row read() would return, to come back to with seek()
+     * The value means nothing outside the source that gave it
+     */
+    virtual uint64_t tell() const;
+
+    /* Carry on reading from a position tell() gave earlier
+     * Throws std::runtime_error if the source can only be read from the start
+     */
+    virtual void seek(uint64_t pos);
+
+protected:
+    std::vector<RowColumn> cols;
+    size_t nrows = 0;
+};
+
+/* Open a CSV, binary or Arrow IPC data file as a row source, by its contents
+ * Throws std::runtime_error if the file can't be read
+ */
+std::unique_ptr<RowSource> open_rows(const std::string& path);
+
+/* Columns holding flags rather than numbers, by the names src/main.cpp gives them */
+bool is_flag_name(const std::string& name);
+
+} /* namespace pal */
+
+#endif /* _PAL_ROWS_HPP_ */
@@ -0,0 +1,212 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "stitch.hpp"
+#include "mapped_file.hpp"
+#include "pal/log_format.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+namespace pal
+{
+
+/* What a segment says about the run it belongs to */
+struct SegInfo
+{
+    int boot = -1;          /* Boot id, or -1 if it doesn't record one */
+    bool split = false;     /* Closed by log_segment() */
+    bool timed = false;     /* Has rows, spanning first to last */
+    double first = 0.0;
+    double last = 0.0;
+};
+
+static SegInfo seg_info(const CardSegment& seg)
+{
+    SegInfo info;
+    if(!seg.log.empty())
+    {
+        MappedFile log(seg.log);
+        std::string text(log.chars(),log.size());
+        size_t at = text.find("Log file opened (");
+        if(at != std::string::npos)
+        {
+            size_t eol = text.find('\n',at);
+            size_t b = text.find("), boot ",at);
+            if(b != std::string::npos && b < eol) info.boot = atoi(text.c_str() + b + 8);
+        }
+        info.split = text.find("Segment requested") != std::string::npos;
+    }
+    if(!seg.data.empty())
+    {
+        {
+            MappedFile data(seg.data);
+            log_bin_header_t hdr;
+            if(data.size() >= sizeof(hdr) && !memcmp(data.data(),LOG_BIN_MAGIC,4))
+            {
+                memcpy(&hdr,data.data(),sizeof(hdr));
+                if(hdr.boot) info.boot = static_cast<int>(hdr.boot) - 1;
+            }
+        }
+        info.timed = open_rows(seg.data)->span(info.first,info.last);
+    }
+    return info;
+}
+
+std::vector<Run> find_runs(const std::vector<CardSegment>& segs)
+{
+    std::vector<Run> runs;
+    SegInfo prev;
+    for(size_t i = 0; i < segs.size(); i++)
+    {
+        SegInfo info = seg_info(segs[i]);
+        bool joins;
+        if(i == 0)
+        {
+            joins = false;
+        }
+        else if(info.boot >= 0 && prev.boot >= 0)
+        {
+            joins = info.boot == prev.boot;
+        }
+        else
+        {
+            /* millis() carries on through a run, and starts again at power on */
+            joins = segs[i].segment == segs[i - 1].segment + 1 && prev.split &&
+                (!info.timed || !prev.timed || info.first >= prev.last);
+        }
+
+        if(!joins)
+        {
+            runs.push_back({info.boot >= 0 ? info.boot : segs[i].segment,{}});
+        }
+        runs.back().segs.push_back(segs[i]);
+        prev = info;
+    }
+    return runs;
+}
+
+/* Sources read one after another into the union of their columns */
+class ConcatRows : public RowSource
+{
+public:
+    explicit ConcatRows(std::vector<std::unique_ptr<RowSource>> srcs) : srcs(std::move(srcs))
+    {
+        /* A name repeated within a source is a separate column each time */
+        std::map<std::string, std::vector<size_t>> by_name;
+        for(const auto& s : this->srcs)
+        {
+            std::map<std::string, size_t> seen;
+            std::vector<size_t> map;
+            for(const auto& c : s->columns())
+            {
+                std::vector<size_t>& same = by_name[c.name];
+                size_t nth = seen[c.name]++;
+                if(nth == same.size())
+                {
+                    same.push_back(cols.size());
+                    cols.push_back(c);
+                }
+                RowColumn& out = cols[same[nth]];
+                if(out.type != c.type) out.type = ColType::Double;
+                map.push_back(same[nth]);
+            }
+            maps.push_back(map);
+            nrows += s->rows();
+        }
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t r = 0;
+        while(r < max && cur < srcs.size())
+        {
+            RowSource& s = *srcs[cur];
+            size_t want = max - r;
+            buf.resize(s.columns().size() * want);
+            size_t n = s.read(buf.data(),want);
+            if(!n)
+            {
+                cur++;
+                continue;
+            }
+
+            /* Columns of other sources are NaN here */
+            for(size_t c = 0; c < cols.size(); c++)
+            {
+                std::fill(block + c * max + r,block + c * max + r + n,std::numeric_limits<double>::quiet_NaN());
+            }
+            const std::vector<size_t>& map = maps[cur];
+            for(size_t c = 0; c < map.size(); c++)
+            {
+                memcpy(block + map[c] * max + r,&buf[c * want],n * sizeof(double));
+            }
+            r += n;
+        }
+        return r;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        bool any = false;
+        for(const auto& s : srcs)
+        {
+            double a, b;
+            if(!s->span(a,b)) continue;
+            if(!any) first = a;
+            last = b;
+            any = true;
+        }
+        return any;
+    }
+
+private:
+    std::vector<std::unique_ptr<RowSource>> srcs;
+    std::vector<std::vector<size_t>> maps;  /* Output column of each source column */
+    std::vector<double> buf;
+    size_t cur = 0;
+};
+
+std::unique_ptr<RowSource> concat_rows(std::vector<std::unique_ptr<RowSource>> sources)
+{
+    return std::unique_ptr<RowSource>(new ConcatRows(std::move(sources)));
+}
+
+void concat_logs(const std::vector<CardSegment>& segs, const std::string& path)
+{
+    FILE * f = fopen(path.c_str(),"wb");
+    if(!f) throw std::runtime_error(path + ": " + strerror(errno));
+    try
+    {
+        for(const auto& s : segs)
+        {
+            if(s.log.empty()) continue;
+            /* The logger starts each message with a line break, so the files join
+             * up as they are
+             */
+            MappedFile log(s.log);
+            if(fwrite(log.data(),1,log.size(),f) != log.size())
+            {
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+        }
+    }
+    catch(...)
+    {
+        fclose(f);
+        remove(path.c_str());
+        throw;
+    }
+    if(fclose(f) != 0) throw std::runtime_error(path + ": " + strerror(errno));
+}
+
+} /* namespace pal */
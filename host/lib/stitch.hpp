@@ -0,0 +1,52 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_STITCH_HPP_
+#define _PAL_STITCH_HPP_
+
+#include "archive.hpp"
+#include "rows.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* The segments of one run of the program, from power on until it stopped
+ * src/main.cpp calls log_segment() at every mode change, so one match is spread
+ * over several consecutive files, each with its own columns
+ */
+struct Run
+{
+    int boot;                       /* Index of the first file of the run */
+    std::vector<CardSegment> segs;  /* In index order */
+};
+
+/* Group the segments of a card dump into runs
+ * Current loggers record the boot id in the binary header and the "Log file
+ * opened" message. For older files, a segment continues the one before if their
+ * indexes are consecutive, the one before was closed by log_segment() and time
+ * carries on from where it left off
+ * Throws std::runtime_error if a file can't be read
+ */
+std::vector<Run> find_runs(const std::vector<CardSegment>& segs);
+
+/* Row source reading several sources one after another, with the union of their
+ * columns in order of appearance. Columns a source doesn't have are NaN in its
+ * rows, and a column whose type differs between sources becomes Double
+ */
+std::unique_ptr<RowSource> concat_rows(std::vector<std::unique_ptr<RowSource>> sources);
+
+/* Write the text logs of segments one after another into one file
+ * Throws std::runtime_error if a file can't be read or written
+ */
+void concat_logs(const std::vector<CardSegment>& segs, const std::string& path);
+
+} /* namespace pal */
+
+#endif /* _PAL_STITCH_HPP_ */
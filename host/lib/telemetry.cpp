@@ -0,0 +1,336 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "telemetry.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace pal
+{
+
+/* PROS console streams on a multiplexed link */
+#define STREAM_SOUT 0x74756f73  /* "sout" */
+#define STREAM_SERR 0x72726573  /* "serr" */
+
+/* Length of the stream id at the start of a PROS packet */
+#define STREAM_ID_LEN 4
+
+std::vector<uint8_t> cobs_encode(const uint8_t * data, size_t len)
+{
+    std::vector<uint8_t> out;
+    out.reserve(len + len / 254 + 1);
+    size_t code = 0;
+    out.push_back(0);
+    for(size_t i = 0; i < len; i++)
+    {
+        if(data[i]) out.push_back(data[i]);
+        /* A zero, or a full block, closes the block */
+        if(!data[i] || out.size() - code == 0xff)
+        {
+            out[code] = static_cast<uint8_t>(out.size() - code);
+            code = out.size();
+            out.push_back(0);
+        }
+    }
+    out[code] = static_cast<uint8_t>(out.size() - code);
+    return out;
+}
+
+std::vector<uint8_t> cobs_decode(const uint8_t * data, size_t len)
+{
+    std::vector<uint8_t> out;
+    out.reserve(len);
+    size_t i = 0;
+    while(i < len)
+    {
+        uint8_t code = data[i++];
+        if(!code || i + code - 1 > len) throw std::runtime_error("bad COBS block");
+        out.insert(out.end(),data + i,data + i + code - 1);
+        i += code - 1;
+        /* A block shorter than the longest ends at a zero, except the last */
+        if(code != 0xff && i < len) out.push_back(0);
+    }
+    return out;
+}
+
+uint16_t crc16(const void * data, size_t len, uint16_t crc)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(data);
+    while(len--)
+    {
+        crc ^= static_cast<uint16_t>(*p++) << 8;
+        for(int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ LOG_CRC_POLY) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint32_t crc32(const void * data, size_t len, uint32_t crc)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ LOG_CRC32_POLY : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+std::vector<uint8_t> pack_frame(const void * head, size_t hlen, const void * body, size_t blen)
+{
+    std::vector<uint8_t> raw(hlen + blen + 2);
+    memcpy(raw.data(),head,hlen);
+    if(blen) memcpy(raw.data() + hlen,body,blen);
+    uint16_t crc = crc16(raw.data(),hlen + blen);
+    raw[hlen + blen] = static_cast<uint8_t>(crc);
+    raw[hlen + blen + 1] = static_cast<uint8_t>(crc >> 8);
+    std::vector<uint8_t> out = cobs_encode(raw.data(),raw.size());
+    out.push_back(0);
+    return out;
+}
+
+void FrameSplitter::feed(const uint8_t * data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(data[i]) buf.push_back(data[i]);
+        else frame();
+    }
+}
+
+void FrameSplitter::frame()
+{
+    bool first = !synced;
+    synced = true;
+    if(buf.empty()) return;
+
+    std::vector<uint8_t> raw;
+    bool good = false;
+    try
+    {
+        raw = cobs_decode(buf.data(),buf.size());
+        if(raw.size() >= 2)
+        {
+            size_t n = raw.size() - 2;
+            good = static_cast<uint16_t>(raw[n] | (raw[n + 1] << 8)) == crc16(raw.data(),n);
+            raw.resize(n);
+        }
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+    buf.clear();
+    if(good) fn(raw);
+    else if(!first) nbad++;
+}
+
+void ProsDemux::feed(const uint8_t * data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(data[i])
+        {
+            buf.push_back(data[i]);
+            continue;
+        }
+        /* Packets have no CRC of their own, a damaged one is lost with its chunk */
+        try
+        {
+            std::vector<uint8_t> raw = cobs_decode(buf.data(),buf.size());
+            if(raw.size() >= STREAM_ID_LEN)
+            {
+                uint32_t id;
+                memcpy(&id,raw.data(),STREAM_ID_LEN);
+                fn(id,raw.data() + STREAM_ID_LEN,raw.size() - STREAM_ID_LEN);
+            }
+        }
+        catch(const std::runtime_error&)
+        {
+        }
+        buf.clear();
+    }
+}
+
+TelemetryDecoder::TelemetryDecoder(bool mux, FrameFn on_frame, ConsoleFn on_console)
+    : mux(mux), on_frame(std::move(on_frame)), on_console(std::move(on_console)),
+      demux([this](uint32_t id, const uint8_t * data, size_t len) { stream(id,data,len); }),
+      frames([this](const std::vector<uint8_t>& raw) { frame(raw); })
+{
+}
+
+void TelemetryDecoder::feed(const uint8_t * data, size_t len)
+{
+    st.bytes += len;
+    if(mux) demux.feed(data,len);
+    else frames.feed(data,len);
+}
+
+TelemetryStats TelemetryDecoder::stats() const
+{
+    TelemetryStats s = st;
+    s.bad = frames.bad() + bad;
+    return s;
+}
+
+/* A chunk of one of the streams on a PROS link */
+void TelemetryDecoder::stream(uint32_t id, const uint8_t * data, size_t len)
+{
+    if(id == LOG_WIRE_STREAM_ID)
+    {
+        frames.feed(data,len);
+    }
+    else if(id == STREAM_SOUT || id == STREAM_SERR)
+    {
+        st.console += len;
+        if(on_console) on_console(reinterpret_cast<const char *>(data),len,id == STREAM_SERR);
+    }
+}
+
+/* A telemetry frame whose CRC was good */
+void TelemetryDecoder::frame(const std::vector<uint8_t>& raw)
+{
+    if(raw.size() < sizeof(log_wire_t))
+    {
+        bad++;
+        return;
+    }
+    TelemetryFrame f;
+    memcpy(&f.wire,raw.data(),sizeof(f.wire));
+    const uint8_t * p = raw.data() + sizeof(f.wire);
+    const uint8_t * end = raw.data() + raw.size();
+    if(f.wire.type == LOG_SINK_MSG)
+    {
+        const uint8_t * nul = static_cast<const uint8_t *>(memchr(p,0,end - p));
+        if(!nul)
+        {
+            bad++;
+            return;
+        }
+        f.file.assign(reinterpret_cast<const char *>(p),nul - p);
+        p = nul + 1;
+        if(p < end && end[-1] == 0) end--;
+    }
+    f.payload.assign(p,end);
+
+    if(have_seq)
+    {
+        st.lost += f.wire.seq - next_seq;
+        st.dropped += f.wire.dropped - last_dropped;
+    }
+    else
+    {
+        st.dropped += f.wire.dropped;
+    }
+    have_seq = true;
+    next_seq = f.wire.seq + 1;
+    last_dropped = f.wire.dropped;
+    st.frames++;
+    if(on_frame) on_frame(f);
+}
+
+std::vector<uint8_t> encode_frame(const TelemetryFrame& f)
+{
+    std::vector<uint8_t> body;
+    if(f.wire.type == LOG_SINK_MSG)
+    {
+        body.assign(f.file.begin(),f.file.end());
+        body.push_back(0);
+    }
+    body.insert(body.end(),f.payload.begin(),f.payload.end());
+    if(f.wire.type == LOG_SINK_MSG) body.push_back(0);
+    return pack_frame(&f.wire,sizeof(f.wire),body.data(),body.size());
+}
+
+std::string format_message(const TelemetryFrame& f)
+{
+    static const char * const names[] = {"DEBUG","INFO","WARN","ERROR","ALWAYS"};
+    int level = f.wire.level > LOG_LEVEL_ALWAYS ? static_cast<int>(LOG_LEVEL_ALWAYS) : f.wire.level;
+    std::string text(f.payload.begin(),f.payload.end());
+    char head[64];
+    snprintf(head,sizeof(head),"%08.3f [%s] in ",f.wire.time_ms / 1000.0,names[level]);
+    return head + f.file + " line " + std::to_string(f.wire.line) + ": " + text;
+}
+
+TelemetryWriter::TelemetryWriter(const std::string& dir)
+    : dir(dir)
+{
+}
+
+TelemetryWriter::~TelemetryWriter()
+{
+    close();
+}
+
+void TelemetryWriter::close()
+{
+    if(text) fclose(text);
+    if(data) fclose(data);
+    text = data = nullptr;
+    text_name.clear();
+    data_name.clear();
+}
+
+void TelemetryWriter::write(const TelemetryFrame& f)
+{
+    switch(f.wire.type)
+    {
+    case LOG_SINK_OPEN:
+    {
+        log_sink_open_t open;
+        if(f.payload.size() < sizeof(open)) throw std::runtime_error("short open record");
+        memcpy(&open,f.payload.data(),sizeof(open));
+        close();
+
+        char name[32];
+        snprintf(name,sizeof(name),"/log%05d.txt",static_cast<int>(open.index));
+        text_name = dir + name;
+        snprintf(name,sizeof(name),open.binary ? "/dat%05d.bin" : "/dat%05d.csv",static_cast<int>(open.index));
+        data_name = dir + name;
+        text = fopen(text_name.c_str(),"w");
+        data = fopen(data_name.c_str(),"w");
+        if(!text || !data)
+        {
+            std::string what = (text ? data_name : text_name) + ": " + strerror(errno);
+            close();
+            throw std::runtime_error(what);
+        }
+        break;
+    }
+    case LOG_SINK_MSG:
+        if(text)
+        {
+            fprintf(text,"\n%s",format_message(f).c_str());
+            fflush(text);
+        }
+        break;
+    case LOG_SINK_DATA:
+        if(data)
+        {
+            fwrite(f.payload.data(),1,f.payload.size(),data);
+            fflush(data);
+        }
+        break;
+    case LOG_SINK_FLUSH:
+        if(text) fflush(text);
+        if(data) fflush(data);
+        break;
+    case LOG_SINK_CLOSE:
+        close();
+        break;
+    default:
+        break;
+    }
+}
+
+} /* namespace pal */
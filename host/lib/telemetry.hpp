@@ -0,0 +1,173 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TELEMETRY_HPP_
+#define _PAL_TELEMETRY_HPP_
+
+#include "pal/log_format.h"
+#include "pal/log_sink.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pal
+{
+
+/* COBS encode data, without the zero terminator */
+std::vector<uint8_t> cobs_encode(const uint8_t * data, size_t len);
+
+/* Decode one COBS block, without its zero terminator
+ * Throws std::runtime_error if it is not valid COBS
+ */
+std::vector<uint8_t> cobs_decode(const uint8_t * data, size_t len);
+
+/* CRC-16/CCITT-FALSE, as the stream sink computes it */
+uint16_t crc16(const void * data, size_t len, uint16_t crc = LOG_CRC_INIT);
+
+/* CRC-32 as zlib computes it, crc being 0 or the CRC of what came before */
+uint32_t crc32(const void * data, size_t len, uint32_t crc = 0);
+
+/* Splits a stream of frames at the zero bytes, handing on the contents of those
+ * whose COBS and CRC are good, less the CRC
+ * Until the first zero a frame may have been joined part way through, so one that
+ * fails then isn't counted as bad
+ */
+class FrameSplitter
+{
+public:
+    using Fn = std::function<void(const std::vector<uint8_t>& frame)>;
+
+    explicit FrameSplitter(Fn fn) : fn(std::move(fn)) {}
+
+    void feed(const uint8_t * data, size_t len);
+
+    uint64_t bad() const { return nbad; }
+
+private:
+    void frame();
+
+    Fn fn;
+    std::vector<uint8_t> buf;
+    bool synced = false;
+    uint64_t nbad = 0;
+};
+
+/* Takes PROS's USB link apart into its streams, which it sends as packets of the
+ * COBS encoded stream id and a chunk of the stream, each ended by a zero byte
+ */
+class ProsDemux
+{
+public:
+    using Fn = std::function<void(uint32_t id, const uint8_t * data, size_t len)>;
+
+    explicit ProsDemux(Fn fn) : fn(std::move(fn)) {}
+
+    void feed(const uint8_t * data, size_t len);
+
+private:
+    Fn fn;
+    std::vector<uint8_t> buf;
+};
+
+/* Encode a header and body as one frame, as log_frame_pack() does on the robot */
+std::vector<uint8_t> pack_frame(const void * head, size_t hlen, const void * body, size_t blen);
+
+/* A record received from a stream sink, see log_wire_t */
+struct TelemetryFrame
+{
+    log_wire_t wire;
+    std::string file;               /* Source file of a message */
+    std::vector<uint8_t> payload;   /* Text of a message (without its NUL), data bytes, or log_sink_open_t */
+};
+
+/* Encode a frame as log_frame_encode() does on the robot, zero terminator included */
+std::vector<uint8_t> encode_frame(const TelemetryFrame& f);
+
+/* Counts kept by TelemetryDecoder */
+struct TelemetryStats
+{
+    uint64_t bytes = 0;         /* Bytes fed in */
+    uint64_t frames = 0;        /* Good frames */
+    uint64_t bad = 0;           /* Frames which failed COBS, the CRC, or were too short */
+    uint64_t lost = 0;          /* Frames missing from the sequence */
+    uint64_t dropped = 0;       /* Records the robot's sink skipped, having fallen behind */
+    uint64_t console = 0;       /* Bytes of console output, when the link is multiplexed */
+};
+
+/* Takes the bytes of a link apart into telemetry frames
+ * On a PROS USB link (mux set) the bytes are PROS's own packets, each the COBS
+ * encoded stream id and a chunk of that stream. The console streams go to the
+ * console callback and LOG_WIRE_STREAM's chunks are joined up and split into frames.
+ * Otherwise the bytes are the frames themselves, i.e. a file a stream sink wrote
+ * Bad frames are counted and skipped, picking up at the next zero byte
+ */
+class TelemetryDecoder
+{
+public:
+    using FrameFn = std::function<void(const TelemetryFrame&)>;
+    using ConsoleFn = std::function<void(const char * text, size_t len, bool err)>;
+
+    TelemetryDecoder(bool mux, FrameFn on_frame, ConsoleFn on_console = nullptr);
+
+    void feed(const uint8_t * data, size_t len);
+
+    TelemetryStats stats() const;
+
+private:
+    void stream(uint32_t id, const uint8_t * data, size_t len);
+    void frame(const std::vector<uint8_t>& raw);
+
+    bool mux;
+    FrameFn on_frame;
+    ConsoleFn on_console;
+    ProsDemux demux;
+    FrameSplitter frames;
+    bool have_seq = false;
+    uint32_t next_seq = 0;
+    uint32_t last_dropped = 0;
+    uint64_t bad = 0;               /* Frames with a good CRC which don't parse */
+    TelemetryStats st;
+};
+
+/* Writes received frames back into the files the uSD card has, in a directory
+ * Each file is flushed as its records arrive, so other tools can follow it
+ * Throws std::runtime_error if a file can't be opened
+ */
+class TelemetryWriter
+{
+public:
+    explicit TelemetryWriter(const std::string& dir);
+    ~TelemetryWriter();
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    void write(const TelemetryFrame& f);
+
+    /* Paths of the files open, empty when none are */
+    const std::string& text_path() const { return text_name; }
+    const std::string& data_path() const { return data_name; }
+
+private:
+    void close();
+
+    std::string dir;
+    FILE * text = nullptr;
+    FILE * data = nullptr;
+    std::string text_name;
+    std::string data_name;
+};
+
+/* Text of a message frame as the uSD text file has it, without the newline */
+std::string format_message(const TelemetryFrame& f);
+
+} /* namespace pal */
+
+#endif /* _PAL_TELEMETRY_HPP_ */
@@ -0,0 +1,261 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "timeline.hpp"
+#include "batch.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <strings.h>
+#include <sys/stat.h>
+
+namespace pal
+{
+
+static const char * level_names[] = {"DEBUG","INFO","WARN","ERROR","ALWAYS"};
+
+int log_level(const std::string& name)
+{
+    for(int i = 0; i < 5; i++)
+    {
+        if(!strcasecmp(name.c_str(),level_names[i])) return i;
+    }
+    return -1;
+}
+
+const char * log_level_name(int level)
+{
+    return (level >= 0 && level < 5) ? level_names[level] : "?";
+}
+
+std::string timeline_path(const std::string& data)
+{
+    return output_path(data,"",".tlx");
+}
+
+/* Parts of the header the text file sink writes, "%08.3f [%s] in %s line %d: " */
+struct MsgHeader
+{
+    double time;
+    int level;
+    const char * file;      /* File name, up to " line " */
+    size_t file_len;
+    int line;
+    const char * text;      /* After the header */
+};
+
+/* Parse a message header at p, returning false if the line doesn't start with one */
+static bool parse_header(const char * p, const char * end, MsgHeader& h)
+{
+    const char * q = p;
+    while(q < end && *q >= '0' && *q <= '9') q++;
+    if(q == p || q + 4 > end || *q != '.') return false;
+    for(int i = 1; i <= 3; i++)
+    {
+        if(q[i] < '0' || q[i] > '9') return false;
+    }
+    h.time = strtod(p,nullptr);
+    q += 4;
+
+    if(end - q < 2 || q[0] != ' ' || q[1] != '[') return false;
+    const char * name = q + 2;
+    q = name;
+    while(q < end && *q != ']' && *q != '\n') q++;
+    if(end - q < 5 || memcmp(q,"] in ",5)) return false;
+    h.level = log_level(std::string(name,q - name));
+    if(h.level < 0) h.level = TIMELINE_NO_LEVEL;
+
+    h.file = q + 5;
+    const char * eol = static_cast<const char *>(memchr(h.file,'\n',end - h.file));
+    if(!eol) eol = end;
+    for(q = h.file; q + 6 <= eol; q++)
+    {
+        if(!memcmp(q," line ",6)) break;
+    }
+    if(q + 6 > eol) return false;
+    h.file_len = q - h.file;
+    q += 6;
+    h.line = atoi(q);
+    while(q < eol && *q >= '0' && *q <= '9') q++;
+    if(eol - q < 2 || q[0] != ':' || q[1] != ' ') return false;
+    h.text = q + 2;
+    return true;
+}
+
+void write_timeline(const std::string& log, const std::string& data, const std::string& path)
+{
+    struct stat log_st, data_st;
+    if(stat(log.c_str(),&log_st) < 0) throw std::runtime_error(log + ": " + strerror(errno));
+    if(stat(data.c_str(),&data_st) < 0) throw std::runtime_error(data + ": " + strerror(errno));
+
+    /* Each message starts on a new line, and runs until the next one does. Lines
+     * without a header belong to the message before (a LOG_* text with a line break)
+     */
+    std::vector<timeline_msg_t> msgs;
+    {
+        MappedFile text(log);
+        const char * start = text.chars();
+        const char * end = start + text.size();
+        const char * p = start;
+        while(p < end)
+        {
+            const char * eol = static_cast<const char *>(memchr(p,'\n',end - p));
+            MsgHeader h;
+            if(parse_header(p,end,h))
+            {
+                if(!msgs.empty()) msgs.back().len = (p - 1) - start - msgs.back().offset;
+                timeline_msg_t m;
+                memset(&m,0,sizeof(m));
+                m.time = h.time;
+                m.offset = p - start;
+                m.len = (end - p);
+                m.level = h.level;
+                msgs.push_back(m);
+            }
+            p = eol ? eol + 1 : end;
+        }
+    }
+
+    /* Row times, and where to seek to every TIMELINE_STRIDE rows */
+    std::vector<double> times;
+    std::vector<uint64_t> seeks;
+    {
+        auto src = open_rows(data);
+        times.reserve(src->rows());
+        std::vector<double> block(src->columns().size() * TIMELINE_STRIDE);
+        for(;;)
+        {
+            uint64_t pos = src->tell();
+            size_t n = src->read(block.data(),TIMELINE_STRIDE);
+            if(!n) break;
+            seeks.push_back(pos);
+            times.insert(times.end(),block.begin(),block.begin() + n);
+            if(n < TIMELINE_STRIDE) break;
+        }
+    }
+
+    /* Link each message to the nearest row */
+    for(auto& m : msgs)
+    {
+        if(times.empty()) break;
+        size_t r = std::lower_bound(times.begin(),times.end(),m.time) - times.begin();
+        if(r == times.size() || (r > 0 && m.time - times[r - 1] <= times[r] - m.time)) r--;
+        m.row = r;
+    }
+
+    timeline_file_t hdr;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.magic,TIMELINE_MAGIC,sizeof(hdr.magic));
+    hdr.version = TIMELINE_VERSION;
+    hdr.stride = TIMELINE_STRIDE;
+    hdr.nmsgs = msgs.size();
+    hdr.nrows = times.size();
+    hdr.log_size = log_st.st_size;
+    hdr.log_mtime = log_st.st_mtime;
+    hdr.data_size = data_st.st_size;
+    hdr.data_mtime = data_st.st_mtime;
+
+    FILE * f = fopen(path.c_str(),"wb");
+    if(!f) throw std::runtime_error(path + ": " + strerror(errno));
+    bool ok = fwrite(&hdr,sizeof(hdr),1,f) == 1 &&
+        fwrite(msgs.data(),sizeof(timeline_msg_t),msgs.size(),f) == msgs.size() &&
+        fwrite(times.data(),sizeof(double),times.size(),f) == times.size() &&
+        fwrite(seeks.data(),sizeof(uint64_t),seeks.size(),f) == seeks.size();
+    if(fclose(f) != 0) ok = false;
+    if(!ok)
+    {
+        int err = errno;
+        remove(path.c_str());
+        throw std::runtime_error(path + ": " + strerror(err));
+    }
+}
+
+Timeline::Timeline(const std::string& path, const std::string& log) : file(path), text(log)
+{
+    if(file.size() < sizeof(timeline_file_t) || memcmp(file.data(),TIMELINE_MAGIC,4))
+    {
+        throw std::runtime_error(path + ": not a timeline sidecar");
+    }
+    hdr = reinterpret_cast<const timeline_file_t *>(file.data());
+    if(hdr->version != TIMELINE_VERSION || !hdr->stride)
+    {
+        throw std::runtime_error(path + ": unsupported version " + std::to_string(hdr->version));
+    }
+
+    size_t nseeks = (hdr->nrows + hdr->stride - 1) / hdr->stride;
+    if(file.size() < sizeof(timeline_file_t) + hdr->nmsgs * sizeof(timeline_msg_t) +
+        hdr->nrows * sizeof(double) + nseeks * sizeof(uint64_t))
+    {
+        throw std::runtime_error(path + ": truncated");
+    }
+    msgs = reinterpret_cast<const timeline_msg_t *>(hdr + 1);
+    times = reinterpret_cast<const double *>(msgs + hdr->nmsgs);
+    seeks = reinterpret_cast<const uint64_t *>(times + hdr->nrows);
+
+    for(size_t i = 0; i < hdr->nmsgs; i++)
+    {
+        if(msgs[i].offset + msgs[i].len > text.size())
+        {
+            throw std::runtime_error(path + ": does not match " + log);
+        }
+    }
+}
+
+bool Timeline::stale(const std::string& data) const
+{
+    struct stat st;
+    if(stat(data.c_str(),&st) < 0) return true;
+    if(static_cast<uint64_t>(st.st_size) != hdr->data_size || st.st_mtime != hdr->data_mtime) return true;
+    if(stat(text.path().c_str(),&st) < 0) return true;
+    return static_cast<uint64_t>(st.st_size) != hdr->log_size || st.st_mtime != hdr->log_mtime;
+}
+
+LogMessage Timeline::message(size_t i) const
+{
+    const timeline_msg_t& m = msgs[i];
+    const char * p = text.chars() + m.offset;
+    const char * end = p + m.len;
+    MsgHeader h;
+    parse_header(p,end,h);
+
+    /* Trailing line breaks are the printf() and not part of the text */
+    const char * e = end;
+    while(e > h.text && (e[-1] == '\n' || e[-1] == '\r')) e--;
+    return {m.time,m.level,std::string(h.file,h.file_len),h.line,std::string(h.text,e - h.text),
+        static_cast<size_t>(m.row)};
+}
+
+std::pair<size_t,size_t> Timeline::range(double t0, double t1) const
+{
+    const double * end = times + hdr->nrows;
+    size_t first = std::lower_bound(times,end,t0) - times;
+    size_t last = std::upper_bound(times,end,t1) - times;
+    return {first,std::max(first,last)};
+}
+
+void Timeline::seek(RowSource& src, size_t row) const
+{
+    if(row >= hdr->nrows) throw std::out_of_range("row out of range");
+
+    /* Seek to the row's stride, then read up to it */
+    size_t k = row / hdr->stride;
+    src.seek(seeks[k]);
+    size_t left = row - k * hdr->stride;
+    if(!left) return;
+    std::vector<double> skip(src.columns().size() * left);
+    while(left)
+    {
+        size_t n = src.read(skip.data(),left);
+        if(!n) break;
+        left -= n;
+    }
+}
+
+} /* namespace pal */
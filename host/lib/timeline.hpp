@@ -0,0 +1,133 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TIMELINE_HPP_
+#define _PAL_TIMELINE_HPP_
+
+#include "mapped_file.hpp"
+#include "rows.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pal
+{
+
+/* Cross index of a text log and the data file written alongside it, stored in a
+ * sidecar next to the data file (dat00012.csv gives dat00012.tlx)
+ *
+ * Both files are stamped with millis(), so each LOG_* message in the text log is
+ * linked to the data row nearest it in time. The sidecar also holds the time of
+ * every row, and a position to seek() the data file to every TIMELINE_STRIDE rows,
+ * so the rows around any message are found and read without going through either
+ * file again.
+ *
+ * Sidecar layout, all little-endian and 8-byte aligned:
+ *   timeline_file_t, then nmsgs timeline_msg_t, then nrows row times (double,
+ *   seconds), then one uint64_t seek position per TIMELINE_STRIDE rows
+ */
+
+#define TIMELINE_MAGIC "PALT"
+#define TIMELINE_VERSION 1
+
+/* Rows between seek positions */
+#define TIMELINE_STRIDE 256
+
+/* Level of text which is not a LOG_* message */
+#define TIMELINE_NO_LEVEL 0xFF
+
+typedef struct
+{
+    char magic[4];          /* TIMELINE_MAGIC */
+    uint16_t version;       /* TIMELINE_VERSION */
+    uint16_t stride;        /* Rows per seek position */
+    uint32_t nmsgs;
+    uint32_t reserved;
+    uint64_t nrows;
+    uint64_t log_size;      /* Size and modification time of both files, to spot */
+    int64_t log_mtime;      /* a sidecar which is out of date */
+    uint64_t data_size;
+    int64_t data_mtime;
+} timeline_file_t;
+
+typedef struct
+{
+    double time;            /* Seconds, from the message header */
+    uint64_t row;           /* Nearest row, the earlier on a tie, or 0 if there are none */
+    uint64_t offset;        /* File offset of the message in the text log, after its line break */
+    uint32_t len;           /* Length up to the line break before the next message */
+    uint8_t level;          /* LOG_LEVEL_*, or TIMELINE_NO_LEVEL */
+    uint8_t reserved[3];
+} timeline_msg_t;
+
+/* A message of the text log, as the text file sink wrote it */
+struct LogMessage
+{
+    double time;            /* Seconds */
+    int level;              /* LOG_LEVEL_*, or TIMELINE_NO_LEVEL */
+    std::string file;       /* Source file and line of the LOG_* call */
+    int line;
+    std::string text;
+    size_t row;             /* Nearest data row */
+};
+
+/* Level by name (DEBUG, INFO, WARN, ERROR or ALWAYS, ignoring case), or -1 */
+int log_level(const std::string& name);
+
+/* Name of a level, or "?" */
+const char * log_level_name(int level);
+
+/* Build the cross index of a text log and data file into a sidecar
+ * Throws std::runtime_error if a file can't be read or written
+ */
+void write_timeline(const std::string& log, const std::string& data, const std::string& path);
+
+/* Sidecar mapped into memory, with the text log it indexes
+ * Throws std::runtime_error if a file can't be read or the sidecar is not a
+ * cross index
+ */
+class Timeline
+{
+public:
+    Timeline(const std::string& path, const std::string& log);
+
+    size_t messages() const { return hdr->nmsgs; }
+    size_t rows() const { return hdr->nrows; }
+
+    const timeline_msg_t& entry(size_t i) const { return msgs[i]; }
+    LogMessage message(size_t i) const;
+    double row_time(size_t row) const { return times[row]; }
+
+    /* True if the sidecar was not built from the files as they are now */
+    bool stale(const std::string& data) const;
+
+    /* Rows with time in [t0,t1] seconds, as an index range [first,last) */
+    std::pair<size_t,size_t> range(double t0, double t1) const;
+
+    /* Position a row source opened on the data file so its next read() starts at row
+     * Throws std::runtime_error if the source can't seek, or std::out_of_range if
+     * there is no such row
+     */
+    void seek(RowSource& src, size_t row) const;
+
+private:
+    MappedFile file;
+    MappedFile text;
+    const timeline_file_t * hdr;
+    const timeline_msg_t * msgs;
+    const double * times;
+    const uint64_t * seeks;
+};
+
+/* Sidecar path of a data file */
+std::string timeline_path(const std::string& data);
+
+} /* namespace pal */
+
+#endif /* _PAL_TIMELINE_HPP_ */
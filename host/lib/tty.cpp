@@ -0,0 +1,48 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "tty.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+namespace pal
+{
+
+void tty_raw(int fd, int baud)
+{
+    struct termios t;
+    if(tcgetattr(fd,&t)) return;
+    cfmakeraw(&t);
+    if(baud && cfsetspeed(&t,baud)) throw std::runtime_error("unsupported baud rate " + std::to_string(baud));
+    if(tcsetattr(fd,TCSANOW,&t)) throw std::runtime_error(std::string("can't set raw mode: ") + strerror(errno));
+}
+
+int tty_open(const std::string& path, int flags, int baud)
+{
+    int fd = open(path.c_str(),flags | O_NOCTTY);
+    if(fd < 0) throw std::runtime_error(path + ": " + strerror(errno));
+    if(isatty(fd)) tty_raw(fd,baud);
+    return fd;
+}
+
+int tty_pty(int& slave, std::string& name)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(fd < 0 || grantpt(fd) || unlockpt(fd)) throw std::runtime_error(std::string("can't open a pty: ") + strerror(errno));
+    name = ptsname(fd);
+    slave = open(name.c_str(),O_RDWR | O_NOCTTY);
+    if(slave < 0) throw std::runtime_error(name + ": " + strerror(errno));
+    tty_raw(slave);
+    return fd;
+}
+
+} /* namespace pal */
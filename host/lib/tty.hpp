@@ -0,0 +1,33 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TTY_HPP_
+#define _PAL_TTY_HPP_
+
+#include <string>
+
+namespace pal
+{
+
+/* Serial links to the robot, for the tools talking to it
+ * Each throws std::runtime_error on failure
+ */
+
+/* Put a tty into raw mode, so bytes pass untouched, at baud unless it is 0 */
+void tty_raw(int fd, int baud = 0);
+
+/* Open a device or file with flags (O_RDONLY, O_RDWR, ...), raw at baud if it is a tty */
+int tty_open(const std::string& path, int flags, int baud = 0);
+
+/* Open a pty for a program standing in for the robot (i.e. palhil -s) to open by
+ * the name given, returning the master. The other side is held open in slave, so
+ * reads don't fail before the program opens it or after it closes it
+ */
+int tty_pty(int& slave, std::string& name);
+
+} /* namespace pal */
+
+#endif /* _PAL_TTY_HPP_ */
@@ -0,0 +1,328 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "tune.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "batch.hpp"
+
+namespace pal
+{
+
+/* Rows read per block when loading a log */
+#define TUNE_BLOCK_ROWS 4096
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+TuneLog load_tune_log(const std::string& path)
+{
+    TuneLog log;
+    log.path = path;
+    auto src = open_rows(path);
+    EkfColumns in(src->columns());
+    if(!in.has_gps()) throw std::runtime_error(path + ": no GPS x and y channels to score against");
+
+    const size_t ncols = src->columns().size();
+    std::vector<double> block(ncols * TUNE_BLOCK_ROWS);
+    log.rows.reserve(src->rows());
+    size_t n;
+    while((n = src->read(block.data(),TUNE_BLOCK_ROWS)))
+    {
+        for(size_t r = 0; r < n; r++) log.rows.push_back(in.row(block.data(),TUNE_BLOCK_ROWS,r));
+    }
+    return log;
+}
+
+/* Replay a log, calling fn(error, gps_error) at each held out reading scored */
+template <typename F>
+static void replay(const TuneLog& log, const EkfReplay& opt, double max_error, F fn)
+{
+    EkfReplayer rep(opt);
+    for(const auto& in : log.rows)
+    {
+        rep.step(in);
+        if(!rep.held_out() || in.gps_error > max_error) continue;
+        const Ekf& f = rep.filter();
+        fn(std::hypot(f[EKF_X] - in.gps_x,f[EKF_Y] - in.gps_y),in.gps_error);
+    }
+}
+
+TuneScore score_log(const TuneLog& log, const EkfReplay& opt, double max_error)
+{
+    std::vector<double> err;
+    double sum2 = 0.0, gsum = 0.0;
+    size_t gcount = 0;
+    replay(log,opt,max_error,[&](double e, double g)
+    {
+        err.push_back(e);
+        sum2 += e * e;
+        if(std::isfinite(g))
+        {
+            gsum += g;
+            gcount++;
+        }
+    });
+
+    TuneScore s;
+    s.count = err.size();
+    if(err.empty()) return s;
+    s.rms = std::sqrt(sum2 / err.size());
+    std::sort(err.begin(),err.end());
+    s.p95 = err[std::min(err.size() - 1,static_cast<size_t>(std::ceil(0.95 * err.size())) - 1)];
+    s.max = err.back();
+    s.gps_error = gcount ? gsum / gcount : NAN;
+    return s;
+}
+
+/* Process noise parameters, and the states each one sets */
+static const struct
+{
+    const char * name;
+    int first, last;
+} q_params[] = {
+    {"q_xy",EKF_X,EKF_Y},
+    {"q_theta",EKF_THETA,EKF_THETA},
+    {"q_v",EKF_VF,EKF_VN},
+    {"q_omega",EKF_OMEGA,EKF_OMEGA},
+    {"q_a",EKF_AF,EKF_AN},
+    {"q_alpha",EKF_ALPHA,EKF_ALPHA},
+};
+
+/* Measurement variances */
+static const struct
+{
+    const char * name;
+    double EkfParams::*value;
+} r_params[] = {
+    {"r_gps_xy",&EkfParams::r_gps_xy},
+    {"r_gps_theta",&EkfParams::r_gps_theta},
+    {"r_gyro",&EkfParams::r_gyro},
+    {"r_accel",&EkfParams::r_accel},
+    {"r_odom_v",&EkfParams::r_odom_v},
+    {"r_odom_w",&EkfParams::r_odom_w},
+};
+
+const std::vector<std::string>& tune_param_names()
+{
+    static std::vector<std::string> names;
+    if(names.empty())
+    {
+        for(const auto& q : q_params) names.push_back(q.name);
+        for(const auto& r : r_params) names.push_back(r.name);
+    }
+    return names;
+}
+
+bool tune_set(EkfParams& p, const std::string& name, double value)
+{
+    for(const auto& q : q_params)
+    {
+        if(name != q.name) continue;
+        for(int i = q.first; i <= q.last; i++) p.q[i] = value;
+        return true;
+    }
+    for(const auto& r : r_params)
+    {
+        if(name != r.name) continue;
+        p.*r.value = value;
+        return true;
+    }
+    return false;
+}
+
+double tune_get(const EkfParams& p, const std::string& name)
+{
+    for(const auto& q : q_params)
+    {
+        if(name == q.name) return p.q[q.first];
+    }
+    for(const auto& r : r_params)
+    {
+        if(name == r.name) return p.*r.value;
+    }
+    return NAN;
+}
+
+Tuner::Tuner(const std::vector<TuneLog>& logs, const EkfReplay& base, const std::vector<TuneParam>& params,
+             unsigned threads, double max_error)
+    : logs(logs), base(base), params(params), threads(threads), max_error(max_error)
+{
+    for(const auto& p : params)
+    {
+        if(std::isnan(tune_get(base.params,p.name))) throw std::runtime_error("unknown parameter " + p.name);
+    }
+}
+
+EkfReplay Tuner::apply(const std::vector<double>& candidate) const
+{
+    EkfReplay opt = base;
+    for(size_t i = 0; i < params.size(); i++) tune_set(opt.params,params[i].name,std::pow(10.0,candidate[i]));
+    return opt;
+}
+
+std::vector<double> Tuner::start() const
+{
+    std::vector<double> x;
+    for(const auto& p : params)
+    {
+        x.push_back(std::min(std::max(std::log10(tune_get(base.params,p.name)),p.lo),p.hi));
+    }
+    return x;
+}
+
+std::vector<double> Tuner::evaluate(const std::vector<std::vector<double>>& candidates)
+{
+    /* Squared error sums and counts of every (candidate, log) pair, pooled after */
+    const size_t nlogs = logs.size();
+    std::vector<double> sum2(candidates.size() * nlogs, 0.0);
+    std::vector<size_t> count(candidates.size() * nlogs, 0);
+    parallel_for(candidates.size() * nlogs,threads,[&](size_t i)
+    {
+        EkfReplay opt = apply(candidates[i / nlogs]);
+        replay(logs[i % nlogs],opt,max_error,[&](double e, double)
+        {
+            sum2[i] += e * e;
+            count[i]++;
+        });
+    });
+    evals += candidates.size();
+
+    std::vector<double> score(candidates.size());
+    for(size_t c = 0; c < candidates.size(); c++)
+    {
+        double s = 0.0;
+        size_t n = 0;
+        for(size_t l = 0; l < nlogs; l++)
+        {
+            s += sum2[c * nlogs + l];
+            n += count[c * nlogs + l];
+        }
+        /* A filter which diverged leaves NaN behind, so it can never win */
+        score[c] = (n && std::isfinite(s)) ? std::sqrt(s / n) : INF;
+    }
+    return score;
+}
+
+std::vector<double> Tuner::grid(double& best)
+{
+    std::vector<std::vector<double>> cands(1);
+    for(const auto& p : params)
+    {
+        std::vector<std::vector<double>> next;
+        for(const auto& c : cands)
+        {
+            for(int s = 0; s < p.steps; s++)
+            {
+                next.push_back(c);
+                next.back().push_back(p.steps > 1 ? p.lo + (p.hi - p.lo) * s / (p.steps - 1) : (p.lo + p.hi) / 2.0);
+            }
+        }
+        cands.swap(next);
+    }
+
+    std::vector<double> score = evaluate(cands);
+    size_t b = std::min_element(score.begin(),score.end()) - score.begin();
+    best = score[b];
+    return cands[b];
+}
+
+std::vector<double> Tuner::nelder_mead(int iterations, double& best)
+{
+    const size_t n = params.size();
+    auto clamp = [&](std::vector<double> x)
+    {
+        for(size_t i = 0; i < n; i++) x[i] = std::min(std::max(x[i],params[i].lo),params[i].hi);
+        return x;
+    };
+    auto blend = [&](const std::vector<double>& a, const std::vector<double>& b, double t)
+    {
+        std::vector<double> x(n);
+        for(size_t i = 0; i < n; i++) x[i] = a[i] + t * (b[i] - a[i]);
+        return clamp(x);
+    };
+
+    /* Start from the base parameters, stepping a quarter of each range */
+    std::vector<std::vector<double>> simplex(1,start());
+    for(size_t i = 0; i < n; i++)
+    {
+        std::vector<double> x = simplex[0];
+        double step = (params[i].hi - params[i].lo) / 4.0;
+        x[i] += (x[i] + step <= params[i].hi) ? step : -step;
+        simplex.push_back(x);
+    }
+    std::vector<double> f = evaluate(simplex);
+
+    for(int it = 0; it < iterations; it++)
+    {
+        /* Order best to worst */
+        std::vector<size_t> order(n + 1);
+        for(size_t i = 0; i <= n; i++) order[i] = i;
+        std::sort(order.begin(),order.end(),[&](size_t a, size_t b) { return f[a] < f[b]; });
+        std::vector<std::vector<double>> s;
+        std::vector<double> fs;
+        for(size_t i : order)
+        {
+            s.push_back(simplex[i]);
+            fs.push_back(f[i]);
+        }
+        simplex.swap(s);
+        f.swap(fs);
+        if(std::isfinite(f[n]) && f[n] - f[0] <= 1e-6 * f[0]) break;
+
+        std::vector<double> centroid(n, 0.0);
+        for(size_t v = 0; v < n; v++)
+        {
+            for(size_t i = 0; i < n; i++) centroid[i] += simplex[v][i] / n;
+        }
+
+        std::vector<double> xr = blend(centroid,simplex[n],-1.0);
+        double fr = evaluate({xr})[0];
+        if(fr < f[0])
+        {
+            std::vector<double> xe = blend(centroid,simplex[n],-2.0);
+            double fe = evaluate({xe})[0];
+            simplex[n] = fe < fr ? xe : xr;
+            f[n] = std::min(fe,fr);
+        }
+        else if(fr < f[n - 1])
+        {
+            simplex[n] = xr;
+            f[n] = fr;
+        }
+        else
+        {
+            std::vector<double> xc = blend(centroid,fr < f[n] ? xr : simplex[n],0.5);
+            double fc = evaluate({xc})[0];
+            if(fc < std::min(fr,f[n]))
+            {
+                simplex[n] = xc;
+                f[n] = fc;
+            }
+            else
+            {
+                /* Shrink towards the best vertex, evaluating the new vertices together */
+                std::vector<std::vector<double>> shrunk;
+                for(size_t v = 1; v <= n; v++) shrunk.push_back(blend(simplex[0],simplex[v],0.5));
+                std::vector<double> fsh = evaluate(shrunk);
+                for(size_t v = 1; v <= n; v++)
+                {
+                    simplex[v] = shrunk[v - 1];
+                    f[v] = fsh[v - 1];
+                }
+            }
+        }
+    }
+
+    size_t b = std::min_element(f.begin(),f.end()) - f.begin();
+    best = f[b];
+    return simplex[b];
+}
+
+} /* namespace pal */
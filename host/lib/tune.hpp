@@ -0,0 +1,102 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TUNE_HPP_
+#define _PAL_TUNE_HPP_
+
+#include "estimate.hpp"
+
+#include <string>
+#include <vector>
+
+namespace pal
+{
+
+/* Sensor readings of a whole log, loaded once and replayed for every candidate */
+struct TuneLog
+{
+    std::string path;
+    std::vector<EkfInput> rows;
+};
+
+/* Load a log's readings
+ * Throws std::runtime_error if it can't be read or has no GPS channels
+ */
+TuneLog load_tune_log(const std::string& path);
+
+/* Error of the estimate at the held out GPS readings of one log, skipping those
+ * the GPS reported an error above the limit for
+ */
+struct TuneScore
+{
+    size_t count = 0;
+    double rms = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+    double gps_error = 0.0;     /* Mean error the GPS reported with the readings scored */
+};
+
+TuneScore score_log(const TuneLog& log, const EkfReplay& opt, double max_error);
+
+/* A tuned parameter: q_<state> for the process noise of a state (q_xy sets both
+ * x and y), or one of the r_* measurement variances of EkfParams
+ * The search runs over log10 of the value, from lo to hi in steps grid points
+ */
+struct TuneParam
+{
+    std::string name;
+    double lo, hi;
+    int steps;
+};
+
+/* Names tune_set() understands */
+const std::vector<std::string>& tune_param_names();
+
+/* Set a parameter by name, or return false if there is no such parameter */
+bool tune_set(EkfParams& p, const std::string& name, double value);
+
+/* Value of a parameter by name, or NaN */
+double tune_get(const EkfParams& p, const std::string& name);
+
+/* Search for the parameters giving the lowest RMS error over every held out
+ * reading of every log. Each log is replayed independently, so evaluations are
+ * spread over threads (0 uses every core) as (candidate, log) pairs
+ */
+class Tuner
+{
+public:
+    Tuner(const std::vector<TuneLog>& logs, const EkfReplay& base, const std::vector<TuneParam>& params,
+          unsigned threads, double max_error);
+
+    /* Pooled RMS error of each candidate, given as log10 of the parameters */
+    std::vector<double> evaluate(const std::vector<std::vector<double>>& candidates);
+
+    /* Every point of the grid, returning the best */
+    std::vector<double> grid(double& best);
+
+    /* Nelder-Mead simplex from the base parameters, for up to iterations steps */
+    std::vector<double> nelder_mead(int iterations, double& best);
+
+    /* Base replay options with a candidate's parameters */
+    EkfReplay apply(const std::vector<double>& candidate) const;
+
+    /* Log10 of the base parameters, clamped to the search ranges */
+    std::vector<double> start() const;
+
+    size_t evaluations() const { return evals; }
+
+private:
+    const std::vector<TuneLog>& logs;
+    EkfReplay base;
+    std::vector<TuneParam> params;
+    unsigned threads;
+    double max_error;
+    size_t evals = 0;
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_TUNE_HPP_ */
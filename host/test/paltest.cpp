@@ -0,0 +1,99 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* paltest, the runner for the host tests
+ * With no arguments every test runs, otherwise those whose names contain an argument
+ */
+
+#include "test.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace pal
+{
+namespace test
+{
+
+struct Case
+{
+    const char * name;
+    void (*fn)();
+};
+
+/* Tests register from static initializers, so the table is built on first use */
+static std::vector<Case>& cases()
+{
+    static std::vector<Case> all;
+    return all;
+}
+
+int add(const char * name, void (*fn)())
+{
+    cases().push_back({name,fn});
+    return 0;
+}
+
+void fail(const char * file, int line, const std::string& what)
+{
+    throw std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": " + what);
+}
+
+TempDir::TempDir()
+{
+    char name[] = "/tmp/paltestXXXXXX";
+    if(!mkdtemp(name)) fail(__FILE__,__LINE__,std::string("mkdtemp: ") + strerror(errno));
+    path = name;
+}
+
+TempDir::~TempDir()
+{
+    std::error_code ec;
+    std::filesystem::remove_all(path,ec);
+}
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path,std::ios::binary);
+    if(!in) fail(__FILE__,__LINE__,path + ": can't open");
+    std::ostringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+} /* namespace test */
+} /* namespace pal */
+
+int main(int argc, char ** argv)
+{
+    int run = 0, failed = 0;
+    for(const pal::test::Case& c : pal::test::cases())
+    {
+        bool want = (argc < 2);
+        for(int i = 1; i < argc; i++) want |= (strstr(c.name,argv[i]) != nullptr);
+        if(!want) continue;
+        run++;
+        try
+        {
+            c.fn();
+            printf("pass  %s\n",c.name);
+        }
+        catch(const std::exception& e)
+        {
+            printf("FAIL  %s\n      %s\n",c.name,e.what());
+            failed++;
+        }
+    }
+    printf("%d of %d tests passed\n",run - failed,run);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "sim.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace pal
+{
+namespace test
+{
+
+void isolated(void (*fn)(), unsigned timeout_s)
+{
+    int p[2];
+    if(pipe(p)) fail(__FILE__,__LINE__,std::string("pipe: ") + strerror(errno));
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) fail(__FILE__,__LINE__,std::string("fork: ") + strerror(errno));
+    if(!pid)
+    {
+        /* The tasks are still blocked on their threads when fn returns, so leave
+         * with _exit rather than running the destructors under them
+         */
+        close(p[0]);
+        int null = open("/dev/null",O_WRONLY);
+        if(null >= 0) dup2(null,STDOUT_FILENO);
+        alarm(timeout_s);
+        std::string what;
+        try
+        {
+            fn();
+        }
+        catch(const std::exception& e)
+        {
+            what = e.what();
+        }
+        if(!what.empty() && write(p[1],what.data(),what.size()) < 0) _exit(2);
+        _exit(what.empty() ? 0 : 1);
+    }
+
+    close(p[1]);
+    std::string what;
+    char buf[512];
+    ssize_t n;
+    while((n = read(p[0],buf,sizeof(buf))) > 0) what.append(buf,n);
+    close(p[0]);
+    int status = 0;
+    waitpid(pid,&status,0);
+    if(WIFSIGNALED(status))
+    {
+        fail(__FILE__,__LINE__,WTERMSIG(status) == SIGALRM ? "timed out" : strsignal(WTERMSIG(status)));
+    }
+    if(!WIFEXITED(status) || WEXITSTATUS(status))
+    {
+        if(what.empty()) fail(__FILE__,__LINE__,"failed");
+        throw std::runtime_error(what);
+    }
+}
+
+} /* namespace test */
+} /* namespace pal */
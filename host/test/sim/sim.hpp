@@ -0,0 +1,29 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TEST_SIM_HPP_
+#define _PAL_TEST_SIM_HPP_
+
+#include "test.hpp"
+
+/* Helpers for the tests which run the robot code on palhil's mocked PROS API
+ * The robot code keeps its state in globals and there is one SimKernel a process,
+ * so each such test runs in a process of its own
+ */
+namespace pal
+{
+namespace test
+{
+
+/* Run fn in a child process, failing with what failed in it, or if it takes more
+ * than timeout_s of real time. The child's console output is discarded
+ */
+void isolated(void (*fn)(), unsigned timeout_s = 30);
+
+} /* namespace test */
+} /* namespace pal */
+
+#endif /* _PAL_TEST_SIM_HPP_ */
@@ -0,0 +1,141 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the device poller in src/log_poll.c, run on the simulated kernel */
+
+#include "sim.hpp"
+#include "hil.hpp"
+#include "api.h"
+#include "pal/log.h"
+#include "pal/log_sink.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/* The data file, as the sinks get it */
+std::string data;
+
+void capture_write(log_sink_t *, const log_sink_rec_t * rec, const void * payload)
+{
+    data.append(static_cast<const char *>(payload),rec->len);
+}
+
+log_sink_t capture = {"capture",LOG_SINK_TYPE(LOG_SINK_DATA),LOG_LEVEL_ALWAYS,LOG_SINK_FMT_SHORT,capture_write,
+                      nullptr,0,0,nullptr};
+
+/* Column of a CSV header line, or -1 */
+int column(const std::string& header, const std::string& name)
+{
+    std::istringstream s(header);
+    std::string f;
+    for(int i = 0; std::getline(s,f,','); i++)
+    {
+        if(f == name) return i;
+    }
+    return -1;
+}
+
+std::vector<std::string> fields(const std::string& line)
+{
+    std::vector<std::string> out;
+    std::istringstream s(line);
+    std::string f;
+    while(std::getline(s,f,',')) out.push_back(f);
+    return out;
+}
+
+/* Until the poller has sampled, a device's values are NaN at the row time, however
+ * long the robot has been on. Here it is an hour, which as a delta from 0 overflows
+ */
+const uint64_t HOUR_US = 3600000000ull;
+double unsampled_value = 0.0;
+
+void log_unsampled(void *)
+{
+    log_poll_gps("gps",11,LOG_FIELD_POSITION | LOG_FIELD_TIME);
+    log_sink_add(&capture);
+    log_init();
+    for(int r = 0; r < 5; r++)
+    {
+        log_step();
+        unsampled_value = log_poll_value(log_poll_find("gps_x"));
+        pros::c::task_delay(10);
+    }
+    log_step();
+}
+
+/* A task below the poller, counting the milliseconds it gets to run in */
+int low_runs = 0;
+
+void run_low(void *)
+{
+    while(true)
+    {
+        low_runs++;
+        pros::c::task_delay(1);
+    }
+}
+
+void start_poller(void *)
+{
+    log_poll_motor("left",1,LOG_FIELD_VEL);
+    log_poll_start(2);
+}
+
+} /* namespace */
+
+TEST(poll_unsampled)
+{
+    pal::test::isolated([]
+    {
+        pal::test::TempDir card;
+        pal::hil_attach(nullptr,card.path);
+        pal::SimKernel& k = pal::SimKernel::get();
+        k.spawn(log_unsampled,nullptr,TASK_PRIORITY_DEFAULT,"unsampled");
+        k.run(HOUR_US,HOUR_US + 1000000);
+
+        CHECK(std::isnan(unsampled_value));
+        std::istringstream lines(data);
+        std::string header;
+        CHECK(std::getline(lines,header));
+        int x = column(header,"gps_x");
+        int dt = column(header,"gps_x_dt");
+        int y = column(header,"gps_y");
+        CHECK(x > 0 && dt > 0 && y > 0);
+        int rows = 0;
+        for(std::string line; std::getline(lines,line); rows++)
+        {
+            std::vector<std::string> f = fields(line);
+            CHECK(static_cast<int>(f.size()) > y);
+            CHECK(std::isnan(strtod(f[x].c_str(),nullptr)));
+            CHECK(std::isnan(strtod(f[y].c_str(),nullptr)));
+            CHECK(strtoll(f[dt].c_str(),nullptr,10) == 0);
+        }
+        CHECK(rows >= 4);
+    });
+}
+
+/* A device read taking longer than the period leaves the poller behind on every
+ * cycle, but it still sleeps a millisecond each, so lower priority tasks still run
+ */
+TEST(poll_overrun_yields)
+{
+    pal::test::isolated([]
+    {
+        pal::SimKernel& k = pal::SimKernel::get();
+        pal::hil_read_cost(3000);
+        k.spawn(start_poller,nullptr,TASK_PRIORITY_DEFAULT,"start");
+        k.spawn(run_low,nullptr,TASK_PRIORITY_MIN,"low");
+        k.run(0,1000000);
+        CHECK(low_runs >= 200);
+    });
+}
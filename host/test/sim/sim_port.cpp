@@ -0,0 +1,138 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the smart port sink in src/log_sinks.c, run on the simulated kernel
+ * with the port on a pty, decoded on the other side as pallog recv -n does
+ */
+
+#include "sim.hpp"
+#include "hil.hpp"
+#include "kernel.hpp"
+#include "telemetry.hpp"
+#include "tty.hpp"
+#include "api.h"
+#include "pal/log.h"
+#include "pal/log_sink.h"
+
+#include <cstdint>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+
+/* How a run is set up */
+struct PortCfg
+{
+    int32_t baud;
+    uint32_t rate;              /* The sink's rate, 0 to leave it at baud / 10 */
+    uint32_t period_ms;         /* Between messages */
+    uint32_t secs;              /* Of simulated time the messages are sent for */
+};
+
+/* What came out of the port */
+struct PortResult
+{
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    pal::TelemetryStats st;
+};
+
+const PortCfg * run_cfg = nullptr;
+log_sink_port_t port;
+
+/* Messages of 90 bytes of text, 126 framed, every period for secs. The run goes
+ * on a second more, for the sink to send what it has queued
+ */
+void send_messages(void *)
+{
+    log_sink_port_init(&port,1,run_cfg->baud,LOG_SINK_TYPE(LOG_SINK_MSG),LOG_LEVEL_INFO);
+    if(run_cfg->rate) port.rate = run_cfg->rate;
+    log_sink_add(&port.sink);
+    log_init();
+    uint32_t end = pros::c::millis() + run_cfg->secs * 1000;
+    for(int i = 0; pros::c::millis() < end; i++)
+    {
+        LOG_WARN("Message %08d, as long as a line of the data file might be, padded out to ninety",i);
+        pros::c::task_delay(run_cfg->period_ms);
+    }
+}
+
+/* Run the sink on port 1, reading the pty the port writes to while it runs */
+PortResult run_port(const PortCfg& cfg)
+{
+    int slave;
+    std::string name;
+    int master = pal::tty_pty(slave,name);
+    pal::hil_port(1,name);
+    run_cfg = &cfg;
+
+    pal::SimKernel& k = pal::SimKernel::get();
+    k.spawn(send_messages,nullptr,TASK_PRIORITY_DEFAULT,"send");
+    std::thread sim([&k,&cfg] { k.run(0,(cfg.secs + 1) * 1000000ull); });
+
+    PortResult res;
+    pal::TelemetryDecoder dec(false,[&](const pal::TelemetryFrame&) { res.frames++; });
+    uint8_t sync = 0;
+    dec.feed(&sync,1);
+    while(true)
+    {
+        pollfd p = {master,POLLIN,0};
+        if(poll(&p,1,500) <= 0) break;
+        uint8_t buf[4096];
+        ssize_t n = read(master,buf,sizeof(buf));
+        if(n <= 0) break;
+        res.bytes += n;
+        dec.feed(buf,n);
+    }
+    sim.join();
+    res.st = dec.stats();
+    CHECK(res.bytes == port.sent);
+    CHECK(res.st.bad == 0 && res.st.lost == 0);
+    return res;
+}
+
+} /* namespace */
+
+/* Offered seven times what it may send, the sink sends at its rate, keeping on
+ * at it with what it has queued once the messages stop, and skips whole frames
+ * for the rest, counting them
+ */
+TEST(port_rate_limit)
+{
+    pal::test::isolated([]
+    {
+        PortResult res = run_port({115200,4000,5,10});
+        CHECK(res.st.dropped > 0 && res.st.dropped <= port.skipped);
+        CHECK(res.bytes <= 4000 * 11);
+        CHECK(res.bytes >= 4000 * 10 + 2000);
+    });
+}
+
+/* Left at the rate the baud carries, the port's own buffer holds it to that */
+TEST(port_line_rate)
+{
+    pal::test::isolated([]
+    {
+        PortResult res = run_port({115200,0,2,10});
+        CHECK(res.st.dropped > 0);
+        CHECK(res.bytes <= 11520 * 11);
+        CHECK(res.bytes >= 11520 * 10 + 5760);
+    });
+}
+
+/* Offered less than the rate, everything arrives */
+TEST(port_under_rate)
+{
+    pal::test::isolated([]
+    {
+        PortResult res = run_port({115200,4000,50,10});
+        CHECK(res.st.dropped == 0 && port.skipped == 0);
+        CHECK(res.frames == 200);
+    });
+}
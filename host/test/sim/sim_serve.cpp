@@ -0,0 +1,236 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the file server in src/log_serve.c, run on the simulated kernel with
+ * its serial link on a pty, against the host's fetch client as pallog fetch uses it
+ */
+
+#include "sim.hpp"
+#include "hil.hpp"
+#include "kernel.hpp"
+#include "fetch.hpp"
+#include "tty.hpp"
+#include "api.h"
+#include "pal/log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+void start_server(void *)
+{
+    log_init();
+    log_serve_start();
+}
+
+void write_file(const std::string& path, const std::string& data)
+{
+    FILE * f = fopen(path.c_str(),"wb");
+    CHECK(f);
+    CHECK(fwrite(data.data(),1,data.size(),f) == data.size());
+    fclose(f);
+}
+
+std::string random_bytes(size_t n, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::string s(n,0);
+    for(char& c : s) c = static_cast<char>(rng());
+    return s;
+}
+
+/* The host's side of the link, taken message by message, to see what the server
+ * sends for each request without a client's retries in the way
+ */
+struct Link
+{
+    explicit Link(int fd)
+        : fd(fd),
+          demux([this](uint32_t id, const uint8_t * data, size_t len) { if(id == LOG_SERVE_STREAM_ID) frames.feed(data,len); }),
+          frames([this](const std::vector<uint8_t>& raw)
+          {
+              CHECK(raw.size() >= sizeof(log_serve_msg_t));
+              log_serve_msg_t m;
+              memcpy(&m,raw.data(),sizeof(m));
+              msgs.push_back(m);
+              bodies.emplace_back(raw.begin() + sizeof(m),raw.end());
+          })
+    {
+    }
+
+    void send(uint8_t op, uint32_t id, uint32_t offset, uint32_t arg, const std::string& name = "")
+    {
+        log_serve_msg_t msg = {};
+        msg.op = op;
+        msg.id = id;
+        msg.offset = offset;
+        msg.arg = arg;
+        std::vector<uint8_t> frame = pal::pack_frame(&msg,sizeof(msg),name.data(),name.size());
+        CHECK(write(fd,frame.data(),frame.size()) == static_cast<ssize_t>(frame.size()));
+    }
+
+    /* The next message, or false if none comes in timeout_ms */
+    bool next(log_serve_msg_t& m, std::string& body, int timeout_ms = 300)
+    {
+        while(msgs.empty())
+        {
+            pollfd p = {fd,POLLIN,0};
+            if(poll(&p,1,timeout_ms) <= 0) return false;
+            uint8_t buf[4096];
+            ssize_t n = read(fd,buf,sizeof(buf));
+            CHECK(n > 0);
+            demux.feed(buf,n);
+        }
+        m = msgs.front();
+        body = bodies.front();
+        msgs.pop_front();
+        bodies.pop_front();
+        return true;
+    }
+
+    int fd;
+    pal::ProsDemux demux;
+    pal::FrameSplitter frames;
+    std::deque<log_serve_msg_t> msgs;
+    std::deque<std::string> bodies;
+};
+
+/* Thrown from a fetch's progress, breaking it off part way as a lost link would */
+struct Broken
+{
+};
+
+} /* namespace */
+
+/* The server sends a window of chunks past the last ACK and no more, the end once
+ * it has sent the last, and an error for a file it can't send, under the id asked
+ * A fetch broken off part way resumes from what it left, ignoring the answers to
+ * the old requests still on the link, and comes out the same as the robot's file
+ */
+TEST(serve_fetch)
+{
+    pal::test::isolated([]
+    {
+        pal::test::TempDir card, host;
+        std::string bin = random_bytes(20000,1);
+        std::string txt = random_bytes(3000,2);
+        write_file(card.path + "/dat00000.bin",bin);
+        write_file(card.path + "/log00000.txt",txt);
+        write_file(card.path + "/index.txt","0\n");
+
+        int slave;
+        std::string name;
+        int master = pal::tty_pty(slave,name);
+        pal::hil_attach(nullptr,card.path);
+        pal::hil_serial(name);
+
+        /* The tasks are left running when the test ends, as the robot would be */
+        pal::SimKernel& k = pal::SimKernel::get();
+        k.spawn(start_server,nullptr,TASK_PRIORITY_DEFAULT,"start");
+        k.pace(1.0);
+        std::thread([&k] { k.run(0,600000000); }).detach();
+
+        Link link(master);
+        log_serve_msg_t m;
+        std::string body;
+
+        /* Two chunks unacknowledged, then one more for each ACK of this transfer */
+        link.send(LOG_SERVE_READ,77,0,2,"dat00000.bin");
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_DATA && m.id == 77 && m.offset == 0);
+        CHECK(body == bin.substr(0,LOG_SERVE_CHUNK));
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_DATA && m.id == 77 && m.offset == LOG_SERVE_CHUNK);
+        CHECK(!link.next(m,body));
+        link.send(LOG_SERVE_ACK,76,LOG_SERVE_CHUNK,0);
+        CHECK(!link.next(m,body));
+        link.send(LOG_SERVE_ACK,77,LOG_SERVE_CHUNK,0);
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_DATA && m.offset == 2 * LOG_SERVE_CHUNK);
+        CHECK(!link.next(m,body));
+
+        /* From an offset to the end */
+        link.send(LOG_SERVE_READ,78,19900,4,"dat00000.bin");
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_DATA && m.id == 78 && m.offset == 19900);
+        CHECK(body == bin.substr(19900));
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_END && m.id == 78 && m.offset == 20000);
+        link.send(LOG_SERVE_ACK,78,20000,0);
+
+        link.send(LOG_SERVE_READ,79,0,4,"dat00009.bin");
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_ERROR && m.id == 79);
+        link.send(LOG_SERVE_READ,80,20001,4,"dat00000.bin");
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_ERROR && m.id == 80);
+        link.send(LOG_SERVE_SUM,81,1000,0,"dat00000.bin");
+        CHECK(link.next(m,body) && m.op == LOG_SERVE_SUM && m.id == 81 && m.offset == 1000);
+        CHECK(m.arg == pal::crc32(bin.data(),1000));
+        CHECK(!link.next(m,body));
+
+        pal::FileClient client(master,500,3);
+        std::vector<pal::RemoteFile> files = client.list();
+        pal::RemoteFile fbin = {}, ftxt = {};
+        int open = 0;
+        for(const pal::RemoteFile& f : files)
+        {
+            if(f.name == "dat00000.bin") fbin = f;
+            if(f.name == "log00000.txt") ftxt = f;
+            /* Those log_init() opened, the logger still writing them */
+            CHECK(f.open == (f.name.find("00001.") != std::string::npos));
+            open += f.open;
+        }
+        CHECK(open == 2);
+        CHECK(fbin.size == bin.size() && !fbin.open);
+        CHECK(ftxt.size == txt.size() && !ftxt.open);
+
+        /* Broken off part way, a fetch resumes from what it left. Answers to other
+         * requests, here a sum of the other file, then a window of this one from the
+         * start, are ignored for their ids, though they come first
+         */
+        std::string pbin = host.path + "/dat00000.bin";
+        std::string ptxt = host.path + "/log00000.txt";
+        bool broke = false;
+        try
+        {
+            client.fetch(fbin,pbin,4,[](uint32_t done, uint32_t) { if(done >= 1000) throw Broken(); });
+        }
+        catch(const Broken&)
+        {
+            broke = true;
+        }
+        CHECK(broke);
+        CHECK(pal::test::read_file(pbin + ".part") == bin.substr(0,2 * LOG_SERVE_CHUNK));
+
+        link.send(LOG_SERVE_SUM,90,2 * LOG_SERVE_CHUNK,0,"log00000.txt");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pal::FetchResult res = client.fetch(fbin,pbin,4);
+        CHECK(res.from == 2 * LOG_SERVE_CHUNK && res.size == bin.size());
+        CHECK(pal::test::read_file(pbin) == bin);
+
+        link.send(LOG_SERVE_READ,91,0,8,"dat00000.bin");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        res = client.fetch(ftxt,ptxt,8);
+        CHECK(res.from == 0 && res.size == txt.size());
+        CHECK(pal::test::read_file(ptxt) == txt);
+
+        /* Fetched whole, it is had, until a byte of it changes */
+        CHECK(client.have(fbin,pbin));
+        bin[12345] ^= 1;
+        write_file(pbin,bin);
+        CHECK(!client.have(fbin,pbin));
+
+        broke = false;
+        try { client.fetch({"dat00009.bin",10,false},host.path + "/dat00009.bin",4); }
+        catch(const std::runtime_error& e) { broke = strstr(e.what(),"Unable to open") != nullptr; }
+        CHECK(broke);
+    });
+}
@@ -0,0 +1,90 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TEST_TABLE_HPP_
+#define _PAL_TEST_TABLE_HPP_
+
+#include "rows.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pal
+{
+namespace test
+{
+
+/* Rows held in memory, one vector per column with time first, handed out a few at
+ * a time so what reads them sees rows span its blocks
+ */
+class Table : public RowSource
+{
+public:
+    Table(const std::vector<std::string>& names, std::vector<std::vector<double>> data, size_t chunk = 333)
+        : data(std::move(data)), chunk(chunk)
+    {
+        for(const auto& n : names) cols.push_back({n,ColType::Double});
+        nrows = this->data.empty() ? 0 : this->data[0].size();
+    }
+
+    size_t read(double * block, size_t max) override
+    {
+        size_t n = std::min({max,nrows - at,chunk});
+        for(size_t c = 0; c < cols.size(); c++)
+        {
+            std::copy(data[c].begin() + at,data[c].begin() + at + n,block + c * max);
+        }
+        at += n;
+        return n;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        if(!nrows) return false;
+        first = data[0].front();
+        last = data[0].back();
+        return std::isfinite(first) && std::isfinite(last);
+    }
+
+    uint64_t tell() const override
+    {
+        return at;
+    }
+
+    void seek(uint64_t pos) override
+    {
+        at = pos;
+    }
+
+private:
+    std::vector<std::vector<double>> data;
+    size_t chunk;
+    size_t at = 0;
+};
+
+/* All rows of a source, one vector per column */
+inline std::vector<std::vector<double>> read_all(RowSource& src, size_t block = 100)
+{
+    size_t ncols = src.columns().size();
+    std::vector<std::vector<double>> out(ncols);
+    std::vector<double> buf(ncols * block);
+    while(size_t n = src.read(buf.data(),block))
+    {
+        for(size_t c = 0; c < ncols; c++)
+        {
+            out[c].insert(out[c].end(),buf.begin() + c * block,buf.begin() + c * block + n);
+        }
+    }
+    return out;
+}
+
+} /* namespace test */
+} /* namespace pal */
+
+#endif /* _PAL_TEST_TABLE_HPP_ */
@@ -0,0 +1,60 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_TEST_HPP_
+#define _PAL_TEST_HPP_
+
+#include <sstream>
+#include <string>
+
+/* Minimal harness for the host tests, which make test builds into paltest and runs
+ * TEST(name) defines a test, and CHECK(cond) fails it, reporting the condition
+ * CHECK_NEAR(a,b,tol) also reports both values
+ */
+namespace pal
+{
+namespace test
+{
+
+int add(const char * name, void (*fn)());
+[[noreturn]] void fail(const char * file, int line, const std::string& what);
+
+/* A directory under /tmp, removed with what is in it when it goes out of scope */
+struct TempDir
+{
+    TempDir();
+    ~TempDir();
+    std::string path;
+};
+
+/* Contents of a file, which must exist */
+std::string read_file(const std::string& path);
+
+} /* namespace test */
+} /* namespace pal */
+
+#define TEST(name) \
+    static void test_##name(); \
+    static int test_reg_##name = pal::test::add(#name,test_##name); \
+    static void test_##name()
+
+#define CHECK(cond) \
+    do { if(!(cond)) pal::test::fail(__FILE__,__LINE__,#cond); } while(0)
+
+#define CHECK_NEAR(a,b,tol) \
+    do \
+    { \
+        double check_a = (a), check_b = (b); \
+        if(!(check_a - check_b <= (tol) && check_b - check_a <= (tol))) \
+        { \
+            std::ostringstream check_s; \
+            check_s.precision(17); \
+            check_s << #a << " = " << check_a << ", " << #b << " = " << check_b; \
+            pal::test::fail(__FILE__,__LINE__,check_s.str()); \
+        } \
+    } while(0)
+
+#endif /* _PAL_TEST_HPP_ */
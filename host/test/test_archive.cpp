@@ -0,0 +1,208 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the archive pallog ingest builds: the content hash, the segments found
+ * on a card dump, what ingesting one stores, and the catalog written and read back
+ */
+
+#include "test.hpp"
+#include "archive.hpp"
+#include "hash.hpp"
+#include "rows.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+void write_file(const std::string& path, const std::string& text)
+{
+    FILE * f = fopen(path.c_str(),"wb");
+    CHECK(f);
+    CHECK(fwrite(text.data(),1,text.size(),f) == text.size());
+    fclose(f);
+}
+
+bool exists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(),&st) == 0;
+}
+
+/* 60 rows 20 ms apart from 1.5 s, in ms as the logger writes them: disabled for
+ * 10, autonomous for 30, driver for 20
+ */
+std::string comp_csv()
+{
+    std::string text = "time,comp_dis,comp_auto,batt_volt\n";
+    char line[64];
+    for(int r = 0; r < 60; r++)
+    {
+        snprintf(line,sizeof(line),"%d,%d,%d,%d\n",1500 + r * 20,r < 10,r >= 10 && r < 40,12000 - r);
+        text += line;
+    }
+    return text;
+}
+
+} /* namespace */
+
+/* XXH64 as the reference gives it, across the stripes and each tail */
+TEST(hash_known)
+{
+    CHECK(pal::xxh64("",0) == 0xEF46DB3751D8E999ULL);
+    CHECK(pal::xxh64("a",1) == 0xD24EC4F1A98C6E5BULL);
+    CHECK(pal::xxh64("abc",3) == 0x44BC2CF5AD770999ULL);
+    const char * s = "Nobody inspects the spammish repetition";
+    CHECK(pal::xxh64(s,strlen(s)) == 0xFBCEA83C8A378BF1ULL);
+    CHECK(pal::xxh64(s,strlen(s),1) != pal::xxh64(s,strlen(s)));
+
+    /* The same contents under any name, in order, with their total length last */
+    pal::test::TempDir dir;
+    write_file(dir.path + "/a","first file");
+    write_file(dir.path + "/b","second");
+    write_file(dir.path + "/c","first file");
+    std::string ab = pal::content_id({dir.path + "/a",dir.path + "/b"});
+    CHECK(ab.size() == 24 && ab.substr(16) == "00000010");
+    CHECK(pal::content_id({dir.path + "/c",dir.path + "/b"}) == ab);
+    CHECK(pal::content_id({dir.path + "/b",dir.path + "/a"}) != ab);
+    CHECK(pal::content_id({dir.path + "/a"}) != ab);
+}
+
+/* Segments pair by index, ignoring names that aren't the logger's; dates come
+ * from the path where there is one
+ */
+TEST(archive_segments)
+{
+    pal::test::TempDir dir;
+    for(const char * name : {"dat00000.csv","log00000.txt","log00001.txt","dat00002.bin",
+        "dat0003.csv","log00004.TXT","dat00005.csv.tmp","xlog00006.txt","index.txt"})
+    {
+        write_file(dir.path + "/" + name,"");
+    }
+    std::vector<pal::CardSegment> segs = pal::find_segments(dir.path);
+    CHECK(segs.size() == 3);
+    CHECK(segs[0].segment == 0 && segs[0].data == dir.path + "/dat00000.csv" && segs[0].log == dir.path + "/log00000.txt");
+    CHECK(segs[1].segment == 1 && segs[1].data.empty() && segs[1].log == dir.path + "/log00001.txt");
+    CHECK(segs[2].segment == 2 && segs[2].data == dir.path + "/dat00002.bin" && segs[2].log.empty());
+
+    CHECK(pal::path_date("/dumps/2024-03-09/usd") == "2024-03-09");
+    CHECK(pal::path_date("worlds_2023-04-27_pm") == "2023-04-27");
+    CHECK(pal::path_date("/dumps/12024-03-09/usd").empty());
+    CHECK(pal::path_date("/dumps/2024-03-091").empty());
+    CHECK(pal::path_date("/dumps/2024-3-09").empty());
+    CHECK(pal::dump_date("/dumps/2024-03-09/usd",dir.path + "/log00000.txt") == "2024-03-09");
+    CHECK(pal::dump_date(dir.path,dir.path + "/missing.txt") == "unknown");
+}
+
+/* A segment's data is stored as Arrow with the same rows, its log as it was, and
+ * its mode is the one enabled for most rows, or from the log if there is no data
+ */
+TEST(archive_ingest)
+{
+    pal::test::TempDir card, root;
+    std::string csv = comp_csv();
+    write_file(card.path + "/dat00000.csv",csv);
+    write_file(card.path + "/log00000.txt","In Autonomous\n");
+    write_file(card.path + "/log00001.txt","In Competition Initialize\nIn Autonomous\nIn Disabled\n");
+    write_file(card.path + "/log00002.txt","In Disabled\nIn Autonomous\n");
+    write_file(card.path + "/dat00003.csv","time,batt_volt\n0,12000\n500,11990\n");
+    std::vector<pal::CardSegment> segs = pal::find_segments(card.path);
+    CHECK(segs.size() == 4);
+
+    pal::Archive archive(root.path);
+    pal::CatalogEntry e = pal::ingest_segment(root.path,"id0",segs[0]);
+    CHECK(e.id == "id0" && e.segment == 0 && e.mode == "auto");
+    CHECK(e.rows == 60);
+    CHECK_NEAR(e.seconds,59 * 0.02,1e-9);
+    CHECK(e.data == "data/id0.feather" && e.log == "logs/id0.txt");
+    CHECK(pal::test::read_file(root.path + "/" + e.log) == "In Autonomous\n");
+    CHECK(!exists(root.path + "/" + e.data + ".tmp"));
+
+    auto rows = pal::open_rows(root.path + "/" + e.data);
+    CHECK(rows->rows() == 60 && rows->columns().size() == 4);
+    CHECK(rows->columns()[3].name == "batt_volt");
+    std::vector<double> block(4 * 100);
+    CHECK(rows->read(block.data(),100) == 60);
+    for(int r = 0; r < 60; r++)
+    {
+        CHECK_NEAR(block[r],1.5 + r * 0.02,1e-9);
+        CHECK(block[100 + r] == (r < 10) && block[200 + r] == (r >= 10 && r < 40));
+        CHECK(block[300 + r] == 12000 - r);
+    }
+
+    CHECK(pal::ingest_segment(root.path,"id1",segs[1]).mode == "disabled");
+    pal::CatalogEntry e2 = pal::ingest_segment(root.path,"id2",segs[2]);
+    CHECK(e2.mode == "auto" && e2.data.empty() && e2.rows == 0);
+    pal::CatalogEntry e3 = pal::ingest_segment(root.path,"id3",segs[3]);
+    CHECK(e3.mode == "unknown" && e3.log.empty() && e3.rows == 2);
+    CHECK_NEAR(e3.seconds,0.5,1e-9);
+
+    /* Mostly driver control */
+    std::string driver = "time,comp_dis,comp_auto\n0,1,0\n1,0,1\n2,0,0\n3,0,0\n";
+    write_file(card.path + "/dat00000.csv",driver);
+    CHECK(pal::ingest_segment(root.path,"id4",segs[0]).mode == "driver");
+    write_file(card.path + "/dat00000.csv","time,comp_dis,comp_auto\n0,1,0\n1,1,0\n");
+    CHECK(pal::ingest_segment(root.path,"id5",segs[0]).mode == "disabled");
+}
+
+/* The catalog and sources survive a save and a load, fields quoted where they
+ * need it, and an entry removed takes its files with it
+ */
+TEST(archive_catalog)
+{
+    pal::test::TempDir root;
+    std::string dir = root.path + "/archive";
+    {
+        pal::Archive archive(dir);
+        CHECK(archive.entries().empty() && exists(dir + "/data") && exists(dir + "/logs"));
+        pal::CatalogEntry a;
+        a.id = "bbbb";
+        a.robot = "robot \"b\", the second";
+        a.date = "2024-03-09";
+        a.segment = 4;
+        a.mode = "driver";
+        a.rows = 1200;
+        a.seconds = 24.5;
+        a.data = "data/bbbb.feather";
+        a.log = "logs/bbbb.txt";
+        a.source = "/dumps/b,c/dat00004.csv";
+        pal::CatalogEntry b = a;
+        b.id = "aaaa";
+        b.robot = "alpha";
+        b.data.clear();
+        archive.add(a);
+        archive.add(b);
+        b.segment = 7;
+        archive.add(b);
+        CHECK(archive.entries().size() == 2 && archive.find("aaaa")->segment == 7);
+        archive.add_source("/dumps/b,c/dat00004.csv",{12345,1700000000,"bbbb"});
+        archive.save();
+    }
+    CHECK(!exists(dir + "/catalog.csv.tmp"));
+    CHECK(pal::test::read_file(dir + "/catalog.csv").find("\"robot \"\"b\"\", the second\"") != std::string::npos);
+
+    pal::Archive archive(dir);
+    CHECK(archive.entries().size() == 2);
+    CHECK(archive.entries()[0].id == "aaaa" && archive.entries()[1].id == "bbbb");
+    const pal::CatalogEntry * a = archive.find("bbbb");
+    CHECK(a && a->robot == "robot \"b\", the second" && a->date == "2024-03-09");
+    CHECK(a->segment == 4 && a->mode == "driver" && a->rows == 1200 && a->seconds == 24.5);
+    CHECK(a->data == "data/bbbb.feather" && a->log == "logs/bbbb.txt" && a->source == "/dumps/b,c/dat00004.csv");
+    CHECK(archive.find("aaaa")->data.empty() && !archive.find("cccc"));
+    auto s = archive.sources().find("/dumps/b,c/dat00004.csv");
+    CHECK(s != archive.sources().end() && s->second.size == 12345 && s->second.mtime == 1700000000 && s->second.id == "bbbb");
+
+    write_file(dir + "/data/bbbb.feather","x");
+    write_file(dir + "/logs/bbbb.txt","x");
+    archive.remove("bbbb");
+    CHECK(archive.entries().size() == 1 && !archive.find("bbbb") && archive.find("aaaa"));
+    CHECK(!exists(dir + "/data/bbbb.feather") && !exists(dir + "/logs/bbbb.txt"));
+}
@@ -0,0 +1,51 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the output naming the batch converters share */
+
+#include "test.hpp"
+#include "batch.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+bool collides(const std::vector<std::string>& files, const std::string& dir)
+{
+    try
+    {
+        pal::output_paths(files,dir,".mat");
+    }
+    catch(const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+} /* namespace */
+
+TEST(batch_output_path)
+{
+    CHECK(pal::output_path("a/b/dat00001.csv","",".mat") == "a/b/dat00001.mat");
+    CHECK(pal::output_path("a/b/dat00001.csv","out",".mat") == "out/dat00001.mat");
+    CHECK(pal::output_path("dat00001.bin","",".lod") == "dat00001.lod");
+}
+
+/* Files of one name from two cards can't share an output directory */
+TEST(batch_output_collisions)
+{
+    CHECK(!collides({"a/dat00001.csv","a/dat00002.csv"},"out"));
+    CHECK(!collides({"a/dat00001.csv","b/dat00001.csv"},""));
+    CHECK(collides({"a/dat00001.csv","b/dat00001.csv"},"out"));
+    CHECK(collides({"a/dat00001.csv","a/dat00001.bin"},""));
+    CHECK(collides({"a/dat00001.csv","a/dat00001.csv"},""));
+    std::vector<std::string> outs = pal::output_paths({"a/dat00001.csv","b/dat00002.bin"},"out",".mat");
+    CHECK(outs.size() == 2 && outs[0] == "out/dat00001.mat" && outs[1] == "out/dat00002.mat");
+}
@@ -0,0 +1,325 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Round trip of the binary data format, written by src/log_bin.c as log_step() drives
+ * it and read back by BinLog and the row exporters
+ */
+
+#include "test.hpp"
+#include "binlog.hpp"
+#include "rows.hpp"
+
+extern "C"
+{
+#include "log_internal.h"
+}
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/* The writer's output, in place of the file the logger holds open */
+static std::vector<uint8_t> bin_out;
+
+extern "C" int log_out_ready()
+{
+    return 1;
+}
+
+extern "C" void log_out_write(const void * data, size_t len)
+{
+    const uint8_t * p = static_cast<const uint8_t *>(data);
+    bin_out.insert(bin_out.end(),p,p + len);
+}
+
+extern "C" void log_message(const char *, int, log_level_t, const char *, ...)
+{
+}
+
+namespace
+{
+
+const uint32_t ROWS = 500;
+
+struct Blob
+{
+    uint16_t id;
+    int16_t x;
+    float v;
+};
+
+/* Values of row r, each channel a different function of it */
+int32_t count_at(uint32_t r) { return static_cast<int32_t>(r * 7) - 1000; }
+double volt_at(uint32_t r) { return 12.6 - r * 0.001; }
+double accel_at(uint32_t r, int e) { return std::sin(r * 0.1 + e); }
+double vel_at(uint32_t r) { return r * 0.5 - 60.0; }
+double cur_at(uint32_t r) { return 1.0 + (r % 13) * 0.1; }
+int32_t enc_at(uint32_t r) { return static_cast<int32_t>(r * r); }
+double batt_at(uint32_t r) { return 12.0 + std::sin(r * 0.02); }
+double temp_at(uint32_t r) { return 30.0 + (r / 100); }
+int32_t dt_motor(uint32_t r) { return -10000 + static_cast<int32_t>(r % 7); }
+int32_t dt_enc(uint32_t r) { return -static_cast<int32_t>(r % 1000); }
+
+/* One log_step() worth of calls, as log.c makes them. Plain rows have only the
+ * channels in the ROW record, so nothing comes between them
+ */
+void log_row(uint32_t r, uint32_t t_ms, int header, bool plain = false)
+{
+    log_bin_step(t_ms,header);
+    log_bin_data("count",LOG_TYPE_INT,count_at(r),0.0,LOG_TS_NONE,0);
+    log_bin_data("volt",LOG_TYPE_DBL,0,volt_at(r),LOG_TS_NONE,0);
+    double accel[3] = {accel_at(r,0),accel_at(r,1),accel_at(r,2)};
+    log_bin_vec("accel",LOG_SHAPE_XYZ,accel,3);
+    uint64_t t_us = static_cast<uint64_t>(t_ms) * 1000;
+    log_bin_data("m_vel",LOG_TYPE_DBL,0,vel_at(r),LOG_TS_OWN,t_us + dt_motor(r));
+    log_bin_data("m_cur",LOG_TYPE_DBL,0,cur_at(r),LOG_TS_SHARED,0);
+    log_bin_data("enc",LOG_TYPE_INT,enc_at(r),0.0,LOG_TS_OWN,t_us + dt_enc(r));
+    if(plain) return;
+    Blob blobs[3];
+    int nblobs = r % 4;
+    for(int i = 0; i < nblobs; i++) blobs[i] = {static_cast<uint16_t>(r),static_cast<int16_t>(-i),i * 0.5f};
+    log_bin_var("blob","id:u16,x:i16,v:f32",blobs,nblobs,sizeof(Blob));
+    log_bin_comp("batt",batt_at(r),LOG_COMP_SDT,0.01);
+    log_bin_comp("temp",temp_at(r),LOG_COMP_DEADBAND,0.5);
+}
+
+/* A file as the logger writes it, a header pass then ROWS rows 10 ms apart */
+std::vector<uint8_t> write_file(bool plain = false)
+{
+    bin_out.clear();
+    log_bin_open(400,0);
+    log_row(0,400,1,plain);
+    for(uint32_t r = 0; r < ROWS; r++) log_row(r,410 + r * 10,0,plain);
+    log_bin_close();
+    return bin_out;
+}
+
+/* A temporary file holding data, removed when it goes out of scope */
+struct TempFile
+{
+    std::string path;
+
+    explicit TempFile(const std::vector<uint8_t>& data)
+    {
+        char name[] = "/tmp/paltestXXXXXX";
+        int fd = mkstemp(name);
+        CHECK(fd >= 0);
+        CHECK(write(fd,data.data(),data.size()) == static_cast<ssize_t>(data.size()));
+        close(fd);
+        path = name;
+    }
+    ~TempFile() { unlink(path.c_str()); }
+};
+
+/* Value of a sparse channel at t, from its points, as the exporters reconstruct it */
+double sparse_at(const pal::Records<log_bin_point_t>& pts, bool hold, uint32_t t)
+{
+    size_t i = 0;
+    while(i + 1 < pts.size() && pts[i + 1].time_ms <= t) i++;
+    if(hold || i + 1 >= pts.size() || pts[i].time_ms == t) return pts[i].value;
+    const log_bin_point_t& a = pts[i];
+    const log_bin_point_t& b = pts[i + 1];
+    return a.value + (b.value - a.value) * (t - a.time_ms) / (double)(b.time_ms - a.time_ms);
+}
+
+} /* namespace */
+
+/* Every channel kind comes back as it went in */
+TEST(bin_round_trip)
+{
+    TempFile f(write_file());
+    pal::BinLog log(f.path);
+    CHECK(!log.truncated());
+    CHECK(log.open_ms() == 400);
+    CHECK(log.rows() == ROWS);
+    CHECK(log.channels().size() == 9);
+
+    int count = log.find("count"), volt = log.find("volt"), accel = log.find("accel");
+    int vel = log.find("m_vel"), cur = log.find("m_cur"), enc = log.find("enc");
+    int blob = log.find("blob"), batt = log.find("batt"), temp = log.find("temp");
+    CHECK(count >= 0 && volt >= 0 && accel >= 0 && vel >= 0 && cur >= 0 && enc >= 0);
+    CHECK(blob >= 0 && batt >= 0 && temp >= 0);
+    CHECK(log.channels()[blob].layout == "id:u16,x:i16,v:f32");
+    CHECK(log.channels()[accel].element_name(2) == "accel_z");
+
+    pal::Column<uint32_t> time = log.time();
+    pal::Column<int32_t> c_count = log.column<int32_t>(count);
+    pal::Column<double> c_volt = log.column<double>(volt);
+    pal::Column<double> c_vel = log.column<double>(vel);
+    pal::Column<double> c_cur = log.column<double>(cur);
+    pal::Column<int32_t> c_enc = log.column<int32_t>(enc);
+    pal::Column<int32_t> d_vel = log.sample_delta(vel);
+    pal::Column<int32_t> d_cur = log.sample_delta(cur);
+    pal::Column<int32_t> d_enc = log.sample_delta(enc);
+    for(uint32_t r = 0; r < ROWS; r++)
+    {
+        CHECK(time[r] == 410 + r * 10);
+        CHECK(c_count[r] == count_at(r));
+        CHECK(c_volt[r] == volt_at(r));
+        for(int e = 0; e < 3; e++) CHECK(log.value(accel,e,r) == accel_at(r,e));
+        CHECK(c_vel[r] == vel_at(r));
+        CHECK(c_cur[r] == cur_at(r));
+        CHECK(c_enc[r] == enc_at(r));
+        CHECK(d_vel[r] == dt_motor(r));
+        CHECK(d_cur[r] == dt_motor(r));
+        CHECK(d_enc[r] == dt_enc(r));
+    }
+
+    /* VAR records only for rows which had structs */
+    pal::Records<log_bin_var_t> vars = log.vars(blob);
+    size_t nvars = 0;
+    for(uint32_t r = 0; r < ROWS; r++) nvars += (r % 4) ? 1 : 0;
+    CHECK(vars.size() == nvars);
+    for(size_t i = 0; i < vars.size(); i++)
+    {
+        const log_bin_var_t& v = vars[i];
+        uint32_t r = (v.time_ms - 410) / 10;
+        CHECK(v.count == r % 4 && v.size == sizeof(Blob));
+        Blob b;
+        memcpy(&b,reinterpret_cast<const uint8_t *>(&v + 1) + (v.count - 1) * sizeof(Blob),sizeof(b));
+        CHECK(b.id == r && b.x == -static_cast<int>(v.count - 1) && b.v == (v.count - 1) * 0.5f);
+    }
+
+    /* Compressed channels reconstruct to within their tolerance */
+    pal::Records<log_bin_point_t> p_batt = log.points(batt);
+    pal::Records<log_bin_point_t> p_temp = log.points(temp);
+    CHECK(p_batt.size() > 1 && p_batt.size() < ROWS / 2);
+    CHECK(p_temp.size() > 1 && p_temp.size() < ROWS / 10);
+    for(uint32_t r = 0; r < ROWS; r++)
+    {
+        CHECK_NEAR(sparse_at(p_batt,false,410 + r * 10),batt_at(r),0.01 + 1e-12);
+        CHECK_NEAR(sparse_at(p_temp,true,410 + r * 10),temp_at(r),0.5);
+    }
+}
+
+/* Values sit at their natural alignment, with 4-byte items filling the gaps */
+TEST(bin_row_packing)
+{
+    TempFile f(write_file());
+    pal::BinLog log(f.path);
+    size_t area = 0;
+    for(const pal::BinChannel& c : log.channels())
+    {
+        if(!c.in_row()) continue;
+        CHECK(c.offset % c.value_size() == 0);
+        area += c.value_size() * c.count;
+        if((c.flags & LOG_CHAN_TS) && c.name != "m_cur") area += sizeof(int32_t);
+        if(c.flags & LOG_CHAN_TS) CHECK(c.ts_offset % sizeof(int32_t) == 0);
+    }
+    CHECK(log.channels()[log.find("m_cur")].ts_offset == log.channels()[log.find("m_vel")].ts_offset);
+
+    /* The ROW record holds nothing but the row time and the values */
+    pal::BinCursor cur(log.mapped().data(),log.mapped().size());
+    bool found = false;
+    while(!found && cur.next())
+    {
+        if(cur.record().type != LOG_REC_ROW) continue;
+        CHECK(cur.record().len == sizeof(log_bin_row_t) + area);
+        found = true;
+    }
+    CHECK(found);
+}
+
+/* The exporters' columns, with one sample time column per delta */
+TEST(bin_rows_export)
+{
+    TempFile f(write_file());
+    std::unique_ptr<pal::RowSource> src = pal::open_rows(f.path);
+    std::vector<std::string> names;
+    for(const pal::RowColumn& c : src->columns()) names.push_back(c.name);
+    auto at = [&](const std::string& n) -> int
+    {
+        for(size_t i = 0; i < names.size(); i++) if(names[i] == n) return static_cast<int>(i);
+        return -1;
+    };
+    CHECK(at("m_t") >= 0);
+    CHECK(at("enc_t") >= 0);
+    CHECK(at("m_vel_t") < 0 && at("m_cur_t") < 0);
+    CHECK(at("accel_y") >= 0);
+
+    const size_t block = 64;
+    std::vector<double> buf(names.size() * block);
+    uint32_t r = 0;
+    size_t n;
+    while((n = src->read(buf.data(),block)) > 0)
+    {
+        for(size_t i = 0; i < n; i++, r++)
+        {
+            double t = (410 + r * 10) / 1000.0;
+            CHECK_NEAR(buf[at("time") * block + i],t,1e-9);
+            CHECK(buf[at("m_cur") * block + i] == cur_at(r));
+            CHECK_NEAR(buf[at("m_t") * block + i],t + dt_motor(r) / 1e6,1e-9);
+            CHECK_NEAR(buf[at("enc_t") * block + i],t + dt_enc(r) / 1e6,1e-9);
+            CHECK(buf[at("enc") * block + i] == enc_at(r));
+        }
+    }
+    CHECK(r == ROWS);
+}
+
+/* A file cut off part way through a record, as when the robot loses power */
+TEST(bin_truncated)
+{
+    std::vector<uint8_t> data = write_file();
+    data.resize(data.size() * 2 / 3 + 5);
+    TempFile f(data);
+    pal::BinLog log(f.path);
+    CHECK(log.truncated());
+    CHECK(log.rows() > ROWS / 2 && log.rows() < ROWS);
+    pal::Column<double> c_vel = log.column<double>(log.find("m_vel"));
+    for(size_t r = 0; r < log.rows(); r++) CHECK(c_vel[r] == vel_at(r));
+}
+
+/* Time ranges come out as the rows and records within them, whether the columns
+ * are plain strides over evenly spaced rows or go through the row index
+ */
+TEST(bin_time_slices)
+{
+    for(bool plain : {false,true})
+    {
+        TempFile f(write_file(plain));
+        pal::BinLog log(f.path);
+        CHECK(log.rows() == ROWS);
+        CHECK(log.range(0,400) == std::make_pair(size_t(0),size_t(0)));
+        CHECK(log.range(0,411) == std::make_pair(size_t(0),size_t(1)));
+        CHECK(log.range(1410,2410) == std::make_pair(size_t(100),size_t(200)));
+        CHECK(log.range(1405,2405) == std::make_pair(size_t(100),size_t(200)));
+        CHECK(log.range(2410,1410) == std::make_pair(size_t(200),size_t(200)));
+        CHECK(log.range(5410,9000) == std::make_pair(size_t(ROWS),size_t(ROWS)));
+
+        std::pair<size_t,size_t> r = log.range(1410,2410);
+        pal::Column<uint32_t> time = log.time().slice(r.first,r.second);
+        pal::Column<double> vel = log.column<double>(log.find("m_vel")).slice(r.first,r.second);
+        pal::Column<int32_t> count = log.column<int32_t>(log.find("count")).slice(r.first,r.second);
+        CHECK(time.size() == 100 && vel.size() == 100 && count.size() == 100);
+        for(uint32_t i = 0; i < 100; i++)
+        {
+            CHECK(time[i] == 1410 + i * 10);
+            CHECK(vel[i] == vel_at(100 + i));
+        }
+        int64_t sum = 0;
+        count.for_each([&](int32_t v) { sum += v; });
+        int64_t want = 0;
+        for(uint32_t i = 100; i < 200; i++) want += count_at(i);
+        CHECK(sum == want);
+        CHECK(log.column<double>(log.find("volt")).slice(490,600).size() == 10);
+
+        pal::Span<double> accel = log.values<double>(log.find("accel"),123);
+        CHECK(accel.size() == 3);
+        for(int e = 0; e < 3; e++) CHECK(accel[e] == accel_at(123,e));
+        if(plain) continue;
+
+        /* Rows 100 to 199 with structs, three of every four */
+        pal::Records<log_bin_var_t> vars = log.vars(log.find("blob")).slice_time(1410,2410);
+        CHECK(vars.size() == 75);
+        CHECK(vars[0].time_ms == 1420 && vars[vars.size() - 1].time_ms == 2400);
+        CHECK(log.points(log.find("temp")).slice_time(0,410).size() == 0);
+    }
+}
@@ -0,0 +1,68 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the logger's clocks in src/log_clock.c, built with LOG_CLOCK_PLUGGABLE */
+
+#include "test.hpp"
+
+extern "C"
+{
+#include "log_internal.h"
+}
+
+/* The PROS clock, which the real clock reads */
+static uint64_t pros_us = 0;
+
+extern "C" uint64_t micros(void)
+{
+    return pros_us;
+}
+
+TEST(clock_real)
+{
+    CHECK(log_clock(nullptr) == 0);
+    CHECK(LOG_CLOCK_IS_REAL());
+    pros_us = 123456789;
+    CHECK(log_clock_us() == 123456789);
+    CHECK(log_now_ms() == 123456);
+}
+
+TEST(clock_manual)
+{
+    log_clock_manual_t clk;
+    log_clock_manual_init(&clk,5000);
+    CHECK(log_clock(&clk.clock) == 0);
+    CHECK(!LOG_CLOCK_IS_REAL());
+    pros_us = 999999;
+    CHECK(log_clock_us() == 5000);
+    log_clock_manual_advance(&clk,250);
+    CHECK(log_clock_us() == 5250);
+    log_clock_manual_advance(&clk,10000);
+    CHECK(log_now_ms() == 15);
+    CHECK(log_clock(nullptr) == 0);
+    CHECK(log_clock_us() == 999999);
+}
+
+/* Holds the first time until stepped, and the last once past the end */
+TEST(clock_replay)
+{
+    const uint64_t times[] = {1000,2000,4000};
+    log_clock_replay_t clk;
+    log_clock_replay_init(&clk,times,3);
+    CHECK(log_clock(&clk.clock) == 0);
+    CHECK(log_clock_us() == 1000);
+    CHECK(log_clock_replay_next(&clk) == 1);
+    CHECK(log_clock_us() == 2000);
+    CHECK(log_clock_replay_next(&clk) == 1);
+    CHECK(log_clock_us() == 4000);
+    CHECK(log_clock_replay_next(&clk) == 0);
+    CHECK(log_clock_us() == 4000);
+
+    log_clock_replay_init(&clk,times,0);
+    CHECK(log_clock_us() == 0);
+    CHECK(log_clock_replay_next(&clk) == 0);
+    CHECK(log_clock(nullptr) == 0);
+}
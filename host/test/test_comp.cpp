@@ -0,0 +1,192 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the lossy compressor in src/log_comp.c against the bound pal/log.h gives,
+ * every pushed value reconstructed from the kept points to within the tolerance
+ */
+
+#include "test.hpp"
+
+extern "C"
+{
+#include "log_internal.h"
+}
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct Sample
+{
+    uint32_t t;
+    double v;
+};
+
+/* Run a series through the compressor, returning the kept points */
+std::vector<log_comp_point_t> compress(const std::vector<Sample>& in, uint8_t mode, double tol)
+{
+    log_comp_state_t c;
+    log_comp_reset(&c,mode,tol);
+    std::vector<log_comp_point_t> kept;
+    log_comp_point_t out[2];
+    for(const Sample& s : in)
+    {
+        int n = log_comp_push(&c,s.t,s.v,out);
+        kept.insert(kept.end(),out,out + n);
+    }
+    int n = log_comp_finish(&c,out);
+    kept.insert(kept.end(),out,out + n);
+    return kept;
+}
+
+/* Value at t reconstructed as a reader does, holding for DEADBAND or interpolating for SDT */
+double reconstruct(const std::vector<log_comp_point_t>& kept, uint8_t mode, uint32_t t)
+{
+    size_t i = 0;
+    while(i + 1 < kept.size() && kept[i + 1].time_ms <= t) i++;
+    const log_comp_point_t& a = kept[i];
+    if(mode == LOG_COMP_DEADBAND || i + 1 >= kept.size() || a.time_ms == t) return a.value;
+    const log_comp_point_t& b = kept[i + 1];
+    return a.value + (b.value - a.value) * (double)(t - a.time_ms) / (double)(b.time_ms - a.time_ms);
+}
+
+/* Largest reconstruction error over the series */
+double max_error(const std::vector<Sample>& in, uint8_t mode, double tol, size_t * nkept)
+{
+    std::vector<log_comp_point_t> kept = compress(in,mode,tol);
+    *nkept = kept.size();
+    CHECK(!kept.empty());
+    CHECK(kept.front().time_ms == in.front().t);
+    CHECK(kept.back().time_ms == in.back().t);
+    double err = 0.0;
+    for(const Sample& s : in)
+    {
+        err = std::fmax(err,std::fabs(reconstruct(kept,mode,s.t) - s.v));
+    }
+    return err;
+}
+
+/* Series shaped like the slow channels the compressor is for, at the 10 ms log rate */
+std::vector<Sample> random_walk(unsigned seed, size_t n)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> step(0.0,0.3);
+    std::vector<Sample> s;
+    double v = 0.0;
+    for(size_t i = 0; i < n; i++)
+    {
+        v += step(rng);
+        s.push_back({static_cast<uint32_t>(i * 10),v});
+    }
+    return s;
+}
+
+std::vector<Sample> noisy_sine(unsigned seed, size_t n)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0,0.2);
+    std::vector<Sample> s;
+    for(size_t i = 0; i < n; i++)
+    {
+        double t = i * 0.01;
+        s.push_back({static_cast<uint32_t>(i * 10),5.0 * std::sin(t) + noise(rng)});
+    }
+    return s;
+}
+
+/* A battery sagging in steps under load, with jittered sample times */
+std::vector<Sample> steps(unsigned seed, size_t n)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> jitter(5,15);
+    std::uniform_real_distribution<double> noise(-0.05,0.05);
+    std::vector<Sample> s;
+    uint32_t t = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        double v = 12.6 - 0.5 * static_cast<double>((i / 200) % 4) - 0.0005 * i;
+        s.push_back({t,v + noise(rng)});
+        t += jitter(rng);
+    }
+    return s;
+}
+
+void check_bound(uint8_t mode)
+{
+    const double tols[] = {0.05,0.5,1.0,3.0};
+    for(unsigned seed = 1; seed <= 20; seed++)
+    {
+        for(double tol : tols)
+        {
+            for(const std::vector<Sample>& in : {random_walk(seed,3000),noisy_sine(seed,3000),steps(seed,3000)})
+            {
+                size_t nkept;
+                double err = max_error(in,mode,tol,&nkept);
+                CHECK_NEAR(err,0.0,tol * (1 + 1e-9));
+                CHECK(nkept <= in.size());
+            }
+        }
+    }
+}
+
+} /* namespace */
+
+TEST(comp_deadband_bound)
+{
+    check_bound(LOG_COMP_DEADBAND);
+}
+
+TEST(comp_sdt_bound)
+{
+    check_bound(LOG_COMP_SDT);
+}
+
+/* A line is kept as its two ends, and a long one also every COMP_MAX_MS */
+TEST(comp_sdt_line)
+{
+    std::vector<Sample> in;
+    for(uint32_t i = 0; i < 1000; i++) in.push_back({i * 10,1.0 + 0.25 * i});
+    size_t nkept;
+    CHECK_NEAR(max_error(in,LOG_COMP_SDT,0.01,&nkept),0.0,0.01);
+    CHECK(nkept <= 4);
+}
+
+/* Both modes drop most values of a slow channel */
+TEST(comp_ratio)
+{
+    for(uint8_t mode : {LOG_COMP_DEADBAND,LOG_COMP_SDT})
+    {
+        size_t nkept;
+        std::vector<Sample> in = steps(7,3000);
+        max_error(in,mode,0.2,&nkept);
+        CHECK(nkept < in.size() / 10);
+    }
+}
+
+/* Values which can't be interpolated are kept, and the series around them still holds */
+TEST(comp_non_finite)
+{
+    std::vector<Sample> in = noisy_sine(3,300);
+    in[100].v = INFINITY;
+    in[101].v = INFINITY;
+    in[200].v = NAN;
+    for(uint8_t mode : {LOG_COMP_DEADBAND,LOG_COMP_SDT})
+    {
+        std::vector<log_comp_point_t> kept = compress(in,mode,0.5);
+        bool inf = false, nan = false;
+        for(const log_comp_point_t& p : kept)
+        {
+            inf |= (p.time_ms == in[100].t && std::isinf(p.value));
+            nan |= (p.time_ms == in[200].t && std::isnan(p.value));
+        }
+        CHECK(inf);
+        CHECK(nan);
+    }
+}
@@ -0,0 +1,156 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the CSV loader, whose SWAR field parser must give what strtod gives */
+
+#include "test.hpp"
+#include "csv.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/* Same double, bit for bit, or both NaN */
+bool same(double a, double b)
+{
+    if(std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+    return !memcmp(&a,&b,sizeof(a));
+}
+
+double field(const std::string& s)
+{
+    return pal::parse_field(s.data(),s.data() + s.size());
+}
+
+void check_strtod(const std::string& s)
+{
+    double want = strtod(s.c_str(),nullptr);
+    double got = field(s);
+    if(!same(got,want))
+    {
+        char msg[160];
+        snprintf(msg,sizeof(msg),"\"%s\" parsed as %.17g, strtod gives %.17g",s.c_str(),got,want);
+        pal::test::fail(__FILE__,__LINE__,msg);
+    }
+}
+
+/* Text of a double in one of the ways the logger or a hand-edited file writes it */
+std::string format(double v, int how)
+{
+    static const char * formats[] = {"%f","%.3f","%.9f","%.17g","%g","%e","%.0f","%.15f"};
+    char buf[64];
+    snprintf(buf,sizeof(buf),formats[how % 8],v);
+    return buf;
+}
+
+} /* namespace */
+
+/* Every format of random values, over the magnitudes a robot logs and beyond */
+TEST(csv_field_matches_strtod)
+{
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> mant(-1.0,1.0);
+    std::uniform_int_distribution<int> exp(-12,18);
+    for(int i = 0; i < 200000; i++)
+    {
+        double v = mant(rng) * std::pow(10.0,exp(rng));
+        check_strtod(format(v,i));
+    }
+}
+
+/* Digit strings at the edges of the fast path, 8-digit SWAR blocks and 2^53 */
+TEST(csv_field_edges)
+{
+    std::mt19937_64 rng(2);
+    std::uniform_int_distribution<int> digit('0','9');
+    for(int idig = 0; idig <= 24; idig++)
+    {
+        for(int fdig = 0; fdig <= 24; fdig++)
+        {
+            for(int k = 0; k < 20; k++)
+            {
+                std::string s;
+                if(k & 1) s += '-';
+                for(int d = 0; d < idig; d++) s += static_cast<char>(digit(rng));
+                if(fdig || (k & 2)) s += '.';
+                for(int d = 0; d < fdig; d++) s += static_cast<char>(digit(rng));
+                if(idig + fdig) check_strtod(s);
+            }
+        }
+    }
+    const char * edges[] =
+    {
+        "9007199254740992","9007199254740993","9007199254740991.5","900719925474099.3",
+        "18446744073709551615","18446744073709551616","0.0000000000000000000001",
+        "1e22","1e23","-0","-0.0","+5",".5","5.","-.5","00000000012.50000000",
+        "0.1","0.2","0.3","2.2250738585072014e-308","1.7976931348623157e308","4.9e-324",
+        "12345678","123456789","12345678.12345678","99999999.99999999",
+    };
+    for(const char * s : edges) check_strtod(s);
+}
+
+/* Words PROS prints for sensors which are not ready, and empty fields */
+TEST(csv_field_special)
+{
+    CHECK(std::isinf(field("inf")) && field("inf") > 0);
+    CHECK(std::isinf(field("-inf")) && field("-inf") < 0);
+    CHECK(std::isinf(field("Infinity")));
+    CHECK(std::isnan(field("nan")));
+    CHECK(std::isnan(field("-nan")));
+    CHECK(std::isnan(field("")));
+    CHECK(std::isnan(field("   ")));
+    CHECK(std::isnan(field("x")));
+    CHECK(same(field(" 1.5 "),1.5));
+    CHECK(same(field("2.25\r"),2.25));
+}
+
+/* A file split across threads loads the same as one parsed by strtod */
+TEST(csv_parse_threads)
+{
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> val(-5000.0,5000.0);
+    const size_t ncols = 7, nrows = 20000;
+    std::string text = "TIME,a,b,c,d,e,f\n";
+    std::vector<std::vector<std::string>> fields(ncols);
+    for(size_t r = 0; r < nrows; r++)
+    {
+        for(size_t c = 0; c < ncols; c++)
+        {
+            std::string f;
+            if(c == 0) f = format(r * 0.01,1);
+            else if((r + c) % 97 == 0) f = "";
+            else if((r + c) % 89 == 0) f = "inf";
+            else f = format(val(rng),static_cast<int>(r + c));
+            text += (c ? "," : "") + f;
+            fields[c].push_back(f);
+        }
+        text += (r % 3) ? "\n" : "\r\n";
+    }
+    for(unsigned threads : {1u,4u,13u})
+    {
+        pal::CsvLog log = pal::parse_csv(text.data(),text.size(),threads);
+        CHECK(log.names.size() == ncols);
+        CHECK(log.find("d") == 4);
+        CHECK(log.rows() == nrows);
+        for(size_t c = 0; c < ncols; c++)
+        {
+            for(size_t r = 0; r < nrows; r++)
+            {
+                const std::string& f = fields[c][r];
+                double want = f.empty() ? NAN : strtod(f.c_str(),nullptr);
+                CHECK(same(log.cols[c][r],want));
+            }
+        }
+    }
+}
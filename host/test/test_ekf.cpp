@@ -0,0 +1,229 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the pose estimator in include/pal/ekf.hpp, and of pallog ekf replaying
+ * it over a synthetic trace of a robot driving a circle with noisy sensors
+ */
+
+#include "test.hpp"
+#include "table.hpp"
+#include "estimate.hpp"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/* The circle: 0.5 m/s forward turning at 0.4 rad/s, from the origin facing +x */
+const double V = 0.5;
+const double W = 0.4;
+const double ROW_DT = 0.01;
+const size_t ROWS = 3000;
+
+double true_x(double t) { return V / W * std::sin(W * t); }
+double true_y(double t) { return V / W * (1.0 - std::cos(W * t)); }
+double true_theta(double t) { return pal::ekf_wrap(W * t); }
+
+/* Rows every 10 ms as the poller logs them: the GPS, which reads every 50 ms with
+ * 2 cm and 1 degree of noise and has no fix for the first 100 ms, the IMU's gyro,
+ * and the drive's wheel speeds in rpm
+ */
+std::unique_ptr<pal::RowSource> circle(const pal::EkfReplay& opt)
+{
+    std::mt19937 rng(47);
+    std::normal_distribution<double> noise(0.0,1.0);
+    std::vector<std::vector<double>> d(8,std::vector<double>(ROWS));
+    double gx = NaN, gy = NaN, gh = NaN;
+    for(size_t r = 0; r < ROWS; r++)
+    {
+        double t = r * ROW_DT;
+        if(r >= 10 && r % 5 == 0)
+        {
+            gx = true_x(t) + 0.02 * noise(rng);
+            gy = true_y(t) + 0.02 * noise(rng);
+            gh = 90.0 - true_theta(t) * 180.0 / M_PI + noise(rng);
+        }
+        double side = W * opt.track / 2.0;
+        d[0][r] = t;
+        d[1][r] = gx;
+        d[2][r] = gy;
+        d[3][r] = gh;
+        d[4][r] = 0.02;
+        d[5][r] = -W * 180.0 / M_PI + 0.5 * noise(rng);
+        d[6][r] = (V - side) / opt.mps_per_rpm + 2.0 * noise(rng);
+        d[7][r] = (V + side) / opt.mps_per_rpm + 2.0 * noise(rng);
+    }
+    return std::unique_ptr<pal::RowSource>(new pal::test::Table(
+        {"time","gps_x","gps_y","gps_hdg","gps_error","imu_gyro_z","left_vel","right_vel"},d));
+}
+
+/* Column of a replay's output by name */
+size_t column(const pal::RowSource& src, const std::string& name)
+{
+    for(size_t c = 0; c < src.columns().size(); c++)
+    {
+        if(src.columns()[c].name == name) return c;
+    }
+    pal::test::fail(__FILE__,__LINE__,"no column " + name);
+}
+
+} /* namespace */
+
+/* Angles as the V5 sensors give them, and wrapping */
+TEST(ekf_angles)
+{
+    CHECK_NEAR(pal::ekf_compass_theta(0.0),M_PI / 2.0,1e-15);
+    CHECK_NEAR(pal::ekf_compass_theta(90.0),0.0,1e-15);
+    CHECK_NEAR(pal::ekf_compass_theta(180.0),-M_PI / 2.0,1e-15);
+    CHECK_NEAR(pal::ekf_compass_theta(270.0),-M_PI,1e-15);
+    CHECK_NEAR(pal::ekf_compass_rate(90.0),-M_PI / 2.0,1e-15);
+    CHECK_NEAR(pal::ekf_wrap(1.5 * M_PI),-0.5 * M_PI,1e-15);
+    CHECK_NEAR(pal::ekf_wrap(-1.5 * M_PI),0.5 * M_PI,1e-15);
+    CHECK(pal::ekf_wrap(M_PI) == -M_PI);
+    CHECK(pal::ekf_wrap(0.25) == 0.25);
+}
+
+/* Held still and read by the GPS somewhere else, the estimate moves there, the
+ * shorter way round for the heading, and grows more certain as it does
+ */
+TEST(ekf_static_gps)
+{
+    pal::Ekf ekf;
+    ekf.reset(1.0,2.0,3.0);
+    CHECK(ekf[pal::EKF_X] == 1.0 && ekf[pal::EKF_THETA] == 3.0);
+    double p0 = ekf.covariance().m[pal::EKF_X][pal::EKF_X];
+    CHECK_NEAR(p0,0.05 * 0.05,1e-15);
+
+    for(int i = 0; i < 200; i++)
+    {
+        ekf.predict();
+        CHECK(std::isnan(ekf.innovation(pal::EKF_NU_GPS_X)));
+        CHECK(ekf.update_gps(1.1,1.9,-3.1));
+        if(i == 0)
+        {
+            /* The heading is 0.18 rad away across the wrap, not 6.1 */
+            CHECK_NEAR(ekf.innovation(pal::EKF_NU_GPS_THETA),2.0 * M_PI - 6.1,1e-12);
+            CHECK_NEAR(ekf.innovation(pal::EKF_NU_GPS_X),0.1,1e-12);
+        }
+    }
+    CHECK_NEAR(ekf[pal::EKF_X],1.1,1e-3);
+    CHECK_NEAR(ekf[pal::EKF_Y],1.9,1e-3);
+    CHECK_NEAR(ekf[pal::EKF_THETA],-3.1,1e-3);
+    CHECK(ekf.covariance().m[pal::EKF_X][pal::EKF_X] < p0 / 10.0);
+
+    /* Readings that aren't finite are skipped, a heading that isn't updates position */
+    CHECK(!ekf.update_gps(NaN,1.9,0.0));
+    CHECK(!ekf.update_gyro(NaN));
+    ekf.predict();
+    CHECK(ekf.update_gps(1.1,1.9,NaN));
+    CHECK(std::isnan(ekf.innovation(pal::EKF_NU_GPS_THETA)));
+}
+
+/* Told only its speed and turn rate, the estimate drives the arc they give */
+TEST(ekf_dead_reckoning)
+{
+    pal::EkfParams p;
+    p.q[pal::EKF_AF] = p.q[pal::EKF_AN] = p.q[pal::EKF_ALPHA] = 0.0;
+    p.p0[pal::EKF_AF] = p.p0[pal::EKF_AN] = p.p0[pal::EKF_ALPHA] = 0.0;
+    p.r_odom_v = p.r_odom_w = 1e-12;
+    pal::Ekf ekf(p);
+    ekf.reset(0.0,0.0,0.0);
+    ekf.update_odometry(V,W);
+    CHECK_NEAR(ekf[pal::EKF_VF],V,1e-6);
+    CHECK_NEAR(ekf[pal::EKF_OMEGA],W,1e-6);
+    for(int i = 0; i < 1000; i++)
+    {
+        ekf.predict(0.001);
+        ekf.update_odometry(V,W);
+    }
+    CHECK_NEAR(ekf[pal::EKF_X],true_x(1.0),1e-3);
+    CHECK_NEAR(ekf[pal::EKF_Y],true_y(1.0),1e-3);
+    CHECK_NEAR(ekf[pal::EKF_THETA],W,1e-6);
+}
+
+/* Replayed over the circle, the estimate starts at the first fix, settles within
+ * a few seconds, and then tracks the true pose closer than the GPS reads it
+ */
+TEST(ekf_circle)
+{
+    pal::EkfReplay opt;
+    auto out = pal::replay_ekf(circle(opt),opt);
+    CHECK(out->rows() == ROWS && out->columns().size() == 8 + pal::EKF_STATES + pal::EKF_INNOVATIONS);
+    auto d = pal::test::read_all(*out,256);
+    size_t ex = column(*out,"ekf_x"), ey = column(*out,"ekf_y"), eth = column(*out,"ekf_theta");
+    size_t evf = column(*out,"ekf_vf"), ew = column(*out,"ekf_omega"), nu = column(*out,"ekf_nu_gps_x");
+
+    CHECK(std::isnan(d[ex][9]) && d[ex][10] == d[1][10] && d[ey][10] == d[2][10]);
+
+    double est2 = 0.0, gps2 = 0.0, th2 = 0.0, nu_sum = 0.0;
+    size_t n = 0, fixes = 0;
+    for(size_t r = 500; r < ROWS; r++)
+    {
+        double t = d[0][r];
+        double ex2 = std::pow(d[ex][r] - true_x(t),2) + std::pow(d[ey][r] - true_y(t),2);
+        est2 += ex2;
+        gps2 += std::pow(d[1][r] - true_x(t),2) + std::pow(d[2][r] - true_y(t),2);
+        th2 += std::pow(pal::ekf_wrap(d[eth][r] - true_theta(t)),2);
+        CHECK(ex2 < 0.05 * 0.05);
+        CHECK_NEAR(d[evf][r],V,0.05);
+        CHECK_NEAR(d[ew][r],W,0.05);
+        if(std::isfinite(d[nu][r]))
+        {
+            nu_sum += d[nu][r];
+            fixes++;
+        }
+        n++;
+    }
+    double est_rms = std::sqrt(est2 / n), gps_rms = std::sqrt(gps2 / n);
+    CHECK(est_rms < 0.015 && est_rms < 0.7 * gps_rms);
+    CHECK(std::sqrt(th2 / n) < 0.5 * M_PI / 180.0);
+    CHECK(fixes == (ROWS - 500) / 5);
+    CHECK_NEAR(nu_sum / fixes,0.0,0.005);
+}
+
+/* With all but one GPS reading in five held out, the estimate still predicts the
+ * ones it didn't see, and is updated by none of them
+ */
+TEST(ekf_held_out)
+{
+    pal::EkfReplay opt;
+    opt.gps_every = 5;
+    auto src = circle(opt);
+    pal::EkfColumns cols(src->columns());
+    CHECK(cols.has_gps());
+    auto d = pal::test::read_all(*src);
+    std::vector<double> block(d.size());
+
+    pal::EkfReplayer rep(opt);
+    size_t held = 0, used = 0, scored = 0;
+    double miss2 = 0.0;
+    for(size_t r = 0; r < ROWS; r++)
+    {
+        for(size_t c = 0; c < d.size(); c++) block[c] = d[c][r];
+        rep.step(cols.row(block.data(),1,0));
+        bool updated = std::isfinite(rep.filter().innovation(pal::EKF_NU_GPS_X));
+        CHECK(!(updated && rep.held_out()));
+        used += updated;
+        held += rep.held_out();
+        if(rep.held_out() && r >= 500)
+        {
+            miss2 += std::pow(rep.filter()[pal::EKF_X] - d[1][r],2) + std::pow(rep.filter()[pal::EKF_Y] - d[2][r],2);
+            scored++;
+        }
+    }
+
+    /* 598 readings: the first starts the filter, then every fifth of the rest is used */
+    CHECK(used == 119 && held == 478);
+    /* The readings themselves are 2.8 cm out, so most of the miss is theirs */
+    CHECK(std::sqrt(miss2 / scored) < 2.0 * std::sqrt(2.0) * 0.02);
+}
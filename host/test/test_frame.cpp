@@ -0,0 +1,336 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the COBS telemetry frames, written by src/log_frame.c on the robot and
+ * taken apart by the host's decoder, and the host's encoder which must match it
+ */
+
+#include "test.hpp"
+#include "telemetry.hpp"
+#include "tty.hpp"
+
+extern "C"
+{
+#include "log_internal.h"
+}
+
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+/* Bodies which exercise COBS: empty, all zero, no zeros across the 254-byte block
+ * length, and random with zeros
+ */
+std::vector<std::vector<uint8_t>> bodies()
+{
+    std::vector<std::vector<uint8_t>> all;
+    std::mt19937 rng(4);
+    for(size_t n : {0,1,2,252,253,254,255,256,507,508,509,1000})
+    {
+        all.push_back(std::vector<uint8_t>(n,0));
+        all.push_back(std::vector<uint8_t>(n,0x5a));
+        std::vector<uint8_t> r(n);
+        for(uint8_t& b : r) b = static_cast<uint8_t>(rng() % 4 ? rng() : 0);
+        all.push_back(r);
+    }
+    return all;
+}
+
+/* Robot encoding of a header and body, zero terminator included */
+std::vector<uint8_t> robot_pack(const uint32_t& head, const std::vector<uint8_t>& body)
+{
+    std::vector<uint8_t> out(sizeof(head) + body.size() + body.size() / 254 + 8);
+    out.resize(log_frame_pack(&head,sizeof(head),body.data(),body.size(),out.data()));
+    return out;
+}
+
+/* A record of a session as the robot's sinks see it, see session() */
+struct Rec
+{
+    log_sink_rec_t rec;
+    std::vector<uint8_t> payload;
+};
+
+/* A session of records, opening files, writing messages and data rows of every
+ * length up to a few COBS blocks, some with zeros, then flushing and closing them
+ */
+std::vector<Rec> session()
+{
+    static const char * const files[] = {"../src/main.cpp","../src/log_poll.c"};
+    std::vector<Rec> all;
+    std::mt19937 rng(11);
+    auto add = [&](log_sink_type_t type, std::vector<uint8_t> payload)
+    {
+        Rec r = {};
+        r.rec.seq = static_cast<uint32_t>(all.size());
+        r.rec.time_ms = 5000 + 20 * static_cast<uint32_t>(all.size());
+        r.rec.type = type;
+        r.rec.len = static_cast<uint16_t>(payload.size());
+        r.payload = std::move(payload);
+        all.push_back(r);
+    };
+
+    log_sink_open_t open = {7,5,1};
+    const uint8_t * o = reinterpret_cast<const uint8_t *>(&open);
+    add(LOG_SINK_OPEN,std::vector<uint8_t>(o,o + sizeof(open)));
+    for(int i = 0; i < 60; i++)
+    {
+        if(i % 3)
+        {
+            std::vector<uint8_t> row(1 + rng() % 600);
+            for(uint8_t& b : row) b = static_cast<uint8_t>(rng() % 5 ? rng() : 0);
+            add(LOG_SINK_DATA,row);
+        }
+        else
+        {
+            std::string text = "step " + std::to_string(i) + std::string(rng() % 300,'x');
+            add(LOG_SINK_MSG,std::vector<uint8_t>(text.begin(),text.end()));
+            all.back().rec.file = files[i % 2];
+            all.back().rec.line = 100 + i;
+            all.back().rec.level = static_cast<log_level_t>(i % 5);
+        }
+    }
+    add(LOG_SINK_FLUSH,{});
+    add(LOG_SINK_CLOSE,{});
+    return all;
+}
+
+/* Frames of a session as the robot's stream sink encodes them */
+std::vector<std::vector<uint8_t>> encode(const std::vector<Rec>& recs)
+{
+    std::vector<std::vector<uint8_t>> all;
+    for(const Rec& r : recs)
+    {
+        std::vector<uint8_t> f(2 * LOG_FRAME_MAX);
+        f.resize(log_frame_encode(&r.rec,r.payload.data(),r.rec.seq,0,f.data()));
+        all.push_back(f);
+    }
+    return all;
+}
+
+/* The text and data files the uSD card has after a session, less the records in skip */
+std::pair<std::string,std::string> card_files(const std::vector<Rec>& recs, const std::vector<uint32_t>& skip)
+{
+    static const char * const names[] = {"DEBUG","INFO","WARN","ERROR","ALWAYS"};
+    std::string text, data;
+    for(const Rec& r : recs)
+    {
+        bool skipped = false;
+        for(uint32_t s : skip) skipped |= (s == r.rec.seq);
+        if(skipped) continue;
+        if(r.rec.type == LOG_SINK_MSG)
+        {
+            char line[1024];
+            snprintf(line,sizeof(line),"\n%08.3f [%s] in %s line %d: %.*s",r.rec.time_ms / 1000.0,
+                names[r.rec.level],r.rec.file,r.rec.line,static_cast<int>(r.payload.size()),
+                reinterpret_cast<const char *>(r.payload.data()));
+            text += line;
+        }
+        else if(r.rec.type == LOG_SINK_DATA)
+        {
+            data.append(r.payload.begin(),r.payload.end());
+        }
+    }
+    return {text,data};
+}
+
+/* Send bytes through a pty, as a serial link to the robot, rebuilding the files
+ * from what comes out of the other side in dir
+ */
+pal::TelemetryStats rebuild(const std::vector<uint8_t>& link, const std::string& dir)
+{
+    int slave;
+    std::string name;
+    int master = pal::tty_pty(slave,name);
+    std::thread robot([&]
+    {
+        for(size_t at = 0; at < link.size(); at += 100)
+        {
+            size_t n = std::min<size_t>(100,link.size() - at);
+            if(write(master,&link[at],n) != static_cast<ssize_t>(n)) break;
+        }
+    });
+
+    pal::TelemetryWriter writer(dir);
+    pal::TelemetryDecoder dec(false,[&](const pal::TelemetryFrame& f) { writer.write(f); });
+    size_t got = 0;
+    while(got < link.size())
+    {
+        pollfd p = {slave,POLLIN,0};
+        if(poll(&p,1,2000) <= 0) break;
+        uint8_t buf[333];
+        ssize_t n = read(slave,buf,sizeof(buf));
+        if(n <= 0) break;
+        dec.feed(buf,n);
+        got += n;
+    }
+    robot.join();
+    close(master);
+    close(slave);
+    CHECK(got == link.size());
+    return dec.stats();
+}
+
+} /* namespace */
+
+/* The robot and host encoders agree, and each decoder takes the frame apart */
+TEST(frame_pack_round_trip)
+{
+    uint32_t head = 0x00c0ffee;
+    for(const std::vector<uint8_t>& body : bodies())
+    {
+        std::vector<uint8_t> frame = robot_pack(head,body);
+        CHECK(frame == pal::pack_frame(&head,sizeof(head),body.data(),body.size()));
+        CHECK(frame.back() == 0);
+        CHECK(memchr(frame.data(),0,frame.size() - 1) == nullptr);
+
+        std::vector<uint8_t> raw(frame.begin(),frame.end() - 1);
+        size_t n = log_frame_unpack(raw.data(),raw.size());
+        CHECK(n == sizeof(head) + body.size());
+        CHECK(!memcmp(raw.data(),&head,sizeof(head)));
+        CHECK(!memcmp(raw.data() + sizeof(head),body.data(),body.size()));
+
+        /* The host's COBS decoder gives the header, body and their CRC */
+        std::vector<uint8_t> dec = pal::cobs_decode(frame.data(),frame.size() - 1);
+        CHECK(dec.size() == sizeof(head) + body.size() + sizeof(uint16_t));
+        uint16_t crc;
+        memcpy(&crc,&dec[dec.size() - sizeof(crc)],sizeof(crc));
+        CHECK(crc == pal::crc16(dec.data(),dec.size() - sizeof(crc)));
+    }
+}
+
+/* A damaged frame is refused, and the splitter picks up at the next one */
+TEST(frame_damage)
+{
+    uint32_t head = 7;
+    std::vector<uint8_t> body(300);
+    for(size_t i = 0; i < body.size(); i++) body[i] = static_cast<uint8_t>(i * 31);
+    std::vector<uint8_t> good = robot_pack(head,body);
+    for(size_t i = 0; i + 1 < good.size(); i += 17)
+    {
+        std::vector<uint8_t> bad(good.begin(),good.end() - 1);
+        bad[i] ^= (bad[i] == 1) ? 2 : 1;
+        CHECK(log_frame_unpack(bad.data(),bad.size()) == 0);
+    }
+
+    std::vector<uint8_t> stream = good;
+    std::vector<uint8_t> bad = good;
+    bad[bad.size() / 2] ^= 0x40;
+    if(!bad[bad.size() / 2]) bad[bad.size() / 2] = 0x40;
+    stream.insert(stream.end(),bad.begin(),bad.end());
+    stream.insert(stream.end(),good.begin(),good.end());
+
+    /* Fed a byte at a time, as a serial link delivers it */
+    size_t frames = 0;
+    pal::FrameSplitter split([&](const std::vector<uint8_t>& f)
+    {
+        CHECK(f.size() == sizeof(head) + body.size());
+        CHECK(!memcmp(f.data() + sizeof(head),body.data(),body.size()));
+        frames++;
+    });
+    uint8_t sync = 0;
+    split.feed(&sync,1);
+    for(uint8_t b : stream) split.feed(&b,1);
+    CHECK(frames == 2);
+    CHECK(split.bad() == 1);
+}
+
+/* Records encoded on the robot come out of the host's decoder with every field */
+TEST(frame_records)
+{
+    const char * text = "Battery low";
+    log_sink_rec_t msg = {};
+    msg.seq = 41;
+    msg.time_ms = 123456;
+    msg.file = "../src/main.cpp";
+    msg.line = 296;
+    msg.type = LOG_SINK_MSG;
+    msg.level = LOG_LEVEL_WARN;
+    msg.len = static_cast<uint16_t>(strlen(text));
+
+    uint8_t data[40];
+    for(size_t i = 0; i < sizeof(data); i++) data[i] = static_cast<uint8_t>(i % 3);
+    log_sink_rec_t row = {};
+    row.time_ms = 123460;
+    row.type = LOG_SINK_DATA;
+    row.len = sizeof(data);
+
+    std::vector<uint8_t> link(2 * LOG_FRAME_MAX);
+    size_t n = log_frame_encode(&msg,text,10,3,link.data());
+    pal::TelemetryFrame want;
+    want.wire = {10,3,123456,LOG_SINK_MSG,LOG_LEVEL_WARN,296};
+    want.file = "../src/main.cpp";
+    want.payload.assign(text,text + strlen(text));
+    CHECK(pal::encode_frame(want) == std::vector<uint8_t>(link.begin(),link.begin() + n));
+    n += log_frame_encode(&row,data,12,5,&link[n]);
+    link.resize(n);
+
+    std::vector<pal::TelemetryFrame> got;
+    pal::TelemetryDecoder dec(false,[&](const pal::TelemetryFrame& f) { got.push_back(f); });
+    uint8_t sync = 0;
+    dec.feed(&sync,1);
+    dec.feed(link.data(),link.size());
+    CHECK(got.size() == 2);
+    CHECK(got[0].wire.seq == 10 && got[0].wire.time_ms == 123456 && got[0].wire.line == 296);
+    CHECK(got[0].wire.type == LOG_SINK_MSG && got[0].wire.level == LOG_LEVEL_WARN);
+    CHECK(got[0].file == "../src/main.cpp");
+    CHECK(std::string(got[0].payload.begin(),got[0].payload.end()) == text);
+    CHECK(got[1].wire.type == LOG_SINK_DATA && got[1].wire.time_ms == 123460);
+    CHECK(got[1].payload == std::vector<uint8_t>(data,data + sizeof(data)));
+
+    pal::TelemetryStats st = dec.stats();
+    CHECK(st.frames == 2 && st.bad == 0);
+    CHECK(st.lost == 1 && st.dropped == 5);
+}
+
+/* A session sent through a pty comes out as the files the uSD card has, byte for
+ * byte, and damaged on the way the records lost are all that is missing
+ */
+TEST(frame_pty_files)
+{
+    std::vector<Rec> recs = session();
+    std::vector<std::vector<uint8_t>> frames = encode(recs);
+
+    std::vector<uint8_t> link(1,0);
+    for(const std::vector<uint8_t>& f : frames) link.insert(link.end(),f.begin(),f.end());
+    pal::test::TempDir clean;
+    pal::TelemetryStats st = rebuild(link,clean.path);
+    CHECK(st.frames == recs.size() && st.bad == 0 && st.lost == 0);
+    std::pair<std::string,std::string> want = card_files(recs,{});
+    CHECK(pal::test::read_file(clean.path + "/log00007.txt") == want.first);
+    CHECK(pal::test::read_file(clean.path + "/dat00007.bin") == want.second);
+
+    /* Joined part way through a frame, then a byte of 10 flipped, failing its CRC,
+     * 21 lost whole, 30 cut short so it runs into 31, failing both, and junk which
+     * isn't COBS before 41. Each time the decoder picks up at the next zero
+     */
+    link.assign(frames[5].begin() + frames[5].size() / 2,frames[5].end());
+    for(uint32_t i = 0; i < frames.size(); i++)
+    {
+        std::vector<uint8_t> f = frames[i];
+        if(i == 10) f[f.size() / 2] = (f[f.size() / 2] == 0x40) ? 0x41 : 0x40;
+        if(i == 21) continue;
+        if(i == 30) f.resize(f.size() / 2);
+        if(i == 41) link.insert(link.end(),{0x09,0x11,0x22,0});
+        link.insert(link.end(),f.begin(),f.end());
+    }
+    pal::test::TempDir damaged;
+    st = rebuild(link,damaged.path);
+    CHECK(st.bad == 3);
+    CHECK(st.lost == 4);
+    CHECK(st.frames == recs.size() - 4);
+    want = card_files(recs,{10,21,30,31});
+    CHECK(pal::test::read_file(damaged.path + "/log00007.txt") == want.first);
+    CHECK(pal::test::read_file(damaged.path + "/dat00007.bin") == want.second);
+}
@@ -0,0 +1,122 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the segment metrics pallog kpi reports, on rows laid out so each
+ * metric has an answer worked out by hand
+ */
+
+#include "test.hpp"
+#include "table.hpp"
+#include "kpi.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+using pal::test::Table;
+
+double kpi(const pal::KpiList& k, const std::string& name)
+{
+    for(const auto& m : k)
+    {
+        if(m.first == name) return m.second;
+    }
+    pal::test::fail(__FILE__,__LINE__,("no metric " + name).c_str());
+    return NaN;
+}
+
+/* 1000 rows 10 ms apart, but for steps of 30, 16 and 15 ms into rows 200, 500 and
+ * 700, and no time at row 300. Disabled for 100 rows, autonomous for 300, then
+ * driver control
+ */
+Table segment()
+{
+    std::vector<std::vector<double>> d(9,std::vector<double>(1000));
+    for(int r = 0; r < 1000; r++)
+    {
+        int ms = r * 10 + (r >= 200) * 20 + (r >= 500) * 6 + (r >= 700) * 5;
+        d[0][r] = (r == 300) ? NaN : ms / 1000.0;
+        d[1][r] = r < 100;
+        d[2][r] = r >= 100 && r < 400;
+        d[3][r] = r ? 12.0 - r * 0.001 : NaN;
+        d[4][r] = (r % 2) ? -4.0 : 3.0;
+        d[5][r] = 30.0 + r % 26;
+        d[6][r] = (r == 600) ? -2.5 : std::sin(r) * 2.0;
+        d[7][r] = 45.0;
+        d[8][r] = r;
+    }
+    return Table({"time","comp_dis","comp_auto","batt_volt","gps_error","left_temp","left_cur","batt_temp","count"},d);
+}
+
+} /* namespace */
+
+/* Each metric of a segment with gaps, a missing time and all three modes */
+TEST(kpi_known)
+{
+    Table src = segment();
+    pal::KpiList k = pal::segment_kpis(src);
+    CHECK(k.size() == 19);
+    CHECK(k[0].first == "rows" && k[17].first == "left_temp_max" && k[18].first == "left_cur_max");
+    CHECK(kpi(k,"rows") == 1000);
+    CHECK_NEAR(kpi(k,"seconds"),10.021,1e-9);
+
+    /* Row 0 has no voltage, and there is no current column */
+    CHECK_NEAR(kpi(k,"batt_volt_min"),11.001,1e-9);
+    CHECK_NEAR(kpi(k,"batt_volt_max"),11.999,1e-9);
+    CHECK_NEAR(kpi(k,"batt_volt_mean"),11.5,1e-9);
+    CHECK(std::isnan(kpi(k,"batt_cur_min")) && std::isnan(kpi(k,"batt_cur_mean")));
+
+    /* Steps of 30 ms, 16 ms and 20 ms over the missing time are overruns, 15 ms is not */
+    CHECK(kpi(k,"period_ms") == 10);
+    CHECK(kpi(k,"overruns") == 3);
+    CHECK_NEAR(kpi(k,"gap_max_ms"),30.0,1e-9);
+
+    CHECK_NEAR(kpi(k,"gps_error_mean"),-0.5,1e-12);
+    CHECK_NEAR(kpi(k,"gps_error_rms"),std::sqrt(12.5),1e-12);
+    CHECK(kpi(k,"gps_error_max") == 3.0);
+
+    /* Each step counts to the mode at its start, so the slow steps are the
+     * autonomous and driver windows'
+     */
+    CHECK_NEAR(kpi(k,"disabled_s"),1.0,1e-9);
+    CHECK_NEAR(kpi(k,"auto_s"),3.02,1e-9);
+    CHECK_NEAR(kpi(k,"driver_s"),6.001,1e-9);
+    CHECK(kpi(k,"left_temp_max") == 55.0);
+    CHECK(kpi(k,"left_cur_max") == 2.5);
+}
+
+/* A period given overrides the most common step */
+TEST(kpi_period)
+{
+    Table a = segment();
+    pal::KpiList k = pal::segment_kpis(a,20.0);
+    CHECK(kpi(k,"period_ms") == 20 && kpi(k,"overruns") == 0);
+    Table b = segment();
+    k = pal::segment_kpis(b,8.0);
+    CHECK(kpi(k,"period_ms") == 8 && kpi(k,"overruns") == 4);
+}
+
+/* With no modes, one row or none, the metrics with nothing to go on are NaN */
+TEST(kpi_empty)
+{
+    Table one({"time","batt_volt"},{{2.5},{12.0}});
+    pal::KpiList k = pal::segment_kpis(one);
+    CHECK(k.size() == 17);
+    CHECK(kpi(k,"rows") == 1 && kpi(k,"seconds") == 0.0 && kpi(k,"batt_volt_mean") == 12.0);
+    CHECK(std::isnan(kpi(k,"period_ms")) && std::isnan(kpi(k,"overruns")) && std::isnan(kpi(k,"gap_max_ms")));
+    CHECK(std::isnan(kpi(k,"disabled_s")) && std::isnan(kpi(k,"driver_s")));
+
+    Table none({"time","comp_dis"},{{},{}});
+    k = pal::segment_kpis(none);
+    CHECK(kpi(k,"rows") == 0 && std::isnan(kpi(k,"seconds")));
+    CHECK(kpi(k,"disabled_s") == 0.0 && kpi(k,"auto_s") == 0.0);
+}
@@ -0,0 +1,185 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the level-of-detail pyramid, built from rows of known values and read
+ * back through the sidecar as pallog lod-query reads it
+ */
+
+#include "test.hpp"
+#include "lod.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sys/stat.h>
+
+namespace
+{
+
+const size_t ROWS = 1000;
+
+/* Time in seconds, a ramp of the row number, and a column with a gap of NaN */
+double value(size_t c, size_t r)
+{
+    if(c == 0) return r / 100.0;
+    if(c == 1) return static_cast<double>(r);
+    if(r >= 100 && r < 300) return std::numeric_limits<double>::quiet_NaN();
+    return (r % 7) * 1.5 - 3.0;
+}
+
+class Rows : public pal::RowSource
+{
+public:
+    Rows()
+    {
+        cols = {{"time",pal::ColType::Double},{"ramp",pal::ColType::Double},{"gap",pal::ColType::Double}};
+        nrows = ROWS;
+    }
+
+    /* Short reads, so buckets span blocks */
+    size_t read(double * block, size_t max) override
+    {
+        size_t n = std::min<size_t>({max,ROWS - at,size_t(300)});
+        for(size_t c = 0; c < cols.size(); c++)
+        {
+            for(size_t r = 0; r < n; r++) block[c * max + r] = value(c,at + r);
+        }
+        at += n;
+        return n;
+    }
+
+    bool span(double& first, double& last) const override
+    {
+        first = value(0,0);
+        last = value(0,ROWS - 1);
+        return true;
+    }
+
+private:
+    size_t at = 0;
+};
+
+bool same(double a, double b)
+{
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+} /* namespace */
+
+/* Every bucket of every level holds the min, max, mean, first and last finite
+ * value of its rows, the last bucket of a level taking what is left
+ */
+TEST(lod_buckets)
+{
+    pal::test::TempDir dir;
+    Rows src;
+    std::string path = dir.path + "/dat00001.lod";
+    pal::write_lod(src,path,1234,5678);
+    pal::LodFile lod(path);
+    CHECK(lod.rows() == ROWS);
+    CHECK(lod.columns().size() == 3 && lod.find("gap") == 2 && lod.find("nope") < 0);
+    CHECK(lod.levels() == 7);
+    CHECK(lod.level(0).rows == LOD_BASE && lod.level(0).count == 63);
+    CHECK(lod.level(6).rows == 1024 && lod.level(6).count == 1);
+
+    for(size_t k = 0; k < lod.levels(); k++)
+    {
+        size_t rows = lod.level(k).rows;
+        for(int c = 0; c < 3; c++)
+        {
+            const pal::lod_bucket_t * b = lod.buckets(c,k);
+            for(size_t i = 0; i < lod.level(k).count; i++)
+            {
+                double lo = INFINITY, hi = -INFINITY, sum = 0.0, first = NAN, last = NAN;
+                size_t n = 0;
+                for(size_t r = i * rows; r < std::min(ROWS,(i + 1) * rows); r++)
+                {
+                    double v = value(c,r);
+                    if(std::isnan(v)) continue;
+                    if(!n) first = v;
+                    last = v;
+                    lo = std::fmin(lo,v);
+                    hi = std::fmax(hi,v);
+                    sum += v;
+                    n++;
+                }
+                if(!n) lo = hi = NAN;
+                CHECK(same(b[i].min,lo) && same(b[i].max,hi));
+                CHECK(same(b[i].first,first) && same(b[i].last,last));
+                if(n) CHECK_NEAR(b[i].mean,sum / n,1e-9);
+                else CHECK(std::isnan(b[i].mean));
+            }
+        }
+    }
+
+    /* By hand: the ramp's last bucket of 16, and the gap's buckets around its edge */
+    const pal::lod_bucket_t& tail = lod.buckets(1,0)[62];
+    CHECK(tail.min == 992 && tail.max == 999 && tail.mean == 995.5);
+    CHECK(std::isnan(lod.buckets(2,0)[7].min));
+    CHECK(lod.buckets(2,0)[6].last == (99 % 7) * 1.5 - 3.0);
+    CHECK(lod.buckets(2,0)[18].first == (300 % 7) * 1.5 - 3.0);
+}
+
+/* A window takes the finest level with no more buckets than pixels, or the rows
+ * themselves when there are few enough
+ */
+TEST(lod_windows)
+{
+    pal::test::TempDir dir;
+    Rows src;
+    std::string path = dir.path + "/dat00001.lod";
+    pal::write_lod(src,path,0,0);
+    pal::LodFile lod(path);
+
+    /* Rows 100 to 500 lie in buckets 6 to 31 of 16 */
+    pal::LodWindow w = lod.window(1,1.0,5.0,40);
+    CHECK(w.level == 0 && w.bucket_rows == 16 && w.count == 26);
+    CHECK(w.first_row == 96 && w.last_row == 512);
+    CHECK(w.buckets == lod.buckets(1,0) + 6);
+
+    w = lod.window(1,1.0,5.0,10);
+    CHECK(w.level == 2 && w.bucket_rows == 64 && w.count == 7);
+    CHECK(w.first_row == 64 && w.last_row == 512);
+    CHECK(w.buckets[0].min == 64 && w.buckets[6].max == 511);
+
+    w = lod.window(1,1.0,5.0,1000);
+    CHECK(w.level == -1 && w.count == 0);
+    CHECK(w.first_row == 96 && w.last_row == 512);
+
+    /* All of it in one pixel, and past the end */
+    w = lod.window(1,-1.0,100.0,1);
+    CHECK(w.level == 6 && w.count == 1 && w.last_row == ROWS);
+    CHECK(w.buckets[0].min == 0 && w.buckets[0].max == 999);
+    w = lod.window(1,20.0,30.0,10);
+    CHECK(w.level == -1 && w.first_row == ROWS && w.last_row == ROWS);
+    CHECK(lod.window(3,0.0,1.0,10).level == -1);
+}
+
+/* The sidecar knows the data file it was built from */
+TEST(lod_stale)
+{
+    pal::test::TempDir dir;
+    std::string data = dir.path + "/dat00001.csv";
+    FILE * f = fopen(data.c_str(),"w");
+    CHECK(f);
+    fputs("time\n0\n",f);
+    fclose(f);
+    struct stat st;
+    CHECK(stat(data.c_str(),&st) == 0);
+
+    Rows src;
+    std::string path = pal::lod_path(data);
+    CHECK(path == dir.path + "/dat00001.lod");
+    pal::write_lod(src,path,st.st_size,st.st_mtime);
+    pal::LodFile lod(path);
+    CHECK(!lod.stale(data));
+    f = fopen(data.c_str(),"a");
+    fputs("1\n",f);
+    fclose(f);
+    CHECK(lod.stale(data));
+    CHECK(lod.stale(dir.path + "/missing.csv"));
+}
@@ -0,0 +1,214 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of pallog resample: each method's value at every grid time, worked out
+ * from channels that are lines in time, and the grid itself
+ */
+
+#include "test.hpp"
+#include "table.hpp"
+#include "resample.hpp"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using pal::test::Table;
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/* 100 rows 10 ms apart from 4 ms, x = 2t + 1 with row 50's missing, and an
+ * encoder sampled every 50 ms from 3 ms counting up by 10, with its sample time
+ * in enc_t as a binary log gives it, repeated on the rows between
+ */
+std::unique_ptr<pal::RowSource> first_segment()
+{
+    std::vector<std::vector<double>> d(4);
+    for(int r = 0; r < 100; r++)
+    {
+        double t = 0.004 + 0.01 * r;
+        int j = (r * 10 + 4 - 3) / 50;
+        d[0].push_back(t);
+        d[1].push_back((r == 50) ? NaN : 2.0 * t + 1.0);
+        d[2].push_back(10.0 * j);
+        d[3].push_back(0.003 + 0.05 * j);
+    }
+    return std::unique_ptr<pal::RowSource>(new Table({"time","x","enc","enc_t"},d));
+}
+
+/* The run's next segment, after a 200 ms gap, without the encoder */
+std::unique_ptr<pal::RowSource> second_segment()
+{
+    std::vector<std::vector<double>> d(2);
+    for(int r = 0; r < 50; r++)
+    {
+        double t = 1.204 + 0.01 * r;
+        d[0].push_back(t);
+        d[1].push_back(2.0 * t + 1.0);
+    }
+    return std::unique_ptr<pal::RowSource>(new Table({"time","x"},d));
+}
+
+std::vector<std::vector<double>> run(pal::Resample method, bool both = false, pal::ResampleOptions opt = {})
+{
+    std::vector<std::unique_ptr<pal::RowSource>> srcs;
+    srcs.push_back(first_segment());
+    if(both) srcs.push_back(second_segment());
+    opt.method = method;
+    auto out = pal::resample(std::move(srcs),opt);
+    return pal::test::read_all(*out);
+}
+
+} /* namespace */
+
+/* On a 10 ms grid from 10 ms, a line comes back exact, the encoder's samples
+ * rise 200 a second between its sample times, and nothing is made up past the
+ * last of them
+ */
+TEST(resample_linear)
+{
+    auto d = run(pal::Resample::Linear);
+    CHECK(d.size() == 3 && d[0].size() == 99);
+    for(size_t k = 0; k < 99; k++)
+    {
+        double g = (k + 1) / 100.0;
+        CHECK(d[0][k] == g);
+        CHECK_NEAR(d[1][k],2.0 * g + 1.0,1e-12);
+        if(g < 0.953) CHECK_NEAR(d[2][k],200.0 * (g - 0.003),1e-9);
+        else CHECK(std::isnan(d[2][k]));
+    }
+}
+
+/* A hold takes the last sample at or before each grid time, and carries it on */
+TEST(resample_hold)
+{
+    auto d = run(pal::Resample::Hold);
+    CHECK(d[0].size() == 99);
+    for(size_t k = 0; k < 99; k++)
+    {
+        double g = (k + 1) / 100.0;
+        double row = g - 0.006;
+        if(k + 1 == 51) row -= 0.01;
+        CHECK_NEAR(d[1][k],2.0 * row + 1.0,1e-12);
+        CHECK(d[2][k] == 10.0 * std::min(19,static_cast<int>(std::floor((g - 0.003) / 0.05))));
+    }
+}
+
+/* Nearest takes the sample 4 ms on over the one 6 ms back, except where the one
+ * on is missing
+ */
+TEST(resample_nearest)
+{
+    auto d = run(pal::Resample::Nearest);
+    for(size_t k = 0; k < 99; k++)
+    {
+        double g = (k + 1) / 100.0;
+        double row = (k + 1 == 50) ? g - 0.006 : g + 0.004;
+        CHECK_NEAR(d[1][k],2.0 * row + 1.0,1e-12);
+    }
+    /* Halfway between two samples, the earlier is taken */
+    std::vector<std::unique_ptr<pal::RowSource>> srcs;
+    srcs.emplace_back(new Table({"time","y"},{{0.0,0.5,1.0,1.5},{0.0,10.0,20.0,30.0}}));
+    pal::ResampleOptions opt;
+    opt.dt = 0.25;
+    opt.method = pal::Resample::Nearest;
+    auto out = pal::resample(std::move(srcs),opt);
+    auto e = pal::test::read_all(*out);
+    CHECK(e[0].size() == 7);
+    const double want[] = {0.0,0.0,10.0,10.0,20.0,20.0,30.0};
+    for(size_t k = 0; k < 7; k++) CHECK(e[1][k] == want[k]);
+}
+
+/* Segments are read one after the other, a line kept across the gap between
+ * them, and a channel the second lacks ends with the first
+ */
+TEST(resample_segments)
+{
+    auto d = run(pal::Resample::Linear,true);
+    CHECK(d[0].size() == 169 && d[0].back() == 1.69);
+    for(size_t k = 0; k < 169; k++) CHECK_NEAR(d[1][k],2.0 * d[0][k] + 1.0,1e-12);
+    CHECK(std::isnan(d[2][100]) && std::isnan(d[2].back()));
+
+    d = run(pal::Resample::Hold,true);
+    CHECK(d[1][110] == 2.0 * 0.994 + 1.0 && d[2].back() == 190.0);
+}
+
+/* The grid from and to given times, at steps not a whole number a second, and a
+ * long run streamed through in blocks
+ */
+TEST(resample_grid)
+{
+    pal::ResampleOptions opt;
+    opt.dt = 0.05;
+    opt.t0 = 0.5;
+    opt.t1 = 0.6;
+    auto d = run(pal::Resample::Linear,false,opt);
+    CHECK(d[0].size() == 3 && d[0][0] == 0.5 && d[0][1] == 0.55 && d[0][2] == 0.6);
+    CHECK_NEAR(d[1][1],2.1,1e-12);
+
+    opt = {};
+    opt.dt = 0.03;
+    d = run(pal::Resample::Linear,false,opt);
+    CHECK(d[0].size() == 33);
+    CHECK_NEAR(d[0][0],0.03,1e-15);
+    CHECK_NEAR(d[0][32],0.99,1e-12);
+
+    std::vector<std::vector<double>> rows(2);
+    for(int r = 0; r < 20000; r++)
+    {
+        rows[0].push_back(r * 0.005);
+        rows[1].push_back(3.0 * r * 0.005 - 2.0);
+    }
+    std::vector<std::unique_ptr<pal::RowSource>> srcs;
+    srcs.emplace_back(new Table({"time","y"},rows,1000));
+    opt = {};
+    opt.dt = 0.02;
+    auto out = pal::resample(std::move(srcs),opt);
+    d = pal::test::read_all(*out,777);
+    CHECK(d[0].size() == 5000);
+    for(size_t k = 0; k < 5000; k++)
+    {
+        CHECK(d[0][k] == k / 50.0);
+        CHECK_NEAR(d[1][k],3.0 * d[0][k] - 2.0,1e-9);
+    }
+}
+
+/* Channels by name, and what can't be resampled */
+TEST(resample_options)
+{
+    pal::ResampleOptions opt;
+    opt.channels = {"enc"};
+    std::vector<std::unique_ptr<pal::RowSource>> srcs;
+    srcs.push_back(first_segment());
+    auto out = pal::resample(std::move(srcs),opt);
+    CHECK(out->columns().size() == 2 && out->columns()[1].name == "enc");
+
+    for(int bad = 0; bad < 2; bad++)
+    {
+        opt = {};
+        if(bad) opt.dt = 0.0;
+        else opt.channels = {"nope"};
+        srcs.clear();
+        srcs.push_back(first_segment());
+        bool threw = false;
+        try { pal::resample(std::move(srcs),opt); }
+        catch(const std::runtime_error&) { threw = true; }
+        CHECK(threw);
+    }
+
+    CHECK(pal::resample_method("zoh") == pal::Resample::Hold);
+    CHECK(pal::resample_method("nearest") == pal::Resample::Nearest);
+    bool threw = false;
+    try { pal::resample_method("cubic"); }
+    catch(const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
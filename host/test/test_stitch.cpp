@@ -0,0 +1,151 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of pallog stitch: where one run of the program ends and the next starts
+ * on a card, and the rows and logs of a run joined back together
+ */
+
+#include "test.hpp"
+#include "table.hpp"
+#include "stitch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using pal::test::Table;
+
+void write_file(const std::string& path, const std::string& text)
+{
+    FILE * f = fopen(path.c_str(),"wb");
+    CHECK(f);
+    CHECK(fwrite(text.data(),1,text.size(),f) == text.size());
+    fclose(f);
+}
+
+/* A segment of rows every 10 ms from from_ms to to_ms, and its log, which opens
+ * with the boot id if given one, and ends with a segment request if split
+ */
+void segment(const std::string& dir, int idx, int from_ms, int to_ms, bool split, int boot = -1)
+{
+    char name[64];
+    std::string data = "time,batt_volt\n";
+    for(int t = from_ms; t <= to_ms; t += 10)
+    {
+        snprintf(name,sizeof(name),"%d,%d\n",t,12000 - idx);
+        data += name;
+    }
+    snprintf(name,sizeof(name),"/dat%05d.csv",idx);
+    write_file(dir + name,data);
+
+    snprintf(name,sizeof(name),"/usd/dat%05d.csv",idx);
+    std::string log = "\n00000000 ALWAYS: Log file opened (" + std::string(name + 5) + ")";
+    if(boot >= 0) log += ", boot " + std::to_string(boot);
+    if(split) log += "\n00000000 ALWAYS: Segment requested, opening with new file name";
+    snprintf(name,sizeof(name),"/log%05d.txt",idx);
+    write_file(dir + name,log);
+}
+
+std::vector<int> indexes(const pal::Run& run)
+{
+    std::vector<int> out;
+    for(const auto& s : run.segs) out.push_back(s.segment);
+    return out;
+}
+
+} /* namespace */
+
+/* Without boot ids, a segment carries on the run only from the segment just
+ * before, split by log_segment(), and from a time at or after where it ended
+ */
+TEST(stitch_runs_by_time)
+{
+    pal::test::TempDir dir;
+    segment(dir.path,0,0,1000,true);
+    segment(dir.path,1,1000,2000,true);     /* Carries on from the same time */
+    segment(dir.path,2,50,500,true);        /* Time starts again: power on */
+    segment(dir.path,3,600,900,false);
+    segment(dir.path,4,1000,1500,true);     /* 3 wasn't split */
+    segment(dir.path,6,1600,1700,true);     /* 5 is missing */
+    write_file(dir.path + "/log00007.txt","\nno data file");   /* Joins 6, no time to go by */
+    segment(dir.path,8,1800,1900,false);    /* 7 wasn't split */
+
+    std::vector<pal::Run> runs = pal::find_runs(pal::find_segments(dir.path));
+    CHECK(runs.size() == 5);
+    CHECK(runs[0].boot == 0 && indexes(runs[0]) == std::vector<int>({0,1}));
+    CHECK(runs[1].boot == 2 && indexes(runs[1]) == std::vector<int>({2,3}));
+    CHECK(runs[2].boot == 4 && indexes(runs[2]) == std::vector<int>({4}));
+    CHECK(runs[3].boot == 6 && indexes(runs[3]) == std::vector<int>({6,7}));
+    CHECK(runs[4].boot == 8 && indexes(runs[4]) == std::vector<int>({8}));
+}
+
+/* With boot ids, the ids alone decide, whatever the times and indexes say */
+TEST(stitch_runs_by_boot)
+{
+    pal::test::TempDir dir;
+    segment(dir.path,0,0,1000,true,3);
+    segment(dir.path,1,1010,2000,true,4);   /* Would join by time */
+    segment(dir.path,2,0,100,true,4);       /* Would not */
+    segment(dir.path,5,200,300,false,4);
+    segment(dir.path,6,400,500,true);       /* No id: back to the times, and 5 wasn't split */
+    segment(dir.path,7,600,700,false);
+
+    std::vector<pal::Run> runs = pal::find_runs(pal::find_segments(dir.path));
+    CHECK(runs.size() == 3);
+    CHECK(runs[0].boot == 3 && indexes(runs[0]) == std::vector<int>({0}));
+    CHECK(runs[1].boot == 4 && indexes(runs[1]) == std::vector<int>({1,2,5}));
+    CHECK(runs[2].boot == 6 && indexes(runs[2]) == std::vector<int>({6,7}));
+    CHECK(pal::find_runs({}).empty());
+}
+
+/* A run's rows come out one segment after another, with the union of their
+ * columns, NaN where a segment lacks one, and its logs joined as they were
+ */
+TEST(stitch_concat)
+{
+    std::vector<std::unique_ptr<pal::RowSource>> srcs;
+    srcs.emplace_back(new Table({"time","a","b"},{{0.0,0.01,0.02},{1,2,3},{4,5,6}},2));
+    srcs.emplace_back(new Table({"time","b","c","c"},{{0.03,0.04},{7,8},{9,10},{11,12}},1));
+    srcs.emplace_back(new Table({"time"},{{}}));
+    srcs.emplace_back(new Table({"time","a"},{{0.05},{13}}));
+    auto rows = pal::concat_rows(std::move(srcs));
+
+    CHECK(rows->rows() == 6);
+    const char * names[] = {"time","a","b","c","c"};
+    CHECK(rows->columns().size() == 5);
+    for(size_t c = 0; c < 5; c++) CHECK(rows->columns()[c].name == names[c]);
+    double first, last;
+    CHECK(rows->span(first,last) && first == 0.0 && last == 0.05);
+
+    auto d = pal::test::read_all(*rows,4);
+    const double want[5][6] =
+    {
+        {0.0,0.01,0.02,0.03,0.04,0.05},
+        {1,2,3,NAN,NAN,13},
+        {4,5,6,7,8,NAN},
+        {NAN,NAN,NAN,9,10,NAN},
+        {NAN,NAN,NAN,11,12,NAN},
+    };
+    for(size_t c = 0; c < 5; c++)
+    {
+        CHECK(d[c].size() == 6);
+        for(size_t r = 0; r < 6; r++) CHECK(d[c][r] == want[c][r] || (std::isnan(d[c][r]) && std::isnan(want[c][r])));
+    }
+
+    pal::test::TempDir dir;
+    segment(dir.path,0,0,100,true);
+    segment(dir.path,1,110,200,false);
+    write_file(dir.path + "/dat00002.csv","time\n300\n");
+    auto segs = pal::find_segments(dir.path);
+    pal::concat_logs(segs,dir.path + "/run.txt");
+    CHECK(pal::test::read_file(dir.path + "/run.txt") ==
+        pal::test::read_file(segs[0].log) + pal::test::read_file(segs[1].log));
+}
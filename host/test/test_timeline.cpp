@@ -0,0 +1,163 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of the cross index pallog timeline and pallog around read: which row each
+ * message is linked to, where each message starts and ends, and the rows found
+ * and read around a time
+ */
+
+#include "test.hpp"
+#include "rows.hpp"
+#include "timeline.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const size_t ROWS = 1000;
+
+void write_file(const std::string& path, const std::string& text)
+{
+    FILE * f = fopen(path.c_str(),"wb");
+    CHECK(f);
+    CHECK(fwrite(text.data(),1,text.size(),f) == text.size());
+    fclose(f);
+}
+
+/* Rows every 10 ms from 0, numbered in n */
+std::string data_csv()
+{
+    std::string text = "time,n\n";
+    char line[32];
+    for(size_t r = 0; r < ROWS; r++)
+    {
+        snprintf(line,sizeof(line),"%zu,%zu\n",r * 10,r);
+        text += line;
+    }
+    return text;
+}
+
+/* Messages as the text file sink writes them, each after a line break, with text
+ * before the first that isn't one, and one running over two lines
+ */
+const char * LOG_TEXT =
+    "stray text\n"
+    "\n0000.004 [INFO] in src/main.cpp line 12: first"
+    "\n0000.015 [WARN] in src/main.cpp line 40: halfway between rows 1 and 2"
+    "\n0000.016 [ERROR] in src/auton.cpp line 7: nearer row 2\nand a second line\n"
+    "\n0005.000 [TRACE] in src/auton.cpp line 9: not a level"
+    "\n0020.000 [ALWAYS] in src/log.c line 118: after the last row\n";
+
+struct Files
+{
+    Files()
+    {
+        log = dir.path + "/log00001.txt";
+        data = dir.path + "/dat00001.csv";
+        write_file(log,LOG_TEXT);
+        write_file(data,data_csv());
+        path = pal::timeline_path(data);
+        pal::write_timeline(log,data,path);
+    }
+
+    pal::test::TempDir dir;
+    std::string log, data, path;
+};
+
+} /* namespace */
+
+/* Each message is linked to the row nearest it in time, the earlier on a tie, and
+ * runs from its header to the line break before the next
+ */
+TEST(timeline_messages)
+{
+    Files f;
+    CHECK(f.path == f.dir.path + "/dat00001.tlx");
+    pal::Timeline tl(f.path,f.log);
+    CHECK(tl.rows() == ROWS && tl.messages() == 5);
+    for(size_t r = 0; r < ROWS; r++) CHECK(tl.row_time(r) == r / 100.0);
+
+    const size_t rows[] = {0,1,2,500,ROWS - 1};
+    const int levels[] = {1,2,3,TIMELINE_NO_LEVEL,4};
+    for(size_t i = 0; i < 5; i++) CHECK(tl.entry(i).row == rows[i] && tl.entry(i).level == levels[i]);
+
+    std::string text = LOG_TEXT;
+    CHECK(tl.entry(0).offset == text.find("0000.004"));
+    CHECK(tl.entry(0).len == text.find("\n0000.015") - tl.entry(0).offset);
+    CHECK(tl.entry(4).offset + tl.entry(4).len == text.size());
+
+    pal::LogMessage m = tl.message(2);
+    CHECK(m.time == 0.016 && m.level == 3 && m.file == "src/auton.cpp" && m.line == 7);
+    CHECK(m.text == "nearer row 2\nand a second line" && m.row == 2);
+    m = tl.message(4);
+    CHECK(m.file == "src/log.c" && m.line == 118 && m.text == "after the last row");
+
+    CHECK(pal::log_level("warn") == 2 && pal::log_level("TRACE") < 0);
+    CHECK(std::string(pal::log_level_name(4)) == "ALWAYS" && std::string(pal::log_level_name(TIMELINE_NO_LEVEL)) == "?");
+}
+
+/* The rows around a message, as pallog around takes them, found by time and read
+ * after seeking the data file, either side of the seek stride
+ */
+TEST(timeline_around)
+{
+    Files f;
+    pal::Timeline tl(f.path,f.log);
+
+    /* 20 ms either side of 5 s: rows 498 to 502 */
+    auto r = tl.range(5.0 - 0.02,5.0 + 0.02);
+    CHECK(r.first == 498 && r.second == 503);
+    r = tl.range(0.995,1.025);
+    CHECK(r.first == 100 && r.second == 103);
+    r = tl.range(-1.0,0.0);
+    CHECK(r.first == 0 && r.second == 1);
+    r = tl.range(10.0,20.0);
+    CHECK(r.first == ROWS && r.second == ROWS);
+    r = tl.range(2.0,1.0);
+    CHECK(r.first == r.second);
+
+    auto src = pal::open_rows(f.data);
+    std::vector<double> block(2 * 8);
+    for(size_t row : {size_t(0),size_t(255),size_t(256),size_t(600),ROWS - 1})
+    {
+        tl.seek(*src,row);
+        size_t n = src->read(block.data(),8);
+        CHECK(n == std::min<size_t>(8,ROWS - row));
+        for(size_t k = 0; k < n; k++) CHECK(block[8 + k] == row + k && block[k] == (row + k) / 100.0);
+    }
+    bool threw = false;
+    try { tl.seek(*src,ROWS); }
+    catch(const std::out_of_range&) { threw = true; }
+    CHECK(threw);
+}
+
+/* The index goes stale when either file changes, and won't pair with another log */
+TEST(timeline_stale)
+{
+    Files f;
+    {
+        pal::Timeline tl(f.path,f.log);
+        CHECK(!tl.stale(f.data));
+        write_file(f.log,std::string(LOG_TEXT) + "\n0021.000 [INFO] in src/main.cpp line 1: more\n");
+        CHECK(tl.stale(f.data));
+    }
+    pal::write_timeline(f.log,f.data,f.path);
+    pal::Timeline tl(f.path,f.log);
+    CHECK(tl.messages() == 6 && !tl.stale(f.data));
+    write_file(f.data,data_csv() + "10000,1000\n");
+    CHECK(tl.stale(f.data));
+
+    write_file(f.dir.path + "/short.txt","\n0000.004 [INFO] in x line 1: y");
+    bool threw = false;
+    try { pal::Timeline other(f.path,f.dir.path + "/short.txt"); }
+    catch(const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
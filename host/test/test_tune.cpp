@@ -0,0 +1,203 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Tests of pallog tune: the score of the held out GPS readings, worked out for a
+ * robot the estimate can't be moved from, and the searches over parameters
+ */
+
+#include "test.hpp"
+#include "tune.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+pal::EkfInput reading(double t, double x, double y, double error)
+{
+    return {t,x,y,NaN,error,NaN,NaN,NaN,NaN,NaN};
+}
+
+/* A robot standing at (1,2) with no sensors but the GPS. Every other reading is
+ * held out, and the rest read exactly where it is, so the estimate never moves
+ * and each held out reading misses by its own offset: k cm for the kth, the last
+ * of them reported with an error of half a metre
+ */
+pal::TuneLog standing()
+{
+    pal::TuneLog log;
+    log.rows.push_back(reading(0.0,1.0,2.0,0.01));
+    for(int k = 1; k <= 20; k++)
+    {
+        double e = k * 0.01;
+        log.rows.push_back(reading(k * 0.1 - 0.05,1.0 + 0.6 * e,2.0 - 0.8 * e,(k == 20) ? 0.5 : 0.01 * k));
+        log.rows.push_back(reading(k * 0.1,1.0,2.0,0.01));
+    }
+    return log;
+}
+
+/* Driving along x at 0.5 m/s, the GPS reading every 50 ms with 2 cm of noise */
+pal::TuneLog driving(unsigned seed)
+{
+    pal::EkfReplay opt;
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0,0.02);
+    pal::TuneLog log;
+    double gx = NaN, gy = NaN;
+    for(int r = 0; r < 1000; r++)
+    {
+        double t = r * 0.01;
+        if(r % 5 == 0)
+        {
+            gx = 0.5 * t + noise(rng);
+            gy = 1.0 + noise(rng);
+        }
+        double rpm = 0.5 / opt.mps_per_rpm;
+        log.rows.push_back({t,gx,gy,90.0,0.02,0.0,NaN,NaN,rpm,rpm});
+    }
+    return log;
+}
+
+} /* namespace */
+
+/* Held out readings score as far as they are from the estimate, leaving out those
+ * the GPS said were worse than the limit
+ */
+TEST(tune_score)
+{
+    pal::EkfReplay opt;
+    opt.gps_every = 2;
+    pal::TuneScore s = pal::score_log(standing(),opt,1.0);
+    double sum2 = 0.0;
+    for(int k = 1; k <= 20; k++) sum2 += k * k * 1e-4;
+    CHECK(s.count == 20);
+    CHECK_NEAR(s.rms,std::sqrt(sum2 / 20),1e-12);
+    CHECK_NEAR(s.p95,0.19,1e-12);
+    CHECK_NEAR(s.max,0.20,1e-12);
+    CHECK_NEAR(s.gps_error,(0.01 * 190 + 0.5) / 20,1e-12);
+
+    s = pal::score_log(standing(),opt,0.2);
+    CHECK(s.count == 19);
+    CHECK_NEAR(s.rms,std::sqrt((sum2 - 0.04) / 19),1e-12);
+    CHECK_NEAR(s.p95,0.19,1e-12);
+    CHECK_NEAR(s.max,0.19,1e-12);
+
+    /* With nothing held out there is nothing to score */
+    opt.gps_every = 1;
+    s = pal::score_log(standing(),opt,1.0);
+    CHECK(s.count == 0 && s.rms == 0.0);
+}
+
+/* Parameters by name, q_xy setting both position states */
+TEST(tune_params)
+{
+    CHECK(pal::tune_param_names().size() == 12);
+    pal::EkfParams p;
+    CHECK(pal::tune_set(p,"q_xy",0.5) && p.q[pal::EKF_X] == 0.5 && p.q[pal::EKF_Y] == 0.5);
+    CHECK(pal::tune_set(p,"q_a",0.25) && p.q[pal::EKF_AF] == 0.25 && p.q[pal::EKF_AN] == 0.25);
+    CHECK(pal::tune_set(p,"r_odom_w",3.0) && p.r_odom_w == 3.0);
+    CHECK(pal::tune_get(p,"q_xy") == 0.5 && pal::tune_get(p,"r_odom_w") == 3.0);
+    for(const auto& n : pal::tune_param_names()) CHECK(!std::isnan(pal::tune_get(p,n)));
+    CHECK(!pal::tune_set(p,"q_z",1.0) && std::isnan(pal::tune_get(p,"q_z")));
+
+    std::vector<pal::TuneLog> logs;
+    bool threw = false;
+    try { pal::Tuner t(logs,pal::EkfReplay(),{{"q_z",-3,-1,3}},1,1.0); }
+    catch(const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
+
+/* The grid tries every point, in order, and keeps the best; Nelder-Mead starts
+ * from the base parameters clamped into range and ends no worse than there. The
+ * scores come out the same however many threads share them
+ */
+TEST(tune_search)
+{
+    std::vector<pal::TuneLog> logs = {driving(1),driving(2),driving(3)};
+    pal::EkfReplay base;
+    base.gps_every = 2;
+    std::vector<pal::TuneParam> params = {{"r_gps_xy",-5.0,-2.0,4},{"q_v",-3.0,-1.0,3}};
+    pal::Tuner tuner(logs,base,params,4,1.0);
+
+    std::vector<double> start = tuner.start();
+    CHECK(start.size() == 2 && start[0] == -4.0 && start[1] == -2.0);
+    pal::EkfReplay at = tuner.apply({-3.0,-1.5});
+    CHECK_NEAR(at.params.r_gps_xy,1e-3,1e-18);
+    CHECK_NEAR(at.params.q[pal::EKF_VN],std::pow(10.0,-1.5),1e-15);
+    CHECK(at.gps_every == 2);
+
+    double best;
+    std::vector<double> g = tuner.grid(best);
+    CHECK(tuner.evaluations() == 12);
+    std::vector<std::vector<double>> all;
+    for(double r : {-5.0,-4.0,-3.0,-2.0})
+    {
+        for(double q : {-3.0,-2.0,-1.0}) all.push_back({r,q});
+    }
+    std::vector<double> score = tuner.evaluate(all);
+    size_t b = std::min_element(score.begin(),score.end()) - score.begin();
+    CHECK(g == all[b] && best == score[b]);
+    CHECK(std::isfinite(best) && best > 0.0);
+
+    pal::Tuner serial(logs,base,params,1,1.0);
+    CHECK(serial.evaluate(all) == score);
+
+    /* Pooled over the logs, which each score on their own */
+    double sum2 = 0.0;
+    size_t n = 0;
+    for(const auto& l : logs)
+    {
+        pal::TuneScore s = pal::score_log(l,tuner.apply(all[5]),1.0);
+        sum2 += s.rms * s.rms * s.count;
+        n += s.count;
+    }
+    CHECK_NEAR(score[5],std::sqrt(sum2 / n),1e-12);
+
+    double nm;
+    std::vector<double> x = tuner.nelder_mead(40,nm);
+    CHECK(nm <= tuner.evaluate({start})[0]);
+    CHECK(x[0] >= -5.0 && x[0] <= -2.0 && x[1] >= -3.0 && x[1] <= -1.0);
+    CHECK(nm == tuner.evaluate({x})[0]);
+
+    /* A log with nothing held out can't score, so no candidate wins on it */
+    base.gps_every = 1;
+    pal::Tuner none(logs,base,params,2,1.0);
+    CHECK(std::isinf(none.evaluate({start})[0]));
+}
+
+/* A log's readings load from the poller's channels, and a log without a GPS is refused */
+TEST(tune_load)
+{
+    pal::test::TempDir dir;
+    std::string path = dir.path + "/dat00001.csv";
+    FILE * f = fopen(path.c_str(),"w");
+    CHECK(f);
+    fputs("time,gps_x,gps_y,gps_hdg,gps_error,imu_gyro_z,left_vel,right_vel\n"
+        "0,1.5,2.5,90,0.01,3,100,110\n10,1.6,2.4,91,0.02,4,120,130\n",f);
+    fclose(f);
+    pal::TuneLog log = pal::load_tune_log(path);
+    CHECK(log.path == path && log.rows.size() == 2);
+    const pal::EkfInput& r = log.rows[1];
+    CHECK(r.time == 0.01 && r.gps_x == 1.6 && r.gps_y == 2.4 && r.gps_hdg == 91 && r.gps_error == 0.02);
+    CHECK(r.gyro_z == 4 && r.left_vel == 120 && r.right_vel == 130 && std::isnan(r.acc_x));
+
+    f = fopen(path.c_str(),"w");
+    fputs("time,imu_gyro_z\n0,1\n",f);
+    fclose(f);
+    bool threw = false;
+    try { pal::load_tune_log(path); }
+    catch(const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
@@ -0,0 +1,207 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "binlog.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/* Parse a time range in seconds ("T0:T1", either end may be empty) into ms */
+static bool parse_range(const char * arg, uint32_t& t0, uint32_t& t1)
+{
+    char * end;
+    t0 = 0;
+    t1 = UINT32_MAX;
+    if(*arg != ':')
+    {
+        t0 = static_cast<uint32_t>(strtod(arg,&end) * 1000.0);
+        if(*end != ':') return false;
+        arg = end;
+    }
+    arg++;
+    if(*arg)
+    {
+        t1 = static_cast<uint32_t>(strtod(arg,&end) * 1000.0);
+        if(*end) return false;
+    }
+    return true;
+}
+
+/* Running min, max and mean of a column */
+struct Stats
+{
+    double lo = INFINITY, hi = -INFINITY, sum = 0.0;
+    size_t n = 0, bad = 0;
+
+    void add(double v)
+    {
+        if(!std::isfinite(v))
+        {
+            bad++;
+            return;
+        }
+        lo = std::fmin(lo,v);
+        hi = std::fmax(hi,v);
+        sum += v;
+        n++;
+    }
+
+    void print(const std::string& name) const
+    {
+        printf("  %-24s %14g %14g %14g %8zu\n",name.c_str(),n ? lo : NAN,n ? hi : NAN,
+            n ? sum / n : NAN,bad);
+    }
+};
+
+/* Summarize every channel of each binary file, optionally within a time range */
+int cmd_bin(int argc, char ** argv)
+{
+    uint32_t t0 = 0, t1 = UINT32_MAX;
+    int opt;
+    while((opt = getopt(argc,argv,"t:")) != -1)
+    {
+        if(opt != 't' || !parse_range(optarg,t0,t1))
+        {
+            fprintf(stderr,"usage: pallog bin [-t T0:T1] FILE...\n");
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"usage: pallog bin [-t T0:T1] FILE...\n");
+        return 2;
+    }
+
+    for(int i = optind; i < argc; i++)
+    {
+        pal::BinLog log(argv[i]);
+        auto r = log.range(t0,t1);
+        auto time = log.time().slice(r.first,r.second);
+        printf("%s: %zu rows, %zu channels%s\n",argv[i],log.rows(),log.channels().size(),
+            log.truncated() ? " (truncated)" : "");
+        if(time.size())
+        {
+            printf("  rows %zu to %zu, %.3f s to %.3f s\n",r.first,r.second,time[0] / 1000.0,
+                time[time.size() - 1] / 1000.0);
+        }
+        printf("  %-24s %14s %14s %14s %8s\n","channel","min","max","mean","nonfinite");
+
+        for(size_t c = 0; c < log.channels().size(); c++)
+        {
+            const pal::BinChannel& ch = log.channels()[c];
+            if(ch.flags & LOG_CHAN_VAR)
+            {
+                auto recs = log.vars(c).slice_time(t0,t1);
+                size_t objs = 0;
+                for(size_t k = 0; k < recs.size(); k++) objs += recs[k].count;
+                printf("  %-24s %zu records, %zu structs of %u bytes (%s)\n",ch.name.c_str(),
+                    recs.size(),objs,ch.count,ch.layout.c_str());
+                continue;
+            }
+            if(ch.flags & LOG_CHAN_SPARSE)
+            {
+                auto pts = log.points(c).slice_time(t0,t1);
+                Stats s;
+                for(size_t k = 0; k < pts.size(); k++) s.add(pts[k].value);
+                s.print(ch.name + " (" + std::to_string(pts.size()) + " points)");
+                continue;
+            }
+            for(int e = 0; e < ch.count; e++)
+            {
+                Stats s;
+                if(ch.type == LOG_TYPE_INT)
+                {
+                    log.column<int32_t>(c,e).slice(r.first,r.second).for_each([&](int32_t v){ s.add(v); });
+                }
+                else
+                {
+                    log.column<double>(c,e).slice(r.first,r.second).for_each([&](double v){ s.add(v); });
+                }
+                s.print(ch.element_name(e));
+            }
+        }
+    }
+    return 0;
+}
+
+/* Seconds taken by fn, best of reps runs */
+template <typename F>
+static double best_time(int reps, F fn)
+{
+    double best = INFINITY;
+    for(int r = 0; r < reps; r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::fmin(best,std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+/* Measure the time to open and index each file, and to scan every row column */
+int cmd_bench_bin(int argc, char ** argv)
+{
+    int reps = 20;
+    int opt;
+    while((opt = getopt(argc,argv,"r:")) != -1)
+    {
+        if(opt != 'r' || (reps = atoi(optarg)) < 1)
+        {
+            fprintf(stderr,"usage: pallog bench-bin [-r R] FILE...\n");
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"usage: pallog bench-bin [-r R] FILE...\n");
+        return 2;
+    }
+
+    printf("%-24s %8s %8s %10s %12s %12s %12s\n","file","MB","rows","open ms","scan ms",
+        "values GB/s","file GB/s");
+    for(int i = optind; i < argc; i++)
+    {
+        double t_open = best_time(reps,[&]{ pal::BinLog log(argv[i]); });
+        pal::BinLog log(argv[i]);
+
+        /* Sum every element of every row channel, one column at a time */
+        size_t bytes = 0;
+        volatile double sink = 0.0;
+        double t_scan = best_time(reps,[&]
+        {
+            double sum = 0.0;
+            bytes = 0;
+            for(size_t c = 0; c < log.channels().size(); c++)
+            {
+                const pal::BinChannel& ch = log.channels()[c];
+                if(!ch.in_row()) continue;
+                for(int e = 0; e < ch.count; e++)
+                {
+                    if(ch.type == LOG_TYPE_INT)
+                    {
+                        log.column<int32_t>(c,e).for_each([&](int32_t v){ sum += v; });
+                    }
+                    else
+                    {
+                        log.column<double>(c,e).for_each([&](double v){ sum += v; });
+                    }
+                    bytes += log.rows() * ch.value_size();
+                }
+            }
+            sink = sum;
+        });
+        (void)sink;
+
+        printf("%-24s %8.2f %8zu %10.3f %12.3f %12.3f %12.3f\n",argv[i],log.mapped().size() / 1e6,
+            log.rows(),t_open * 1e3,t_scan * 1e3,bytes / t_scan / 1e9,log.mapped().size() / t_scan / 1e9);
+    }
+    return 0;
+}
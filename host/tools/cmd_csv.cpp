@@ -0,0 +1,137 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "csv.hpp"
+#include "mapped_file.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+/* Summarize every column of each CSV file */
+int cmd_csv(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr,"usage: pallog csv FILE...\n");
+        return 2;
+    }
+
+    for(int i = 1; i < argc; i++)
+    {
+        pal::CsvLog log = pal::load_csv(argv[i]);
+        printf("%s: %zu rows, %zu columns\n",argv[i],log.rows(),log.names.size());
+        printf("  %-20s %14s %14s %14s %8s\n","column","min","max","mean","nonfinite");
+        for(size_t c = 0; c < log.names.size(); c++)
+        {
+            double lo = INFINITY, hi = -INFINITY, sum = 0.0;
+            size_t n = 0, bad = 0;
+            for(double v : log.cols[c])
+            {
+                if(!std::isfinite(v))
+                {
+                    bad++;
+                    continue;
+                }
+                lo = std::fmin(lo,v);
+                hi = std::fmax(hi,v);
+                sum += v;
+                n++;
+            }
+            printf("  %-20s %14g %14g %14g %8zu\n",log.names[c].c_str(),
+                n ? lo : NAN,n ? hi : NAN,n ? sum / n : NAN,bad);
+        }
+    }
+    return 0;
+}
+
+/* Reference loader, splitting fields by hand and converting each with strtod */
+static size_t load_strtod(const char * data, size_t len)
+{
+    const char * p = data;
+    const char * end = data + len;
+    size_t n = 0;
+    char buf[64];
+    double sink = 0.0;
+    while(p < end)
+    {
+        const char * f = p;
+        while(p < end && *p != ',' && *p != '\n') p++;
+        size_t flen = (size_t)(p - f) < sizeof(buf) - 1 ? p - f : sizeof(buf) - 1;
+        memcpy(buf,f,flen);
+        buf[flen] = 0;
+        sink += strtod(buf,nullptr);
+        n++;
+        p++;
+    }
+    return n + (sink == 0.123456789);
+}
+
+/* Seconds taken by fn, best of reps runs */
+template <typename F>
+static double best_time(int reps, F fn)
+{
+    double best = INFINITY;
+    for(int r = 0; r < reps; r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::fmin(best,std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+/* Measure load throughput of each file, single threaded, multithreaded and against strtod */
+int cmd_bench_csv(int argc, char ** argv)
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    int reps = 20;
+    int opt;
+    while((opt = getopt(argc,argv,"j:r:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'r':
+            reps = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr,"usage: pallog bench-csv [-j N] [-r R] FILE...\n");
+            return 2;
+        }
+    }
+    if(optind >= argc || reps < 1)
+    {
+        fprintf(stderr,"usage: pallog bench-csv [-j N] [-r R] FILE...\n");
+        return 2;
+    }
+    if(!threads) threads = 1;
+
+    printf("%-24s %8s %12s %14s %12s\n","file","MB","strtod GB/s","1 thread GB/s","GB/s");
+    for(int i = optind; i < argc; i++)
+    {
+        /* Map once and touch every page, so the timings only measure parsing */
+        pal::MappedFile file(argv[i]);
+        volatile uint8_t touch = 0;
+        for(size_t b = 0; b < file.size(); b += 4096) touch ^= file.data()[b];
+
+        double gb = file.size() / 1e9;
+        double t_ref = best_time(reps,[&]{ load_strtod(file.chars(),file.size()); });
+        double t_one = best_time(reps,[&]{ pal::parse_csv(file.chars(),file.size(),1); });
+        double t_all = best_time(reps,[&]{ pal::parse_csv(file.chars(),file.size(),threads); });
+        printf("%-24s %8.2f %12.3f %14.3f %12.3f (%u threads)\n",argv[i],file.size() / 1e6,
+            gb / t_ref,gb / t_one,gb / t_all,threads);
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "arrow.hpp"
+#include "batch.hpp"
+#include "estimate.hpp"
+#include "rows.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/* Rows read per block when only replaying */
+#define EKF_BLOCK_ROWS 4096
+
+/* Replay logs through the estimator, writing the source channels and the
+ * estimator's channels to .feather files, or with -n only timing the replay and
+ * summarizing the GPS innovations
+ */
+int cmd_ekf(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog ekf [-a] [-n] [-g DEG] [-o DIR] FILE|DIR...\n";
+    pal::EkfReplay opt;
+    bool write = true;
+    std::string outdir;
+    int c;
+    while((c = getopt(argc,argv,"ag:no:")) != -1)
+    {
+        switch(c)
+        {
+        case 'a':
+            opt.accel = true;
+            break;
+        case 'g':
+            opt.gps_offset = atof(optarg);
+            break;
+        case 'n':
+            write = false;
+            break;
+        case 'o':
+            outdir = optarg;
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    std::vector<std::string> files = pal::find_logs(std::vector<std::string>(argv + optind,argv + argc));
+    std::vector<std::string> outs = pal::output_paths(files,outdir,"_ekf.feather");
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        const std::string& f = files[i];
+        auto t0 = std::chrono::steady_clock::now();
+        auto src = pal::open_rows(f);
+        double first = 0.0, last = 0.0;
+        double logged = src->span(first,last) ? last - first : 0.0;
+        auto rs = pal::replay_ekf(std::move(src),opt);
+        const std::string& out = outs[i];
+
+        double sum2 = 0.0;
+        size_t updates = 0;
+        if(write)
+        {
+            pal::write_arrow(*rs,out);
+        }
+        else
+        {
+            const size_t ncols = rs->columns().size();
+            const size_t nu_x = ncols - pal::EKF_INNOVATIONS + pal::EKF_NU_GPS_X;
+            std::vector<double> block(ncols * EKF_BLOCK_ROWS);
+            size_t n;
+            while((n = rs->read(block.data(),EKF_BLOCK_ROWS)))
+            {
+                for(size_t r = 0; r < n; r++)
+                {
+                    double dx = block[nu_x * EKF_BLOCK_ROWS + r];
+                    double dy = block[(nu_x + 1) * EKF_BLOCK_ROWS + r];
+                    if(std::isnan(dx)) continue;
+                    sum2 += dx * dx + dy * dy;
+                    updates++;
+                }
+            }
+        }
+
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        printf("%s: %zu rows, %.1f s of log in %.3f s (%.0fx real time)",f.c_str(),rs->rows(),logged,secs,
+            secs > 0.0 ? logged / secs : 0.0);
+        if(write) printf(" -> %s\n",out.c_str());
+        else printf(", %zu GPS updates, innovation rms %.4f m\n",updates,updates ? std::sqrt(sum2 / updates) : NAN);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "arrow.hpp"
+#include "batch.hpp"
+#include "mat.hpp"
+#include "rows.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <unistd.h>
+
+/* Convert data files (or directories of them) with writer, in parallel */
+static int run_export(int argc, char ** argv, const char * ext,
+    void (*writer)(pal::RowSource&, const std::string&))
+{
+    unsigned threads = 0;
+    std::string outdir;
+    int opt;
+    while((opt = getopt(argc,argv,"j:o:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'o':
+            outdir = optarg;
+            break;
+        default:
+            fprintf(stderr,"usage: pallog %s [-j N] [-o DIR] FILE|DIR...\n",argv[0]);
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"usage: pallog %s [-j N] [-o DIR] FILE|DIR...\n",argv[0]);
+        return 2;
+    }
+
+    /* Outputs are checked up front, so two jobs never write the same file */
+    std::vector<std::string> files = pal::find_logs(std::vector<std::string>(argv + optind,argv + argc));
+    std::vector<std::string> outs = pal::output_paths(files,outdir,ext);
+    std::mutex out_lock;
+    std::atomic<int> failed(0);
+    auto t0 = std::chrono::steady_clock::now();
+
+    pal::parallel_for(files.size(),threads,[&](size_t i)
+    {
+        const std::string& out = outs[i];
+        try
+        {
+            auto src = pal::open_rows(files[i]);
+            writer(*src,out);
+            std::lock_guard<std::mutex> lock(out_lock);
+            printf("%s -> %s (%zu rows, %zu columns)\n",files[i].c_str(),out.c_str(),src->rows(),
+                src->columns().size());
+        }
+        catch(const std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(out_lock);
+            fprintf(stderr,"pallog %s: %s\n",argv[0],e.what());
+            failed++;
+        }
+    });
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%zu files in %.3f s, %d failed\n",files.size(),secs,failed.load());
+    return failed ? 1 : 0;
+}
+
+int cmd_mat(int argc, char ** argv)
+{
+    return run_export(argc,argv,".mat",pal::write_mat);
+}
+
+int cmd_arrow(int argc, char ** argv)
+{
+    return run_export(argc,argv,".feather",pal::write_arrow);
+}
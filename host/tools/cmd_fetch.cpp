@@ -0,0 +1,159 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "fetch.hpp"
+#include "tty.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/* Fetch the logger's files from the robot's file server over the USB link */
+int cmd_fetch(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog fetch [-o DIR] [-a] [-l] [-w WINDOW] [-T MS] [-b BAUD] [-t | DEVICE] [NAME...]\n"
+                         "  -o DIR    write the files into DIR, by default the current one\n"
+                         "  -a        also fetch the files the logger is still writing\n"
+                         "  -l        list the files on the robot, without fetching them\n"
+                         "  -w WINDOW chunks the robot sends ahead of those acknowledged (1 to 32)\n"
+                         "  -T MS     time the robot has to answer before asking again\n"
+                         "  -b BAUD   set a serial DEVICE to BAUD\n"
+                         "  -t        talk over a new pty, whose name is printed, i.e. for palhil -s\n"
+                         "Files already in DIR with the robot's size and CRC are skipped, and a fetch\n"
+                         "which broke off resumes from its .part file\n";
+    std::string dir = ".";
+    bool all = false;
+    bool list_only = false;
+    int window = 8;
+    int timeout = 1000;
+    int baud = 0;
+    bool pty = false;
+    int opt;
+    while((opt = getopt(argc,argv,"o:alw:T:b:t")) != -1)
+    {
+        switch(opt)
+        {
+        case 'o':
+            dir = optarg;
+            break;
+        case 'a':
+            all = true;
+            break;
+        case 'l':
+            list_only = true;
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        case 'T':
+            timeout = atoi(optarg);
+            break;
+        case 'b':
+            baud = atoi(optarg);
+            break;
+        case 't':
+            pty = true;
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(window < 1 || window > LOG_SERVE_WINDOW_MAX || timeout <= 0 || (!pty && optind >= argc))
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    int slave = -1;
+    int fd;
+    if(pty)
+    {
+        std::string name;
+        fd = pal::tty_pty(slave,name);
+        printf("%s\n",name.c_str());
+        fflush(stdout);
+    }
+    else
+    {
+        fd = pal::tty_open(argv[optind++],O_RDWR,baud);
+    }
+    std::vector<std::string> names(argv + optind,argv + argc);
+
+    int status = 0;
+    try
+    {
+        pal::FileClient client(fd,timeout);
+        /* A robot on a pty starts when it starts, so wait for it to say something */
+        if(pty && !client.wait_link(24 * 60 * 60 * 1000)) throw std::runtime_error("the robot never started");
+        std::vector<pal::RemoteFile> files = client.list();
+
+        if(list_only)
+        {
+            for(const pal::RemoteFile& f : files)
+            {
+                printf("%10u  %s%s\n",f.size,f.name.c_str(),f.open ? "  (open)" : "");
+            }
+            if(slave >= 0) close(slave);
+            close(fd);
+            return 0;
+        }
+
+        if(mkdir(dir.c_str(),0777) && errno != EEXIST) throw std::runtime_error(dir + ": " + strerror(errno));
+        for(const std::string& name : names)
+        {
+            if(std::none_of(files.begin(),files.end(),[&](const pal::RemoteFile& f) { return f.name == name; }))
+            {
+                fprintf(stderr,"%s: not on the robot\n",name.c_str());
+                status = 1;
+            }
+        }
+
+        for(const pal::RemoteFile& f : files)
+        {
+            if(!names.empty() && std::find(names.begin(),names.end(),f.name) == names.end()) continue;
+            if(f.open && !all && names.empty())
+            {
+                printf("%s: still being written, skipped\n",f.name.c_str());
+                continue;
+            }
+            std::string path = dir + "/" + f.name;
+            if(!f.open && client.have(f,path))
+            {
+                printf("%s: have it\n",f.name.c_str());
+                continue;
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            pal::FetchResult res = client.fetch(f,path,window);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            uint32_t moved = res.size - res.from;
+            printf("%s: %u bytes in %.2f s, %.1f kB/s",f.name.c_str(),res.size,secs,
+                   secs > 0 ? moved / secs / 1000.0 : 0.0);
+            if(res.from) printf(", resumed at %u",res.from);
+            if(res.resent) printf(", %u resent",res.resent);
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    catch(const std::runtime_error& e)
+    {
+        fprintf(stderr,"pallog fetch: %s\n",e.what());
+        status = 1;
+    }
+    if(slave >= 0) close(slave);
+    close(fd);
+    return status;
+}
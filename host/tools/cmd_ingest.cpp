@@ -0,0 +1,171 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "archive.hpp"
+#include "batch.hpp"
+#include "hash.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Robot name of a card dump, the last directory name other than usd or a date */
+static std::string robot_name(std::string dir)
+{
+    for(;;)
+    {
+        while(dir.size() > 1 && dir.back() == '/') dir.pop_back();
+        size_t slash = dir.find_last_of('/');
+        std::string base = (slash == std::string::npos) ? dir : dir.substr(slash + 1);
+        if((base != "usd" && pal::path_date(base).empty()) || slash == std::string::npos) return base;
+        dir.resize(slash);
+    }
+}
+
+/* A segment still to look at */
+struct Job
+{
+    pal::CardSegment seg;
+    std::string robot;
+    std::string date;
+    std::string source;     /* Full path of the data file, or the log if there is none */
+    std::vector<std::string> files;
+    pal::SourceEntry stat;
+};
+
+/* Ingest card dumps into an archive, in parallel
+ * Files seen before with the same size and time are skipped without reading them,
+ * files with the same contents as a segment already in the archive are only
+ * recorded as seen, and files which changed replace what they gave before
+ */
+int cmd_ingest(int argc, char ** argv)
+{
+    unsigned threads = 0;
+    std::string robot;
+    int opt;
+    while((opt = getopt(argc,argv,"j:r:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'r':
+            robot = optarg;
+            break;
+        default:
+            fprintf(stderr,"usage: pallog ingest [-j N] [-r ROBOT] ARCHIVE DIR...\n");
+            return 2;
+        }
+    }
+    if(optind + 2 > argc)
+    {
+        fprintf(stderr,"usage: pallog ingest [-j N] [-r ROBOT] ARCHIVE DIR...\n");
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    pal::Archive archive(argv[optind]);
+    std::vector<Job> jobs;
+    int unchanged = 0;
+    for(int a = optind + 1; a < argc; a++)
+    {
+        std::string dir = argv[a];
+        for(const auto& seg : pal::find_segments(dir))
+        {
+            Job job;
+            job.seg = seg;
+            job.robot = robot.empty() ? robot_name(dir) : robot;
+
+            const std::string& key = seg.data.empty() ? seg.log : seg.data;
+            char full[PATH_MAX];
+            if(!realpath(key.c_str(),full))
+            {
+                fprintf(stderr,"pallog ingest: can't read %s\n",key.c_str());
+                continue;
+            }
+            job.source = full;
+            for(const std::string * f : {&seg.data,&seg.log})
+            {
+                struct stat st;
+                if(f->empty() || stat(f->c_str(),&st) < 0) continue;
+                job.files.push_back(*f);
+                job.stat.size += st.st_size;
+                if(st.st_mtime > job.stat.mtime) job.stat.mtime = st.st_mtime;
+            }
+
+            auto it = archive.sources().find(job.source);
+            if(it != archive.sources().end() && it->second.size == job.stat.size &&
+                it->second.mtime == job.stat.mtime)
+            {
+                unchanged++;
+                continue;
+            }
+            job.date = pal::dump_date(dir,key);
+            jobs.push_back(job);
+        }
+    }
+
+    /* Hash and convert in parallel, holding the lock only to update the archive */
+    std::mutex lock;
+    std::set<std::string> claimed;
+    std::atomic<int> added(0), duplicate(0), failed(0);
+    pal::parallel_for(jobs.size(),threads,[&](size_t i)
+    {
+        Job& job = jobs[i];
+        try
+        {
+            job.stat.id = pal::content_id(job.files);
+            {
+                std::lock_guard<std::mutex> g(lock);
+                if(archive.find(job.stat.id) || !claimed.insert(job.stat.id).second)
+                {
+                    archive.add_source(job.source,job.stat);
+                    duplicate++;
+                    return;
+                }
+            }
+
+            pal::CatalogEntry e = pal::ingest_segment(archive.dir(),job.stat.id,job.seg);
+            e.robot = job.robot;
+            e.date = job.date;
+            e.source = job.source;
+            std::lock_guard<std::mutex> g(lock);
+
+            /* A file which changed in place replaces what was ingested from it */
+            auto old = archive.sources().find(job.source);
+            if(old != archive.sources().end() && old->second.id != e.id)
+            {
+                const pal::CatalogEntry * prev = archive.find(old->second.id);
+                if(prev && prev->source == job.source) archive.remove(prev->id);
+            }
+            archive.add(e);
+            archive.add_source(job.source,job.stat);
+            added++;
+            printf("%s -> %s %s %05d %s (%zu rows)\n",job.source.c_str(),e.robot.c_str(),e.date.c_str(),
+                e.segment,e.mode.c_str(),e.rows);
+        }
+        catch(const std::exception& e)
+        {
+            std::lock_guard<std::mutex> g(lock);
+            fprintf(stderr,"pallog ingest: %s\n",e.what());
+            failed++;
+        }
+    });
+    archive.save();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%d added, %d duplicate, %d unchanged, %d failed in %.3f s, %zu segments in archive\n",
+        added.load(),duplicate.load(),unchanged,failed.load(),secs,archive.entries().size());
+    return failed ? 1 : 0;
+}
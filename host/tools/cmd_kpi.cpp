@@ -0,0 +1,163 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "archive.hpp"
+#include "batch.hpp"
+#include "kpi.hpp"
+#include "rows.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* A segment to summarize, with what the catalog says about it */
+struct KpiJob
+{
+    std::string path;
+    pal::CatalogEntry entry;
+    pal::KpiList kpis;
+    bool ok = false;
+};
+
+/* Summarize segments of archives, data files or directories of them into one
+ * table, a row per segment, in parallel
+ */
+int cmd_kpi(int argc, char ** argv)
+{
+    unsigned threads = 0;
+    double period = 0.0;
+    std::string outpath;
+    int opt;
+    while((opt = getopt(argc,argv,"j:o:p:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'o':
+            outpath = optarg;
+            break;
+        case 'p':
+            period = atof(optarg);
+            break;
+        default:
+            fprintf(stderr,"usage: pallog kpi [-j N] [-p MS] [-o FILE.csv] ARCHIVE|FILE|DIR...\n");
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"usage: pallog kpi [-j N] [-p MS] [-o FILE.csv] ARCHIVE|FILE|DIR...\n");
+        return 2;
+    }
+
+    /* Archives are recognised by their catalog, anything else is data files */
+    std::vector<KpiJob> jobs;
+    for(int a = optind; a < argc; a++)
+    {
+        struct stat st;
+        std::string catalog = std::string(argv[a]) + "/catalog.csv";
+        if(stat(catalog.c_str(),&st) == 0)
+        {
+            pal::Archive archive(argv[a]);
+            for(const auto& e : archive.entries())
+            {
+                if(e.data.empty()) continue;
+                KpiJob job;
+                job.path = archive.dir() + "/" + e.data;
+                job.entry = e;
+                jobs.push_back(job);
+            }
+            continue;
+        }
+        for(const auto& f : pal::find_logs({argv[a]}))
+        {
+            KpiJob job;
+            job.path = f;
+            job.entry.source = f;
+            jobs.push_back(job);
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::mutex err_lock;
+    std::atomic<int> failed(0);
+    pal::parallel_for(jobs.size(),threads,[&](size_t i)
+    {
+        try
+        {
+            auto src = pal::open_rows(jobs[i].path);
+            jobs[i].kpis = pal::segment_kpis(*src,period);
+            jobs[i].ok = true;
+        }
+        catch(const std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(err_lock);
+            fprintf(stderr,"pallog kpi: %s\n",e.what());
+            failed++;
+        }
+    });
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    /* Columns are the union over the segments, as motors differ between robots */
+    std::vector<std::string> names;
+    std::map<std::string, size_t> index;
+    for(const auto& j : jobs)
+    {
+        for(const auto& k : j.kpis)
+        {
+            if(index.count(k.first)) continue;
+            index[k.first] = names.size();
+            names.push_back(k.first);
+        }
+    }
+
+    FILE * out = stdout;
+    if(!outpath.empty() && !(out = fopen(outpath.c_str(),"w")))
+    {
+        fprintf(stderr,"pallog kpi: %s: %s\n",outpath.c_str(),strerror(errno));
+        return 1;
+    }
+    fprintf(out,"robot,date,segment,mode,source");
+    for(const auto& n : names) fprintf(out,",%s",n.c_str());
+    fprintf(out,"\n");
+    size_t done = 0;
+    for(const auto& j : jobs)
+    {
+        if(!j.ok) continue;
+        const pal::CatalogEntry& e = j.entry;
+        fprintf(out,"%s,%s,",e.robot.c_str(),e.date.c_str());
+        if(e.segment >= 0) fprintf(out,"%d",e.segment);
+        fprintf(out,",%s,%s",e.mode.c_str(),e.source.c_str());
+
+        /* Empty fields for metrics the segment has no data for, as the logger writes */
+        std::vector<double> row(names.size(),NAN);
+        for(const auto& k : j.kpis) row[index[k.first]] = k.second;
+        for(double v : row)
+        {
+            if(std::isfinite(v)) fprintf(out,",%.6g",v);
+            else fprintf(out,",");
+        }
+        fprintf(out,"\n");
+        done++;
+    }
+    if(out != stdout && fclose(out) != 0)
+    {
+        fprintf(stderr,"pallog kpi: %s: %s\n",outpath.c_str(),strerror(errno));
+        return 1;
+    }
+    fprintf(stderr,"%zu segments in %.3f s, %d failed\n",done,secs,failed.load());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "batch.hpp"
+#include "lod.hpp"
+#include "rows.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Build pyramid sidecars for data files (or directories of them), in parallel
+ * Sidecars which are up to date are skipped unless -f is given
+ */
+int cmd_lod(int argc, char ** argv)
+{
+    unsigned threads = 0;
+    bool force = false;
+    int opt;
+    while((opt = getopt(argc,argv,"fj:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'f':
+            force = true;
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr,"usage: pallog lod [-f] [-j N] FILE|DIR...\n");
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"usage: pallog lod [-f] [-j N] FILE|DIR...\n");
+        return 2;
+    }
+
+    std::vector<std::string> files = pal::find_logs(std::vector<std::string>(argv + optind,argv + argc));
+    std::mutex out_lock;
+    std::atomic<int> failed(0);
+    std::atomic<int> skipped(0);
+    auto t0 = std::chrono::steady_clock::now();
+
+    pal::parallel_for(files.size(),threads,[&](size_t i)
+    {
+        std::string out = pal::lod_path(files[i]);
+        try
+        {
+            if(!force)
+            {
+                try
+                {
+                    if(!pal::LodFile(out).stale(files[i]))
+                    {
+                        skipped++;
+                        return;
+                    }
+                }
+                catch(const std::exception&)
+                {
+                    /* Missing or unreadable, so build it */
+                }
+            }
+
+            struct stat st;
+            if(stat(files[i].c_str(),&st) < 0) st.st_size = st.st_mtime = 0;
+            auto src = pal::open_rows(files[i]);
+            pal::write_lod(*src,out,st.st_size,st.st_mtime);
+            pal::LodFile lod(out);
+            std::lock_guard<std::mutex> lock(out_lock);
+            printf("%s -> %s (%zu rows, %zu levels)\n",files[i].c_str(),out.c_str(),lod.rows(),lod.levels());
+        }
+        catch(const std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(out_lock);
+            fprintf(stderr,"pallog lod: %s\n",e.what());
+            failed++;
+        }
+    });
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%zu files in %.3f s, %d up to date, %d failed\n",files.size(),secs,skipped.load(),failed.load());
+    return failed ? 1 : 0;
+}
+
+/* Print the buckets a viewer would plot for a column over a time window */
+int cmd_lod_query(int argc, char ** argv)
+{
+    size_t pixels = 1000;
+    int opt;
+    while((opt = getopt(argc,argv,"p:")) != -1)
+    {
+        if(opt != 'p' || !(pixels = strtoul(optarg,nullptr,10)))
+        {
+            fprintf(stderr,"usage: pallog lod-query [-p PIXELS] FILE.lod COLUMN T0 T1\n");
+            return 2;
+        }
+    }
+    if(argc - optind != 4)
+    {
+        fprintf(stderr,"usage: pallog lod-query [-p PIXELS] FILE.lod COLUMN T0 T1\n");
+        return 2;
+    }
+
+    pal::LodFile lod(argv[optind]);
+    int col = lod.find(argv[optind + 1]);
+    if(col < 0)
+    {
+        fprintf(stderr,"pallog lod-query: no column %s\n",argv[optind + 1]);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    pal::LodWindow w = lod.window(col,atof(argv[optind + 2]),atof(argv[optind + 3]),pixels);
+    double us = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e6;
+
+    if(w.level < 0)
+    {
+        printf("rows %zu to %zu fit in %zu pixels, plot them from the data file\n",w.first_row,w.last_row,
+            pixels);
+        return 0;
+    }
+    printf("level %d, %zu rows per bucket, rows %zu to %zu, %zu buckets, found in %.1f us\n",w.level,
+        w.bucket_rows,w.first_row,w.last_row,w.count,us);
+    const pal::lod_bucket_t * t = lod.buckets(0,w.level) + w.first_row / w.bucket_rows;
+    printf("%12s %14s %14s %14s %14s %14s\n","time","min","max","mean","first","last");
+    for(size_t i = 0; i < w.count; i++)
+    {
+        const pal::lod_bucket_t& b = w.buckets[i];
+        printf("%12.3f %14g %14g %14g %14g %14g\n",t[i].first,b.min,b.max,b.mean,b.first,b.last);
+    }
+    return 0;
+}
@@ -0,0 +1,338 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "telemetry.hpp"
+#include "tty.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t recv_stop = 0;
+
+static void recv_signal(int)
+{
+    recv_stop = 1;
+}
+
+/* Receive the telemetry a stream sink sends, printing the messages and writing the
+ * files the uSD card would have
+ */
+int cmd_recv(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog recv [-n] [-b BAUD] [-q] [-r RAW] [-o DIR] [-t | DEVICE | FILE | -]\n"
+                         "  -n      the link carries the frames alone, not PROS's multiplexed streams,\n"
+                         "          as from a serial smart port (log_sink_port_t)\n"
+                         "  -b BAUD set a serial DEVICE to BAUD\n"
+                         "  -q      don't print messages or console output\n"
+                         "  -r RAW  also save the bytes received to RAW\n"
+                         "  -o DIR  write the log and data files the robot opens into DIR\n"
+                         "  -t      receive on a new pty, whose name is printed, i.e. for palhil -s\n";
+    bool mux = true;
+    int baud = 0;
+    bool quiet = false;
+    bool pty = false;
+    std::string raw_path;
+    std::string dir;
+    int opt;
+    while((opt = getopt(argc,argv,"nb:qr:o:t")) != -1)
+    {
+        switch(opt)
+        {
+        case 'n':
+            mux = false;
+            break;
+        case 'b':
+            baud = atoi(optarg);
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        case 'r':
+            raw_path = optarg;
+            break;
+        case 'o':
+            dir = optarg;
+            break;
+        case 't':
+            pty = true;
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind + (pty ? 0 : 1) != argc)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    int slave = -1;
+    int fd;
+    if(pty)
+    {
+        std::string name;
+        fd = pal::tty_pty(slave,name);
+        printf("%s\n",name.c_str());
+        fflush(stdout);
+    }
+    else if(!strcmp(argv[optind],"-"))
+    {
+        fd = STDIN_FILENO;
+    }
+    else
+    {
+        fd = pal::tty_open(argv[optind],O_RDONLY,baud);
+    }
+
+    std::unique_ptr<FILE,int (*)(FILE *)> raw(nullptr,fclose);
+    if(!raw_path.empty())
+    {
+        raw.reset(fopen(raw_path.c_str(),"wb"));
+        if(!raw) throw std::runtime_error(raw_path + ": " + strerror(errno));
+    }
+    std::unique_ptr<pal::TelemetryWriter> writer;
+    if(!dir.empty())
+    {
+        if(mkdir(dir.c_str(),0777) && errno != EEXIST) throw std::runtime_error(dir + ": " + strerror(errno));
+        writer.reset(new pal::TelemetryWriter(dir));
+    }
+
+    pal::TelemetryDecoder dec(mux,
+        [&](const pal::TelemetryFrame& f)
+        {
+            if(writer)
+            {
+                writer->write(f);
+                if(f.wire.type == LOG_SINK_OPEN)
+                {
+                    fprintf(stderr,"recv: writing %s and %s\n",writer->text_path().c_str(),writer->data_path().c_str());
+                }
+            }
+            if(!quiet && f.wire.type == LOG_SINK_MSG) printf("%s\n",pal::format_message(f).c_str());
+        },
+        [&](const char * text, size_t len, bool err)
+        {
+            if(!quiet) fwrite(text,1,len,err ? stderr : stdout);
+        });
+
+    /* Stop on ^C or the end of the input, without SA_RESTART so read() returns */
+    struct sigaction sa;
+    memset(&sa,0,sizeof(sa));
+    sa.sa_handler = recv_signal;
+    sigaction(SIGINT,&sa,nullptr);
+    sigaction(SIGTERM,&sa,nullptr);
+
+    uint8_t buf[4096];
+    while(!recv_stop)
+    {
+        ssize_t n = read(fd,buf,sizeof(buf));
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0) throw std::runtime_error(std::string("read: ") + strerror(errno));
+        if(n == 0) break;
+        if(raw) fwrite(buf,1,n,raw.get());
+        dec.feed(buf,n);
+        fflush(stdout);
+    }
+    if(slave >= 0) close(slave);
+    if(fd != STDIN_FILENO) close(fd);
+
+    const pal::TelemetryStats& st = dec.stats();
+    fprintf(stderr,"recv: %llu bytes, %llu frames, %llu bad, %llu lost on the link, %llu dropped by the robot, "
+        "%llu bytes of console\n",static_cast<unsigned long long>(st.bytes),static_cast<unsigned long long>(st.frames),
+        static_cast<unsigned long long>(st.bad),static_cast<unsigned long long>(st.lost),
+        static_cast<unsigned long long>(st.dropped),static_cast<unsigned long long>(st.console));
+    return 0;
+}
+
+/* What one run of bench-link saw */
+struct LinkResult
+{
+    uint64_t bytes = 0;         /* Received after the first read, over secs */
+    uint64_t payload = 0;       /* Payload bytes in the frames received after the first read */
+    double secs = 0.0;          /* From the first read to the last */
+    pal::TelemetryStats st;
+};
+
+/* Replay log on palhil for secs seconds of real time, its logger sending all its
+ * records through log_sink_port_t on a smart port at baud, and receive what the
+ * port sends on a pty, flipping bits at rate ber on the way
+ * The sink's rate control and buffering are the robot's own, so what arrives, and
+ * what the sink skipped to keep to the rate, are what a robot replaying the log would give
+ */
+static LinkResult bench_link(const std::string& palhil, const std::string& log, int baud, double secs, double ber)
+{
+    int slave;
+    std::string name;
+    int master = pal::tty_pty(slave,name);
+    char card[] = "/tmp/pallogXXXXXX";
+    if(!mkdtemp(card)) throw std::runtime_error(std::string("mkdtemp: ") + strerror(errno));
+
+    /* The logger only writes data rows with a card to write them to */
+    std::string sink = "1=" + std::to_string(baud);
+    std::string port = "1=" + name;
+    std::string usd = std::string(card) + "/usd";
+    const char * args[] = {palhil.c_str(),"-q","-x","1","-o",usd.c_str(),"-t",sink.c_str(),"-p",port.c_str(),
+                           log.c_str(),nullptr};
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) throw std::runtime_error(std::string("fork: ") + strerror(errno));
+    if(!pid)
+    {
+        int null = open("/dev/null",O_WRONLY);
+        if(null >= 0) dup2(null,STDERR_FILENO);
+        execv(args[0],const_cast<char * const *>(args));
+        _exit(127);
+    }
+
+    LinkResult res;
+    typedef std::chrono::steady_clock clock;
+    clock::time_point first, last;
+    bool got = false;
+    pal::TelemetryDecoder dec(false,[&](const pal::TelemetryFrame& f) { if(got) res.payload += f.payload.size(); });
+    std::mt19937 rng(baud);
+    std::uniform_int_distribution<int> bit(0,7);
+    std::uniform_real_distribution<double> unit(0.0,1.0);
+    const double flip = 1.0 - std::pow(1.0 - ber,8.0);
+    clock::time_point end = clock::now() + std::chrono::seconds(30);
+    int status = 0;
+    bool exited = false;
+    while(true)
+    {
+        int left = std::chrono::duration_cast<std::chrono::milliseconds>(end - clock::now()).count();
+        if(left <= 0) break;
+        struct pollfd p = {master,POLLIN,0};
+        int r = poll(&p,1,std::min(left,500));
+        if(r < 0 && errno != EINTR) break;
+        if(r <= 0)
+        {
+            /* Stop early if palhil has, having failed or come to the end of the log */
+            exited = (waitpid(pid,&status,WNOHANG) == pid);
+            if(exited) break;
+            continue;
+        }
+        uint8_t buf[4096];
+        ssize_t n = read(master,buf,sizeof(buf));
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) break;
+        for(ssize_t i = 0; flip > 0.0 && i < n; i++)
+        {
+            if(unit(rng) < flip) buf[i] ^= static_cast<uint8_t>(1 << bit(rng));
+        }
+        dec.feed(buf,n);
+        last = clock::now();
+        if(got)
+        {
+            res.bytes += n;
+            continue;
+        }
+        first = last;
+        end = first + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(secs));
+        got = true;
+    }
+
+    if(!exited)
+    {
+        kill(pid,SIGTERM);
+        waitpid(pid,&status,0);
+    }
+    close(master);
+    close(slave);
+    std::error_code ec;
+    std::filesystem::remove_all(card,ec);
+    if(WIFEXITED(status) && WEXITSTATUS(status)) throw std::runtime_error(palhil + " failed to run " + log);
+    res.secs = got ? std::chrono::duration<double>(last - first).count() : 0.0;
+    res.st = dec.stats();
+    return res;
+}
+
+/* palhil, from beside this program */
+static std::string bench_palhil()
+{
+    char self[4096];
+    ssize_t n = readlink("/proc/self/exe",self,sizeof(self) - 1);
+    if(n <= 0) return "palhil";
+    std::string path(self,n);
+    return path.substr(0,path.rfind('/') + 1) + "palhil";
+}
+
+/* Measure what a serial link carries: a log replayed on palhil, sent through the
+ * smart port sink at each baud rate
+ */
+int cmd_bench_link(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog bench-link [-b BAUD,..] [-s SECS] [-e BER] [-H PALHIL] LOG\n"
+                         "  -b BAUD,..  baud rates to run at, 115200,230400,460800,921600 by default\n"
+                         "  -s SECS     seconds to receive for at each, 10 by default\n"
+                         "  -e BER      bit error rate of the link, 0 by default\n"
+                         "  -H PALHIL   palhil to replay LOG on, that beside pallog by default\n";
+    std::string bauds = "115200,230400,460800,921600";
+    double secs = 10.0;
+    double ber = 0.0;
+    std::string palhil = bench_palhil();
+    int opt;
+    while((opt = getopt(argc,argv,"b:s:e:H:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'b':
+            bauds = optarg;
+            break;
+        case 's':
+            secs = atof(optarg);
+            break;
+        case 'e':
+            ber = atof(optarg);
+            break;
+        case 'H':
+            palhil = optarg;
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind + 1 != argc || secs <= 0.0)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    printf("%8s %10s %6s %10s %9s %9s %7s %7s\n","baud","line B/s","line%","data B/s","received",
+        "dropped","lost","bad");
+    for(const char * p = bauds.c_str(); *p;)
+    {
+        int baud = atoi(p);
+        p += strcspn(p,",");
+        if(*p) p++;
+        if(baud <= 0) continue;
+
+        LinkResult r = bench_link(palhil,argv[optind],baud,secs,ber);
+        double line = r.secs > 0.0 ? r.bytes / r.secs : 0.0;
+        printf("%8d %10.0f %5.1f%% %10.0f %9llu %9llu %7llu %7llu\n",baud,line,100.0 * line / (baud / 10.0),
+            r.secs > 0.0 ? r.payload / r.secs : 0.0,static_cast<unsigned long long>(r.st.frames),
+            static_cast<unsigned long long>(r.st.dropped),static_cast<unsigned long long>(r.st.lost),
+            static_cast<unsigned long long>(r.st.bad));
+        fflush(stdout);
+    }
+    return 0;
+}
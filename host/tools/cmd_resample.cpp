@@ -0,0 +1,108 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "arrow.hpp"
+#include "lod.hpp"
+#include "mat.hpp"
+#include "resample.hpp"
+#include "rows.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/* Parse a time range in seconds ("T0:T1", either end may be empty), leaving
+ * missing ends NaN
+ */
+static bool parse_range(const char * arg, double& t0, double& t1)
+{
+    char * end;
+    if(*arg != ':')
+    {
+        t0 = strtod(arg,&end);
+        if(*end != ':') return false;
+        arg = end;
+    }
+    arg++;
+    if(*arg)
+    {
+        t1 = strtod(arg,&end);
+        if(*end) return false;
+    }
+    return true;
+}
+
+/* True if path ends with ext */
+static bool has_ext(const std::string& path, const char * ext)
+{
+    size_t n = strlen(ext);
+    return path.size() >= n && !path.compare(path.size() - n,n,ext);
+}
+
+/* Resample channels of one or more segments onto a uniform grid, and write the
+ * result as .mat or .feather by the output's extension
+ */
+int cmd_resample(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog resample [-m hold|linear|nearest] [-d DT] [-c CH,...] [-t T0:T1] "
+        "-o OUT.mat|OUT.feather FILE...\n";
+    pal::ResampleOptions opt;
+    std::string outpath;
+    int opt_c;
+    while((opt_c = getopt(argc,argv,"c:d:m:o:t:")) != -1)
+    {
+        switch(opt_c)
+        {
+        case 'c':
+        {
+            std::string list = optarg;
+            size_t p = 0;
+            while(p <= list.size())
+            {
+                size_t q = list.find(',',p);
+                if(q == std::string::npos) q = list.size();
+                if(q > p) opt.channels.push_back(list.substr(p,q - p));
+                p = q + 1;
+            }
+            break;
+        }
+        case 'd':
+            opt.dt = atof(optarg);
+            break;
+        case 'm':
+            opt.method = pal::resample_method(optarg);
+            break;
+        case 'o':
+            outpath = optarg;
+            break;
+        case 't':
+            if(parse_range(optarg,opt.t0,opt.t1)) break;
+            /* Fall through */
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind >= argc || outpath.empty() || !(has_ext(outpath,".mat") || has_ext(outpath,".feather")))
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<pal::RowSource>> sources;
+    for(int i = optind; i < argc; i++) sources.push_back(pal::open_rows(argv[i]));
+    auto rows = pal::resample(std::move(sources),opt);
+    if(has_ext(outpath,".mat")) pal::write_mat(*rows,outpath);
+    else pal::write_arrow(*rows,outpath);
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%s: %zu rows, %zu columns in %.3f s\n",outpath.c_str(),rows->rows(),rows->columns().size(),secs);
+    return 0;
+}
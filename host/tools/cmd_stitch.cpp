@@ -0,0 +1,79 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "archive.hpp"
+#include "arrow.hpp"
+#include "mat.hpp"
+#include "rows.hpp"
+#include "stitch.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/* Join the segments of each run in card dumps into run%05d data and text files */
+int cmd_stitch(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog stitch [-o DIR] [-x .mat|.feather] DIR...\n";
+    std::string outdir;
+    std::string ext = ".feather";
+    int opt;
+    while((opt = getopt(argc,argv,"o:x:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'o':
+            outdir = optarg;
+            break;
+        case 'x':
+            ext = optarg;
+            if(ext == ".mat" || ext == ".feather") break;
+            /* Fall through */
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind >= argc)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+
+    for(int a = optind; a < argc; a++)
+    {
+        std::string dir = outdir.empty() ? std::string(argv[a]) : outdir;
+        for(const auto& run : pal::find_runs(pal::find_segments(argv[a])))
+        {
+            char base[32];
+            snprintf(base,sizeof(base),"/run%05d",run.boot);
+            std::string data = dir + base + ext;
+            std::string text = dir + base + ".txt";
+
+            std::vector<std::unique_ptr<pal::RowSource>> srcs;
+            for(const auto& s : run.segs)
+            {
+                if(!s.data.empty()) srcs.push_back(pal::open_rows(s.data));
+            }
+            size_t rows = 0, ncols = 0;
+            if(!srcs.empty())
+            {
+                auto rs = pal::concat_rows(std::move(srcs));
+                if(ext == ".mat") pal::write_mat(*rs,data);
+                else pal::write_arrow(*rs,data);
+                rows = rs->rows();
+                ncols = rs->columns().size();
+            }
+            pal::concat_logs(run.segs,text);
+
+            printf("run %d: segments %d-%d -> %s %s (%zu rows, %zu columns)\n",run.boot,run.segs.front().segment,
+                run.segs.back().segment,text.c_str(),rows ? data.c_str() : "",rows,ncols);
+        }
+    }
+    return 0;
+}
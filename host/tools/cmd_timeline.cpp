@@ -0,0 +1,279 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "rows.hpp"
+#include "timeline.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+/* Rows read per block */
+#define TIMELINE_BLOCK_ROWS 4096
+
+/* Parse a time range in seconds ("T0:T1", either end may be empty), leaving
+ * missing ends as they were
+ */
+static bool parse_range(const char * arg, double& t0, double& t1)
+{
+    char * end;
+    if(*arg != ':')
+    {
+        t0 = strtod(arg,&end);
+        if(*end != ':') return false;
+        arg = end;
+    }
+    arg++;
+    if(*arg)
+    {
+        t1 = strtod(arg,&end);
+        if(*end) return false;
+    }
+    return true;
+}
+
+/* Cross index of a text log and data file, built first if missing or out of date */
+static std::unique_ptr<pal::Timeline> open_index(const std::string& log, const std::string& data)
+{
+    std::string path = pal::timeline_path(data);
+    try
+    {
+        std::unique_ptr<pal::Timeline> tl(new pal::Timeline(path,log));
+        if(!tl->stale(data)) return tl;
+    }
+    catch(const std::exception&)
+    {
+        /* Missing or unreadable, so build it */
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    pal::write_timeline(log,data,path);
+    std::unique_ptr<pal::Timeline> tl(new pal::Timeline(path,log));
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    fprintf(stderr,"%s: %zu messages, %zu rows, indexed in %.3f s\n",path.c_str(),tl->messages(),tl->rows(),secs);
+    return tl;
+}
+
+/* Indexes of comma separated column names, or of every column if list is empty
+ * Returns false if a name is not a column
+ */
+static bool pick_columns(const pal::RowSource& src, const std::string& list, std::vector<size_t>& out)
+{
+    const auto& cols = src.columns();
+    if(list.empty())
+    {
+        for(size_t c = 1; c < cols.size(); c++) out.push_back(c);
+        return true;
+    }
+    size_t a = 0;
+    while(a <= list.size())
+    {
+        size_t b = list.find(',',a);
+        if(b == std::string::npos) b = list.size();
+        std::string name = list.substr(a,b - a);
+        size_t c = 0;
+        while(c < cols.size() && cols[c].name != name) c++;
+        if(c == cols.size())
+        {
+            fprintf(stderr,"no column %s\n",name.c_str());
+            return false;
+        }
+        out.push_back(c);
+        a = b + 1;
+    }
+    return true;
+}
+
+/* Write a message as the last two fields of a merged row, quoted for CSV */
+static void print_message(FILE * out, const pal::LogMessage& m, size_t ncols)
+{
+    fprintf(out,"%.3f",m.time);
+    for(size_t c = 0; c < ncols; c++) fputc(',',out);
+    fprintf(out,",%s,\"%s line %d: ",pal::log_level_name(m.level),m.file.c_str(),m.line);
+    for(char ch : m.text)
+    {
+        if(ch == '"') fputc('"',out);
+        fputc(ch,out);
+    }
+    fputs("\"\n",out);
+}
+
+/* Merge a text log into its data rows in time order, as CSV with the level and
+ * message as two extra columns, empty on data rows
+ */
+int cmd_timeline(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog timeline [-c COL,...] [-t T0:T1] [-o CSV] LOG DATA\n";
+    std::string list;
+    std::string outpath;
+    double t0 = -INFINITY, t1 = INFINITY;
+    int opt;
+    while((opt = getopt(argc,argv,"c:o:t:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c':
+            list = optarg;
+            break;
+        case 'o':
+            outpath = optarg;
+            break;
+        case 't':
+            if(parse_range(optarg,t0,t1)) break;
+            /* Fall through */
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(argc - optind != 2)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+    std::string log = argv[optind];
+    std::string data = argv[optind + 1];
+
+    auto tl = open_index(log,data);
+    auto src = pal::open_rows(data);
+    std::vector<size_t> cols;
+    if(!pick_columns(*src,list,cols)) return 1;
+
+    FILE * out = outpath.empty() ? stdout : fopen(outpath.c_str(),"w");
+    if(!out)
+    {
+        perror(outpath.c_str());
+        return 1;
+    }
+
+    fprintf(out,"time");
+    for(size_t c : cols) fprintf(out,",%s",src->columns()[c].name.c_str());
+    fprintf(out,",level,message\n");
+
+    /* Start at the first row and message in the window */
+    auto rows = tl->range(t0,t1);
+    if(rows.first < rows.second) tl->seek(*src,rows.first);
+    size_t m = 0;
+    while(m < tl->messages() && tl->entry(m).time < t0) m++;
+
+    const size_t ncols = src->columns().size();
+    std::vector<double> block(ncols * TIMELINE_BLOCK_ROWS);
+    size_t row = rows.first;
+    while(row < rows.second)
+    {
+        size_t n = src->read(block.data(),TIMELINE_BLOCK_ROWS);
+        if(!n) break;
+        for(size_t r = 0; r < n && row < rows.second; r++, row++)
+        {
+            double t = block[r];
+            for(; m < tl->messages() && tl->entry(m).time < t; m++) print_message(out,tl->message(m),cols.size());
+            fprintf(out,"%.3f",t);
+            for(size_t c : cols)
+            {
+                double v = block[c * TIMELINE_BLOCK_ROWS + r];
+                if(std::isnan(v)) fputc(',',out);
+                else fprintf(out,",%.9g",v);
+            }
+            fprintf(out,",,\n");
+        }
+    }
+    for(; m < tl->messages() && tl->entry(m).time <= t1; m++) print_message(out,tl->message(m),cols.size());
+
+    if(out != stdout && fclose(out) != 0)
+    {
+        perror(outpath.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+/* Print data rows within a window around each matching message, found through
+ * the cross index rather than by reading the files
+ */
+int cmd_around(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog around [-l LEVEL] [-g TEXT] [-w MS] [-c COL,...] LOG DATA\n";
+    int level = pal::log_level("ERROR");
+    std::string grep;
+    std::string list;
+    double window = 500.0;
+    int opt;
+    while((opt = getopt(argc,argv,"c:g:l:w:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c':
+            list = optarg;
+            break;
+        case 'g':
+            grep = optarg;
+            break;
+        case 'l':
+            /* Any level is one past them all */
+            level = strcmp(optarg,"any") ? pal::log_level(optarg) : TIMELINE_NO_LEVEL + 1;
+            if(level >= 0) break;
+            /* Fall through */
+        case 'w':
+            if(opt == 'w' && (window = atof(optarg)) >= 0.0) break;
+            /* Fall through */
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(argc - optind != 2)
+    {
+        fprintf(stderr,"%s",usage);
+        return 2;
+    }
+    std::string log = argv[optind];
+    std::string data = argv[optind + 1];
+
+    auto tl = open_index(log,data);
+    auto src = pal::open_rows(data);
+    std::vector<size_t> cols;
+    if(!pick_columns(*src,list,cols)) return 1;
+
+    auto t0 = std::chrono::steady_clock::now();
+    const size_t ncols = src->columns().size();
+    std::vector<double> block;
+    size_t found = 0, shown = 0;
+    for(size_t i = 0; i < tl->messages(); i++)
+    {
+        if(level <= TIMELINE_NO_LEVEL && tl->entry(i).level != level) continue;
+        pal::LogMessage m = tl->message(i);
+        if(!grep.empty() && m.text.find(grep) == std::string::npos) continue;
+        found++;
+
+        printf("%s%08.3f [%s] in %s line %d: %s\n",found > 1 ? "\n" : "",m.time,pal::log_level_name(m.level),
+            m.file.c_str(),m.line,m.text.c_str());
+        auto rows = tl->range(m.time - window / 1000.0,m.time + window / 1000.0);
+        if(rows.first == rows.second) continue;
+
+        size_t n = rows.second - rows.first;
+        block.resize(ncols * n);
+        tl->seek(*src,rows.first);
+        n = src->read(block.data(),n);
+        printf("  %10s","dt_ms");
+        for(size_t c : cols) printf(" %14s",src->columns()[c].name.c_str());
+        printf("\n");
+        for(size_t r = 0; r < n; r++)
+        {
+            printf("%c %10.1f",rows.first + r == m.row ? '*' : ' ',(block[r] - m.time) * 1000.0);
+            for(size_t c : cols) printf(" %14g",block[c * (rows.second - rows.first) + r]);
+            printf("\n");
+        }
+        shown += n;
+    }
+
+    double ms = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1000.0;
+    fprintf(stderr,"%zu of %zu messages, %zu rows in %.3f ms\n",found,tl->messages(),shown,ms);
+    return 0;
+}
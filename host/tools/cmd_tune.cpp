@@ -0,0 +1,201 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#include "commands.hpp"
+#include "batch.hpp"
+#include "tune.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+/* Parameters tuned when none are given: those the logged sensors constrain best */
+static const char * tune_default = "r_gps_xy,q_v,q_a,r_odom_v,r_odom_w,r_gyro";
+
+/* Parse NAME[=LO:HI[:STEPS]],... into params, the range defaulting to two decades
+ * either side of the base value
+ */
+static void parse_params(const char * arg, const pal::EkfParams& base, int steps, std::vector<pal::TuneParam>& params)
+{
+    std::string list = arg;
+    size_t pos = 0;
+    while(pos <= list.size())
+    {
+        size_t end = list.find(',',pos);
+        if(end == std::string::npos) end = list.size();
+        std::string item = list.substr(pos,end - pos);
+        pos = end + 1;
+        if(item.empty()) continue;
+
+        pal::TuneParam p;
+        size_t eq = item.find('=');
+        p.name = item.substr(0,eq);
+        double v = pal::tune_get(base,p.name);
+        if(std::isnan(v)) throw std::runtime_error("unknown parameter " + p.name);
+        p.lo = std::log10(v) - 2.0;
+        p.hi = std::log10(v) + 2.0;
+        p.steps = steps;
+        if(eq != std::string::npos)
+        {
+            double lo, hi;
+            int n = 0;
+            int got = sscanf(item.c_str() + eq + 1,"%lf:%lf:%d",&lo,&hi,&n);
+            if(got < 2 || !(lo > 0.0) || !(hi >= lo)) throw std::runtime_error("bad range for " + p.name);
+            p.lo = std::log10(lo);
+            p.hi = std::log10(hi);
+            if(got == 3 && n > 0) p.steps = n;
+        }
+        params.push_back(p);
+    }
+}
+
+static void print_scores(const std::vector<pal::TuneLog>& logs, const pal::EkfReplay& opt, double max_error,
+                         unsigned threads)
+{
+    std::vector<pal::TuneScore> scores(logs.size());
+    pal::parallel_for(logs.size(),threads,[&](size_t i) { scores[i] = pal::score_log(logs[i],opt,max_error); });
+    printf("  %-40s %7s %9s %9s %9s %9s\n","log","scored","rms m","p95 m","max m","gps err");
+    for(size_t i = 0; i < logs.size(); i++)
+    {
+        const auto& s = scores[i];
+        printf("  %-40s %7zu %9.4f %9.4f %9.4f %9.4f\n",logs[i].path.c_str(),s.count,s.rms,s.p95,s.max,s.gps_error);
+    }
+}
+
+/* Search the estimator's noise parameters for the lowest error at GPS readings
+ * held out of the replay, over every log given
+ */
+int cmd_tune(int argc, char ** argv)
+{
+    const char * usage = "usage: pallog tune [-m grid|nm] [-p NAME[=LO:HI[:STEPS]],...] [-s STEPS] [-i ITER] "
+                         "[-k N] [-e M] [-g DEG] [-a] [-j N] FILE|DIR...\n";
+    pal::EkfReplay base;
+    base.gps_every = 2;
+    const char * plist = tune_default;
+    bool grid = false;
+    int steps = 3;
+    int iterations = 200;
+    double max_error = 0.05;
+    unsigned threads = 0;
+    int c;
+    while((c = getopt(argc,argv,"ae:g:i:j:k:m:p:s:")) != -1)
+    {
+        switch(c)
+        {
+        case 'a':
+            base.accel = true;
+            break;
+        case 'e':
+            max_error = atof(optarg);
+            break;
+        case 'g':
+            base.gps_offset = atof(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'j':
+            threads = static_cast<unsigned>(atoi(optarg));
+            break;
+        case 'k':
+            base.gps_every = atoi(optarg);
+            break;
+        case 'm':
+            if(!strcmp(optarg,"grid")) grid = true;
+            else if(!strcmp(optarg,"nm")) grid = false;
+            else
+            {
+                fprintf(stderr,"%s",usage);
+                return 2;
+            }
+            break;
+        case 'p':
+            plist = optarg;
+            break;
+        case 's':
+            steps = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr,"%s",usage);
+            return 2;
+        }
+    }
+    if(optind >= argc || base.gps_every < 2 || steps < 1)
+    {
+        fprintf(stderr,"%s",usage);
+        if(base.gps_every < 2) fprintf(stderr,"-k must be at least 2, to leave GPS readings to score against\n");
+        fprintf(stderr,"parameters: ");
+        for(const auto& n : pal::tune_param_names()) fprintf(stderr,"%s ",n.c_str());
+        fprintf(stderr,"\n");
+        return 2;
+    }
+
+    std::vector<pal::TuneParam> params;
+    parse_params(plist,base.params,steps,params);
+
+    /* Load every log once, in parallel */
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::string> files = pal::find_logs(std::vector<std::string>(argv + optind,argv + argc));
+    std::vector<pal::TuneLog> loaded(files.size());
+    std::vector<std::string> errors(files.size());
+    pal::parallel_for(files.size(),threads,[&](size_t i)
+    {
+        try
+        {
+            loaded[i] = pal::load_tune_log(files[i]);
+        }
+        catch(const std::exception& e)
+        {
+            errors[i] = e.what();
+        }
+    });
+    std::vector<pal::TuneLog> logs;
+    size_t rows = 0;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        if(!errors[i].empty())
+        {
+            fprintf(stderr,"skipping %s\n",errors[i].c_str());
+            continue;
+        }
+        rows += loaded[i].rows.size();
+        logs.push_back(std::move(loaded[i]));
+    }
+    if(logs.empty()) throw std::runtime_error("no logs to tune against");
+    auto t1 = std::chrono::steady_clock::now();
+
+    pal::Tuner tuner(logs,base,params,threads,max_error);
+    double before = tuner.evaluate({tuner.start()})[0];
+    double best;
+    std::vector<double> x = grid ? tuner.grid(best) : tuner.nelder_mead(iterations,best);
+    auto t2 = std::chrono::steady_clock::now();
+
+    unsigned cores = threads ? threads : std::thread::hardware_concurrency();
+    double load_s = std::chrono::duration<double>(t1 - t0).count();
+    double search_s = std::chrono::duration<double>(t2 - t1).count();
+    printf("%zu logs, %zu rows loaded in %.2f s; %zu candidates (%s) in %.2f s on %u threads, %.1f us per row\n",
+        logs.size(),rows,load_s,tuner.evaluations(),grid ? "grid" : "Nelder-Mead",search_s,cores,
+        1e6 * search_s * cores / (static_cast<double>(rows) * tuner.evaluations()));
+    printf("scoring 1 in %d GPS readings with error under %.3f m\n\n",base.gps_every,max_error);
+
+    pal::EkfReplay tuned = tuner.apply(x);
+    printf("%-12s %12s %12s %9s\n","parameter","base","best","range");
+    for(size_t i = 0; i < params.size(); i++)
+    {
+        printf("%-12s %12.4g %12.4g %4.0e:%.0e\n",params[i].name.c_str(),pal::tune_get(base.params,params[i].name),
+            pal::tune_get(tuned.params,params[i].name),std::pow(10.0,params[i].lo),std::pow(10.0,params[i].hi));
+    }
+    printf("\nrms %.4f m with the base parameters:\n",before);
+    print_scores(logs,base,max_error,threads);
+    printf("\nrms %.4f m with the best parameters:\n",best);
+    print_scores(logs,tuned,max_error,threads);
+    return 0;
+}
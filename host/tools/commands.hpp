@@ -0,0 +1,33 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_COMMANDS_HPP_
+#define _PAL_COMMANDS_HPP_
+
+/* Subcommands of pallog, each takes the arguments following the command name
+ * (argv[0] is the command name) and returns the process exit status
+ */
+int cmd_csv(int argc, char ** argv);
+int cmd_bench_csv(int argc, char ** argv);
+int cmd_bin(int argc, char ** argv);
+int cmd_bench_bin(int argc, char ** argv);
+int cmd_mat(int argc, char ** argv);
+int cmd_arrow(int argc, char ** argv);
+int cmd_lod(int argc, char ** argv);
+int cmd_lod_query(int argc, char ** argv);
+int cmd_ingest(int argc, char ** argv);
+int cmd_kpi(int argc, char ** argv);
+int cmd_resample(int argc, char ** argv);
+int cmd_stitch(int argc, char ** argv);
+int cmd_timeline(int argc, char ** argv);
+int cmd_around(int argc, char ** argv);
+int cmd_ekf(int argc, char ** argv);
+int cmd_tune(int argc, char ** argv);
+int cmd_recv(int argc, char ** argv);
+int cmd_bench_link(int argc, char ** argv);
+int cmd_fetch(int argc, char ** argv);
+
+#endif /* _PAL_COMMANDS_HPP_ */
@@ -0,0 +1,82 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* pallog, the host tool for working with logs pulled off the robot */
+
+#include "commands.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+/* Table of subcommands */
+static const struct
+{
+    const char * name;
+    int (*fn)(int, char **);
+    const char * args;
+    const char * help;
+} commands[] =
+{
+    {"csv",cmd_csv,"FILE...","Load CSV data files and summarize each column"},
+    {"bench-csv",cmd_bench_csv,"[-j N] [-r R] FILE...","Measure CSV load throughput"},
+    {"bin",cmd_bin,"[-t T0:T1] FILE...","Summarize binary data files, within T0 to T1 seconds"},
+    {"bench-bin",cmd_bench_bin,"[-r R] FILE...","Measure binary open and column scan throughput"},
+    {"mat",cmd_mat,"[-j N] [-o DIR] FILE|DIR...","Convert data files to MATLAB .mat files"},
+    {"arrow",cmd_arrow,"[-j N] [-o DIR] FILE|DIR...","Convert data files to Arrow IPC (.feather) files"},
+    {"lod",cmd_lod,"[-f] [-j N] FILE|DIR...","Build min/max pyramid sidecars (.lod) for plotting"},
+    {"lod-query",cmd_lod_query,"[-p PIXELS] FILE.lod COLUMN T0 T1","Fetch a time window at screen resolution"},
+    {"ingest",cmd_ingest,"[-j N] [-r ROBOT] ARCHIVE DIR...","Add card dumps to a deduplicated log archive"},
+    {"kpi",cmd_kpi,"[-j N] [-p MS] [-o CSV] ARCHIVE|DIR...","Summarize battery, motor, loop and GPS metrics per segment"},
+    {"resample",cmd_resample,"[-m M] [-d DT] [-c CH,..] -o OUT FILE...","Resample channels onto a uniform time grid"},
+    {"stitch",cmd_stitch,"[-o DIR] [-x .mat|.feather] DIR...","Join the segments of each run into one timeline"},
+    {"timeline",cmd_timeline,"[-c COL,..] [-t T0:T1] [-o CSV] LOG DATA","Merge text log messages into the data rows"},
+    {"around",cmd_around,"[-l LVL] [-w MS] [-c COL,..] LOG DATA","Show rows around each matching message"},
+    {"ekf",cmd_ekf,"[-a] [-n] [-g DEG] [-o DIR] FILE|DIR...","Replay logs through the pose estimator"},
+    {"tune",cmd_tune,"[-m grid|nm] [-p NAME=LO:HI,..] FILE|DIR...","Search estimator noise parameters against held out GPS"},
+    {"recv",cmd_recv,"[-n] [-b BAUD] [-o DIR] [-t | DEVICE]","Receive telemetry from the robot, rebuilding its log files"},
+    {"bench-link",cmd_bench_link,"[-b BAUD,..] [-s SECS] [-e BER] LOG","Measure the smart port sink's throughput and loss, replaying LOG on palhil"},
+    {"fetch",cmd_fetch,"[-o DIR] [-a] [-l] [-w N] [-t | DEVICE] [NAME...]","Fetch the log files from the robot over its USB link"},
+};
+
+static void usage()
+{
+    fprintf(stderr,"usage: pallog COMMAND [ARGS]\n\n");
+    for(const auto& c : commands)
+    {
+        fprintf(stderr,"  pallog %-10s %-40s %s\n",c.name,c.args,c.help);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        usage();
+        return 2;
+    }
+
+    for(const auto& c : commands)
+    {
+        if(!strcmp(argv[1],c.name))
+        {
+            /* Library errors are exceptions, report them here rather than in every command */
+            try
+            {
+                return c.fn(argc - 1,argv + 1);
+            }
+            catch(const std::exception& e)
+            {
+                fprintf(stderr,"pallog %s: %s\n",c.name,e.what());
+                return 1;
+            }
+        }
+    }
+
+    fprintf(stderr,"pallog: unknown command '%s'\n\n",argv[1]);
+    usage();
+    return 2;
+}
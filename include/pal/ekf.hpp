@@ -0,0 +1,319 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_EKF_HPP_
+#define _PAL_EKF_HPP_
+
+/* Extended Kalman filter for the robot's pose, from model/model.m
+ *
+ * The state is the pose in field coordinates and its derivatives in the robot's
+ * frame: x and y in m, heading theta in radians counterclockwise from the x axis,
+ * forward and normal (leftward) velocity in m/s, turn rate in rad/s, and the
+ * derivatives of those three. The accelerations and angular acceleration are
+ * random walks driven by the process noise.
+ *
+ * Measurements are all optional, and each update takes one sensor's reading:
+ *   GPS position and heading, with the sensor's own error estimate
+ *   gyro turn rate
+ *   accelerometer, which sees the centripetal terms as well as af and an
+ *   wheel odometry, as forward velocity and turn rate
+ * Readings which are not finite are skipped, so the values the poller logs before
+ * a sensor is ready can be passed straight in.
+ *
+ * Everything is fixed size and held in the object, with no heap use, so it runs
+ * in the control loop on the brain. The header has no dependencies on PROS, so the
+ * host tools build the same filter to replay logs.
+ */
+#include "pal/matrix.hpp"
+
+namespace pal
+{
+
+/* State vector elements */
+enum
+{
+    EKF_X,
+    EKF_Y,
+    EKF_THETA,
+    EKF_VF,
+    EKF_VN,
+    EKF_OMEGA,
+    EKF_AF,
+    EKF_AN,
+    EKF_ALPHA,
+    EKF_STATES
+};
+
+/* Innovations (measurement minus prediction) of the last step, by sensor */
+enum
+{
+    EKF_NU_GPS_X,
+    EKF_NU_GPS_Y,
+    EKF_NU_GPS_THETA,
+    EKF_NU_GYRO,
+    EKF_NU_AF,
+    EKF_NU_AN,
+    EKF_NU_ODOM_V,
+    EKF_NU_ODOM_W,
+    EKF_INNOVATIONS
+};
+
+/* Channel names of the state and innovations, as log_data(const Ekf&) logs them */
+constexpr const char * ekf_state_names[EKF_STATES] =
+{
+    "ekf_x","ekf_y","ekf_theta","ekf_vf","ekf_vn","ekf_omega","ekf_af","ekf_an","ekf_alpha"
+};
+constexpr const char * ekf_innovation_names[EKF_INNOVATIONS] =
+{
+    "ekf_nu_gps_x","ekf_nu_gps_y","ekf_nu_gps_theta","ekf_nu_gyro","ekf_nu_af","ekf_nu_an",
+    "ekf_nu_odom_v","ekf_nu_odom_w"
+};
+
+struct EkfParams
+{
+    /* Step of predict(), the control loop period in seconds */
+    double dt = 0.02;
+
+    /* Process noise, as the variance each state gains per second */
+    double q[EKF_STATES] = {1e-4,1e-4,1e-4,1e-2,1e-2,1e-2,1.0,1.0,10.0};
+
+    /* Standard deviations of the initial state, from model/simulate.m */
+    double p0[EKF_STATES] = {0.05,0.05,5.0 * M_PI / 180.0,0.01,0.01,0.03,0.05,0.05,0.1};
+
+    /* Measurement variances. The GPS position variance is added to the square of
+     * the error the sensor reports with each reading
+     */
+    double r_gps_xy = 1e-4;
+    double r_gps_theta = 3e-4;
+    double r_gyro = 1e-4;
+    double r_accel = 0.05;
+    double r_odom_v = 1e-3;
+    double r_odom_w = 1e-2;
+};
+
+/* Angle wrapped into [-pi,pi) */
+inline double ekf_wrap(double a)
+{
+    return a - 2.0 * M_PI * std::floor((a + M_PI) / (2.0 * M_PI));
+}
+
+/* Heading of the V5 GPS and IMU (degrees clockwise from the field's +y axis) as theta */
+inline double ekf_compass_theta(double deg)
+{
+    return ekf_wrap(M_PI / 2.0 - deg * M_PI / 180.0);
+}
+
+/* Turn rate of the V5 IMU and GPS gyros (degrees per second, clockwise seen from
+ * above like their headings) as counterclockwise rad/s
+ */
+inline double ekf_compass_rate(double deg_s)
+{
+    return -deg_s * M_PI / 180.0;
+}
+
+class Ekf
+{
+public:
+    explicit Ekf(const EkfParams& p = EkfParams()) : par(p)
+    {
+        reset(0.0,0.0,0.0);
+    }
+
+    const EkfParams& params() const { return par; }
+
+    /* Start again at rest at a pose, with the initial uncertainty */
+    void reset(double x0, double y0, double theta0)
+    {
+        x = Vector<EKF_STATES>::zero();
+        x.m[EKF_X][0] = x0;
+        x.m[EKF_Y][0] = y0;
+        x.m[EKF_THETA][0] = ekf_wrap(theta0);
+        p = Matrix<EKF_STATES, EKF_STATES>::zero();
+        for(int i = 0; i < EKF_STATES; i++) p.m[i][i] = par.p0[i] * par.p0[i];
+        clear_innovations();
+    }
+
+    /* Move the state on by one step of dt, or of the time since the last step when
+     * replaying rows which are not evenly spaced
+     * This also starts a new step, so the innovations are cleared to NaN until the
+     * updates which follow fill them in
+     */
+    void predict()
+    {
+        predict(par.dt);
+    }
+
+    void predict(double dt)
+    {
+        clear_innovations();
+        if(!(dt > 0.0)) return;
+
+        double th = x.m[EKF_THETA][0];
+        double c = std::cos(th), s = std::sin(th);
+        double vf = x.m[EKF_VF][0], vn = x.m[EKF_VN][0];
+
+        /* Jacobian of the motion model */
+        Matrix<EKF_STATES, EKF_STATES> f = Matrix<EKF_STATES, EKF_STATES>::identity();
+        f.m[EKF_X][EKF_THETA] = (-vf * s - vn * c) * dt;
+        f.m[EKF_X][EKF_VF] = c * dt;
+        f.m[EKF_X][EKF_VN] = -s * dt;
+        f.m[EKF_Y][EKF_THETA] = (vf * c - vn * s) * dt;
+        f.m[EKF_Y][EKF_VF] = s * dt;
+        f.m[EKF_Y][EKF_VN] = c * dt;
+        f.m[EKF_THETA][EKF_OMEGA] = dt;
+        f.m[EKF_VF][EKF_AF] = dt;
+        f.m[EKF_VN][EKF_AN] = dt;
+        f.m[EKF_OMEGA][EKF_ALPHA] = dt;
+
+        /* The model itself: robot frame velocity turned into the field frame */
+        x.m[EKF_X][0] += (vf * c - vn * s) * dt;
+        x.m[EKF_Y][0] += (vf * s + vn * c) * dt;
+        x.m[EKF_THETA][0] = ekf_wrap(th + x.m[EKF_OMEGA][0] * dt);
+        x.m[EKF_VF][0] += x.m[EKF_AF][0] * dt;
+        x.m[EKF_VN][0] += x.m[EKF_AN][0] * dt;
+        x.m[EKF_OMEGA][0] += x.m[EKF_ALPHA][0] * dt;
+
+        p = f * p * f.transpose();
+        for(int i = 0; i < EKF_STATES; i++) p.m[i][i] += par.q[i] * dt;
+    }
+
+    /* GPS position in m and heading as theta (see ekf_compass_theta), with the error
+     * the sensor reports in m. A heading which is not finite updates position only
+     */
+    bool update_gps(double gx, double gy, double gtheta, double error = 0.0)
+    {
+        if(!std::isfinite(error)) error = 0.0;
+        double r_xy = par.r_gps_xy + error * error;
+        if(!std::isfinite(gtheta))
+        {
+            const int idx[2] = {EKF_X,EKF_Y};
+            const double z[2] = {gx,gy};
+            const double r[2] = {r_xy,r_xy};
+            return update_direct(idx,z,r,EKF_NU_GPS_X);
+        }
+        const int idx[3] = {EKF_X,EKF_Y,EKF_THETA};
+        const double z[3] = {gx,gy,gtheta};
+        const double r[3] = {r_xy,r_xy,par.r_gps_theta};
+        return update_direct(idx,z,r,EKF_NU_GPS_X);
+    }
+
+    /* Turn rate in rad/s, counterclockwise */
+    bool update_gyro(double omega)
+    {
+        const int idx[1] = {EKF_OMEGA};
+        const double z[1] = {omega};
+        const double r[1] = {par.r_gyro};
+        return update_direct(idx,z,r,EKF_NU_GYRO);
+    }
+
+    /* Accelerometer in m/s^2, forward and leftward in the robot's frame
+     * It measures the rate of change of the robot frame velocity plus the turn
+     * rate crossed with it, so the model is af - omega * vn and an + omega * vf
+     */
+    bool update_accel(double af, double an)
+    {
+        double w = x.m[EKF_OMEGA][0], vf = x.m[EKF_VF][0], vn = x.m[EKF_VN][0];
+        Vector<2> z, h;
+        z.m[0][0] = af;
+        z.m[1][0] = an;
+        h.m[0][0] = x.m[EKF_AF][0] - w * vn;
+        h.m[1][0] = x.m[EKF_AN][0] + w * vf;
+        Matrix<2, EKF_STATES> hj = Matrix<2, EKF_STATES>::zero();
+        hj.m[0][EKF_AF] = 1.0;
+        hj.m[0][EKF_VN] = -w;
+        hj.m[0][EKF_OMEGA] = -vn;
+        hj.m[1][EKF_AN] = 1.0;
+        hj.m[1][EKF_VF] = w;
+        hj.m[1][EKF_OMEGA] = vf;
+        Matrix<2, 2> r = Matrix<2, 2>::zero();
+        r.m[0][0] = r.m[1][1] = par.r_accel;
+        return update(z,h,hj,r,EKF_NU_AF,-1);
+    }
+
+    /* Wheel odometry, as forward velocity in m/s and turn rate in rad/s */
+    bool update_odometry(double vf, double omega)
+    {
+        const int idx[2] = {EKF_VF,EKF_OMEGA};
+        const double z[2] = {vf,omega};
+        const double r[2] = {par.r_odom_v,par.r_odom_w};
+        return update_direct(idx,z,r,EKF_NU_ODOM_V);
+    }
+
+    const Vector<EKF_STATES>& state() const { return x; }
+    const Matrix<EKF_STATES, EKF_STATES>& covariance() const { return p; }
+    double operator[](int i) const { return x.m[i][0]; }
+
+    /* Innovation of the last step, NaN if that sensor was not updated */
+    double innovation(int i) const { return nu[i]; }
+
+private:
+    void clear_innovations()
+    {
+        for(int i = 0; i < EKF_INNOVATIONS; i++) nu[i] = NAN;
+    }
+
+    /* Update for sensors which read states directly, with independent noise */
+    template <int M>
+    bool update_direct(const int (&idx)[M], const double (&zv)[M], const double (&rv)[M], int nu0)
+    {
+        Vector<M> z, h;
+        Matrix<M, EKF_STATES> hj = Matrix<M, EKF_STATES>::zero();
+        Matrix<M, M> r = Matrix<M, M>::zero();
+        int angle = -1;
+        for(int i = 0; i < M; i++)
+        {
+            z.m[i][0] = zv[i];
+            h.m[i][0] = x.m[idx[i]][0];
+            hj.m[i][idx[i]] = 1.0;
+            r.m[i][i] = rv[i];
+            if(idx[i] == EKF_THETA) angle = i;
+        }
+        return update(z,h,hj,r,nu0,angle);
+    }
+
+    /* Measurement z with prediction h, Jacobian hj and noise r
+     * Element angle (if not -1) is a heading, whose innovation is wrapped
+     */
+    template <int M>
+    bool update(const Vector<M>& z, const Vector<M>& h, const Matrix<M, EKF_STATES>& hj,
+        const Matrix<M, M>& r, int nu0, int angle)
+    {
+        for(int i = 0; i < M; i++)
+        {
+            if(!std::isfinite(z.m[i][0])) return false;
+        }
+        Vector<M> y = z - h;
+        if(angle >= 0) y.m[angle][0] = ekf_wrap(y.m[angle][0]);
+
+        /* Gain K = P H' S^-1, found as the solution of S K' = H P */
+        Matrix<EKF_STATES, M> pht = p * hj.transpose();
+        Matrix<M, M> s = hj * pht + r;
+        Matrix<M, EKF_STATES> kt;
+        if(!solve_spd(s,pht.transpose(),kt)) return false;
+
+        x += kt.transpose() * y;
+        x.m[EKF_THETA][0] = ekf_wrap(x.m[EKF_THETA][0]);
+        p -= pht * kt;
+
+        /* Keep P symmetric against rounding */
+        for(int i = 0; i < EKF_STATES; i++)
+        {
+            for(int j = 0; j < i; j++) p.m[i][j] = p.m[j][i] = 0.5 * (p.m[i][j] + p.m[j][i]);
+        }
+
+        for(int i = 0; i < M; i++) nu[nu0 + i] = y.m[i][0];
+        return true;
+    }
+
+    EkfParams par;
+    Vector<EKF_STATES> x;
+    Matrix<EKF_STATES, EKF_STATES> p;
+    double nu[EKF_INNOVATIONS];
+};
+
+} /* namespace pal */
+
+#endif /* _PAL_EKF_HPP_ */
@@ -19,14 +19,8 @@ extern "C" {
 
 /* Headers required by log.h macros */
 #include <stdio.h>
-
-/* File descriptors for logfiles
- * fd is the log file descriptor
- * dd is the data file descriptor
- * Not to be used directly, but used by macros in this header
- */
-extern FILE* fd;
-extern FILE* dd;
+#include <stdint.h>
+#include <stddef.h>
 
 /* Log Verbosity Level enumeration */
 typedef enum
@@ -46,26 +40,93 @@ typedef enum
 
 /* Functions to print a message at the specified log levels
  * The funtion will print if the given file is set to log at or above this level
+ * The message goes to every sink whose own level it meets, see pal/log_sink.h
  */
-#define LOG_ALWAYS(...) do{switch(log_check(__FILE__,__LINE__,LOG_LEVEL_ALWAYS,LOG_LEVEL_FILE)){case 2: fprintf(fd,__VA_ARGS__); case 1: printf(__VA_ARGS__);printf("\n");}}while(0)
-#define LOG_ERROR(...) do{switch(log_check(__FILE__,__LINE__,LOG_LEVEL_ERROR,LOG_LEVEL_FILE)){case 2: fprintf(fd,__VA_ARGS__); case 1: printf(__VA_ARGS__);printf("\n");}}while(0)
-#define LOG_WARN(...) do{switch(log_check(__FILE__,__LINE__,LOG_LEVEL_WARN,LOG_LEVEL_FILE)){case 2: fprintf(fd,__VA_ARGS__); case 1: printf(__VA_ARGS__);printf("\n");}}while(0)
-#define LOG_INFO(...) do{switch(log_check(__FILE__,__LINE__,LOG_LEVEL_INFO,LOG_LEVEL_FILE)){case 2: fprintf(fd,__VA_ARGS__); case 1: printf(__VA_ARGS__);printf("\n");}}while(0)
-#define LOG_DEBUG(...) do{switch(log_check(__FILE__,__LINE__,LOG_LEVEL_DEBUG,LOG_LEVEL_FILE)){case 2: fprintf(fd,__VA_ARGS__); case 1: printf(__VA_ARGS__);printf("\n");}}while(0)
+#define LOG_ALWAYS(...) do{if(LOG_LEVEL_ALWAYS >= LOG_LEVEL_FILE) log_message(__FILE__,__LINE__,LOG_LEVEL_ALWAYS,__VA_ARGS__);}while(0)
+#define LOG_ERROR(...) do{if(LOG_LEVEL_ERROR >= LOG_LEVEL_FILE) log_message(__FILE__,__LINE__,LOG_LEVEL_ERROR,__VA_ARGS__);}while(0)
+#define LOG_WARN(...) do{if(LOG_LEVEL_WARN >= LOG_LEVEL_FILE) log_message(__FILE__,__LINE__,LOG_LEVEL_WARN,__VA_ARGS__);}while(0)
+#define LOG_INFO(...) do{if(LOG_LEVEL_INFO >= LOG_LEVEL_FILE) log_message(__FILE__,__LINE__,LOG_LEVEL_INFO,__VA_ARGS__);}while(0)
+#define LOG_DEBUG(...) do{if(LOG_LEVEL_DEBUG >= LOG_LEVEL_FILE) log_message(__FILE__,__LINE__,LOG_LEVEL_DEBUG,__VA_ARGS__);}while(0)
 
 /* Initialize the logger module, it then operates from its own task */
 void log_init();
 
-/* Internal function to check if a log at level should be printed or not, also prints the log header
+/* Internal function to write a message, formatted as printf and cut to 255 characters
  * fname is assumed to be a string literal, as it should be a C-string defined by __FILE__
  * The pointer passed is assumed to be valid in global scope once the calling function returns
+ * Before log_init() the message is printed to the console directly
  */
-int log_check(const char * fname, const int line,log_level_t level,log_level_t flevel);
+void log_message(const char * fname, int line, log_level_t level, const char * format, ...)
+    __attribute__((format(printf,4,5)));
 
 /* Functions to log data */
 void log_data_int(const char * pname, int data);
 void log_data_dbl(const char * pname, double data);
 
+/* Functions to log vectors as a single channel, which is stored contiguously in the
+ * binary file and expands to one CSV column per element:
+ * log_data_vec gives pname_0, pname_1, ... for fixed-size arrays (i.e. one value per motor)
+ * log_data_vec3 gives pname_x, pname_y, pname_z
+ * log_data_quat gives pname_x, pname_y, pname_z, pname_w
+ * log_data_euler gives pname_pitch, pname_roll, pname_yaw
+ * The count of log_data_vec must be the same on every row
+ */
+void log_data_vec(const char * pname, const double * data, int count);
+void log_data_vec3(const char * pname, double x, double y, double z);
+void log_data_quat(const char * pname, double x, double y, double z, double w);
+void log_data_euler(const char * pname, double pitch, double roll, double yaw);
+
+/* Macros to log the PROS vector structs directly
+ * LOG_DATA_XYZ takes imu_accel_s_t, imu_gyro_s_t, gps_accel_s_t or gps_gyro_s_t
+ * LOG_DATA_QUAT takes quaternion_s_t
+ * LOG_DATA_EULER takes euler_s_t
+ */
+#define LOG_DATA_XYZ(pname,v) do{__typeof__(v) _v = (v); log_data_vec3((pname),_v.x,_v.y,_v.z);}while(0)
+#define LOG_DATA_QUAT(pname,q) do{__typeof__(q) _q = (q); log_data_quat((pname),_q.x,_q.y,_q.z,_q.w);}while(0)
+#define LOG_DATA_EULER(pname,e) do{__typeof__(e) _e = (e); log_data_euler((pname),_e.pitch,_e.roll,_e.yaw);}while(0)
+
+/* Function to log a variable number of packed structs as one channel, i.e. the objects
+ * detected by a vision sensor on this row
+ * layout describes the struct fields as "name:type,name:type,..." with types i8, u8,
+ * i16, u16, i32, u32, f32 and f64, and must add up to size
+ * The structs are only stored in the binary file, where the host tools explode them
+ * into a per-object table keyed by the row time. The CSV only gets a pname_n count column
+ */
+void log_data_var(const char * pname, const char * layout, const void * data, int count, int size);
+
+/* Layout of vision_object_s_t, for use with log_data_var */
+#define LOG_VISION_LAYOUT "signature:u16,type:u32,left:i16,top:i16,width:i16,height:i16,angle:u16,x:i16,y:i16"
+
+/* Lossy compression modes for log_data_dbl_comp */
+typedef enum
+{
+    LOG_COMP_DEADBAND,  /* Keep a value once it moves more than the tolerance from the last kept value */
+    LOG_COMP_SDT        /* Swinging door, keep a value once the series leaves the tolerance of the line
+                         * through the kept values */
+} log_comp_mode_t;
+
+/* Function to log data through a lossy compressor, for slow analog channels such as
+ * battery voltage, temperature or GPS position
+ * Every value can be reconstructed to within tolerance (in the units of the
+ * data), by holding the last kept value for DEADBAND or interpolating for SDT
+ * Only the binary file is compressed, the CSV holds every value
+ */
+void log_data_dbl_comp(const char * pname, double data, log_comp_mode_t mode, double tolerance);
+
+/* Functions to log data along with the instant it was sampled
+ * time_us is in microseconds since PROS started, either micros() taken when the value
+ * was read, or a device timestamp such as the one from motor_get_raw_position() * 1000
+ * The instant is stored as a delta from the row time, which is a <pname>_dt column
+ * in microseconds in the CSV, or an int32 delta packed into the binary row
+ */
+void log_data_int_ts(const char * pname, int data, uint64_t time_us);
+void log_data_dbl_ts(const char * pname, double data, uint64_t time_us);
+
+/* Write data to a binary file (dat%05d.bin) instead of CSV, see pal/log_format.h
+ * Must be called before log_init()
+ */
+void log_binary(int enable);
+
 /* Call reopen periodically to reopen the log files */
 void log_step();
 
@@ -75,6 +136,129 @@ void log_segment();
 /* Function to get the most recent log id, or -1 if none */
 int log_id();
 
+/**
+ *  Clock the logger stamps rows, messages and samples with
+ **/
+
+/* A time base, giving the time in microseconds
+ * Clocks with state embed this as their first member
+ */
+typedef struct log_clock_s log_clock_t;
+struct log_clock_s
+{
+    uint64_t (*now_us)(log_clock_t * clock);
+};
+
+/* The PROS clock, micros() */
+extern log_clock_t log_clock_real;
+
+/* A clock which only moves when told to, for host tests and deterministic benchmarks */
+typedef struct
+{
+    log_clock_t clock;
+    uint64_t now_us;
+} log_clock_manual_t;
+
+void log_clock_manual_init(log_clock_manual_t * clk, uint64_t start_us);
+void log_clock_manual_advance(log_clock_manual_t * clk, uint64_t us);
+
+/* A clock which steps through the row times of a recorded log, so the rows written
+ * are stamped as the recording was. times_us is not copied, and must be ascending
+ */
+typedef struct
+{
+    log_clock_t clock;
+    const uint64_t * times_us;
+    size_t count;
+    size_t row;
+} log_clock_replay_t;
+
+void log_clock_replay_init(log_clock_replay_t * clk, const uint64_t * times_us, size_t count);
+
+/* Step to the next recorded time, returning 0 once there are no more */
+int log_clock_replay_next(log_clock_replay_t * clk);
+
+/* Take the logger's time from clock, or from the PROS clock for NULL
+ * Must be called before log_init() and log_poll_start()
+ * The clock can only be changed in builds with LOG_CLOCK_PLUGGABLE defined. Other
+ * builds call millis() and micros() directly, and return -1 for any other clock
+ * Returns 0 on success
+ */
+int log_clock(log_clock_t * clock);
+
+/* Time of the logger's clock, to give log_data_*_ts under a clock other than PROS */
+uint64_t log_clock_us();
+
+/**
+ *  Device poller, which samples registered devices from its own task
+ **/
+
+/* Fields which the poller can sample from a device
+ * Motor fields are VEL through TORQUE, IMU and GPS fields are HDG and above
+ * Fields which do not apply to the registered device type are ignored
+ */
+typedef enum
+{
+    LOG_FIELD_VEL = (1 << 0),       /* Motor actual velocity (rpm) */
+    LOG_FIELD_CUR = (1 << 1),       /* Motor current draw (A) */
+    LOG_FIELD_TEMP = (1 << 2),      /* Motor temperature (C) */
+    LOG_FIELD_POS = (1 << 3),       /* Motor position (encoder units) */
+    LOG_FIELD_VOLT = (1 << 4),      /* Motor voltage (V) */
+    LOG_FIELD_POWER = (1 << 5),     /* Motor power (W) */
+    LOG_FIELD_TORQUE = (1 << 6),    /* Motor torque (Nm) */
+    LOG_FIELD_HDG = (1 << 8),       /* IMU or GPS heading (deg) */
+    LOG_FIELD_ROT = (1 << 9),       /* IMU or GPS rotation (deg) */
+    LOG_FIELD_EULER = (1 << 10),    /* IMU or GPS pitch, yaw and roll (deg) */
+    LOG_FIELD_ACCEL = (1 << 11),    /* IMU or GPS acceleration x, y and z (g) */
+    LOG_FIELD_GYRO = (1 << 12),     /* IMU or GPS gyro rate x, y and z (dps) */
+    LOG_FIELD_STATUS = (1 << 13),   /* IMU status (calibrating flag) */
+    LOG_FIELD_POSITION = (1 << 14), /* GPS position x and y (m) */
+    LOG_FIELD_ERROR = (1 << 15),    /* GPS RMS error (m) */
+    LOG_FIELD_TIME = (1 << 16),     /* Sample instant, one delta shared by the device's fields */
+    LOG_FIELD_QUAT = (1 << 17)      /* IMU quaternion x, y, z and w */
+} log_field_t;
+
+/* Register a device with the poller
+ * name is the column prefix (i.e. "left" gives left_vel, left_cur, ...), or NULL
+ * to name the columns after the port. The string is copied, so it may be temporary
+ * fields is a mask of log_field_t values to sample
+ * Devices must be registered before log_poll_start(), and before log_step() generates the CSV header, either
+ * before the first log_step() or followed by log_segment(), or the columns will misalign
+ * Returns 0 on success or -1 if the poller tables are full
+ */
+int log_poll_motor(const char * name, unsigned char port, unsigned int fields);
+int log_poll_imu(const char * name, unsigned char port, unsigned int fields);
+int log_poll_gps(const char * name, unsigned char port, unsigned int fields);
+
+/* Start the poller task, sampling all registered devices every period_ms of the
+ * logger's clock. The most recent samples are written to the data file by log_step(),
+ * as NaN at the row time until the first are taken. A poll which overruns the
+ * period still sleeps 1 ms, so lower priority tasks aren't starved
+ */
+void log_poll_start(unsigned int period_ms);
+
+/* Most recent poller samples, for control code which would otherwise read the devices
+ * itself. These are the values log_step() wrote to the current row, so call them from
+ * the task which calls log_step(), after it
+ * log_poll_find returns the index of the column with the given name (as in the CSV
+ * header, i.e. "left_vel"), or -1. log_poll_value returns the value of a column, or
+ * NaN for an index of -1 or before the poller's first sample
+ */
+int log_poll_find(const char * name);
+double log_poll_value(int col);
+
+/**
+ *  File server, for collecting the logs over the USB link without taking the card out
+ **/
+
+/* Start a task serving the logger's files on the card to pallog fetch
+ * It reads requests from stdin, so nothing else may read it, and answers on the
+ * serial stream LOG_SERVE_STREAM (see pal/log_format.h). It runs at the lowest
+ * priority, so it only reads the card and sends when every other task is waiting
+ * Call after log_init(). Returns 0 on success
+ */
+int log_serve_start();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,113 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _LOG_HPP_
+#define _LOG_HPP_
+
+/* C++ interface to the logger, for use with the PROS C++ device classes */
+#include "pal/log.h"
+#include "pros/motors.hpp"
+#include "pros/imu.hpp"
+#include "pros/gps.hpp"
+#include "pros/vision.h"
+
+namespace pal
+{
+
+/* Fields which the poller can sample, see log_field_t for units */
+constexpr unsigned int FIELD_VEL = LOG_FIELD_VEL;
+constexpr unsigned int FIELD_CUR = LOG_FIELD_CUR;
+constexpr unsigned int FIELD_TEMP = LOG_FIELD_TEMP;
+constexpr unsigned int FIELD_POS = LOG_FIELD_POS;
+constexpr unsigned int FIELD_VOLT = LOG_FIELD_VOLT;
+constexpr unsigned int FIELD_POWER = LOG_FIELD_POWER;
+constexpr unsigned int FIELD_TORQUE = LOG_FIELD_TORQUE;
+constexpr unsigned int FIELD_HDG = LOG_FIELD_HDG;
+constexpr unsigned int FIELD_ROT = LOG_FIELD_ROT;
+constexpr unsigned int FIELD_EULER = LOG_FIELD_EULER;
+constexpr unsigned int FIELD_ACCEL = LOG_FIELD_ACCEL;
+constexpr unsigned int FIELD_GYRO = LOG_FIELD_GYRO;
+constexpr unsigned int FIELD_STATUS = LOG_FIELD_STATUS;
+constexpr unsigned int FIELD_POSITION = LOG_FIELD_POSITION;
+constexpr unsigned int FIELD_ERROR = LOG_FIELD_ERROR;
+constexpr unsigned int FIELD_TIME = LOG_FIELD_TIME;
+constexpr unsigned int FIELD_QUAT = LOG_FIELD_QUAT;
+
+/* Register a motor with the poller, see log_poll_motor */
+inline int log_motor(const pros::Motor& motor, unsigned int fields, const char * name = nullptr)
+{
+    return log_poll_motor(name,motor.get_port(),fields);
+}
+
+/* Register an IMU or GPS with the poller
+ * pros::Imu and pros::Gps do not expose their port, so it is passed directly
+ */
+inline int log_imu(unsigned char port, unsigned int fields, const char * name = nullptr)
+{
+    return log_poll_imu(name,port,fields);
+}
+inline int log_gps(unsigned char port, unsigned int fields, const char * name = nullptr)
+{
+    return log_poll_gps(name,port,fields);
+}
+
+/* Log the PROS vector structs as a single channel, see log_data_vec3 */
+inline void log_data(const char * pname, const pros::c::imu_raw_s& v)
+{
+    log_data_vec3(pname,v.x,v.y,v.z);
+}
+inline void log_data(const char * pname, const pros::c::gps_raw_s& v)
+{
+    log_data_vec3(pname,v.x,v.y,v.z);
+}
+inline void log_data(const char * pname, const pros::c::quaternion_s_t& q)
+{
+    log_data_quat(pname,q.x,q.y,q.z,q.w);
+}
+inline void log_data(const char * pname, const pros::c::euler_s_t& e)
+{
+    log_data_euler(pname,e.pitch,e.roll,e.yaw);
+}
+
+/* Log a fixed-size array as a single channel, i.e. one value per drive motor */
+template <std::size_t N>
+inline void log_data(const char * pname, const double (&data)[N])
+{
+    log_data_vec(pname,data,N);
+}
+
+/* Log the objects detected by a vision sensor as a variable-length channel,
+ * see log_data_var
+ */
+static_assert(sizeof(pros::vision_object_s_t) == 20,"LOG_VISION_LAYOUT does not match vision_object_s_t");
+inline void log_data(const char * pname, const pros::vision_object_s_t * objs, int count)
+{
+    log_data_var(pname,LOG_VISION_LAYOUT,objs,count,sizeof(*objs));
+}
+
+/* Start the poller task, see log_poll_start */
+inline void log_poll(unsigned int period_ms)
+{
+    log_poll_start(period_ms);
+}
+
+/* Most recent poller sample of a column, see log_poll_value
+ * Holds the column's index, found once by name
+ */
+class PollValue
+{
+public:
+    explicit PollValue(const char * name) : col(log_poll_find(name)) {}
+    double get() const { return log_poll_value(col); }
+    operator double() const { return get(); }
+
+private:
+    int col;
+};
+
+} /* namespace pal */
+
+#endif /* _LOG_HPP_ */
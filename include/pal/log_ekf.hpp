@@ -0,0 +1,31 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _LOG_EKF_HPP_
+#define _LOG_EKF_HPP_
+
+/* Logging of the pose estimator, kept apart from pal/log.hpp so only code which
+ * runs the estimator compiles it
+ */
+#include "pal/log.h"
+#include "pal/ekf.hpp"
+
+namespace pal
+{
+
+/* Log the estimator's state and the innovations of its last step, one channel each
+ * named by ekf_state_names and ekf_innovation_names. Innovations of sensors which
+ * were not updated in the step are NaN
+ */
+inline void log_data(const Ekf& filter)
+{
+    for(int i = 0; i < EKF_STATES; i++) log_data_dbl(ekf_state_names[i],filter[i]);
+    for(int i = 0; i < EKF_INNOVATIONS; i++) log_data_dbl(ekf_innovation_names[i],filter.innovation(i));
+}
+
+} /* namespace pal */
+
+#endif /* _LOG_EKF_HPP_ */
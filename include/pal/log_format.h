@@ -0,0 +1,205 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _LOG_FORMAT_H_
+#define _LOG_FORMAT_H_
+
+/* Layout of the binary data file (dat%05d.bin)
+ * This header is shared by the logger and the host tools, so it only contains
+ * plain types and constants
+ *
+ * The file is a file header followed by a stream of records. Every record starts
+ * with a record header and is padded so the next record starts 8-byte aligned.
+ * All values are little-endian.
+ *
+ * The schema is a CHANNEL record per column, written during the header pass
+ * (the same pass which writes the CSV header). Each ROW record then holds the row
+ * time followed by a fixed-size area, where each channel lives at the offset given
+ * by its CHANNEL record. Vector channels hold count contiguous values, and are
+ * expanded to one column per element on export, named by the channel shape.
+ * Channels with LOG_CHAN_TS set have an int32 delta in microseconds from the row
+ * time to the instant the value was sampled, at the ts_offset their CHANNEL record
+ * gives. Values read from a device together share one delta, so several channels
+ * may give the same ts_offset. Values sit at their natural alignment, and 4-byte
+ * values and deltas fill the gaps aligning a double leaves, so rows carry little
+ * padding.
+ *
+ * Variable-length channels (LOG_CHAN_VAR) have no space in the row. Instead, each
+ * row may be followed by a VAR record per channel, holding a count of packed
+ * structs. Their CHANNEL record gives the struct size in count, and the channel
+ * name is followed by a second NUL terminated string describing the struct fields
+ * as "name:type,name:type,..." with types i8, u8, i16, u16, i32, u32, f32 and f64.
+ *
+ * Compressed channels (LOG_CHAN_SPARSE) also have no space in the row. The logger
+ * only keeps the points needed to reconstruct the series within the channel's
+ * tolerance, each in a POINT record with its own time. The series is rebuilt by
+ * linear interpolation between points, or by holding the last point when
+ * LOG_CHAN_HOLD is set. A POINT record's time may be earlier than the row it
+ * follows, since the compressor only knows a point was needed once it has passed.
+ */
+
+#include <stdint.h>
+
+/* File header magic and version */
+#define LOG_BIN_MAGIC "PALB"
+#define LOG_BIN_VERSION 1
+
+/* Record types */
+#define LOG_REC_CHANNEL 1
+#define LOG_REC_ROW 2
+#define LOG_REC_VAR 3
+#define LOG_REC_POINT 4
+
+/* Channel value types */
+#define LOG_TYPE_INT 1      /* int32_t */
+#define LOG_TYPE_DBL 2      /* double */
+#define LOG_TYPE_RAW 3      /* Packed struct described by the channel layout */
+
+/* Channel flags */
+#define LOG_CHAN_TS (1 << 0)    /* Value has an int32 sample time delta (us), at ts_offset */
+#define LOG_CHAN_VAR (1 << 1)   /* Values are in VAR records following the row */
+#define LOG_CHAN_SPARSE (1 << 2)    /* Values are in POINT records following the row */
+#define LOG_CHAN_HOLD (1 << 3)  /* Sparse values are held, rather than interpolated */
+
+/* Channel shapes, which name the columns of a vector channel on export */
+#define LOG_SHAPE_ARRAY 0   /* name_0, name_1, ... (or just name if count is 1) */
+#define LOG_SHAPE_XYZ 1     /* name_x, name_y, name_z, name_w (imu_accel_s_t, quaternion_s_t) */
+#define LOG_SHAPE_EULER 2   /* name_pitch, name_roll, name_yaw (euler_s_t) */
+
+/* Alignment of every record in the file */
+#define LOG_BIN_ALIGN 8
+
+/* File header, at the start of every file */
+typedef struct
+{
+    char magic[4];          /* LOG_BIN_MAGIC */
+    uint16_t version;       /* LOG_BIN_VERSION */
+    uint16_t header_len;    /* sizeof(log_bin_header_t), records start here */
+    uint32_t open_ms;       /* millis() when the file was opened */
+    uint32_t boot;          /* 1 + index of the first file opened since power on, which
+                             * the segments of one run share, or 0 if unknown */
+} log_bin_header_t;
+
+/* Record header, at the start of every record */
+typedef struct
+{
+    uint16_t type;          /* LOG_REC_* */
+    uint16_t chan;          /* Channel index the record refers to, if any */
+    uint32_t len;           /* Payload length in bytes, not including padding */
+} log_bin_record_t;
+
+/* CHANNEL record payload, followed by the NUL terminated channel name */
+typedef struct
+{
+    uint8_t type;           /* LOG_TYPE_* */
+    uint8_t flags;          /* LOG_CHAN_* */
+    uint16_t count;         /* Number of values, 1 for scalar channels, struct size for VAR */
+    uint16_t offset;        /* Offset of the value within the ROW payload */
+    uint8_t shape;          /* LOG_SHAPE_* */
+    uint8_t reserved;
+    uint16_t ts_offset;     /* Offset of the sample time delta within the ROW payload, if LOG_CHAN_TS is set */
+    uint16_t reserved2;
+} log_bin_channel_t;
+
+/* ROW record payload, followed by the channel area */
+typedef struct
+{
+    uint32_t time_ms;       /* Row time, from log_step() */
+    uint32_t reserved;
+} log_bin_row_t;
+
+/* VAR record payload, followed by count structs of size bytes each */
+typedef struct
+{
+    uint32_t time_ms;       /* Time of the row this record belongs to */
+    uint16_t count;         /* Number of structs */
+    uint16_t size;          /* Size of each struct in bytes */
+} log_bin_var_t;
+
+/* POINT record payload */
+typedef struct
+{
+    uint32_t time_ms;       /* Time of the row the value was logged on */
+    uint32_t reserved;
+    double value;
+} log_bin_point_t;
+
+/* Telemetry record, as the stream sink sends a log_sink_rec_t (see pal/log_sink.h)
+ * It is followed by the payload, which for a message is the source file name and
+ * the text, each NUL terminated, then a CRC of both (LOG_CRC_*) as a uint16.
+ * The whole is COBS encoded and ended by a zero byte, so a receiver finds the next
+ * frame after a lost or damaged one. The data records of a stream hold the bytes
+ * of the data file, so a receiver can write the same files as the uSD card has
+ */
+typedef struct
+{
+    uint32_t seq;           /* Number of the frame on the stream, a gap means frames were lost */
+    uint32_t dropped;       /* Records for the sink overwritten before it read them, since log_init() */
+    uint32_t time_ms;       /* Logger clock */
+    uint8_t type;           /* log_sink_type_t */
+    uint8_t level;          /* log_level_t of a message */
+    uint16_t line;          /* Source line of a message */
+} log_wire_t;
+
+/* CRC-16/CCITT-FALSE over the telemetry record and payload */
+#define LOG_CRC_POLY 0x1021
+#define LOG_CRC_INIT 0xffff
+
+/* PROS serial stream the telemetry goes to, as serctl() takes it ("plog") */
+#define LOG_WIRE_STREAM "plog"
+#define LOG_WIRE_STREAM_ID 0x676f6c70
+
+/* File server messages, see log_serve_start() in pal/log.h
+ * The host writes requests to the robot's stdin, and the robot answers on the
+ * serial stream LOG_SERVE_STREAM. Either way a message is a log_serve_msg_t, its
+ * payload and a CRC of both (LOG_CRC_*) as a uint16, COBS encoded and ended by a
+ * zero byte, as telemetry frames are
+ *
+ * A file is sent as DATA messages of up to LOG_SERVE_CHUNK bytes, at most window
+ * chunks past the last offset the host acknowledged. The host acknowledges each
+ * chunk, and asks for a file again from where it has it if one goes missing, so
+ * it can resume a transfer that broke off as well. Answers carry the id of the
+ * request, so the host ignores those to requests it has given up on
+ */
+#define LOG_SERVE_STREAM "pfil"
+#define LOG_SERVE_STREAM_ID 0x6c696670
+#define LOG_SERVE_CHUNK 512
+#define LOG_SERVE_WINDOW_MAX 32
+#define LOG_SERVE_NAME_MAX 31
+
+typedef enum
+{
+    LOG_SERVE_LIST = 1,     /* Host: list the log files. Robot: a file's name and size
+                             * (arg), then one with no name and the count in arg */
+    LOG_SERVE_READ,         /* Host: send the file named from offset, arg chunks ahead */
+    LOG_SERVE_ACK,          /* Host: has the file up to offset */
+    LOG_SERVE_DATA,         /* Robot: bytes of the file from offset */
+    LOG_SERVE_END,          /* Robot: the file ends at offset */
+    LOG_SERVE_SUM,          /* Host: CRC-32 of the first offset bytes of the file named.
+                             * Robot: the bytes summed (offset) and their CRC (arg) */
+    LOG_SERVE_ERROR         /* Robot: the request failed, the payload says why */
+} log_serve_op_t;
+
+/* Set in flags of a LIST answer for files the logger has open, which still grow */
+#define LOG_SERVE_OPEN 0x01
+
+typedef struct
+{
+    uint8_t op;             /* log_serve_op_t */
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t id;            /* Chosen by the host, and copied into the answers */
+    uint32_t offset;
+    uint32_t arg;
+} log_serve_msg_t;
+
+/* CRC-32 (as zlib) of file contents for LOG_SERVE_SUM */
+#define LOG_CRC32_POLY 0xedb88320u
+
+/* Round a length up to the record alignment */
+#define LOG_BIN_PAD(len) (((len) + (LOG_BIN_ALIGN - 1)) & ~(LOG_BIN_ALIGN - 1))
+
+#endif /* _LOG_FORMAT_H_ */
@@ -0,0 +1,295 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _LOG_SINK_H_
+#define _LOG_SINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "pal/log.h"
+#include "pal/log_format.h"
+
+/* Sinks, which take the logger's messages and data to where they are kept
+ * Producers write each record once into a buffer shared by all sinks, and each
+ * sink reads it at its own pace from its own task. A sink which falls so far
+ * behind that its records are overwritten skips them and counts them as dropped,
+ * so a slow sink never holds up the producers or the other sinks
+ *
+ * log_init() adds the uSD text file, uSD data file and console sinks, and the
+ * others are added with log_sink_add()
+ */
+
+/* Size of the shared record buffer, and the largest record payload */
+#define LOG_SINK_BUF_SIZE (128 * 1024)
+#define LOG_SINK_REC_MAX 4096
+
+/* How soon to call an idle hook again which has work left but can't tell when it's due */
+#define LOG_SINK_IDLE_MS 2
+
+/* Types of record */
+typedef enum
+{
+    LOG_SINK_MSG,       /* A LOG_* message, the payload is its text */
+    LOG_SINK_DATA,      /* Bytes of the data file, CSV text or binary records */
+    LOG_SINK_OPEN,      /* Start new files, the payload is log_sink_open_t */
+    LOG_SINK_FLUSH,     /* Commit what has been written, sent every second */
+    LOG_SINK_CLOSE      /* Close the files, the card was removed or a segment ended */
+} log_sink_type_t;
+
+/* Masks of record types, for log_sink_t types */
+#define LOG_SINK_TYPE(t) (1u << (t))
+#define LOG_SINK_FILES (LOG_SINK_TYPE(LOG_SINK_OPEN) | LOG_SINK_TYPE(LOG_SINK_FLUSH) | LOG_SINK_TYPE(LOG_SINK_CLOSE))
+#define LOG_SINK_ALL 0xffffffffu
+
+/* A record as the sinks see it, followed by len bytes of payload */
+typedef struct
+{
+    uint32_t seq;           /* Number of the record, counting up from log_init() */
+    uint32_t time_ms;       /* Logger clock when it was written */
+    const char * file;      /* __FILE__ and __LINE__ of a message, else NULL and 0 */
+    uint16_t line;
+    uint8_t type;           /* log_sink_type_t */
+    uint8_t level;          /* log_level_t of a message */
+    uint16_t len;
+} log_sink_rec_t;
+
+/* Payload of LOG_SINK_OPEN, naming the files log%05d.txt and dat%05d.csv or .bin */
+typedef struct
+{
+    int32_t index;
+    int32_t boot;           /* Index of the first files opened since power on */
+    int32_t binary;         /* The data file is binary */
+} log_sink_open_t;
+
+/* Formats of the text of a message */
+typedef enum
+{
+    LOG_SINK_FMT_FULL,      /* "%08.3f [LEVEL] in FILE line N: text", as the text file has it */
+    LOG_SINK_FMT_SHORT      /* "%08.3f [LEVEL] text" */
+} log_sink_fmt_t;
+
+/* A sink, which sinks with state embed as their first member
+ * The first six members are set by the sink, the rest kept by the logger
+ */
+typedef struct log_sink_s log_sink_t;
+struct log_sink_s
+{
+    const char * name;      /* Name of its task */
+    uint32_t types;         /* Mask of the record types it takes, 0 to leave it out */
+    log_level_t level;      /* Messages below this level are skipped */
+    log_sink_fmt_t format;  /* Format of message text, for sinks writing text */
+
+    /* Handle a record, called from the sink's task */
+    void (*write)(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload);
+
+    /* Called when the sink has read every record, or NULL. Returns the ms until it
+     * wants calling again, i.e. when a redraw is due, or 0 to wait for a record
+     */
+    uint32_t (*idle)(log_sink_t * sink);
+
+    uint32_t cursor;        /* Offset in the shared buffer of the next record to read */
+    uint32_t dropped;       /* Records it takes which were overwritten before it read them */
+    void * task;
+};
+
+/* Add a sink, which takes the records written from then on
+ * Sinks added before log_init() start with it. Sinks are never removed, so the
+ * sink must stay valid. Returns 0 on success, or -1 if the sink table is full
+ */
+int log_sink_add(log_sink_t * sink);
+
+/* Format the text of a message in the sink's format, as snprintf */
+int log_sink_format(const log_sink_t * sink, const log_sink_rec_t * rec, const void * payload,
+                    char * buf, size_t size);
+
+/* Name of a log level, "DEBUG" to "ALWAYS" */
+const char * log_level_name(int level);
+
+/**
+ *  Sinks provided by the logger
+ **/
+
+/* The files on the uSD card, log%05d.txt with the messages in the full format and
+ * dat%05d.csv or .bin with the data, added by log_init()
+ */
+extern log_sink_t log_sink_usd_text;
+extern log_sink_t log_sink_usd_data;
+
+/* The console, printf in the full format, added by log_init() */
+extern log_sink_t log_sink_console;
+
+/* A ring in RAM holding the latest records, for reading back i.e. after a fault */
+typedef struct
+{
+    log_sink_t sink;
+    uint8_t * buf;
+    uint32_t size;
+    uint32_t head;          /* Offsets of the next byte to write and the oldest record */
+    uint32_t tail;
+    void * mtx;
+} log_sink_ram_t;
+
+/* buf of size bytes holds the records, types and level select them */
+void log_sink_ram_init(log_sink_ram_t * ram, void * buf, size_t size, uint32_t types, log_level_t level);
+
+/* Read the record at *cursor, or the oldest one if that has been overwritten
+ * Copies up to max bytes of its payload, and moves the cursor past it
+ * Start the cursor at 0. Returns 1 for a record or 0 if there are no more
+ */
+int log_sink_ram_read(log_sink_ram_t * ram, uint32_t * cursor, log_sink_rec_t * rec, void * payload, size_t max);
+
+/* A telemetry stream, writing each record as a frame to a serial stream or file
+ * Frames are COBS encoded and CRC checked, see log_wire_t in pal/log_format.h, and
+ * pallog recv writes what it receives back into the files the uSD card would have.
+ * Sinks with no stream (out is NULL) are left out by log_sink_add()
+ */
+typedef struct
+{
+    log_sink_t sink;
+    FILE * out;
+    uint32_t seq;           /* Number of the next frame */
+} log_sink_stream_t;
+
+void log_sink_stream_init(log_sink_stream_t * stream, FILE * out, uint32_t types, log_level_t level);
+
+/* Open the PROS serial stream with a four character id, i.e. LOG_WIRE_STREAM, for
+ * a stream sink. PROS multiplexes it with the console over the USB link, so the
+ * robot keeps printing as before. Returns NULL on failure
+ */
+FILE * log_serial_open(const char * id);
+
+/* A smart port in generic serial mode, i.e. wired to a companion computer
+ * Frames are those of the stream sink without PROS's multiplexing around them, so
+ * pallog recv -n reads them. The sink never waits on the port: frames are batched
+ * in buf and written as the port has room, at most rate bytes a second, and frames
+ * which don't fit are skipped and counted with the sink's dropped records.
+ * A port carries baud / 10 bytes a second, 11.5 kB/s at 115200, so choose the
+ * types and level to fit, and use log_binary() for compact data
+ */
+#define LOG_SINK_PORT_BUF 8192
+
+typedef struct
+{
+    log_sink_t sink;
+    uint8_t port;
+    uint32_t rate;          /* Bytes a second it sends at most, baud / 10 unless changed */
+    uint32_t seq;           /* Number of the next frame */
+    uint32_t skipped;       /* Frames which didn't fit in buf */
+    uint32_t sent;          /* Bytes written to the port */
+    uint32_t credit;        /* Thousandths of a byte it may send, as of credit_ms */
+    uint32_t credit_ms;
+    uint32_t len;           /* Bytes waiting in buf */
+    uint8_t buf[LOG_SINK_PORT_BUF];
+} log_sink_port_t;
+
+/* Set the smart port (1-21) to generic serial at baud
+ * Returns 0 on success, or -1 if the port can't be used, leaving the sink out
+ */
+int log_sink_port_init(log_sink_port_t * port, uint8_t smart_port, int32_t baud, uint32_t types, log_level_t level);
+
+/* The last messages on the brain screen, in the short format, coloured by level
+ * Lines are formatted into a fixed ring as they come, and the screen is redrawn from
+ * the sink's idle hook at most every period_ms, so a burst of messages costs one
+ * redraw rather than one each. It draws with pros/screen.h over the whole screen,
+ * so don't show it with an LVGL chart
+ */
+#define LOG_SINK_SCREEN_LINES 12
+#define LOG_SINK_SCREEN_COLS 80
+#define LOG_SINK_SCREEN_PERIOD_MS 250
+
+typedef struct
+{
+    log_sink_t sink;
+    char lines[LOG_SINK_SCREEN_LINES][LOG_SINK_SCREEN_COLS];
+    uint8_t levels[LOG_SINK_SCREEN_LINES];
+    int next;
+    uint32_t period_ms;     /* Least time between redraws, LOG_SINK_SCREEN_PERIOD_MS unless changed */
+    uint32_t added;         /* Lines added since the last redraw */
+    uint32_t unseen;        /* Lines which scrolled off before a redraw showed them */
+    uint32_t drawn_ms;
+} log_sink_screen_t;
+
+void log_sink_screen_init(log_sink_screen_t * screen, log_level_t level);
+
+/* Channels of the data file plotted live on the brain screen, in an lv_chart
+ * Columns are named as in the CSV header, i.e. "left_vel" or "imu_quat_x", and are
+ * read from CSV or binary files alike. Rows are decimated to a point per interval_ms
+ * of row time, so the rows in between cost no more than finding their end. The sink
+ * only queues points, which an lv_task moves into the chart every period_ms, so the
+ * chart is changed and drawn on LVGL's own task. VAR channels aren't plotted, and
+ * compressed ones hold their last point
+ */
+#define LOG_SINK_CHART_SERIES 4     /* Most columns on one chart */
+#define LOG_SINK_CHART_PENDING 32   /* Points waiting for the next redraw, per column */
+#define LOG_SINK_CHART_NAME 48      /* Longest column name */
+#define LOG_SINK_CHART_SCALE 1000   /* Chart units from lo to hi */
+
+typedef struct
+{
+    char column[LOG_SINK_CHART_NAME];
+    double lo;              /* Values at the bottom and top of the chart */
+    double hi;
+    void * series;          /* lv_chart_series_t */
+    int32_t chan;           /* CSV column or binary channel, -1 if not in this file */
+    uint8_t type;           /* Binary channel's LOG_TYPE_* and LOG_CHAN_* */
+    uint8_t flags;
+    uint16_t offset;        /* Of the value in a binary row */
+    uint8_t value[8];       /* Value of the current row, or a compressed channel's last */
+    int have;               /* value holds one */
+    int16_t pending[LOG_SINK_CHART_PENDING];
+    uint32_t npending;
+} log_sink_chart_series_t;
+
+typedef struct
+{
+    log_sink_t sink;
+    void * chart;           /* lv_obj_t, which may be moved and resized */
+    uint32_t interval_ms;   /* Row time between points */
+    uint32_t period_ms;     /* Time between redraws, 100 unless changed */
+    int nseries;
+    log_sink_chart_series_t series[LOG_SINK_CHART_SERIES];
+    uint32_t skipped;       /* Points which didn't fit in pending before a redraw */
+
+    /* The redraws, and the mutex_t held over the pending points */
+    void * redraw;          /* lv_task_t */
+    void * lock;
+
+    /* Reading the data file: -1 while closed, else 0 for CSV or 1 for binary */
+    int format;
+    uint32_t next_ms;       /* Row time of the next point */
+    int due;                /* The current row is due for a point */
+    int32_t col;            /* CSV column, -1 skipping to the end of the row */
+    int header;             /* In the CSV header row */
+    char field[LOG_SINK_CHART_NAME];
+    uint32_t flen;
+    uint32_t skip;          /* Binary bytes to pass over */
+    log_bin_record_t rec;   /* Binary record being read, and how far */
+    uint32_t rlen;
+    uint32_t pos;
+    uint8_t rbuf[sizeof(log_bin_channel_t) + LOG_SINK_CHART_NAME];
+} log_sink_chart_t;
+
+/* Create a chart of points points, filling parent (an lv_obj_t, or NULL for the
+ * active screen), with a point each interval_ms of row time
+ * Returns 0, or -1 if LVGL couldn't create it, leaving the sink out
+ */
+int log_sink_chart_init(log_sink_chart_t * chart, void * parent, uint16_t points, uint32_t interval_ms);
+
+/* Plot a column from lo at the bottom to hi at the top, in colour 0xRRGGBB
+ * Call before log_sink_add(). Returns 0, or -1 if the chart has no room for it
+ */
+int log_sink_chart_plot(log_sink_chart_t * chart, const char * column, double lo, double hi, uint32_t color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LOG_SINK_H_ */
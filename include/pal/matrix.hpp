@@ -0,0 +1,154 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _PAL_MATRIX_HPP_
+#define _PAL_MATRIX_HPP_
+
+/* Fixed-size matrices for the estimator
+ * The dimensions are template parameters and the values live in the object, so
+ * nothing is allocated and the loops unroll for the small sizes a filter uses.
+ * This header has no dependencies on PROS, so the host tools build it too
+ */
+#include <cmath>
+#include <cstddef>
+
+namespace pal
+{
+
+template <int R, int C>
+struct Matrix
+{
+    static_assert(R > 0 && C > 0,"Matrix dimensions must be positive");
+
+    double m[R][C];
+
+    double& operator()(int r, int c) { return m[r][c]; }
+    double operator()(int r, int c) const { return m[r][c]; }
+
+    static Matrix zero()
+    {
+        Matrix a;
+        for(int r = 0; r < R; r++)
+        {
+            for(int c = 0; c < C; c++) a.m[r][c] = 0.0;
+        }
+        return a;
+    }
+
+    static Matrix identity()
+    {
+        static_assert(R == C,"identity() needs a square matrix");
+        Matrix a = zero();
+        for(int i = 0; i < R; i++) a.m[i][i] = 1.0;
+        return a;
+    }
+
+    Matrix<C, R> transpose() const
+    {
+        Matrix<C, R> a;
+        for(int r = 0; r < R; r++)
+        {
+            for(int c = 0; c < C; c++) a.m[c][r] = m[r][c];
+        }
+        return a;
+    }
+
+    Matrix& operator+=(const Matrix& b)
+    {
+        for(int r = 0; r < R; r++)
+        {
+            for(int c = 0; c < C; c++) m[r][c] += b.m[r][c];
+        }
+        return *this;
+    }
+
+    Matrix& operator-=(const Matrix& b)
+    {
+        for(int r = 0; r < R; r++)
+        {
+            for(int c = 0; c < C; c++) m[r][c] -= b.m[r][c];
+        }
+        return *this;
+    }
+};
+
+/* Column vectors */
+template <int N>
+using Vector = Matrix<N, 1>;
+
+template <int R, int C>
+inline Matrix<R, C> operator+(Matrix<R, C> a, const Matrix<R, C>& b)
+{
+    return a += b;
+}
+
+template <int R, int C>
+inline Matrix<R, C> operator-(Matrix<R, C> a, const Matrix<R, C>& b)
+{
+    return a -= b;
+}
+
+template <int R, int K, int C>
+inline Matrix<R, C> operator*(const Matrix<R, K>& a, const Matrix<K, C>& b)
+{
+    Matrix<R, C> p = Matrix<R, C>::zero();
+    for(int r = 0; r < R; r++)
+    {
+        for(int k = 0; k < K; k++)
+        {
+            double v = a.m[r][k];
+            if(v == 0.0) continue;
+            for(int c = 0; c < C; c++) p.m[r][c] += v * b.m[k][c];
+        }
+    }
+    return p;
+}
+
+/* Solve a * x = b for a symmetric positive definite a, by Cholesky decomposition
+ * Returns false (leaving x alone) if a is not positive definite
+ */
+template <int N, int C>
+inline bool solve_spd(const Matrix<N, N>& a, const Matrix<N, C>& b, Matrix<N, C>& x)
+{
+    /* a = L * L', with L lower triangular */
+    Matrix<N, N> l = Matrix<N, N>::zero();
+    for(int j = 0; j < N; j++)
+    {
+        double d = a.m[j][j];
+        for(int k = 0; k < j; k++) d -= l.m[j][k] * l.m[j][k];
+        if(!(d > 0.0)) return false;
+        l.m[j][j] = std::sqrt(d);
+        for(int i = j + 1; i < N; i++)
+        {
+            double s = a.m[i][j];
+            for(int k = 0; k < j; k++) s -= l.m[i][k] * l.m[j][k];
+            l.m[i][j] = s / l.m[j][j];
+        }
+    }
+
+    /* Forward substitution for L * y = b, then back substitution for L' * x = y */
+    Matrix<N, C> y;
+    for(int c = 0; c < C; c++)
+    {
+        for(int i = 0; i < N; i++)
+        {
+            double s = b.m[i][c];
+            for(int k = 0; k < i; k++) s -= l.m[i][k] * y.m[k][c];
+            y.m[i][c] = s / l.m[i][i];
+        }
+        for(int i = N - 1; i >= 0; i--)
+        {
+            double s = y.m[i][c];
+            for(int k = i + 1; k < N; k++) s -= l.m[k][i] * x.m[k][c];
+            x.m[i][c] = s / l.m[i][i];
+        }
+    }
+    return true;
+}
+
+} /* namespace pal */
+
+#endif /* _PAL_MATRIX_HPP_ */
@@ -0,0 +1,170 @@
+function data = readlog(fname)
+% Read a binary data file (dat%05d.bin) into a struct
+% Each channel becomes a field named after the channel, and time is the row
+% time in seconds. Channels logged with a sample time (log_data_dbl_ts) also
+% get a <name>_t field with the instant each value was sampled, in seconds.
+% Variable-length channels (log_data_var) become a struct of per-object
+% columns, with time holding the row time of each object.
+% See include/pal/log_format.h for the file layout
+
+fid = fopen(fname, 'r', 'ieee-le');
+raw = fread(fid, inf, 'uint8=>uint8');
+fclose(fid);
+
+if numel(raw) < 16 || ~strcmp(char(raw(1:4)'), 'PALB')
+    error('readlog: %s is not a binary log file', fname);
+end
+pos = double(typecast(raw(7:8), 'uint16')) + 1;
+
+% First pass reads the schema and counts the rows
+names = {};
+types = [];
+flags = [];
+counts = [];
+shapes = [];
+offsets = [];
+tsoffsets = [];
+layouts = {};
+rows = [];
+vars = [];
+points = [];
+while pos + 8 <= numel(raw) + 1
+    rtype = typecast(raw(pos:pos+1), 'uint16');
+    rlen = double(typecast(raw(pos+4:pos+7), 'uint32'));
+    payload = pos + 8;
+    if payload + rlen - 1 > numel(raw)
+        break;
+    end
+    if rtype == 1
+        types(end+1) = raw(payload);
+        flags(end+1) = raw(payload+1);
+        counts(end+1) = double(typecast(raw(payload+2:payload+3), 'uint16'));
+        offsets(end+1) = double(typecast(raw(payload+4:payload+5), 'uint16'));
+        shapes(end+1) = raw(payload+6);
+        tsoffsets(end+1) = double(typecast(raw(payload+8:payload+9), 'uint16'));
+        name = raw(payload+12:payload+rlen-1)';
+        nul = find(name == 0);
+        names{end+1} = char(name(1:nul(1) - 1));
+        if numel(nul) > 1
+            layouts{end+1} = char(name(nul(1) + 1:nul(2) - 1));
+        else
+            layouts{end+1} = '';
+        end
+    elseif rtype == 2
+        rows(end+1) = payload;
+    elseif rtype == 3
+        vars(end+1, :) = [double(typecast(raw(pos+2:pos+3), 'uint16')) + 1, payload];
+    elseif rtype == 4
+        points(end+1, :) = [double(typecast(raw(pos+2:pos+3), 'uint16')) + 1, ...
+            double(typecast(raw(payload:payload+3), 'uint32')) / 1000, ...
+            typecast(raw(payload+8:payload+15), 'double')];
+    end
+    pos = payload + ceil(rlen / 8) * 8;
+end
+
+% Second pass gathers each channel from the rows
+n = numel(rows);
+data.time = zeros(n, 1);
+for r = 1:n
+    data.time(r) = double(typecast(raw(rows(r):rows(r)+3), 'uint32')) / 1000;
+end
+xyz = {'x', 'y', 'z', 'w'};
+euler = {'pitch', 'roll', 'yaw'};
+for c = 1:numel(names)
+    name = matlab.lang.makeValidName(names{c});
+    if bitand(flags(c), 2)
+        data.(name) = readvar(raw, vars, c, layouts{c});
+        continue;
+    end
+    if bitand(flags(c), 4)
+        if isempty(points)
+            pts = zeros(0, 2);
+        else
+            pts = sortrows(points(points(:, 1) == c, 2:3));
+        end
+        data.([name '_pts']) = pts;
+        if bitand(flags(c), 8)
+            method = 'previous';
+        else
+            method = 'linear';
+        end
+        if size(pts, 1) > 1
+            data.(name) = interp1(pts(:, 1), pts(:, 2), data.time, method);
+        else
+            data.(name) = repmat(pts(:, 2), n, 1);
+        end
+        continue;
+    end
+    if types(c) == 1
+        esize = 4;
+    else
+        esize = 8;
+    end
+    v = zeros(n, counts(c));
+    dt = zeros(n, 1);
+    for r = 1:n
+        p = rows(r) + offsets(c);
+        for k = 1:counts(c)
+            q = p + (k - 1) * esize;
+            if types(c) == 1
+                v(r, k) = double(typecast(raw(q:q+3), 'int32'));
+            else
+                v(r, k) = typecast(raw(q:q+7), 'double');
+            end
+        end
+        if bitand(flags(c), 1)
+            q = rows(r) + tsoffsets(c);
+            dt(r) = double(typecast(raw(q:q+3), 'int32')) / 1e6;
+        end
+    end
+    % Vector channels expand to one field per element, named by the shape
+    if counts(c) == 1
+        data.(name) = v;
+    else
+        for k = 1:counts(c)
+            if shapes(c) == 1 && k <= 4
+                suffix = xyz{k};
+            elseif shapes(c) == 2 && k <= 3
+                suffix = euler{k};
+            else
+                suffix = sprintf('%d', k - 1);
+            end
+            data.([name '_' suffix]) = v(:, k);
+        end
+    end
+    if bitand(flags(c), 1)
+        data.([name '_t']) = data.time + dt;
+    end
+end
+end
+
+function t = readvar(raw, vars, c, layout)
+% Explode the VAR records of channel c into one entry per object
+sizes = struct('i8', 1, 'u8', 1, 'i16', 2, 'u16', 2, 'i32', 4, 'u32', 4, 'f32', 4, 'f64', 8);
+classes = struct('i8', 'int8', 'u8', 'uint8', 'i16', 'int16', 'u16', 'uint16', ...
+    'i32', 'int32', 'u32', 'uint32', 'f32', 'single', 'f64', 'double');
+fields = strsplit(layout, ',');
+t.time = [];
+for f = 1:numel(fields)
+    nt = strsplit(fields{f}, ':');
+    t.(nt{1}) = [];
+end
+if isempty(vars)
+    return;
+end
+for p = vars(vars(:, 1) == c, 2)'
+    time = double(typecast(raw(p:p+3), 'uint32')) / 1000;
+    count = double(typecast(raw(p+4:p+5), 'uint16'));
+    esize = double(typecast(raw(p+6:p+7), 'uint16'));
+    for k = 1:count
+        q = p + 8 + (k - 1) * esize;
+        t.time(end+1, 1) = time;
+        for f = 1:numel(fields)
+            nt = strsplit(fields{f}, ':');
+            n = sizes.(nt{2});
+            t.(nt{1})(end+1, 1) = double(typecast(raw(q:q+n-1), classes.(nt{2})));
+            q = q + n;
+        end
+    end
+end
+end
@@ -1,5 +1,6 @@
 % Simulation function
 clear
+% Data files convert to .mat with host/bin/pallog mat model/data000047.csv
 load('data000047.mat');
 % Initialize states and cov based on starting assumptions
 curState = [-1.47, 1.207, 275/180*3.14159, 0, 0, 0, 0, 0, 0];
@@ -6,22 +6,27 @@
 
 /* Required headers */
 #include "pros/apix.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 /* Need to define log level for this file lol */
 #define LOG_LEVEL_FILE LOG_LEVEL_WARN
 #include "pal/log.h"
+#include "pal/log_format.h"
+#include "pal/log_sink.h"
+#include "log_internal.h"
 
-/* Variables which are exported */
-FILE* fd;
-FILE* dd;
+/* Longest message text, the rest is cut off */
+#define LOG_MSG_MAX 256
 
 /* Variables which are not exported */
-static char dname[64]; /* File name of the data file and log file */
-static char fname[64]; /* The size of these strings is guaranteed by the naming convention */
+static int dopen = 0; /* The data file is open, so data goes to the sinks */
 static int dheader = 0; /* Indicate if header needs to be printed */
 static int fnum = -1;
+static int boot_id = -1; /* Index of the first file opened since power on */
+static uint32_t row_ms = 0; /* Time of the current row, for sample time deltas */
 
 /* Function to return the file index */
 int log_id()
@@ -46,12 +51,16 @@ void log_reopen(int segment)
      */
     if(segment)
     {
-        /* Close fd and dd if open */
+        /* Close the files if open */
         LOG_ALWAYS("Segment requested, opening with new file name");
-        fclose(fd);
-        fclose(dd);
-        fd = NULL;
-        dd = NULL;
+        /* The last binary row is still buffered, write it to the old file */
+        if(dopen)
+        {
+            log_bin_close();
+            log_out_commit();
+            log_sink_put(LOG_SINK_CLOSE,0,NULL,0,NULL,0);
+        }
+        dopen = 0;
         uSD_last = false;
     }
 
@@ -79,6 +88,7 @@ void log_reopen(int segment)
         }
         LOG_INFO("New file index is %d",idx);
         fnum = idx;
+        if(boot_id < 0) boot_id = idx;
 
         /* In any case, reopen the index file to write the latest file index */
         fidx = fopen("/usd/index.txt","w");
@@ -90,30 +100,24 @@ void log_reopen(int segment)
         }
 
         /* Determine filenames of the data log and message log */
+        char fname[32];
+        char dname[32];
         sprintf(fname,"/usd/log%05d.txt",idx);
-        sprintf(dname,"/usd/dat%05d.csv",idx);
-
-        /* Open the new files */
-        fd = fopen(fname,"w");
-        dd = fopen(dname,"w");
-
-        /* Check for errors in the process */
-        if(fd)
-        {
-            LOG_ALWAYS("Log file opened (%s)",fname);
-        }
-        else
-        {
-            LOG_ERROR("Error opening log file (%s)",fname);
-        }
-        if(dd)
-        {
-            LOG_ALWAYS("Data file opened (%s)",dname);
-        }
-        else
-        {
-            LOG_ERROR("Error opening data file (%s)",dname);
-        }
+        sprintf(dname,log_bin_enabled() ? "/usd/dat%05d.bin" : "/usd/dat%05d.csv",idx);
+
+        /* Have the file sinks open the new files, they only report if that fails
+         * The boot id lets the host join up the segments of one run
+         */
+        log_sink_open_t open;
+        open.index = idx;
+        open.boot = boot_id;
+        open.binary = log_bin_enabled();
+        log_out_commit();
+        log_sink_put(LOG_SINK_OPEN,0,NULL,0,&open,sizeof(open));
+        dopen = 1;
+        LOG_ALWAYS("Log file opened (%s), boot %d",fname,boot_id);
+        LOG_ALWAYS("Data file opened (%s)",dname);
+        if(log_bin_enabled()) log_bin_open(log_now_ms(),boot_id);
 
         /* Since file is open, reset header status to 2, which will decrement to 1 at log_step*/
         dheader = 2;
@@ -121,53 +125,22 @@ void log_reopen(int segment)
         /* Now that the file is open, we can write the first log entry */
         LOG_INFO("Log Files Opened");
     }
-    /* If it was previously installed and isn't any more, close the files and set them null */
+    /* If it was previously installed and isn't any more, close the files */
     else if(!uSD_avail && uSD_last)
     {
         LOG_ALWAYS("uSD now unavailable");
-        fclose(fd);
-        fclose(dd);
-        fd = NULL;
-        dd = NULL;
+        log_out_commit();
+        log_sink_put(LOG_SINK_CLOSE,0,NULL,0,NULL,0);
+        dopen = 0;
         fnum = -1;
     }
-    /* If the uSD is currently valid and was previously valid, reopen the file again */
+    /* If the uSD is currently valid and was previously valid, have the file sinks
+     * reopen their files, which commits what they have written to the card
+     */
     else if(uSD_avail && uSD_last)
     {
-        LOG_DEBUG("About to swap file handles");
-        //task_set_priority(CURRENT_TASK,TASK_PRIORITY_MAX);
-        FILE* fd_temp = fd;
-        fd = NULL;
-        FILE* dd_temp = dd;
-        dd = NULL;
-        //task_set_priority(CURRENT_TASK,TASK_PRIORITY_DEFAULT-1);
-        /* Close the fd and reopen it */
-        fclose(fd_temp);
-        fd_temp = fopen(fname,"a");
-        fclose(dd_temp);
-        dd_temp = fopen(dname,"a");
-        //task_set_priority(CURRENT_TASK,TASK_PRIORITY_MAX);
-        fd = fd_temp;
-        dd = dd_temp;
-        //task_set_priority(CURRENT_TASK,TASK_PRIORITY_DEFAULT-1);
-
-        /* Check for errors */
-        if(fd)
-        {
-            LOG_DEBUG("Log file reopened (%s)",fname);
-        }
-        else
-        {
-            LOG_ERROR("Error reopening log file (%s)",fname);
-        }
-        if(dd)
-        {
-            LOG_DEBUG("Data file reopened (%s)",dname);
-        }
-        else
-        {
-            LOG_ERROR("Error reopening data file (%s)",dname);
-        }
+        log_out_commit();
+        log_sink_put(LOG_SINK_FLUSH,0,NULL,0,NULL,0);
         LOG_INFO("Log Files Reopened");
     }
     /* Otherwise, uSD is not available and wasn't before */
@@ -186,18 +159,23 @@ void log_segment()
     log_reopen(true);
 }
 
+/* Time of the row being written, which the poller gives values it hasn't sampled */
+uint32_t log_row_ms()
+{
+    return row_ms;
+}
+
 /* Log Step checks if it's been more than a second and calls reopen if necessary */
 void log_step()
 {
-    /* decrement dheader if it's above 0 so we can write the header row */
-    if(dheader)
-    {
-        dheader--;
-    }
+    /* The previous row is complete, so hand it to the sinks */
+    log_out_commit();
+
     /* Store previous time */
     static double time_last = 0.0;
     /* Get new time */
-    double time_now = millis() / 1000.0;
+    row_ms = log_now_ms();
+    double time_now = row_ms / 1000.0;
 
     /* If it's been a second or more, reopen */
     if((time_now - time_last) > 1.0)
@@ -206,39 +184,60 @@ void log_step()
         time_last = time_now;
     }
 
+    /* decrement dheader if it's above 0 so we can write the header row
+     * This comes after the reopen, so files opened here get one header pass, as
+     * those opened by log_init() or log_segment() before the step do
+     */
+    if(dheader)
+    {
+        dheader--;
+    }
+
     /* Make sure log file is valid before writing to it */
-    if(dd)
+    if(dopen && log_bin_enabled())
+    {
+        /* Binary rows carry the time in the row record */
+        log_bin_step(row_ms,dheader);
+    }
+    else if(dopen)
     {
         /* If printing headers, print TIME, else print the timestamp */
         if(dheader)
         {
-            fprintf(dd,"TIME");
+            log_out_printf("TIME");
         }
         else
         {
-            fprintf(dd,"\n%08.03f",time_now);
+            log_out_printf("\n%08.03f",time_now);
         }
     }
+
+    /* Write the columns sampled by the device poller, if any */
+    log_poll_emit();
 }
 
 /* Initialize the logger */
 void log_init()
 {
-    /* Open the logger if the uSD card is inserted */
+    /* Start the sinks, then open the files if the uSD card is inserted */
+    log_sink_add(&log_sink_usd_text);
+    log_sink_add(&log_sink_usd_data);
+    log_sink_add(&log_sink_console);
+    log_sink_start();
     log_reopen(false);
 }
 
+/* The data file is open */
+int log_out_ready()
+{
+    return dopen;
+}
 
-/* Internal function to check if a log at level should be printed or not, also prints the log header
- * Return values:
- * 2 = log to both fd and printf
- * 1 = log to printf only (fd is invalid)
- * 0 = don't log
- */
-int log_check(const char * fname, const int line,log_level_t level,log_level_t flevel)
+
+/* Log level strings */
+const char * log_level_name(int level)
 {
-    /* Log level strings */
-    static const char * log_names[] = 
+    static const char * log_names[] =
     {
         "DEBUG",
         "INFO",
@@ -246,62 +245,275 @@ int log_check(const char * fname, const int line,log_level_t level,log_level_t f
         "ERROR",
         "ALWAYS"
     };
+    if(level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if(level > LOG_LEVEL_ALWAYS) level = LOG_LEVEL_ALWAYS;
+    return log_names[level];
+}
 
+/* Internal function to write a message, once, to the shared buffer the sinks read */
+void log_message(const char * fname, int line, log_level_t level, const char * format, ...)
+{
     /* Clamp level to valid values */
     level = (level > LOG_LEVEL_ALWAYS) ? LOG_LEVEL_ALWAYS : level;
 
-    /* If we are below the required log level, exit now */
-    if(flevel > level) return 0;
-
-    /* We should log this, so print the log header and then return true to allow the 
-     * user message to be printed after
-     */
-
-    /* Print the information */
-    double time = millis() / 1000.0;
-    printf("%08.3f [%s] in %s line %d: ",time,log_names[level],fname,line);
-
-    /* If fd is invalid, end here, otherwise print to the file as well */
-    if(!fd) return 1;
-
-    /* Print the same information as earlier to the file */
-    fprintf(fd,"\n%08.3f [%s] in %s line %d: ",time,log_names[level],fname,line);
+    char text[LOG_MSG_MAX];
+    va_list args;
+    va_start(args,format);
+    int len = vsnprintf(text,sizeof(text),format,args);
+    va_end(args);
+    if(len < 0) len = 0;
+    if(len >= (int)sizeof(text)) len = sizeof(text) - 1;
 
-    /* Tell the macro to print to the file */
-    return 2;
+    /* Without sinks yet, print the same line the console sink would */
+    if(!log_sink_started())
+    {
+        printf("%08.3f [%s] in %s line %d: %s\n",log_now_ms() / 1000.0,log_level_name(level),fname,line,text);
+        return;
+    }
+    log_sink_put(LOG_SINK_MSG,level,fname,line,text,len);
 }
 
 /* Functions to log data */
 void log_data_int(const char * pname, int data)
 {
+    /* Binary files store the value in the row buffer */
+    if(log_bin_enabled())
+    {
+        log_bin_data(pname,LOG_TYPE_INT,data,0.0,LOG_TS_NONE,0);
+    }
     /* If data is safe to access, print to it */
-    if(dd)
+    else if(dopen)
     {
         /* If we need to print the header, do that instead of data */
         if(dheader)
         {
-            fprintf(dd,",%s",pname);
+            log_out_printf(",%s",pname);
         }
         else
         {
-            fprintf(dd,",%d",data);
+            log_out_printf(",%d",data);
         }
     }
 
 }
 void log_data_dbl(const char * pname, double data)
 {
+    /* Binary files store the value in the row buffer */
+    if(log_bin_enabled())
+    {
+        log_bin_data(pname,LOG_TYPE_DBL,0,data,LOG_TS_NONE,0);
+    }
     /* If data is safe to access, print to it */
-    if(dd)
+    else if(dopen)
     {
         /* If we need to print the header, do that instead of data */
         if(dheader)
         {
-            fprintf(dd,",%s",pname);
+            log_out_printf(",%s",pname);
         }
         else
         {
-            fprintf(dd,",%f",data);
+            log_out_printf(",%f",data);
+        }
+    }
+}
+
+/* Function to log a vector as one channel, expanded to a CSV column per element */
+static void log_data_shape(const char * pname, uint8_t shape, const double * data, int count)
+{
+    /* Element names for the named shapes */
+    static const char * xyz_names[] = {"x","y","z","w"};
+    static const char * euler_names[] = {"pitch","roll","yaw"};
+
+    /* Binary files store the whole vector contiguously in the row buffer */
+    if(log_bin_enabled())
+    {
+        log_bin_vec(pname,shape,data,count);
+    }
+    /* If data is safe to access, print to it */
+    else if(dopen)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            /* If we need to print the header, do that instead of data */
+            if(!dheader)
+            {
+                log_out_printf(",%f",data[i]);
+            }
+            else if(shape == LOG_SHAPE_XYZ && i < 4)
+            {
+                log_out_printf(",%s_%s",pname,xyz_names[i]);
+            }
+            else if(shape == LOG_SHAPE_EULER && i < 3)
+            {
+                log_out_printf(",%s_%s",pname,euler_names[i]);
+            }
+            else
+            {
+                log_out_printf(",%s_%d",pname,i);
+            }
         }
     }
-}
\ No newline at end of file
+}
+
+/* Functions to log vectors */
+void log_data_vec(const char * pname, const double * data, int count)
+{
+    log_data_shape(pname,LOG_SHAPE_ARRAY,data,count);
+}
+void log_data_vec3(const char * pname, double x, double y, double z)
+{
+    double v[3] = {x,y,z};
+    log_data_shape(pname,LOG_SHAPE_XYZ,v,3);
+}
+void log_data_quat(const char * pname, double x, double y, double z, double w)
+{
+    double v[4] = {x,y,z,w};
+    log_data_shape(pname,LOG_SHAPE_XYZ,v,4);
+}
+void log_data_euler(const char * pname, double pitch, double roll, double yaw)
+{
+    double v[3] = {pitch,roll,yaw};
+    log_data_shape(pname,LOG_SHAPE_EULER,v,3);
+}
+
+/* Compute the struct size described by a VAR layout string, or -1 if it is invalid */
+static int log_layout_size(const char * layout)
+{
+    /* Types allowed in a layout, with their sizes */
+    static const struct
+    {
+        const char * name;
+        int size;
+    } types[] =
+    {
+        {"i8",1},{"u8",1},{"i16",2},{"u16",2},{"i32",4},{"u32",4},{"f32",4},{"f64",8}
+    };
+
+    int size = 0;
+    const char * p = layout;
+    while(p && *p)
+    {
+        /* Skip the field name to the type */
+        const char * t = strchr(p,':');
+        if(!t) return -1;
+        t++;
+        const char * end = strchr(t,',');
+        size_t tlen = end ? (size_t)(end - t) : strlen(t);
+
+        int found = 0;
+        for(size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        {
+            if(strlen(types[i].name) == tlen && !strncmp(types[i].name,t,tlen))
+            {
+                size += types[i].size;
+                found = 1;
+                break;
+            }
+        }
+        if(!found) return -1;
+        p = end ? end + 1 : NULL;
+    }
+    return size;
+}
+
+/* Function to log a variable number of packed structs */
+void log_data_var(const char * pname, const char * layout, const void * data, int count, int size)
+{
+    /* Check the layout once, when the header is generated */
+    if(dheader && log_layout_size(layout) != size)
+    {
+        LOG_ERROR("Layout of %s does not match struct size %d",pname,size);
+        return;
+    }
+
+    /* Binary files store the structs in a VAR record after the row */
+    if(log_bin_enabled())
+    {
+        log_bin_var(pname,layout,data,count,size);
+    }
+    /* CSV files have fixed columns, so only the count is logged */
+    else if(dopen)
+    {
+        if(dheader)
+        {
+            log_out_printf(",%s_n",pname);
+        }
+        else
+        {
+            log_out_printf(",%d",count);
+        }
+    }
+}
+
+/* Function to log data through a lossy compressor */
+void log_data_dbl_comp(const char * pname, double data, log_comp_mode_t mode, double tolerance)
+{
+    /* Binary files only keep the points the compressor needs */
+    if(log_bin_enabled())
+    {
+        log_bin_comp(pname,data,mode,tolerance);
+    }
+    /* CSV files have a value on every row, so are not compressed */
+    else
+    {
+        log_data_dbl(pname,data);
+    }
+}
+
+/* Functions to log data with the instant it was sampled */
+void log_data_int_ts(const char * pname, int data, uint64_t time_us)
+{
+    /* Binary files store the value and delta in the row buffer */
+    if(log_bin_enabled())
+    {
+        log_bin_data(pname,LOG_TYPE_INT,data,0.0,LOG_TS_OWN,time_us);
+    }
+    /* If data is safe to access, print to it */
+    else if(dopen)
+    {
+        /* If we need to print the header, print the value and delta columns */
+        if(dheader)
+        {
+            log_out_printf(",%s,%s_dt",pname,pname);
+        }
+        else
+        {
+            log_out_printf(",%d,%lld",data,(long long)time_us - (long long)row_ms * 1000);
+        }
+    }
+}
+void log_data_dbl_ts(const char * pname, double data, uint64_t time_us)
+{
+    /* Binary files store the value and delta in the row buffer */
+    if(log_bin_enabled())
+    {
+        log_bin_data(pname,LOG_TYPE_DBL,0,data,LOG_TS_OWN,time_us);
+    }
+    /* If data is safe to access, print to it */
+    else if(dopen)
+    {
+        /* If we need to print the header, print the value and delta columns */
+        if(dheader)
+        {
+            log_out_printf(",%s,%s_dt",pname,pname);
+        }
+        else
+        {
+            log_out_printf(",%f,%lld",data,(long long)time_us - (long long)row_ms * 1000);
+        }
+    }
+}
+void log_data_dbl_ts_shared(const char * pname, double data)
+{
+    /* Binary files point the channel at the delta already in the row */
+    if(log_bin_enabled())
+    {
+        log_bin_data(pname,LOG_TYPE_DBL,0,data,LOG_TS_SHARED,0);
+    }
+    /* The CSV already has the _dt column, so this is a plain value */
+    else
+    {
+        log_data_dbl(pname,data);
+    }
+}
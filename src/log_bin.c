@@ -0,0 +1,408 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "pal/log_format.h"
+#include "log_internal.h"
+
+/* Limits of the binary schema, the row buffer is statically allocated */
+#define BIN_MAX_CHAN 256
+#define BIN_ROW_MAX 4096
+#define BIN_VAR_MAX 4096
+#define BIN_MAX_COMP 64
+
+/* Variables which are not exported */
+static int bin_enabled = 0;     /* Set by log_binary() */
+static int bin_header = 0;      /* Current pass is the header pass */
+static int bin_pending = 0;     /* Row buffer holds a row which has not been written */
+static int bin_col = 0;         /* Column index within the current row */
+static uint32_t bin_row_ms = 0; /* Time of the current row */
+
+/* Schema of the current file */
+static int nchan = 0;
+static uint8_t chan_type[BIN_MAX_CHAN];
+static uint8_t chan_flags[BIN_MAX_CHAN];
+static uint16_t chan_count[BIN_MAX_CHAN];
+static uint8_t chan_comp[BIN_MAX_CHAN];   /* Index into comp + 1, or 0 if not compressed */
+
+/* Compressor state of each compressed channel */
+static log_comp_state_t comp[BIN_MAX_COMP];
+static int ncomp = 0;
+static uint16_t chan_offset[BIN_MAX_CHAN];
+static uint16_t chan_ts[BIN_MAX_CHAN];    /* Offset of the sample time delta, if LOG_CHAN_TS */
+static int row_len = 0;
+static int row_hole = -1;   /* A free 4-byte slot left by aligning a double, or -1 */
+static int last_ts = -1;    /* Offset of the latest delta, which LOG_TS_SHARED values use */
+
+/* Row buffer, header followed by the channel area */
+static union
+{
+    uint64_t align;
+    uint8_t buf[sizeof(log_bin_row_t) + BIN_ROW_MAX];
+} row;
+
+/* VAR and POINT records belonging to the current row, written after it */
+static union
+{
+    uint64_t align;
+    uint8_t buf[BIN_VAR_MAX];
+} var;
+static int var_len = 0;
+
+/* Zero padding written after records */
+static const uint8_t pad[LOG_BIN_ALIGN] = {0};
+
+/* Enable binary data files, must be called before log_init() */
+void log_binary(int enable)
+{
+    bin_enabled = enable;
+}
+
+int log_bin_enabled()
+{
+    return bin_enabled;
+}
+
+/* Write one record to the data file, padding it to the record alignment */
+static void log_bin_record(uint16_t type, uint16_t chan, const void * payload, uint32_t len)
+{
+    if(!log_out_ready()) return;
+    log_bin_record_t rec;
+    rec.type = type;
+    rec.chan = chan;
+    rec.len = len;
+    log_out_write(&rec,sizeof(rec));
+    log_out_write(payload,len);
+    log_out_write(pad,LOG_BIN_PAD(len) - len);
+}
+
+/* Start a new file, writing the file header and discarding the old schema
+ * boot is the index of the first file opened since power on
+ */
+void log_bin_open(uint32_t time_ms, int boot)
+{
+    log_bin_header_t hdr;
+    memcpy(hdr.magic,LOG_BIN_MAGIC,sizeof(hdr.magic));
+    hdr.version = LOG_BIN_VERSION;
+    hdr.header_len = sizeof(hdr);
+    hdr.open_ms = time_ms;
+    hdr.boot = boot + 1;
+    if(log_out_ready()) log_out_write(&hdr,sizeof(hdr));
+
+    nchan = 0;
+    ncomp = 0;
+    row_len = 0;
+    row_hole = -1;
+    last_ts = -1;
+    bin_pending = 0;
+    var_len = 0;
+}
+
+/* Write the pending row, if there is one */
+void log_bin_flush()
+{
+    if(!bin_pending) return;
+    bin_pending = 0;
+    log_bin_record(LOG_REC_ROW,0,row.buf,sizeof(log_bin_row_t) + row_len);
+
+    /* VAR and POINT records are already framed and padded */
+    if(var_len && log_out_ready()) log_out_write(var.buf,var_len);
+    var_len = 0;
+}
+
+/* Start a new row, called by log_step() in place of the CSV TIME column */
+void log_bin_step(uint32_t time_ms, int header)
+{
+    /* The previous row is complete now */
+    log_bin_flush();
+
+    bin_header = header;
+    bin_col = 0;
+    bin_row_ms = time_ms;
+
+    /* The header pass rebuilds the schema from scratch */
+    if(header)
+    {
+        nchan = 0;
+        ncomp = 0;
+        row_len = 0;
+        row_hole = -1;
+        last_ts = -1;
+        return;
+    }
+
+    /* Prepare the row buffer, channels which are never written stay zero */
+    log_bin_row_t * r = (log_bin_row_t *)row.buf;
+    memset(row.buf,0,sizeof(log_bin_row_t) + row_len);
+    r->time_ms = time_ms;
+    bin_pending = (nchan > 0);
+    var_len = 0;
+}
+
+/* Take size bytes of the channel area at an alignment of align, 4 or 8
+ * A 4-byte value goes in the gap an earlier double left, if there is one
+ */
+static int log_bin_alloc(int size, int align)
+{
+    if(size == 4 && row_hole >= 0)
+    {
+        int at = row_hole;
+        row_hole = -1;
+        return at;
+    }
+    int at = (row_len + align - 1) & ~(align - 1);
+    if(at > row_len) row_hole = row_len;
+    row_len = at + size;
+    return at;
+}
+
+/* Add a channel to the schema during the header pass
+ * ts is LOG_TS_NONE, or LOG_TS_OWN or LOG_TS_SHARED for its sample time delta
+ */
+static void log_bin_channel(const char * pname, uint8_t type, uint8_t flags, uint8_t shape, int count, const char * layout, int ts)
+{
+    /* Lay out the values at their natural alignment, then the delta if it has its own
+     * VAR and sparse channels live in their own records, so take no space in the row
+     */
+    int size = (type == LOG_TYPE_INT) ? sizeof(int32_t) : sizeof(double);
+    int saved_len = row_len;
+    int saved_hole = row_hole;
+    int offset = 0;
+    int ts_offset = 0;
+    if(ts == LOG_TS_SHARED && last_ts < 0) ts = LOG_TS_NONE;
+    if(ts != LOG_TS_NONE) flags |= LOG_CHAN_TS;
+    if(!(flags & (LOG_CHAN_VAR | LOG_CHAN_SPARSE)) && count >= 1 && count <= UINT16_MAX)
+    {
+        offset = log_bin_alloc(size * count,size);
+        if(ts == LOG_TS_OWN) ts_offset = log_bin_alloc(sizeof(int32_t),sizeof(int32_t));
+        else if(ts == LOG_TS_SHARED) ts_offset = last_ts;
+    }
+
+    if(nchan >= BIN_MAX_CHAN || row_len > BIN_ROW_MAX || count < 1 || count > UINT16_MAX)
+    {
+        row_len = saved_len;
+        row_hole = saved_hole;
+        if(ts == LOG_TS_OWN) last_ts = -1;
+        LOG_ERROR("Binary schema full, dropping channel %s",pname);
+        return;
+    }
+
+    chan_type[nchan] = type;
+    chan_flags[nchan] = flags;
+    chan_count[nchan] = count;
+    chan_offset[nchan] = (flags & (LOG_CHAN_VAR | LOG_CHAN_SPARSE)) ? 0 : sizeof(log_bin_row_t) + offset;
+    chan_ts[nchan] = (flags & LOG_CHAN_TS) ? sizeof(log_bin_row_t) + ts_offset : 0;
+    if(ts == LOG_TS_OWN) last_ts = ts_offset;
+    chan_comp[nchan] = 0;
+
+    /* Write the CHANNEL record, with the name and layout following the fixed part */
+    struct
+    {
+        log_bin_channel_t ch;
+        char name[192];
+    } rec;
+    size_t nlen = strlen(pname);
+    size_t llen = layout ? strlen(layout) : 0;
+    if(nlen > 63) nlen = 63;
+    if(llen > sizeof(rec.name) - nlen - 2) llen = sizeof(rec.name) - nlen - 2;
+    rec.ch.type = type;
+    rec.ch.flags = flags;
+    rec.ch.count = count;
+    rec.ch.offset = chan_offset[nchan];
+    rec.ch.shape = shape;
+    rec.ch.reserved = 0;
+    rec.ch.ts_offset = chan_ts[nchan];
+    rec.ch.reserved2 = 0;
+    memcpy(rec.name,pname,nlen);
+    rec.name[nlen] = 0;
+    if(layout)
+    {
+        memcpy(&rec.name[nlen + 1],layout,llen);
+        rec.name[nlen + 1 + llen] = 0;
+        nlen += llen + 1;
+    }
+    log_bin_record(LOG_REC_CHANNEL,nchan,&rec,sizeof(rec.ch) + nlen + 1);
+    nchan++;
+}
+
+/* Store the sample time of channel c as a delta from the row time, clamped to int32 */
+static void log_bin_ts(int c, uint64_t time_us)
+{
+    int64_t delta = (int64_t)time_us - (int64_t)bin_row_ms * 1000;
+    if(delta > INT32_MAX) delta = INT32_MAX;
+    if(delta < INT32_MIN) delta = INT32_MIN;
+    int32_t d = (int32_t)delta;
+    memcpy(&row.buf[chan_ts[c]],&d,sizeof(d));
+}
+
+/* Log one value, either adding it to the schema or storing it in the row */
+void log_bin_data(const char * pname, uint8_t type, int ival, double dval, int ts, uint64_t time_us)
+{
+    if(!log_out_ready()) return;
+
+    if(bin_header)
+    {
+        log_bin_channel(pname,type,0,LOG_SHAPE_ARRAY,1,NULL,ts);
+        return;
+    }
+
+    /* Values beyond the schema have nowhere to go */
+    if(bin_col >= nchan) return;
+    int c = bin_col++;
+    if(chan_flags[c] & (LOG_CHAN_VAR | LOG_CHAN_SPARSE)) return;
+    uint8_t * p = &row.buf[chan_offset[c]];
+
+    /* Store in the type from the schema, in case the caller switched functions */
+    if(chan_type[c] == LOG_TYPE_INT)
+    {
+        int32_t v = (type == LOG_TYPE_INT) ? ival : (int32_t)dval;
+        memcpy(p,&v,sizeof(v));
+    }
+    else
+    {
+        double v = (type == LOG_TYPE_INT) ? (double)ival : dval;
+        memcpy(p,&v,sizeof(v));
+    }
+
+    /* Values sharing a delta leave it to the one which stored it */
+    if((chan_flags[c] & LOG_CHAN_TS) && ts == LOG_TS_OWN)
+    {
+        log_bin_ts(c,time_us);
+    }
+}
+
+/* Log a vector, stored as one contiguous run of doubles in the row */
+void log_bin_vec(const char * pname, uint8_t shape, const double * data, int count)
+{
+    if(!log_out_ready()) return;
+
+    if(bin_header)
+    {
+        log_bin_channel(pname,LOG_TYPE_DBL,0,shape,count,NULL,LOG_TS_NONE);
+        return;
+    }
+
+    /* The vector must match the schema, otherwise leave the channel zero */
+    if(bin_col >= nchan) return;
+    int c = bin_col++;
+    if(chan_type[c] != LOG_TYPE_DBL || chan_count[c] != count) return;
+    if(chan_flags[c] & (LOG_CHAN_VAR | LOG_CHAN_SPARSE)) return;
+    memcpy(&row.buf[chan_offset[c]],data,count * sizeof(double));
+}
+
+/* Reserve a framed record in the side buffer, returning its zeroed payload
+ * The caller checks there is room
+ */
+static void * log_bin_side(uint16_t type, uint16_t chan, uint32_t len)
+{
+    log_bin_record_t * rec = (log_bin_record_t *)&var.buf[var_len];
+    rec->type = type;
+    rec->chan = chan;
+    rec->len = len;
+    memset(rec + 1,0,LOG_BIN_PAD(len));
+    var_len += sizeof(log_bin_record_t) + LOG_BIN_PAD(len);
+    return rec + 1;
+}
+
+/* Add a POINT record for channel c to the side buffer */
+static void log_bin_point(int c, const log_comp_point_t * pt)
+{
+    if(var_len + sizeof(log_bin_record_t) + sizeof(log_bin_point_t) > BIN_VAR_MAX)
+    {
+        LOG_WARN("No room for compressed point, dropped");
+        return;
+    }
+    log_bin_point_t * p = (log_bin_point_t *)log_bin_side(LOG_REC_POINT,c,sizeof(log_bin_point_t));
+    p->time_ms = pt->time_ms;
+    p->value = pt->value;
+}
+
+/* Log a variable number of packed structs, held in a VAR record after the row */
+void log_bin_var(const char * pname, const char * layout, const void * data, int count, int size)
+{
+    if(!log_out_ready()) return;
+
+    if(bin_header)
+    {
+        log_bin_channel(pname,LOG_TYPE_RAW,LOG_CHAN_VAR,LOG_SHAPE_ARRAY,size,layout,LOG_TS_NONE);
+        return;
+    }
+
+    if(bin_col >= nchan) return;
+    int c = bin_col++;
+    if(!(chan_flags[c] & LOG_CHAN_VAR) || chan_count[c] != size || count <= 0) return;
+
+    /* Frame the record now, dropping it if the row has no room left */
+    uint32_t len = sizeof(log_bin_var_t) + count * size;
+    if(count > UINT16_MAX || var_len + sizeof(log_bin_record_t) + LOG_BIN_PAD(len) > BIN_VAR_MAX)
+    {
+        LOG_WARN("VAR record for %s too large, dropped",pname);
+        return;
+    }
+    log_bin_var_t * v = (log_bin_var_t *)log_bin_side(LOG_REC_VAR,c,len);
+    v->time_ms = bin_row_ms;
+    v->count = count;
+    v->size = size;
+    memcpy(v + 1,data,count * size);
+}
+
+/* Log a value through the lossy compressor, keeping only the points it needs */
+void log_bin_comp(const char * pname, double data, uint8_t mode, double tol)
+{
+    if(!log_out_ready()) return;
+
+    if(bin_header)
+    {
+        if(ncomp >= BIN_MAX_COMP)
+        {
+            LOG_ERROR("Too many compressed channels, dropping channel %s",pname);
+            return;
+        }
+        uint8_t flags = LOG_CHAN_SPARSE | ((mode == LOG_COMP_DEADBAND) ? LOG_CHAN_HOLD : 0);
+        int c = nchan;
+        log_bin_channel(pname,LOG_TYPE_DBL,flags,LOG_SHAPE_ARRAY,1,NULL,LOG_TS_NONE);
+        if(nchan == c) return;
+        log_comp_reset(&comp[ncomp],mode,tol);
+        chan_comp[c] = ++ncomp;
+        return;
+    }
+
+    if(bin_col >= nchan) return;
+    int c = bin_col++;
+    if(!chan_comp[c]) return;
+
+    /* Keep whatever points the compressor asks for */
+    log_comp_point_t pts[2];
+    int n = log_comp_push(&comp[chan_comp[c] - 1],bin_row_ms,data,pts);
+    for(int i = 0; i < n; i++)
+    {
+        log_bin_point(c,&pts[i]);
+    }
+}
+
+/* Close the file, writing the pending row and the last value held by each compressor */
+void log_bin_close()
+{
+    log_bin_flush();
+    for(int c = 0; c < nchan; c++)
+    {
+        log_comp_point_t pt;
+        if(chan_comp[c] && log_comp_finish(&comp[chan_comp[c] - 1],&pt))
+        {
+            log_bin_point(c,&pt);
+        }
+    }
+    if(var_len && log_out_ready()) log_out_write(var.buf,var_len);
+    var_len = 0;
+}
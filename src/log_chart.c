@@ -0,0 +1,420 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+#include "log_internal.h"
+
+/* Default time between redraws */
+#define CHART_PERIOD_MS 100
+
+/* Element names of vector channels, as the CSV header has them */
+static const char * const chart_xyz[] = {"x","y","z","w"};
+static const char * const chart_euler[] = {"pitch","roll","yaw"};
+
+/* Queue a point of a series for the next redraw, dropping the oldest if it's full */
+static void chart_point(log_sink_chart_t * chart, log_sink_chart_series_t * s, double v)
+{
+    lv_coord_t y = LV_CHART_POINT_DEF;
+    if(isfinite(v) && s->hi != s->lo)
+    {
+        double scaled = (v - s->lo) * LOG_SINK_CHART_SCALE / (s->hi - s->lo);
+        if(scaled < 0) scaled = 0;
+        if(scaled > LOG_SINK_CHART_SCALE) scaled = LOG_SINK_CHART_SCALE;
+        y = (lv_coord_t)scaled;
+    }
+    mutex_take((mutex_t)chart->lock,TIMEOUT_MAX);
+    if(s->npending == LOG_SINK_CHART_PENDING)
+    {
+        memmove(s->pending,&s->pending[1],sizeof(s->pending) - sizeof(s->pending[0]));
+        s->npending--;
+        chart->skipped++;
+    }
+    s->pending[s->npending++] = y;
+    mutex_give((mutex_t)chart->lock);
+}
+
+/* Tell if a row at time t is due for a point, and when the next one is */
+static int chart_due(log_sink_chart_t * chart, uint32_t t)
+{
+    if((int32_t)(t - chart->next_ms) < 0) return 0;
+    chart->next_ms = t - t % chart->interval_ms + chart->interval_ms;
+    return 1;
+}
+
+/**
+ *  CSV data files
+ **/
+
+/* A field of the CSV file has ended */
+static void chart_csv_field(log_sink_chart_t * chart)
+{
+    if(chart->col < 0) return;
+    chart->field[chart->flen] = 0;
+
+    /* The header names the columns */
+    if(chart->header)
+    {
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            if(!strcmp(chart->field,chart->series[i].column)) chart->series[i].chan = chart->col;
+        }
+        return;
+    }
+
+    /* The time decides if the row is wanted, the rest of it is skipped if not */
+    if(chart->col == 0)
+    {
+        chart->due = chart_due(chart,(uint32_t)(strtod(chart->field,NULL) * 1000.0 + 0.5));
+        if(!chart->due) chart->col = -1;
+        return;
+    }
+    for(int i = 0; i < chart->nseries; i++)
+    {
+        if(chart->series[i].chan == chart->col) chart_point(chart,&chart->series[i],strtod(chart->field,NULL));
+    }
+}
+
+/* Read CSV text, a row starting at each newline */
+static void chart_csv(log_sink_chart_t * chart, const char * p, size_t len)
+{
+    const char * end = p + len;
+    while(p < end)
+    {
+        if(chart->col < 0)
+        {
+            const char * nl = memchr(p,'\n',end - p);
+            if(!nl) return;
+            p = nl;
+        }
+        char c = *p++;
+        if(c == ',' || c == '\n')
+        {
+            chart_csv_field(chart);
+            chart->flen = 0;
+            if(c == '\n')
+            {
+                chart->col = 0;
+                chart->header = 0;
+            }
+            else if(chart->col >= 0)
+            {
+                chart->col++;
+            }
+            continue;
+        }
+        if(chart->flen < sizeof(chart->field) - 1) chart->field[chart->flen++] = c;
+    }
+}
+
+/**
+ *  Binary data files
+ **/
+
+/* Element of a channel a column names, or -1 if it names another channel */
+static int chart_elem(const char * column, const char * name, uint8_t shape, int count)
+{
+    size_t n = strlen(name);
+    if(strncmp(column,name,n)) return -1;
+    if(!column[n]) return (count == 1) ? 0 : -1;
+    if(column[n] != '_') return -1;
+    const char * e = &column[n + 1];
+    for(int i = 0; i < count; i++)
+    {
+        char num[8];
+        const char * elem = num;
+        if(shape == LOG_SHAPE_XYZ && i < 4) elem = chart_xyz[i];
+        else if(shape == LOG_SHAPE_EULER && i < 3) elem = chart_euler[i];
+        else snprintf(num,sizeof(num),"%d",i);
+        if(!strcmp(e,elem)) return i;
+    }
+    return -1;
+}
+
+/* Copy what falls within [at, at + size) of the bytes at [pos, pos + len) of a record */
+static void chart_copy(uint8_t * dst, uint32_t at, uint32_t size, uint32_t pos, const uint8_t * p, uint32_t len)
+{
+    uint32_t lo = (at > pos) ? at : pos;
+    uint32_t hi = (at + size < pos + len) ? at + size : pos + len;
+    if(lo < hi) memcpy(&dst[lo - at],&p[lo - pos],hi - lo);
+}
+
+/* Take the next bytes of a record's payload, returning 1 to skip the rest of it */
+static int chart_bin_take(log_sink_chart_t * chart, const uint8_t * p, uint32_t len)
+{
+    uint32_t pos = chart->pos;
+    switch(chart->rec.type)
+    {
+    case LOG_REC_CHANNEL:
+        chart_copy(chart->rbuf,0,sizeof(chart->rbuf) - 1,pos,p,len);
+        return 0;
+    case LOG_REC_POINT:
+        chart_copy(chart->rbuf,0,sizeof(log_bin_point_t),pos,p,len);
+        return 0;
+    case LOG_REC_ROW:
+        /* The row time decides if the row is wanted, the rest of it is skipped if not */
+        if(pos < sizeof(log_bin_row_t))
+        {
+            chart_copy(chart->rbuf,0,sizeof(log_bin_row_t),pos,p,len);
+            if(pos + len < sizeof(log_bin_row_t)) return 0;
+            log_bin_row_t row;
+            memcpy(&row,chart->rbuf,sizeof(row));
+            chart->due = chart_due(chart,row.time_ms);
+            if(!chart->due) return 1;
+        }
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            log_sink_chart_series_t * s = &chart->series[i];
+            if(s->chan < 0 || (s->flags & LOG_CHAN_SPARSE)) continue;
+            uint32_t size = (s->type == LOG_TYPE_INT) ? sizeof(int32_t) : sizeof(double);
+            chart_copy(s->value,s->offset,size,pos,p,len);
+        }
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+/* A record has been read whole */
+static void chart_bin_record(log_sink_chart_t * chart)
+{
+    switch(chart->rec.type)
+    {
+    case LOG_REC_CHANNEL:
+    {
+        log_bin_channel_t ch;
+        memcpy(&ch,chart->rbuf,sizeof(ch));
+        const char * name = (const char *)&chart->rbuf[sizeof(ch)];
+        if(chart->rec.len < sizeof(ch) || ch.type == LOG_TYPE_RAW || (ch.flags & LOG_CHAN_VAR)) break;
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            log_sink_chart_series_t * s = &chart->series[i];
+            int elem = chart_elem(s->column,name,ch.shape,ch.count);
+            if(elem < 0) continue;
+            s->chan = chart->rec.chan;
+            s->type = ch.type;
+            s->flags = ch.flags;
+            s->offset = ch.offset + elem * ((ch.type == LOG_TYPE_INT) ? sizeof(int32_t) : sizeof(double));
+            s->have = 0;
+        }
+        break;
+    }
+    case LOG_REC_POINT:
+    {
+        log_bin_point_t pt;
+        memcpy(&pt,chart->rbuf,sizeof(pt));
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            log_sink_chart_series_t * s = &chart->series[i];
+            if(s->chan != chart->rec.chan || !(s->flags & LOG_CHAN_SPARSE)) continue;
+            memcpy(s->value,&pt.value,sizeof(pt.value));
+            s->have = 1;
+        }
+        break;
+    }
+    case LOG_REC_ROW:
+        if(!chart->due) break;
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            log_sink_chart_series_t * s = &chart->series[i];
+            if(s->chan < 0 || ((s->flags & LOG_CHAN_SPARSE) && !s->have)) continue;
+            if(s->type == LOG_TYPE_INT)
+            {
+                int32_t v;
+                memcpy(&v,s->value,sizeof(v));
+                chart_point(chart,s,v);
+            }
+            else
+            {
+                double v;
+                memcpy(&v,s->value,sizeof(v));
+                chart_point(chart,s,v);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Read binary records, which the logger may split across data records */
+static void chart_bin(log_sink_chart_t * chart, const uint8_t * p, size_t len)
+{
+    while(len)
+    {
+        uint32_t n;
+        if(chart->skip)
+        {
+            n = (chart->skip < len) ? chart->skip : len;
+            chart->skip -= n;
+        }
+        else if(chart->rlen < sizeof(chart->rec))
+        {
+            n = sizeof(chart->rec) - chart->rlen;
+            if(n > len) n = len;
+            memcpy((uint8_t *)&chart->rec + chart->rlen,p,n);
+            chart->rlen += n;
+            chart->pos = 0;
+            memset(chart->rbuf,0,sizeof(chart->rbuf));
+            if(chart->rlen == sizeof(chart->rec) && !chart->rec.len)
+            {
+                chart_bin_record(chart);
+                chart->rlen = 0;
+            }
+        }
+        else
+        {
+            n = chart->rec.len - chart->pos;
+            if(n > len) n = len;
+            int rest = chart_bin_take(chart,p,n);
+            chart->pos += n;
+            if(rest || chart->pos == chart->rec.len)
+            {
+                if(!rest) chart_bin_record(chart);
+                chart->skip = LOG_BIN_PAD(chart->rec.len) - chart->pos;
+                chart->rlen = 0;
+            }
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+/**
+ *  The sink
+ **/
+
+static void log_sink_chart_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    log_sink_chart_t * chart = (log_sink_chart_t *)sink;
+    switch(rec->type)
+    {
+    case LOG_SINK_OPEN:
+    {
+        log_sink_open_t open;
+        memcpy(&open,payload,sizeof(open));
+        /* The columns are found again in the new file's header */
+        chart->format = open.binary ? 1 : 0;
+        chart->next_ms = 0;
+        chart->due = 0;
+        chart->col = 0;
+        chart->header = 1;
+        chart->flen = 0;
+        chart->skip = open.binary ? sizeof(log_bin_header_t) : 0;
+        chart->rlen = 0;
+        for(int i = 0; i < chart->nseries; i++)
+        {
+            chart->series[i].chan = -1;
+            chart->series[i].have = 0;
+        }
+        break;
+    }
+    case LOG_SINK_CLOSE:
+        chart->format = -1;
+        break;
+    case LOG_SINK_DATA:
+        if(chart->format == 1) chart_bin(chart,(const uint8_t *)payload,rec->len);
+        else if(!chart->format) chart_csv(chart,(const char *)payload,rec->len);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Move the points queued since the last redraw into the series, on LVGL's task
+ * Points go straight into the series, so the chart is only refreshed once, and
+ * LVGL draws it on its next pass
+ */
+static void log_sink_chart_redraw(void * param)
+{
+    log_sink_chart_t * chart = (log_sink_chart_t *)param;
+    lv_task_set_period((lv_task_t *)chart->redraw,chart->period_ms);
+
+    lv_obj_t * obj = (lv_obj_t *)chart->chart;
+    uint16_t count = lv_chart_get_point_cnt(obj);
+    int drawn = 0;
+    mutex_take((mutex_t)chart->lock,TIMEOUT_MAX);
+    for(int i = 0; i < chart->nseries; i++)
+    {
+        log_sink_chart_series_t * s = &chart->series[i];
+        lv_chart_series_t * ser = (lv_chart_series_t *)s->series;
+        for(uint32_t k = 0; k < s->npending; k++)
+        {
+            ser->points[ser->start_point] = s->pending[k];
+            ser->start_point = (ser->start_point + 1) % count;
+        }
+        if(s->npending) drawn = 1;
+        s->npending = 0;
+    }
+    mutex_give((mutex_t)chart->lock);
+    if(drawn) lv_chart_refresh(obj);
+}
+
+int log_sink_chart_init(log_sink_chart_t * chart, void * parent, uint16_t points, uint32_t interval_ms)
+{
+    memset(chart,0,sizeof(*chart));
+    chart->sink.name = "pal_log_chart";
+    chart->sink.level = LOG_LEVEL_ALWAYS;
+    chart->sink.format = LOG_SINK_FMT_SHORT;
+    chart->sink.write = log_sink_chart_write;
+    chart->interval_ms = interval_ms ? interval_ms : 1;
+    chart->period_ms = CHART_PERIOD_MS;
+    chart->format = -1;
+
+    chart->lock = mutex_create();
+    if(!chart->lock)
+    {
+        LOG_ERROR("Unable to create the chart mutex");
+        return -1;
+    }
+
+    lv_obj_t * par = parent ? (lv_obj_t *)parent : lv_scr_act();
+    lv_obj_t * obj = lv_chart_create(par,NULL);
+    if(!obj)
+    {
+        LOG_ERROR("Unable to create the chart");
+        return -1;
+    }
+    lv_obj_set_size(obj,lv_obj_get_width(par),lv_obj_get_height(par));
+    lv_chart_set_type(obj,LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(obj,points ? points : 1);
+    lv_chart_set_range(obj,0,LOG_SINK_CHART_SCALE);
+    chart->chart = obj;
+    chart->redraw = lv_task_create(log_sink_chart_redraw,chart->period_ms,LV_TASK_PRIO_LOW,chart);
+    if(!chart->redraw)
+    {
+        LOG_ERROR("Unable to create the chart's redraw task");
+        return -1;
+    }
+    chart->sink.types = LOG_SINK_TYPE(LOG_SINK_DATA) | LOG_SINK_TYPE(LOG_SINK_OPEN) | LOG_SINK_TYPE(LOG_SINK_CLOSE);
+    return 0;
+}
+
+int log_sink_chart_plot(log_sink_chart_t * chart, const char * column, double lo, double hi, uint32_t color)
+{
+    if(!chart->chart || chart->nseries >= LOG_SINK_CHART_SERIES) return -1;
+    lv_chart_series_t * ser = lv_chart_add_series((lv_obj_t *)chart->chart,lv_color_hex(color));
+    if(!ser) return -1;
+    log_sink_chart_series_t * s = &chart->series[chart->nseries];
+    snprintf(s->column,sizeof(s->column),"%s",column);
+    s->lo = lo;
+    s->hi = hi;
+    s->series = ser;
+    s->chan = -1;
+    chart->nseries++;
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <errno.h>
+#include <stdint.h>
+#include "pal/log.h"
+#include "log_internal.h"
+
+/* The PROS clock */
+static uint64_t log_clock_real_now(log_clock_t * clock)
+{
+    (void)clock;
+    return micros();
+}
+
+log_clock_t log_clock_real = {log_clock_real_now};
+
+#ifdef LOG_CLOCK_PLUGGABLE
+/* Clock read by log_now_us(), swapped by log_clock() */
+log_clock_t * log_clock_cur = &log_clock_real;
+#endif
+
+/* Manual clock, which holds the time it was last set to */
+static uint64_t log_clock_manual_now(log_clock_t * clock)
+{
+    return ((log_clock_manual_t *)clock)->now_us;
+}
+
+void log_clock_manual_init(log_clock_manual_t * clk, uint64_t start_us)
+{
+    clk->clock.now_us = log_clock_manual_now;
+    clk->now_us = start_us;
+}
+
+void log_clock_manual_advance(log_clock_manual_t * clk, uint64_t us)
+{
+    clk->now_us += us;
+}
+
+/* Replay clock, which holds the recorded time it was last stepped to
+ * Before the first step it reads the first time, and past the last the last
+ */
+static uint64_t log_clock_replay_now(log_clock_t * clock)
+{
+    log_clock_replay_t * clk = (log_clock_replay_t *)clock;
+    if(!clk->count) return 0;
+    return clk->times_us[clk->row < clk->count ? clk->row : clk->count - 1];
+}
+
+void log_clock_replay_init(log_clock_replay_t * clk, const uint64_t * times_us, size_t count)
+{
+    clk->clock.now_us = log_clock_replay_now;
+    clk->times_us = times_us;
+    clk->count = count;
+    clk->row = 0;
+}
+
+int log_clock_replay_next(log_clock_replay_t * clk)
+{
+    if(clk->row + 1 >= clk->count) return 0;
+    clk->row++;
+    return 1;
+}
+
+/* Select the clock */
+int log_clock(log_clock_t * clock)
+{
+    if(!clock) clock = &log_clock_real;
+#ifdef LOG_CLOCK_PLUGGABLE
+    log_clock_cur = clock;
+    return 0;
+#else
+    if(clock == &log_clock_real) return 0;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+uint64_t log_clock_us()
+{
+    return log_now_us();
+}
@@ -0,0 +1,135 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "pal/log.h"
+#include "log_internal.h"
+
+/* Longest time a compressed channel may go without a point, so readers never
+ * have to look too far back and a lost tail stays short
+ */
+#define COMP_MAX_MS 5000
+
+/* Reset a compressor, so the next value is always kept */
+void log_comp_reset(log_comp_state_t * c, uint8_t mode, double tol)
+{
+    memset(c,0,sizeof(*c));
+    c->mode = mode;
+    c->tol = tol;
+}
+
+/* Keep a point, making it the new anchor */
+static int log_comp_keep(log_comp_state_t * c, uint32_t t, double v, log_comp_point_t * out)
+{
+    c->have = 1;
+    c->t0 = t;
+    c->v0 = v;
+    c->tp = t;
+    c->vp = v;
+    c->smin = INFINITY;
+    c->smax = -INFINITY;
+    out->time_ms = t;
+    out->value = v;
+    return 1;
+}
+
+/* Push a value through the compressor
+ * Returns the number of points to keep (0 to 2), which are written to out
+ */
+int log_comp_push(log_comp_state_t * c, uint32_t t, double v, log_comp_point_t * out)
+{
+    int n = 0;
+
+    /* The first value is always kept */
+    if(!c->have)
+    {
+        return log_comp_keep(c,t,v,out);
+    }
+
+    /* Non-finite values (i.e. the inf sensors report before calibrating) can't be
+     * interpolated, so close the current line and keep the value unless it repeats
+     */
+    if(!isfinite(v) || !isfinite(c->v0))
+    {
+        if(isfinite(c->v0) && c->tp != c->t0)
+        {
+            out[n].time_ms = c->tp;
+            out[n].value = c->vp;
+            n++;
+        }
+        if(memcmp(&v,&c->v0,sizeof(v)))
+        {
+            n += log_comp_keep(c,t,v,&out[n]);
+        }
+        else
+        {
+            c->tp = t;
+            c->vp = v;
+        }
+        return n;
+    }
+
+    /* Ignore repeated timestamps, there is nothing to interpolate */
+    if(t == c->t0)
+    {
+        return 0;
+    }
+
+    if(c->mode == LOG_COMP_DEADBAND)
+    {
+        /* Deadband keeps a value once it leaves the band around the last kept value,
+         * and is reconstructed by holding the last kept value
+         */
+        if(fabs(v - c->v0) > c->tol || (t - c->t0) > COMP_MAX_MS)
+        {
+            return log_comp_keep(c,t,v,out);
+        }
+        c->tp = t;
+        c->vp = v;
+        return 0;
+    }
+
+    /* Swinging door keeps the slopes of the two doors pivoting on the anchor.
+     * Once they open past parallel, no line from the anchor stays within the
+     * doors of every value since, so the previous value is kept as the new anchor.
+     * The doors are half the tolerance wide, since the line to the kept value only
+     * lies within the doors at its own end, and may be half the tolerance off
+     * them before that. Every dropped value is then within the tolerance
+     */
+    double half = c->tol / 2;
+    double dt = (double)(t - c->t0);
+    double lo = fmax(c->smax,(v - half - c->v0) / dt);
+    double hi = fmin(c->smin,(v + half - c->v0) / dt);
+    if((lo > hi || (t - c->t0) > COMP_MAX_MS) && c->tp != c->t0)
+    {
+        log_comp_keep(c,c->tp,c->vp,&out[n++]);
+        dt = (double)(t - c->t0);
+        lo = (v - half - c->v0) / dt;
+        hi = (v + half - c->v0) / dt;
+    }
+    c->smax = lo;
+    c->smin = hi;
+    c->tp = t;
+    c->vp = v;
+    return n;
+}
+
+/* Finish the compressor at the end of a file, returning the last value if it was not kept */
+int log_comp_finish(log_comp_state_t * c, log_comp_point_t * out)
+{
+    if(!c->have || c->tp == c->t0)
+    {
+        return 0;
+    }
+    out->time_ms = c->tp;
+    out->value = c->vp;
+    c->have = 0;
+    return 1;
+}
@@ -0,0 +1,162 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include <stdint.h>
+#include <string.h>
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+#include "log_internal.h"
+
+/* CRC-16/CCITT-FALSE, bit at a time since frames are short */
+uint16_t log_crc16(uint16_t crc, const void * data, size_t len)
+{
+    const uint8_t * p = (const uint8_t *)data;
+    while(len--)
+    {
+        crc ^= (uint16_t)(*p++) << 8;
+        for(int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ LOG_CRC_POLY) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* CRC-32 as zlib computes it, crc is 0 to start or the CRC of what came before */
+uint32_t log_crc32(uint32_t crc, const void * data, size_t len)
+{
+    const uint8_t * p = (const uint8_t *)data;
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ LOG_CRC32_POLY : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+/* COBS encoder, which is fed the frame in pieces
+ * code is where the length byte of the current block goes
+ */
+typedef struct
+{
+    uint8_t * out;
+    size_t len;
+    size_t code;
+} cobs_t;
+
+static void cobs_start(cobs_t * c, uint8_t * out)
+{
+    c->out = out;
+    c->code = 0;
+    c->len = 1;
+}
+
+static void cobs_put(cobs_t * c, const void * data, size_t len)
+{
+    const uint8_t * p = (const uint8_t *)data;
+    for(size_t i = 0; i < len; i++)
+    {
+        if(p[i])
+        {
+            c->out[c->len++] = p[i];
+        }
+        /* A zero, or a full block, closes the block */
+        if(!p[i] || c->len - c->code == 0xff)
+        {
+            c->out[c->code] = (uint8_t)(c->len - c->code);
+            c->code = c->len++;
+        }
+    }
+}
+
+static size_t cobs_end(cobs_t * c)
+{
+    c->out[c->code] = (uint8_t)(c->len - c->code);
+    c->out[c->len++] = 0;
+    return c->len;
+}
+
+/* Encode a record as a telemetry frame, see log_wire_t */
+size_t log_frame_encode(const log_sink_rec_t * rec, const void * payload, uint32_t seq, uint32_t dropped,
+                        uint8_t * out)
+{
+    log_wire_t wire;
+    wire.seq = seq;
+    wire.dropped = dropped;
+    wire.time_ms = rec->time_ms;
+    wire.type = rec->type;
+    wire.level = rec->level;
+    wire.line = rec->line;
+
+    /* Messages carry their file name ahead of the text, both NUL terminated */
+    static const uint8_t nul = 0;
+    int msg = rec->type == LOG_SINK_MSG;
+    const char * file = (msg && rec->file) ? rec->file : "";
+    size_t flen = strnlen(file,LOG_FRAME_FILE_MAX);
+
+    uint16_t crc = log_crc16(LOG_CRC_INIT,&wire,sizeof(wire));
+    cobs_t c;
+    cobs_start(&c,out);
+    cobs_put(&c,&wire,sizeof(wire));
+    if(msg)
+    {
+        crc = log_crc16(crc,file,flen);
+        crc = log_crc16(crc,&nul,1);
+        cobs_put(&c,file,flen);
+        cobs_put(&c,&nul,1);
+    }
+    crc = log_crc16(crc,payload,rec->len);
+    cobs_put(&c,payload,rec->len);
+    if(msg)
+    {
+        crc = log_crc16(crc,&nul,1);
+        cobs_put(&c,&nul,1);
+    }
+    cobs_put(&c,&crc,sizeof(crc));
+    return cobs_end(&c);
+}
+
+/* Encode a header and body as a frame, with the CRC of both */
+size_t log_frame_pack(const void * head, size_t hlen, const void * body, size_t blen, uint8_t * out)
+{
+    uint16_t crc = log_crc16(LOG_CRC_INIT,head,hlen);
+    crc = log_crc16(crc,body,blen);
+    cobs_t c;
+    cobs_start(&c,out);
+    cobs_put(&c,head,hlen);
+    cobs_put(&c,body,blen);
+    cobs_put(&c,&crc,sizeof(crc));
+    return cobs_end(&c);
+}
+
+/* Decode a frame in place, given without its zero terminator
+ * Returns the length of what it holds less the CRC, or 0 if it is damaged
+ */
+size_t log_frame_unpack(uint8_t * buf, size_t len)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while(in < len)
+    {
+        uint8_t code = buf[in++];
+        if(!code || in + code - 1 > len) return 0;
+        memmove(&buf[out],&buf[in],code - 1);
+        out += code - 1;
+        in += code - 1;
+        /* A block shorter than the longest ends at a zero, except the last */
+        if(code != 0xff && in < len) buf[out++] = 0;
+    }
+    if(out < 2) return 0;
+    uint16_t crc;
+    memcpy(&crc,&buf[out - 2],sizeof(crc));
+    return (crc == log_crc16(LOG_CRC_INIT,buf,out - 2)) ? out - 2 : 0;
+}
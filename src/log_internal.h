@@ -0,0 +1,137 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+#ifndef _LOG_INTERNAL_H_
+#define _LOG_INTERNAL_H_
+
+#include <stdint.h>
+#include "pros/rtos.h"
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+
+/* Functions shared between the logger modules, not exported to users */
+
+/* Time of the logger's clock, in microseconds and milliseconds
+ * Without LOG_CLOCK_PLUGGABLE these are the PROS calls themselves, so the real
+ * clock costs no more than before. LOG_CLOCK_IS_REAL() tells if device timestamps,
+ * which are in PROS time, can be compared with the clock
+ */
+#ifdef LOG_CLOCK_PLUGGABLE
+extern log_clock_t * log_clock_cur;
+static inline uint64_t log_now_us(void)
+{
+    return log_clock_cur->now_us(log_clock_cur);
+}
+static inline uint32_t log_now_ms(void)
+{
+    return (uint32_t)(log_now_us() / 1000);
+}
+#define LOG_CLOCK_IS_REAL() (log_clock_cur == &log_clock_real)
+#else
+static inline uint64_t log_now_us(void)
+{
+    return micros();
+}
+static inline uint32_t log_now_ms(void)
+{
+    return millis();
+}
+#define LOG_CLOCK_IS_REAL() 1
+#endif
+
+/* Shared record buffer the sinks read from, see log_sink.c
+ * log_sink_put() does nothing until log_sink_start() has run
+ */
+void log_sink_start();
+int log_sink_started();
+void log_sink_put(uint8_t type, uint8_t level, const char * file, int line, const void * payload, size_t len);
+
+/* Size of a record in a ring, header and payload padded to 4 bytes */
+#define LOG_RING_REC_SIZE(len) ((uint32_t)((sizeof(log_sink_rec_t) + (len) + 3) & ~3u))
+void log_ring_copy_in(uint8_t * buf, uint32_t size, uint32_t off, const void * src, size_t len);
+void log_ring_copy_out(const uint8_t * buf, uint32_t size, uint32_t off, void * dst, size_t len);
+
+/* Bytes of the data file, staged and put as one record per row by log_out_commit()
+ * log_out_ready() tells if a data file is open to take them
+ */
+int log_out_ready();
+void log_out_write(const void * data, size_t len);
+void log_out_printf(const char * format, ...);
+void log_out_commit();
+
+/* Telemetry frames, see log_wire_t in pal/log_format.h
+ * LOG_FRAME_MAX bounds an encoded frame, with the file name cut to LOG_FRAME_FILE_MAX
+ */
+#define LOG_FRAME_FILE_MAX 64
+#define LOG_FRAME_RAW_MAX (sizeof(log_wire_t) + LOG_FRAME_FILE_MAX + 1 + LOG_SINK_REC_MAX + 1 + 2)
+#define LOG_FRAME_MAX (LOG_FRAME_RAW_MAX + LOG_FRAME_RAW_MAX / 254 + 2)
+uint16_t log_crc16(uint16_t crc, const void * data, size_t len);
+size_t log_frame_encode(const log_sink_rec_t * rec, const void * payload, uint32_t seq, uint32_t dropped,
+                        uint8_t * out);
+
+/* Frames of a header and body, as the file server sends and takes them, and the
+ * CRC-32 it sums files with. A packed frame takes at most LOG_FRAME_PACK_MAX(len)
+ */
+#define LOG_FRAME_PACK_MAX(len) ((len) + 2 + ((len) + 2) / 254 + 2)
+size_t log_frame_pack(const void * head, size_t hlen, const void * body, size_t blen, uint8_t * out);
+size_t log_frame_unpack(uint8_t * buf, size_t len);
+uint32_t log_crc32(uint32_t crc, const void * data, size_t len);
+
+/* Write the most recent poller samples to the data file, called by log_step */
+void log_poll_emit();
+
+/* Time of the row log_step() is writing */
+uint32_t log_row_ms();
+
+/* How a value stores its sample time in the binary row */
+#define LOG_TS_NONE 0       /* No sample time */
+#define LOG_TS_OWN 1        /* Its own delta */
+#define LOG_TS_SHARED 2     /* The delta of the last LOG_TS_OWN value before it */
+
+/* Log a value sampled at the same instant as the last log_data_*_ts value
+ * Used by the poller so a device's fields share one delta
+ */
+void log_data_dbl_ts_shared(const char * pname, double data);
+
+/* Binary data file writer, used in place of CSV output when log_binary() is enabled */
+int log_bin_enabled();
+void log_bin_open(uint32_t time_ms, int boot);
+void log_bin_flush();
+void log_bin_step(uint32_t time_ms, int header);
+void log_bin_data(const char * pname, uint8_t type, int ival, double dval, int ts, uint64_t time_us);
+void log_bin_vec(const char * pname, uint8_t shape, const double * data, int count);
+void log_bin_var(const char * pname, const char * layout, const void * data, int count, int size);
+
+void log_bin_comp(const char * pname, double data, uint8_t mode, double tol);
+void log_bin_close();
+
+/* Lossy compressor state for one channel */
+typedef struct
+{
+    uint8_t mode;       /* log_comp_mode_t */
+    double tol;         /* Allowed absolute error */
+    int have;           /* An anchor has been kept */
+    uint32_t t0;        /* Anchor, the last kept point */
+    double v0;
+    uint32_t tp;        /* Previous value pushed */
+    double vp;
+    double smin;        /* Swinging door slopes */
+    double smax;
+} log_comp_state_t;
+
+/* A point kept by the compressor */
+typedef struct
+{
+    uint32_t time_ms;
+    double value;
+} log_comp_point_t;
+
+void log_comp_reset(log_comp_state_t * c, uint8_t mode, double tol);
+int log_comp_push(log_comp_state_t * c, uint32_t t, double v, log_comp_point_t * out);
+int log_comp_finish(log_comp_state_t * c, log_comp_point_t * out);
+
+#endif /* _LOG_INTERNAL_H_ */
@@ -0,0 +1,458 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "log_internal.h"
+
+/* Sizes of the poller tables, which are statically allocated */
+#define POLL_MAX_DEVICES 16
+#define POLL_MAX_SLOTS 128
+#define POLL_NAME_LEN 32
+#define POLL_FIELD_VALUES 4 /* Most values one field reads, the quaternion */
+
+/* Device types the poller knows how to read */
+typedef enum
+{
+    POLL_MOTOR,
+    POLL_IMU,
+    POLL_GPS
+} poll_type_t;
+
+/* One registered device */
+typedef struct
+{
+    poll_type_t type;
+    uint8_t port;
+    uint32_t fields;
+    int slot;   /* First slot used by this device */
+    int count;  /* Number of slots used by this device */
+} poll_dev_t;
+
+/* Device table */
+static poll_dev_t devs[POLL_MAX_DEVICES];
+static int ndevs = 0;
+
+/* Channel slots, holding the most recent sample and column name for each value,
+ * along with the instant each device was sampled
+ */
+static double slots[POLL_MAX_SLOTS];
+static uint64_t slot_ts[POLL_MAX_DEVICES];
+static char names[POLL_MAX_SLOTS][POLL_NAME_LEN];
+static int nslots = 0;
+static int sampled = 0;     /* The slots hold a poll cycle */
+
+/* The slots as log_step() last wrote them, which log_poll_value() returns */
+static double snap[POLL_MAX_SLOTS];
+static uint64_t snap_ts[POLL_MAX_DEVICES];
+static int snap_sampled = 0;
+
+/* Mutex protecting slots, and the poller task */
+static mutex_t slot_mtx = NULL;
+static task_t poll_task = NULL;
+static uint32_t poll_period = 10;
+
+/* Column suffixes for each field, in the order the values are read */
+typedef struct
+{
+    uint32_t field;
+    const char * suffix[POLL_FIELD_VALUES];
+} poll_field_t;
+
+static const poll_field_t motor_fields[] =
+{
+    {LOG_FIELD_VEL, {"vel"}},
+    {LOG_FIELD_CUR, {"cur"}},
+    {LOG_FIELD_TEMP, {"temp"}},
+    {LOG_FIELD_POS, {"pos"}},
+    {LOG_FIELD_VOLT, {"volt"}},
+    {LOG_FIELD_POWER, {"power"}},
+    {LOG_FIELD_TORQUE, {"torque"}},
+    {0, {NULL}}
+};
+
+static const poll_field_t imu_fields[] =
+{
+    {LOG_FIELD_STATUS, {"cal"}},
+    {LOG_FIELD_HDG, {"hdg"}},
+    {LOG_FIELD_ROT, {"rot"}},
+    {LOG_FIELD_EULER, {"euler_pitch","euler_yaw","euler_roll"}},
+    {LOG_FIELD_ACCEL, {"acc_x","acc_y","acc_z"}},
+    {LOG_FIELD_GYRO, {"gyro_x","gyro_y","gyro_z"}},
+    {LOG_FIELD_QUAT, {"quat_x","quat_y","quat_z","quat_w"}},
+    {0, {NULL}}
+};
+
+static const poll_field_t gps_fields[] =
+{
+    {LOG_FIELD_POSITION, {"x","y"}},
+    {LOG_FIELD_EULER, {"pitch","yaw","roll"}},
+    {LOG_FIELD_HDG, {"hdg"}},
+    {LOG_FIELD_ROT, {"rot"}},
+    {LOG_FIELD_ACCEL, {"acc_x","acc_y","acc_z"}},
+    {LOG_FIELD_ERROR, {"error"}},
+    {LOG_FIELD_GYRO, {"gyro_x","gyro_y","gyro_z"}},
+    {0, {NULL}}
+};
+
+/* Register a device, allocating a slot and column name for each value */
+static int log_poll_add(poll_type_t type, const char * name, uint8_t port, uint32_t fields)
+{
+    /* Pick the field table and default prefix for this device type */
+    const poll_field_t * table;
+    const char * prefix;
+    switch(type)
+    {
+    case POLL_MOTOR:
+        table = motor_fields;
+        prefix = "mtr";
+        break;
+    case POLL_IMU:
+        table = imu_fields;
+        prefix = "imu";
+        break;
+    default:
+        table = gps_fields;
+        prefix = "gps";
+        break;
+    }
+
+    /* Count the slots required before touching the tables */
+    int count = 0;
+    for(const poll_field_t * f = table; f->field; f++)
+    {
+        if(!(fields & f->field)) continue;
+        for(int i = 0; i < POLL_FIELD_VALUES && f->suffix[i]; i++) count++;
+    }
+
+    /* The poller task walks the tables without a lock, so they are frozen once it starts */
+    if(poll_task)
+    {
+        LOG_ERROR("Poller already started, unable to register port %d",port);
+        return -1;
+    }
+    if(ndevs >= POLL_MAX_DEVICES || (nslots + count) > POLL_MAX_SLOTS)
+    {
+        LOG_ERROR("Poller tables full, unable to register port %d",port);
+        return -1;
+    }
+
+    /* Generate the column names */
+    int slot = nslots;
+    for(const poll_field_t * f = table; f->field; f++)
+    {
+        if(!(fields & f->field)) continue;
+        for(int i = 0; i < POLL_FIELD_VALUES && f->suffix[i]; i++)
+        {
+            if(name)
+            {
+                snprintf(names[slot],POLL_NAME_LEN,"%s_%s",name,f->suffix[i]);
+            }
+            else
+            {
+                snprintf(names[slot],POLL_NAME_LEN,"%s%d_%s",prefix,port,f->suffix[i]);
+            }
+            slots[slot] = 0.0;
+            slot++;
+        }
+    }
+
+    /* Add the device itself */
+    devs[ndevs].type = type;
+    devs[ndevs].port = port;
+    devs[ndevs].fields = fields;
+    devs[ndevs].slot = nslots;
+    devs[ndevs].count = count;
+    ndevs++;
+    nslots += count;
+
+    LOG_INFO("Poller registered port %d with %d values",port,count);
+    return 0;
+}
+
+int log_poll_motor(const char * name, unsigned char port, unsigned int fields)
+{
+    return log_poll_add(POLL_MOTOR,name,port,fields);
+}
+
+int log_poll_imu(const char * name, unsigned char port, unsigned int fields)
+{
+    return log_poll_add(POLL_IMU,name,port,fields);
+}
+
+int log_poll_gps(const char * name, unsigned char port, unsigned int fields)
+{
+    return log_poll_add(POLL_GPS,name,port,fields);
+}
+
+/* Read all fields of a motor into buf, returning the number of values read
+ * The motor reports the time its encoder was sampled, which is used as the sample time
+ * when the logger runs on the PROS clock
+ */
+static int log_poll_read_motor(const poll_dev_t * dev, double * buf, uint64_t * ts)
+{
+    int n = 0;
+    uint8_t port = dev->port;
+    uint32_t fields = dev->fields;
+    if((fields & LOG_FIELD_TIME) && LOG_CLOCK_IS_REAL())
+    {
+        uint32_t ts_ms = 0;
+        if(motor_get_raw_position(port,&ts_ms) != PROS_ERR)
+        {
+            *ts = (uint64_t)ts_ms * 1000;
+        }
+    }
+    if(fields & LOG_FIELD_VEL) buf[n++] = motor_get_actual_velocity(port);
+    if(fields & LOG_FIELD_CUR) buf[n++] = motor_get_current_draw(port) / 1000.0;
+    if(fields & LOG_FIELD_TEMP) buf[n++] = motor_get_temperature(port);
+    if(fields & LOG_FIELD_POS) buf[n++] = motor_get_position(port);
+    if(fields & LOG_FIELD_VOLT) buf[n++] = motor_get_voltage(port) / 1000.0;
+    if(fields & LOG_FIELD_POWER) buf[n++] = motor_get_power(port);
+    if(fields & LOG_FIELD_TORQUE) buf[n++] = motor_get_torque(port);
+    return n;
+}
+
+/* Read all fields of an IMU into buf, returning the number of values read
+ * The IMU API has no device timestamp, so the caller's read time is used
+ */
+static int log_poll_read_imu(const poll_dev_t * dev, double * buf)
+{
+    int n = 0;
+    uint8_t port = dev->port;
+    uint32_t fields = dev->fields;
+    if(fields & LOG_FIELD_STATUS) buf[n++] = (imu_get_status(port) & E_IMU_STATUS_CALIBRATING) ? 1.0 : 0.0;
+    if(fields & LOG_FIELD_HDG) buf[n++] = imu_get_heading(port);
+    if(fields & LOG_FIELD_ROT) buf[n++] = imu_get_rotation(port);
+    if(fields & LOG_FIELD_EULER)
+    {
+        euler_s_t e = imu_get_euler(port);
+        buf[n++] = e.pitch;
+        buf[n++] = e.yaw;
+        buf[n++] = e.roll;
+    }
+    if(fields & LOG_FIELD_ACCEL)
+    {
+        imu_accel_s_t a = imu_get_accel(port);
+        buf[n++] = a.x;
+        buf[n++] = a.y;
+        buf[n++] = a.z;
+    }
+    if(fields & LOG_FIELD_GYRO)
+    {
+        imu_gyro_s_t g = imu_get_gyro_rate(port);
+        buf[n++] = g.x;
+        buf[n++] = g.y;
+        buf[n++] = g.z;
+    }
+    if(fields & LOG_FIELD_QUAT)
+    {
+        quaternion_s_t q = imu_get_quaternion(port);
+        buf[n++] = q.x;
+        buf[n++] = q.y;
+        buf[n++] = q.z;
+        buf[n++] = q.w;
+    }
+    return n;
+}
+
+/* Read all fields of a GPS into buf, returning the number of values read
+ * The GPS API has no device timestamp, so the caller's read time is used
+ */
+static int log_poll_read_gps(const poll_dev_t * dev, double * buf)
+{
+    int n = 0;
+    uint8_t port = dev->port;
+    uint32_t fields = dev->fields;
+
+    /* Position and attitude come from the same status read */
+    if(fields & (LOG_FIELD_POSITION | LOG_FIELD_EULER))
+    {
+        gps_status_s_t s = gps_get_status(port);
+        if(fields & LOG_FIELD_POSITION)
+        {
+            buf[n++] = s.x;
+            buf[n++] = s.y;
+        }
+        if(fields & LOG_FIELD_EULER)
+        {
+            buf[n++] = s.pitch;
+            buf[n++] = s.yaw;
+            buf[n++] = s.roll;
+        }
+    }
+    if(fields & LOG_FIELD_HDG) buf[n++] = gps_get_heading(port);
+    if(fields & LOG_FIELD_ROT) buf[n++] = gps_get_rotation(port);
+    if(fields & LOG_FIELD_ACCEL)
+    {
+        gps_accel_s_t a = gps_get_accel(port);
+        buf[n++] = a.x;
+        buf[n++] = a.y;
+        buf[n++] = a.z;
+    }
+    if(fields & LOG_FIELD_ERROR) buf[n++] = gps_get_error(port);
+    if(fields & LOG_FIELD_GYRO)
+    {
+        gps_gyro_s_t g = gps_get_gyro_rate(port);
+        buf[n++] = g.x;
+        buf[n++] = g.y;
+        buf[n++] = g.z;
+    }
+    return n;
+}
+
+/* Poller task, reads every device into a local batch and commits it to the slots at once */
+static void log_poll_task(void * param)
+{
+    (void)param;
+    static double batch[POLL_MAX_SLOTS];
+    static uint64_t batch_ts[POLL_MAX_DEVICES];
+    /* The period is kept on the logger's clock, so the samples are as far apart on
+     * it as asked. A clock which stands still, or jumps, still gets one cycle per
+     * period of RTOS time at most, rather than a busy loop. A cycle which overruns
+     * still sleeps 1 ms, so the tasks below the poller aren't starved
+     */
+    uint32_t next_time = log_now_ms();
+    while(1)
+    {
+        /* Read all devices without holding the mutex, since device reads are slow */
+        for(int i = 0; i < ndevs; i++)
+        {
+            poll_dev_t * dev = &devs[i];
+            batch_ts[i] = log_now_us();
+            switch(dev->type)
+            {
+            case POLL_MOTOR:
+                log_poll_read_motor(dev,&batch[dev->slot],&batch_ts[i]);
+                break;
+            case POLL_IMU:
+                log_poll_read_imu(dev,&batch[dev->slot]);
+                break;
+            default:
+                log_poll_read_gps(dev,&batch[dev->slot]);
+                break;
+            }
+        }
+
+        /* Commit the batch so a row never mixes samples from two poll cycles */
+        if(mutex_take(slot_mtx,TIMEOUT_MAX))
+        {
+            memcpy(slots,batch,nslots * sizeof(double));
+            memcpy(slot_ts,batch_ts,ndevs * sizeof(uint64_t));
+            sampled = 1;
+            mutex_give(slot_mtx);
+        }
+
+        uint32_t now = log_now_ms();
+        if(LOG_CLOCK_IS_REAL())
+        {
+            /* Fell behind, so skip the cycles missed */
+            if((int32_t)(next_time + poll_period - now) < 1) next_time = now + 1 - poll_period;
+            task_delay_until(&next_time,poll_period);
+            continue;
+        }
+        next_time += poll_period;
+        int32_t wait = (int32_t)(next_time - now);
+        if(wait < 1)
+        {
+            /* Fell behind, i.e. a clock which jumped ahead, so start over from now */
+            next_time = now + 1;
+            wait = 1;
+        }
+        task_delay(wait < (int32_t)poll_period ? (uint32_t)wait : poll_period);
+    }
+}
+
+/* Start the poller task */
+void log_poll_start(unsigned int period_ms)
+{
+    poll_period = period_ms ? period_ms : 1;
+
+    /* Only create the task once, later calls just change the period */
+    if(poll_task) return;
+
+    slot_mtx = mutex_create();
+    if(!slot_mtx)
+    {
+        LOG_ERROR("Unable to create poller mutex");
+        return;
+    }
+    poll_task = task_create(log_poll_task,NULL,TASK_PRIORITY_DEFAULT-1,TASK_STACK_DEPTH_DEFAULT,"pal_log_poll");
+    if(!poll_task)
+    {
+        LOG_ERROR("Unable to create poller task");
+        return;
+    }
+    LOG_INFO("Poller started with %d devices every %d ms",ndevs,poll_period);
+}
+
+/* Write the most recent samples to the data file, called by log_step after the TIME column */
+void log_poll_emit()
+{
+    /* Copy the slots out so the mutex is not held during file writes */
+    if(!nslots) return;
+    if(slot_mtx && mutex_take(slot_mtx,TIMEOUT_MAX))
+    {
+        memcpy(snap,slots,nslots * sizeof(double));
+        memcpy(snap_ts,slot_ts,ndevs * sizeof(uint64_t));
+        snap_sampled = sampled;
+        mutex_give(slot_mtx);
+    }
+
+    /* Until the first poll, or if the poller was never started, the slots hold no
+     * samples, so the values are NAN at the row time
+     */
+    if(!snap_sampled)
+    {
+        for(int j = 0; j < nslots; j++) snap[j] = NAN;
+        for(int i = 0; i < ndevs; i++) snap_ts[i] = (uint64_t)log_row_ms() * 1000;
+    }
+
+    for(int i = 0; i < ndevs; i++)
+    {
+        const poll_dev_t * dev = &devs[i];
+        for(int j = dev->slot; j < dev->slot + dev->count; j++)
+        {
+            /* The device's fields were read together, so share the first one's delta */
+            if((dev->fields & LOG_FIELD_TIME) && j == dev->slot)
+            {
+                log_data_dbl_ts(names[j],snap[j],snap_ts[i]);
+            }
+            else if(dev->fields & LOG_FIELD_TIME)
+            {
+                log_data_dbl_ts_shared(names[j],snap[j]);
+            }
+            else
+            {
+                log_data_dbl(names[j],snap[j]);
+            }
+        }
+    }
+}
+
+/* Find a column by name, for log_poll_value() */
+int log_poll_find(const char * name)
+{
+    for(int i = 0; i < nslots; i++)
+    {
+        if(!strcmp(names[i],name)) return i;
+    }
+    return -1;
+}
+
+/* Value of a column as the last log_step() wrote it */
+double log_poll_value(int col)
+{
+    if(col < 0 || col >= nslots || !snap_sampled) return NAN;
+    return snap[col];
+}
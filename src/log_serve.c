@@ -0,0 +1,309 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+#include "log_internal.h"
+
+/* How long the server sleeps when it has nothing to send */
+#define SERVE_IDLE_MS 10
+
+/* Longest request, and longest answer, once framed */
+#define SERVE_REQ_MAX LOG_FRAME_PACK_MAX(sizeof(log_serve_msg_t) + LOG_SERVE_NAME_MAX)
+#define SERVE_ANS_MAX LOG_FRAME_PACK_MAX(sizeof(log_serve_msg_t) + LOG_SERVE_CHUNK)
+
+/* Names of the logger's files, by index */
+static const char * const serve_names[] = {"log%05d.txt","dat%05d.csv","dat%05d.bin"};
+
+/* Serial stream the answers go to */
+static FILE * out = NULL;
+
+/* Request being read from stdin, skipped to its end if it is too long */
+static uint8_t req[SERVE_REQ_MAX];
+static size_t req_len = 0;
+static int req_skip = 0;
+
+/* File being sent */
+static struct
+{
+    FILE * f;
+    uint32_t id;
+    uint32_t size;
+    uint32_t acked;         /* The host has everything before this */
+    uint32_t sent;          /* Offset of the next chunk to send */
+    uint32_t pos;           /* Offset f is at */
+    uint32_t window;        /* Chunks it sends past acked */
+    int ended;              /* END sent since the last request */
+} xfer;
+
+static uint8_t chunk[LOG_SERVE_CHUNK];
+static uint8_t ans[SERVE_ANS_MAX];
+
+/* Send an answer, body being its payload */
+static void serve_answer(uint8_t op, uint8_t flags, uint32_t id, uint32_t offset, uint32_t arg,
+                         const void * body, size_t len)
+{
+    log_serve_msg_t msg;
+    memset(&msg,0,sizeof(msg));
+    msg.op = op;
+    msg.flags = flags;
+    msg.id = id;
+    msg.offset = offset;
+    msg.arg = arg;
+    size_t n = log_frame_pack(&msg,sizeof(msg),body,len,ans);
+    fwrite(ans,1,n,out);
+    fflush(out);
+}
+
+static void serve_error(uint32_t id, const char * why)
+{
+    LOG_WARN("File server: %s",why);
+    serve_answer(LOG_SERVE_ERROR,0,id,0,0,why,strlen(why));
+}
+
+/* Open a file the host names, which must be on the card and not in a directory
+ * Gives its size, and leaves it at the start
+ */
+static FILE * serve_open(const char * name, size_t len, uint32_t * size)
+{
+    char path[8 + LOG_SERVE_NAME_MAX];
+    if(!len || len > LOG_SERVE_NAME_MAX || memchr(name,'/',len) || memchr(name,0,len)) return NULL;
+    memcpy(path,"/usd/",5);
+    memcpy(&path[5],name,len);
+    path[5 + len] = 0;
+
+    FILE * f = fopen(path,"r");
+    if(!f) return NULL;
+    long end = -1;
+    if(!fseek(f,0,SEEK_END)) end = ftell(f);
+    if(end < 0 || fseek(f,0,SEEK_SET))
+    {
+        fclose(f);
+        return NULL;
+    }
+    *size = end;
+    return f;
+}
+
+static void serve_close()
+{
+    if(xfer.f) fclose(xfer.f);
+    memset(&xfer,0,sizeof(xfer));
+}
+
+/* List the logger's files from the first index to the latest */
+static void serve_list(uint32_t id)
+{
+    int last = log_id();
+    if(last < 0)
+    {
+        FILE * fidx = fopen("/usd/index.txt","r");
+        if(fidx)
+        {
+            if(fscanf(fidx,"%d",&last) != 1) last = -1;
+            fclose(fidx);
+        }
+    }
+
+    uint32_t count = 0;
+    for(int i = 0; i <= last; i++)
+    {
+        for(size_t k = 0; k < sizeof(serve_names) / sizeof(serve_names[0]); k++)
+        {
+            char name[LOG_SERVE_NAME_MAX + 1];
+            uint32_t size;
+            snprintf(name,sizeof(name),serve_names[k],i);
+            FILE * f = serve_open(name,strlen(name),&size);
+            if(!f) continue;
+            fclose(f);
+            serve_answer(LOG_SERVE_LIST,(i == log_id()) ? LOG_SERVE_OPEN : 0,id,0,size,name,strlen(name));
+            count++;
+        }
+    }
+    serve_answer(LOG_SERVE_LIST,0,id,0,count,NULL,0);
+}
+
+/* Start sending a file from the offset asked for */
+static void serve_read(const log_serve_msg_t * msg, const char * name, size_t len)
+{
+    serve_close();
+    uint32_t size;
+    FILE * f = serve_open(name,len,&size);
+    if(!f)
+    {
+        serve_error(msg->id,"Unable to open the file");
+        return;
+    }
+    if(msg->offset > size)
+    {
+        fclose(f);
+        serve_error(msg->id,"Offset past the end of the file");
+        return;
+    }
+    xfer.f = f;
+    xfer.id = msg->id;
+    xfer.size = size;
+    xfer.acked = msg->offset;
+    xfer.sent = msg->offset;
+    xfer.window = msg->arg;
+    if(xfer.window < 1) xfer.window = 1;
+    if(xfer.window > LOG_SERVE_WINDOW_MAX) xfer.window = LOG_SERVE_WINDOW_MAX;
+}
+
+/* Sum the start of a file, so the host can check what it already has */
+static void serve_sum(const log_serve_msg_t * msg, const char * name, size_t len)
+{
+    uint32_t size;
+    FILE * f = serve_open(name,len,&size);
+    if(!f)
+    {
+        serve_error(msg->id,"Unable to open the file");
+        return;
+    }
+    uint32_t want = (msg->offset < size) ? msg->offset : size;
+    uint32_t done = 0;
+    uint32_t crc = 0;
+    while(done < want)
+    {
+        size_t n = want - done;
+        if(n > sizeof(chunk)) n = sizeof(chunk);
+        n = fread(chunk,1,n,f);
+        if(!n) break;
+        crc = log_crc32(crc,chunk,n);
+        done += n;
+    }
+    fclose(f);
+    serve_answer(LOG_SERVE_SUM,0,msg->id,done,crc,NULL,0);
+}
+
+/* Handle a request received whole, len bytes of req in COBS form */
+static void serve_request(size_t len)
+{
+    size_t n = log_frame_unpack(req,len);
+    if(n < sizeof(log_serve_msg_t)) return;
+    log_serve_msg_t msg;
+    memcpy(&msg,req,sizeof(msg));
+    const char * name = (const char *)&req[sizeof(msg)];
+    size_t nlen = n - sizeof(msg);
+
+    switch(msg.op)
+    {
+    case LOG_SERVE_LIST:
+        serve_list(msg.id);
+        break;
+    case LOG_SERVE_READ:
+        serve_read(&msg,name,nlen);
+        break;
+    case LOG_SERVE_ACK:
+        if(!xfer.f || msg.id != xfer.id) break;
+        if(msg.offset > xfer.acked && msg.offset <= xfer.sent) xfer.acked = msg.offset;
+        /* All of it has arrived */
+        if(xfer.acked == xfer.size && xfer.ended) serve_close();
+        break;
+    case LOG_SERVE_SUM:
+        serve_sum(&msg,name,nlen);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Take what the host has written to stdin, without waiting for more */
+static void serve_input()
+{
+    uint8_t buf[64];
+    int32_t avail;
+    while((avail = fdctl(STDIN_FILENO,DEVCTL_FIONREAD,NULL)) > 0)
+    {
+        ssize_t n = read(STDIN_FILENO,buf,(avail < (int32_t)sizeof(buf)) ? (size_t)avail : sizeof(buf));
+        if(n <= 0) return;
+        for(ssize_t i = 0; i < n; i++)
+        {
+            if(buf[i])
+            {
+                if(req_len < sizeof(req)) req[req_len++] = buf[i];
+                else req_skip = 1;
+                continue;
+            }
+            if(req_len && !req_skip) serve_request(req_len);
+            req_len = 0;
+            req_skip = 0;
+        }
+    }
+}
+
+/* Send the next chunk of the file if the window allows, or the end of it
+ * Returns 1 if it sent something
+ */
+static int serve_next()
+{
+    if(!xfer.f) return 0;
+    if(xfer.sent < xfer.size && xfer.sent - xfer.acked < xfer.window * LOG_SERVE_CHUNK)
+    {
+        uint32_t n = xfer.size - xfer.sent;
+        if(n > LOG_SERVE_CHUNK) n = LOG_SERVE_CHUNK;
+        if(xfer.pos != xfer.sent && fseek(xfer.f,xfer.sent,SEEK_SET))
+        {
+            serve_error(xfer.id,"Unable to seek in the file");
+            serve_close();
+            return 0;
+        }
+        if(fread(chunk,1,n,xfer.f) != n)
+        {
+            serve_error(xfer.id,"Unable to read the file");
+            serve_close();
+            return 0;
+        }
+        xfer.pos = xfer.sent + n;
+        serve_answer(LOG_SERVE_DATA,0,xfer.id,xfer.sent,0,chunk,n);
+        xfer.sent += n;
+        return 1;
+    }
+    if(xfer.sent == xfer.size && !xfer.ended)
+    {
+        serve_answer(LOG_SERVE_END,0,xfer.id,xfer.size,0,NULL,0);
+        xfer.ended = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Server task, which only sleeps once the window is full or there is nothing to send */
+static void log_serve_task(void * param)
+{
+    (void)param;
+    while(1)
+    {
+        serve_input();
+        if(!serve_next()) task_delay(SERVE_IDLE_MS);
+    }
+}
+
+/* Start the file server */
+int log_serve_start()
+{
+    static task_t task = NULL;
+    if(task) return 0;
+    out = log_serial_open(LOG_SERVE_STREAM);
+    if(!out) return -1;
+    task = task_create(log_serve_task,NULL,TASK_PRIORITY_MIN,TASK_STACK_DEPTH_DEFAULT,"pal_log_serve");
+    if(!task)
+    {
+        LOG_ERROR("Unable to start the file server");
+        return -1;
+    }
+    return 0;
+}
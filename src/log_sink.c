@@ -0,0 +1,284 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "log_internal.h"
+
+/* Most sinks which can be added */
+#define SINK_MAX 8
+
+/* Shared record buffer, which all sinks read from
+ * Records are a log_sink_rec_t followed by the payload, padded to 4 bytes.
+ * head and tail count the bytes written since power on, so they wrap at 2^32,
+ * which is why the buffer size must be a power of two
+ */
+static union
+{
+    uint32_t align;
+    uint8_t buf[LOG_SINK_BUF_SIZE];
+} ring;
+static uint32_t head = 0;   /* Offset of the next record to write */
+static uint32_t tail = 0;   /* Offset of the oldest record still held */
+static uint32_t seq = 0;    /* Number of the next record */
+static mutex_t ring_mtx = NULL;
+
+/* Sinks, which only start reading once log_init() has run */
+static log_sink_t * sinks[SINK_MAX];
+static int nsinks = 0;
+static int started = 0;
+
+/* Data file bytes of the current row, put as one record */
+static union
+{
+    uint32_t align;
+    uint8_t buf[LOG_SINK_REC_MAX];
+} out;
+static size_t out_len = 0;
+
+/* Copy into and out of a ring of size bytes, a power of two, at offset off */
+void log_ring_copy_in(uint8_t * buf, uint32_t size, uint32_t off, const void * src, size_t len)
+{
+    uint32_t at = off & (size - 1);
+    size_t first = size - at;
+    if(first > len) first = len;
+    memcpy(&buf[at],src,first);
+    memcpy(buf,(const uint8_t *)src + first,len - first);
+}
+
+void log_ring_copy_out(const uint8_t * buf, uint32_t size, uint32_t off, void * dst, size_t len)
+{
+    uint32_t at = off & (size - 1);
+    size_t first = size - at;
+    if(first > len) first = len;
+    memcpy(dst,&buf[at],first);
+    memcpy((uint8_t *)dst + first,buf,len - first);
+}
+
+/* Whether a sink takes a record of this type and level */
+static int log_sink_takes(const log_sink_t * sink, uint8_t type, uint8_t level)
+{
+    if(!(sink->types & LOG_SINK_TYPE(type))) return 0;
+    if(type == LOG_SINK_MSG && level < sink->level) return 0;
+    return 1;
+}
+
+/* Put a record in the shared buffer, overwriting the oldest records to make room
+ * whether or not every sink has read them, then wake the sinks which take it
+ * An overwritten record counts as dropped only by the sinks which take it and
+ * had yet to read it
+ */
+void log_sink_put(uint8_t type, uint8_t level, const char * file, int line, const void * payload, size_t len)
+{
+    if(!started) return;
+    if(len > LOG_SINK_REC_MAX) len = LOG_SINK_REC_MAX;
+
+    log_sink_rec_t rec;
+    rec.file = file;
+    rec.line = line;
+    rec.type = type;
+    rec.level = level;
+    rec.len = len;
+    uint32_t need = LOG_RING_REC_SIZE(len);
+
+    mutex_take(ring_mtx,TIMEOUT_MAX);
+    while((head - tail) + need > LOG_SINK_BUF_SIZE)
+    {
+        log_sink_rec_t old;
+        log_ring_copy_out(ring.buf,LOG_SINK_BUF_SIZE,tail,&old,sizeof(old));
+        for(int i = 0; i < nsinks; i++)
+        {
+            log_sink_t * s = sinks[i];
+            if((int32_t)(s->cursor - tail) <= 0 && log_sink_takes(s,old.type,old.level)) s->dropped++;
+        }
+        tail += LOG_RING_REC_SIZE(old.len);
+    }
+    /* Stamped under the mutex, so time never goes backwards from one record to the next */
+    rec.time_ms = log_now_ms();
+    rec.seq = seq++;
+    log_ring_copy_in(ring.buf,LOG_SINK_BUF_SIZE,head,&rec,sizeof(rec));
+    log_ring_copy_in(ring.buf,LOG_SINK_BUF_SIZE,head + sizeof(rec),payload,len);
+    head += need;
+    mutex_give(ring_mtx);
+
+    for(int i = 0; i < nsinks; i++)
+    {
+        if(log_sink_takes(sinks[i],type,level)) task_notify(sinks[i]->task);
+    }
+}
+
+/* Sink task, reads the shared buffer from its own cursor
+ * Records the sink doesn't take are stepped over by their header. A record it
+ * takes is copied out under the mutex and handled after, so however long the
+ * sink takes, producers only wait for the copy
+ */
+static void log_sink_task(void * param)
+{
+    log_sink_t * sink = (log_sink_t *)param;
+    union
+    {
+        uint32_t align;
+        uint8_t buf[LOG_SINK_REC_MAX + 1];
+    } payload;
+    uint8_t * buf = payload.buf;
+
+    while(1)
+    {
+        log_sink_rec_t rec;
+        int have = 0;
+        mutex_take(ring_mtx,TIMEOUT_MAX);
+        /* Skip what was overwritten before we got to it, already counted as dropped */
+        if((int32_t)(sink->cursor - tail) < 0) sink->cursor = tail;
+        while(sink->cursor != head)
+        {
+            log_ring_copy_out(ring.buf,LOG_SINK_BUF_SIZE,sink->cursor,&rec,sizeof(rec));
+            if(log_sink_takes(sink,rec.type,rec.level))
+            {
+                log_ring_copy_out(ring.buf,LOG_SINK_BUF_SIZE,sink->cursor + sizeof(rec),buf,rec.len);
+                have = 1;
+            }
+            sink->cursor += LOG_RING_REC_SIZE(rec.len);
+            if(have) break;
+        }
+        mutex_give(ring_mtx);
+
+        /* Sleep until a producer has something for this sink, or until its idle
+         * hook wants calling again
+         */
+        if(!have)
+        {
+            uint32_t wait = sink->idle ? sink->idle(sink) : 0;
+            task_notify_take(true,wait ? wait : TIMEOUT_MAX);
+            continue;
+        }
+        buf[rec.len] = 0;
+        sink->write(sink,&rec,buf);
+    }
+}
+
+/* Start reading from the newest record, called with the mutex held */
+static void log_sink_run(log_sink_t * sink)
+{
+    sink->cursor = head;
+    sink->task = task_create(log_sink_task,sink,TASK_PRIORITY_DEFAULT-1,TASK_STACK_DEPTH_DEFAULT,sink->name);
+}
+
+/* Add a sink */
+int log_sink_add(log_sink_t * sink)
+{
+    if(!sink->types) return 0;
+    for(int i = 0; i < nsinks; i++)
+    {
+        if(sinks[i] == sink) return 0;
+    }
+    if(nsinks >= SINK_MAX)
+    {
+        LOG_ERROR("Too many sinks, unable to add %s",sink->name);
+        return -1;
+    }
+
+    sink->dropped = 0;
+    sink->task = NULL;
+    if(started)
+    {
+        mutex_take(ring_mtx,TIMEOUT_MAX);
+        log_sink_run(sink);
+        sinks[nsinks++] = sink;
+        mutex_give(ring_mtx);
+    }
+    else
+    {
+        sinks[nsinks++] = sink;
+    }
+    return 0;
+}
+
+/* Start the sinks added so far, called by log_init() */
+void log_sink_start()
+{
+    if(started) return;
+    ring_mtx = mutex_create();
+    if(!ring_mtx)
+    {
+        printf("Unable to create the log sink mutex\n");
+        return;
+    }
+    for(int i = 0; i < nsinks; i++)
+    {
+        log_sink_run(sinks[i]);
+    }
+    started = 1;
+}
+
+int log_sink_started()
+{
+    return started;
+}
+
+/* Format the text of a message */
+int log_sink_format(const log_sink_t * sink, const log_sink_rec_t * rec, const void * payload,
+                    char * buf, size_t size)
+{
+    double time = rec->time_ms / 1000.0;
+    if(sink->format == LOG_SINK_FMT_SHORT)
+    {
+        return snprintf(buf,size,"%08.3f [%s] %s",time,log_level_name(rec->level),(const char *)payload);
+    }
+    return snprintf(buf,size,"%08.3f [%s] in %s line %d: %s",time,log_level_name(rec->level),
+                    rec->file ? rec->file : "",rec->line,(const char *)payload);
+}
+
+/* Data file bytes, staged until the row is complete */
+void log_out_write(const void * data, size_t len)
+{
+    const uint8_t * p = (const uint8_t *)data;
+    while(len)
+    {
+        if(out_len == sizeof(out.buf)) log_out_commit();
+        size_t n = sizeof(out.buf) - out_len;
+        if(n > len) n = len;
+        memcpy(&out.buf[out_len],p,n);
+        out_len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void log_out_printf(const char * format, ...)
+{
+    va_list args;
+    for(int tries = 0; tries < 2; tries++)
+    {
+        size_t room = sizeof(out.buf) - out_len;
+        va_start(args,format);
+        int n = vsnprintf((char *)&out.buf[out_len],room,format,args);
+        va_end(args);
+        if(n < 0) return;
+        /* Fits, or can't fit even in an empty buffer and is cut short */
+        if((size_t)n < room || !out_len)
+        {
+            out_len += ((size_t)n < room) ? (size_t)n : room - 1;
+            return;
+        }
+        log_out_commit();
+    }
+}
+
+void log_out_commit()
+{
+    if(!out_len) return;
+    log_sink_put(LOG_SINK_DATA,0,NULL,0,out.buf,out_len);
+    out_len = 0;
+}
@@ -0,0 +1,390 @@
+/* Data Logger library for PROS V5
+ * Copyright (c) 2022 Andrew Palardy
+ * This code is subject to the BSD 2-clause 'Simplified' license
+ * See the LICENSE file for complete terms
+ */
+
+/* Required headers */
+#include "pros/apix.h"
+#include "pros/serial.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Need to define log level for this file lol */
+#define LOG_LEVEL_FILE LOG_LEVEL_WARN
+#include "pal/log.h"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+#include "log_internal.h"
+
+/* Longest line of message text a sink formats */
+#define SINK_LINE_MAX 320
+
+/**
+ *  uSD card files
+ **/
+
+/* A file sink's file, opened on LOG_SINK_OPEN and closed on LOG_SINK_CLOSE */
+typedef struct
+{
+    FILE * f;
+    char name[32];
+} sink_file_t;
+
+/* Handle the file records for the text file, or the data file if data is set,
+ * returning 1 if the record was one of them
+ */
+static int sink_file_control(sink_file_t * file, const log_sink_rec_t * rec, const void * payload, int data)
+{
+    const char * what = data ? "data" : "log";
+    switch(rec->type)
+    {
+    case LOG_SINK_OPEN:
+    {
+        log_sink_open_t open;
+        memcpy(&open,payload,sizeof(open));
+        if(file->f) fclose(file->f);
+        if(data)
+        {
+            sprintf(file->name,open.binary ? "/usd/dat%05d.bin" : "/usd/dat%05d.csv",(int)open.index);
+        }
+        else
+        {
+            sprintf(file->name,"/usd/log%05d.txt",(int)open.index);
+        }
+        file->f = fopen(file->name,"w");
+        if(!file->f) LOG_ERROR("Error opening %s file (%s)",what,file->name);
+        return 1;
+    }
+    case LOG_SINK_FLUSH:
+        /* Close the file and reopen it, which commits it to the card */
+        if(file->f)
+        {
+            fclose(file->f);
+            file->f = fopen(file->name,"a");
+            if(!file->f) LOG_ERROR("Error reopening %s file (%s)",what,file->name);
+        }
+        return 1;
+    case LOG_SINK_CLOSE:
+        if(file->f) fclose(file->f);
+        file->f = NULL;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Text file, with a message per line */
+static sink_file_t usd_text;
+
+static void log_sink_usd_text_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    if(sink_file_control(&usd_text,rec,payload,0)) return;
+    if(!usd_text.f) return;
+    char line[SINK_LINE_MAX];
+    log_sink_format(sink,rec,payload,line,sizeof(line));
+    fprintf(usd_text.f,"\n%s",line);
+}
+
+log_sink_t log_sink_usd_text =
+{
+    .name = "pal_log_text",
+    .types = LOG_SINK_TYPE(LOG_SINK_MSG) | LOG_SINK_FILES,
+    .level = LOG_LEVEL_DEBUG,
+    .format = LOG_SINK_FMT_FULL,
+    .write = log_sink_usd_text_write
+};
+
+/* Data file, which takes the bytes log_step() and log_data_* produce as they are */
+static sink_file_t usd_data;
+
+static void log_sink_usd_data_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    (void)sink;
+    if(sink_file_control(&usd_data,rec,payload,1)) return;
+    if(usd_data.f) fwrite(payload,1,rec->len,usd_data.f);
+}
+
+log_sink_t log_sink_usd_data =
+{
+    .name = "pal_log_data",
+    .types = LOG_SINK_TYPE(LOG_SINK_DATA) | LOG_SINK_FILES,
+    .level = LOG_LEVEL_DEBUG,
+    .format = LOG_SINK_FMT_FULL,
+    .write = log_sink_usd_data_write
+};
+
+/**
+ *  Console
+ **/
+
+static void log_sink_console_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    char line[SINK_LINE_MAX];
+    log_sink_format(sink,rec,payload,line,sizeof(line));
+    printf("%s\n",line);
+}
+
+log_sink_t log_sink_console =
+{
+    .name = "pal_log_console",
+    .types = LOG_SINK_TYPE(LOG_SINK_MSG),
+    .level = LOG_LEVEL_DEBUG,
+    .format = LOG_SINK_FMT_FULL,
+    .write = log_sink_console_write
+};
+
+/**
+ *  RAM ring
+ **/
+
+/* Keep the record, overwriting the oldest to make room */
+static void log_sink_ram_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    log_sink_ram_t * ram = (log_sink_ram_t *)sink;
+    uint32_t need = LOG_RING_REC_SIZE(rec->len);
+    if(need > ram->size) return;
+
+    mutex_take(ram->mtx,TIMEOUT_MAX);
+    while((ram->head - ram->tail) + need > ram->size)
+    {
+        log_sink_rec_t old;
+        log_ring_copy_out(ram->buf,ram->size,ram->tail,&old,sizeof(old));
+        ram->tail += LOG_RING_REC_SIZE(old.len);
+    }
+    log_ring_copy_in(ram->buf,ram->size,ram->head,rec,sizeof(*rec));
+    log_ring_copy_in(ram->buf,ram->size,ram->head + sizeof(*rec),payload,rec->len);
+    ram->head += need;
+    mutex_give(ram->mtx);
+}
+
+void log_sink_ram_init(log_sink_ram_t * ram, void * buf, size_t size, uint32_t types, log_level_t level)
+{
+    memset(ram,0,sizeof(*ram));
+    ram->sink.name = "pal_log_ram";
+    ram->sink.types = types;
+    ram->sink.level = level;
+    ram->sink.format = LOG_SINK_FMT_FULL;
+    ram->sink.write = log_sink_ram_write;
+
+    /* Offsets wrap with the ring only if its size is a power of two */
+    uint32_t p = 1;
+    while(p <= size / 2 && p < 0x80000000u) p <<= 1;
+    ram->buf = (uint8_t *)buf;
+    ram->size = (size >= sizeof(log_sink_rec_t)) ? p : 0;
+    ram->mtx = mutex_create();
+}
+
+int log_sink_ram_read(log_sink_ram_t * ram, uint32_t * cursor, log_sink_rec_t * rec, void * payload, size_t max)
+{
+    int have = 0;
+    mutex_take(ram->mtx,TIMEOUT_MAX);
+    /* Start from the oldest record if the cursor's was overwritten */
+    if((int32_t)(*cursor - ram->tail) < 0 || (int32_t)(ram->head - *cursor) < 0) *cursor = ram->tail;
+    if(*cursor != ram->head)
+    {
+        log_ring_copy_out(ram->buf,ram->size,*cursor,rec,sizeof(*rec));
+        log_ring_copy_out(ram->buf,ram->size,*cursor + sizeof(*rec),payload,rec->len < max ? rec->len : max);
+        *cursor += LOG_RING_REC_SIZE(rec->len);
+        have = 1;
+    }
+    mutex_give(ram->mtx);
+    return have;
+}
+
+/**
+ *  Telemetry stream
+ **/
+
+/* Send the record as one frame, flushed so it goes out as one write
+ * Frames are numbered by the stream rather than by record, since the records the
+ * sink doesn't take would look like gaps
+ */
+static void log_sink_stream_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    log_sink_stream_t * stream = (log_sink_stream_t *)sink;
+    uint8_t frame[LOG_FRAME_MAX];
+    size_t len = log_frame_encode(rec,payload,stream->seq++,sink->dropped,frame);
+    fwrite(frame,1,len,stream->out);
+    fflush(stream->out);
+}
+
+void log_sink_stream_init(log_sink_stream_t * stream, FILE * out, uint32_t types, log_level_t level)
+{
+    memset(stream,0,sizeof(*stream));
+    stream->sink.name = "pal_log_stream";
+    stream->sink.types = types;
+    stream->sink.level = level;
+    stream->sink.format = LOG_SINK_FMT_FULL;
+    stream->sink.write = log_sink_stream_write;
+    stream->out = out;
+    if(!out) stream->sink.types = 0;
+}
+
+/* Open a PROS serial stream, which has to be activated before anything written
+ * to it is sent
+ */
+FILE * log_serial_open(const char * id)
+{
+    uint32_t sid = 0;
+    char path[16];
+    if(strlen(id) != 4) return NULL;
+    memcpy(&sid,id,4);
+    if(serctl(SERCTL_ACTIVATE,(void *)(uintptr_t)sid) == PROS_ERR) return NULL;
+    sprintf(path,"/ser/%s",id);
+    FILE * f = fopen(path,"w");
+    if(!f) LOG_ERROR("Error opening serial stream (%s)",path);
+    return f;
+}
+
+/**
+ *  Smart port
+ **/
+
+/* Move what the rate and the port's write buffer allow from buf to the port,
+ * returning the ms until the rate allows the rest, or 0 once none are left
+ */
+static uint32_t log_sink_port_drain(log_sink_port_t * port)
+{
+    /* Earn credit at rate bytes a second, holding at most a buffer's worth */
+    uint32_t now = millis();
+    uint32_t dt = now - port->credit_ms;
+    if(dt > 1000) dt = 1000;
+    port->credit_ms = now;
+    port->credit += dt * port->rate;
+    if(port->credit > LOG_SINK_PORT_BUF * 1000u) port->credit = LOG_SINK_PORT_BUF * 1000u;
+
+    if(!port->len) return 0;
+    int32_t room = serial_get_write_free(port->port);
+    if(room == PROS_ERR) return LOG_SINK_IDLE_MS;
+    uint32_t n = port->len;
+    if(n > (uint32_t)room) n = room;
+    if(n > port->credit / 1000) n = port->credit / 1000;
+    if(n)
+    {
+        int32_t sent = serial_write(port->port,port->buf,n);
+        if(sent > 0)
+        {
+            memmove(port->buf,&port->buf[sent],port->len - sent);
+            port->len -= sent;
+            port->sent += sent;
+            port->credit -= sent * 1000u;
+        }
+    }
+    if(!port->len) return 0;
+
+    /* Wake once the rate allows what the port had room for, or the rest if less,
+     * not all of buf, which would leave the port idle while credit built up. The
+     * port's own buffer empties at the line rate, so it has the room again by then
+     */
+    if(!port->rate || !room) return LOG_SINK_IDLE_MS;
+    uint32_t next = port->len;
+    if(next > (uint32_t)room) next = room;
+    uint32_t owed = next * 1000u;
+    uint32_t ms = (owed > port->credit) ? (owed - port->credit + port->rate - 1) / port->rate : 0;
+    return ms ? ms : 1;
+}
+
+/* Queue the record's frame, or skip it if the port has fallen too far behind */
+static void log_sink_port_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    log_sink_port_t * port = (log_sink_port_t *)sink;
+    log_sink_port_drain(port);
+
+    uint8_t frame[LOG_FRAME_MAX];
+    size_t len = log_frame_encode(rec,payload,port->seq,sink->dropped + port->skipped,frame);
+    if(len > LOG_SINK_PORT_BUF - port->len)
+    {
+        port->skipped++;
+        return;
+    }
+    memcpy(&port->buf[port->len],frame,len);
+    port->len += len;
+    port->seq++;
+    log_sink_port_drain(port);
+}
+
+static uint32_t log_sink_port_idle(log_sink_t * sink)
+{
+    return log_sink_port_drain((log_sink_port_t *)sink);
+}
+
+int log_sink_port_init(log_sink_port_t * port, uint8_t smart_port, int32_t baud, uint32_t types, log_level_t level)
+{
+    memset(port,0,sizeof(*port));
+    port->sink.name = "pal_log_port";
+    port->sink.types = types;
+    port->sink.level = level;
+    port->sink.format = LOG_SINK_FMT_FULL;
+    port->sink.write = log_sink_port_write;
+    port->sink.idle = log_sink_port_idle;
+    port->port = smart_port;
+    port->rate = baud / 10;
+    port->credit_ms = millis();
+
+    if(serial_enable(smart_port) == PROS_ERR || serial_set_baudrate(smart_port,baud) == PROS_ERR)
+    {
+        LOG_ERROR("Error setting port %d to serial at %d baud",smart_port,(int)baud);
+        port->sink.types = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ *  Brain screen
+ **/
+
+/* Colours of the lines, by level */
+static const uint32_t screen_colors[] =
+{
+    COLOR_GRAY,         /* DEBUG */
+    COLOR_WHITE,        /* INFO */
+    COLOR_YELLOW,       /* WARN */
+    COLOR_RED,          /* ERROR */
+    COLOR_LIGHT_GREEN   /* ALWAYS */
+};
+
+/* Add the line to the ring, the idle hook draws it */
+static void log_sink_screen_write(log_sink_t * sink, const log_sink_rec_t * rec, const void * payload)
+{
+    log_sink_screen_t * screen = (log_sink_screen_t *)sink;
+    log_sink_format(sink,rec,payload,screen->lines[screen->next],LOG_SINK_SCREEN_COLS);
+    screen->levels[screen->next] = (rec->level > LOG_LEVEL_ALWAYS) ? LOG_LEVEL_ALWAYS : rec->level;
+    screen->next = (screen->next + 1) % LOG_SINK_SCREEN_LINES;
+    if(screen->added == LOG_SINK_SCREEN_LINES) screen->unseen++;
+    else screen->added++;
+}
+
+/* Redraw with the lines added, at most every period_ms, oldest line at the top */
+static uint32_t log_sink_screen_idle(log_sink_t * sink)
+{
+    log_sink_screen_t * screen = (log_sink_screen_t *)sink;
+    if(!screen->added) return 0;
+    uint32_t now = millis();
+    if(now - screen->drawn_ms < screen->period_ms) return screen->period_ms - (now - screen->drawn_ms);
+
+    screen_erase();
+    for(int i = 0; i < LOG_SINK_SCREEN_LINES; i++)
+    {
+        int line = (screen->next + i) % LOG_SINK_SCREEN_LINES;
+        screen_set_pen(screen_colors[screen->levels[line]]);
+        screen_print(E_TEXT_SMALL,i,"%s",screen->lines[line]);
+    }
+    screen->added = 0;
+    screen->drawn_ms = now;
+    return 0;
+}
+
+void log_sink_screen_init(log_sink_screen_t * screen, log_level_t level)
+{
+    memset(screen,0,sizeof(*screen));
+    screen->sink.name = "pal_log_screen";
+    screen->sink.types = LOG_SINK_TYPE(LOG_SINK_MSG);
+    screen->sink.level = level;
+    screen->sink.format = LOG_SINK_FMT_SHORT;
+    screen->sink.write = log_sink_screen_write;
+    screen->sink.idle = log_sink_screen_idle;
+    screen->period_ms = LOG_SINK_SCREEN_PERIOD_MS;
+}
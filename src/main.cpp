@@ -20,7 +20,28 @@
  * LOG_LEVEL_ALWAYS (highest)
  */
 #define LOG_LEVEL_FILE LOG_LEVEL_DEBUG
-#include "pal/log.h"
+#include "pal/log.hpp"
+#include "pal/log_ekf.hpp"
+#include "pal/log_sink.h"
+#include "pal/log_format.h"
+#include <cmath>
+
+/* Drive motors, which are sampled by the logger's poller task */
+pros::Motor left_drive(1);
+pros::Motor right_drive(2,true);
+
+/* Drive geometry for odometry: 4" wheels driven directly, 30 cm apart */
+#define WHEEL_MPS_PER_RPM (0.1016 * M_PI / 60.0)
+#define TRACK_WIDTH 0.30
+
+/* Pose estimator, stepped once per control loop */
+pal::Ekf ekf;
+
+/* Telemetry over the USB link, alongside the console, for pallog recv */
+log_sink_stream_t telemetry;
+
+/* Live chart of the drive and battery on the brain screen */
+log_sink_chart_t drive_chart;
 
 /**
  * Runs initialization code. This occurs as soon as the program is started.
@@ -30,9 +51,39 @@
  */
 void initialize() 
 {
+	/* Send the messages and data over the USB link as well as to the card. Sinks
+	 * added before log_init() start with it, so they get the first files too
+	 */
+	log_sink_stream_init(&telemetry,log_serial_open(LOG_WIRE_STREAM),LOG_SINK_ALL,LOG_LEVEL_INFO);
+	log_sink_add(&telemetry.sink);
+
+	/* Plot the drive speeds and battery voltage, a point every 50 ms of the last
+	 * 10 seconds, from the rows the logger writes
+	 */
+	log_sink_chart_init(&drive_chart,NULL,200,50);
+	log_sink_chart_plot(&drive_chart,"left_vel",-200,200,0xff0000);
+	log_sink_chart_plot(&drive_chart,"right_vel",-200,200,0x0000ff);
+	log_sink_chart_plot(&drive_chart,"BATT_VOLT",10,14,0x00ff00);
+	log_sink_add(&drive_chart.sink);
+
 	/* Initialize logger - this must be early in your initialization */
 	log_init();
 
+	/* Serve the card's files over the same link, for pallog fetch */
+	log_serve_start();
+
+	/* Register devices with the poller, which reads them from its own task
+	 * instead of the control loop. The sampled values are written by log_step()
+	 * directly after TIME, so registration must happen before the first log_step()
+	 */
+	pal::log_motor(left_drive,pal::FIELD_VEL | pal::FIELD_CUR | pal::FIELD_POS | pal::FIELD_VOLT | pal::FIELD_TEMP | pal::FIELD_TIME,"left");
+	pal::log_motor(right_drive,pal::FIELD_VEL | pal::FIELD_CUR | pal::FIELD_POS | pal::FIELD_VOLT | pal::FIELD_TEMP | pal::FIELD_TIME,"right");
+	pal::log_imu(10,pal::FIELD_STATUS | pal::FIELD_HDG | pal::FIELD_ROT | pal::FIELD_EULER | pal::FIELD_ACCEL | pal::FIELD_GYRO | pal::FIELD_QUAT);
+	pal::log_gps(11,pal::FIELD_POSITION | pal::FIELD_EULER | pal::FIELD_HDG | pal::FIELD_ROT | pal::FIELD_ACCEL | pal::FIELD_ERROR | pal::FIELD_GYRO);
+
+	/* Sample at twice the control loop rate so each row holds a fresh sample */
+	pal::log_poll(10);
+
 	/* Let them know we are in initialize */
 	LOG_ALWAYS("In Initialize");
 }
@@ -69,6 +120,51 @@ void log_batt_data()
 	log_data_dbl("BATT_TEMP",pros::battery::get_temperature());
 }
 
+/* Get the objects seen by the vision sensor, which vary in number every frame */
+void log_vision_data()
+{
+	static pros::Vision vision(12);
+	pros::vision_object_s_t objs[8];
+	int32_t count = vision.read_by_size(0,8,objs);
+	if(count == PROS_ERR) count = 0;
+	pal::log_data("vision",objs,count);
+}
+
+/* Step the pose estimator and log its state
+ * It runs on the samples the poller just logged rather than reading the sensors
+ * again, so pallog ekf replays it from the data file with the same inputs
+ */
+void log_ekf_data()
+{
+	static bool started = false;
+	static const pal::PollValue gps_x("gps11_x"), gps_y("gps11_y"), gps_hdg("gps11_hdg"), gps_error("gps11_error");
+	static const pal::PollValue gyro_z("imu10_gyro_z"), left_vel("left_vel"), right_vel("right_vel");
+	double x = gps_x, y = gps_y;
+	double theta = pal::ekf_compass_theta(gps_hdg);
+
+	/* Start from the first GPS fix, the readings are not finite until then. The
+	 * channels are logged either way, so every row has the same columns
+	 */
+	if(!started && std::isfinite(x) && std::isfinite(y) && std::isfinite(theta))
+	{
+		ekf.reset(x,y,theta);
+		started = true;
+	}
+	if(started)
+	{
+		ekf.predict();
+		ekf.update_gps(x,y,theta,gps_error);
+		ekf.update_gyro(pal::ekf_compass_rate(gyro_z));
+
+		/* Both motors report forward as positive, since the right one is reversed */
+		double vl = left_vel * WHEEL_MPS_PER_RPM;
+		double vr = right_vel * WHEEL_MPS_PER_RPM;
+		ekf.update_odometry((vl + vr) / 2.0,(vr - vl) / TRACK_WIDTH);
+	}
+
+	pal::log_data(ekf);
+}
+
 /* Get control data */
 void log_ctrl_data()
 {
@@ -202,6 +298,8 @@ void opcontrol()
 		/* Call some routines which perform robot control and log data */
 		log_comp_data();
 		log_batt_data();
+		log_vision_data();
+		log_ekf_data();
 		log_ctrl_data();
 		pros::c::task_delay_until(&prev_time,20);
 	}